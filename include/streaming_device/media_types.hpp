@@ -40,7 +40,8 @@ enum class ContainerFormat : uint8_t {
     MP4,
     MOV,
     MKV,
-    WEBM
+    WEBM,
+    RTP       /* Live RTP/UDP elementary streams (rtp:// URIs) */
 };
 
 // =============================================================================
@@ -166,10 +167,24 @@ enum class PixelFormat : uint8_t {
     BGRA8888
 };
 
+/**
+ * Opaque handle to a shareable frame buffer (dma-buf style).
+ * Lets a decoded buffer be scanned out by the display without a copy.
+ */
+struct BufferHandle {
+    int32_t fd{-1};          /* Exported buffer fd, -1 when not shareable */
+    uint64_t id{0};          /* Allocator-unique buffer id */
+    uint32_t offset{0};      /* Start of the image within the buffer */
+    uint64_t modifier{0};    /* Layout modifier (tiling/compression), 0 = linear */
+
+    bool valid() const { return fd >= 0; }
+};
+
 /** Decoded video frame */
 struct DecodedFrame {
     void* data{nullptr};
     size_t size{0};
+    BufferHandle handle;     /* Set when the frame lives in a pooled, exportable buffer */
     uint32_t width{0};
     uint32_t height{0};
     uint32_t stride{0};
@@ -178,6 +193,16 @@ struct DecodedFrame {
     HdrMetadata hdr;
 };
 
+/** Decoded PCM audio, interleaved signed 16-bit */
+struct DecodedAudio {
+    std::vector<int16_t> samples;   /* frames * channels */
+    uint32_t sample_rate{0};
+    uint32_t channels{0};
+    FrameTiming timing;
+
+    size_t frames() const { return channels ? samples.size() / channels : 0; }
+};
+
 /** Encoded packet from demuxer */
 struct EncodedPacket {
     std::vector<uint8_t> data;
@@ -109,7 +109,8 @@ enum class Result : int32_t {
     ERROR_NO_MEMORY = -7,
     ERROR_IO = -8,
     ERROR_AUTH_FAILED = -9,
-    ERROR_NETWORK = -10
+    ERROR_NETWORK = -10,
+    ERROR_END_OF_STREAM = -11
 };
 
 /** Resolution dimensions */
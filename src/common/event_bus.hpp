@@ -85,6 +85,7 @@ namespace events {
     constexpr const char* APP_LAUNCHED = "app.launched";
     constexpr const char* APP_STOPPED = "app.stopped";
     constexpr const char* WIFI_STATE = "wifi.state";
+    constexpr const char* NETWORK_QUALITY = "network.quality";
     constexpr const char* CEC_COMMAND = "cec.command";
     constexpr const char* BT_CONTROL = "bt.control";
     constexpr const char* STREAM_ERROR = "stream.error";
@@ -0,0 +1,194 @@
+/**
+ * @file memory_governor.cpp
+ * @brief MemoryGovernor implementation
+ */
+
+#include "memory_governor.hpp"
+#include "logger.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace streaming::common {
+
+namespace {
+
+void raisePeak(std::atomic<uint64_t>& peak, uint64_t value) {
+    uint64_t prev = peak.load(std::memory_order_relaxed);
+    while (value > prev && !peak.compare_exchange_weak(prev, value, std::memory_order_relaxed)) {}
+}
+
+} // namespace
+
+// -----------------------------------------------------------------------------
+// Registration
+// -----------------------------------------------------------------------------
+
+MemoryGovernor::Registration::Registration(MemoryGovernor* governor, std::shared_ptr<Pool> pool)
+    : governor_(governor), pool_(std::move(pool)) {}
+
+MemoryGovernor::Registration::~Registration() { reset(); }
+
+MemoryGovernor::Registration::Registration(Registration&& other) noexcept
+    : governor_(other.governor_), pool_(std::move(other.pool_)) {
+    other.governor_ = nullptr;
+}
+
+MemoryGovernor::Registration& MemoryGovernor::Registration::operator=(Registration&& other) noexcept {
+    if (this != &other) {
+        reset();
+        governor_ = other.governor_;
+        pool_ = std::move(other.pool_);
+        other.governor_ = nullptr;
+    }
+    return *this;
+}
+
+void MemoryGovernor::Registration::reset() {
+    if (governor_) governor_->unregisterPool(pool_);
+    governor_ = nullptr;
+    pool_.reset();
+}
+
+void MemoryGovernor::Registration::setUsage(uint64_t bytes) {
+    if (governor_) governor_->setUsage(*pool_, bytes);
+}
+
+void MemoryGovernor::Registration::setDemand(uint64_t demand_bytes, uint64_t min_bytes) {
+    if (governor_) governor_->setDemand(*pool_, demand_bytes, min_bytes);
+}
+
+uint64_t MemoryGovernor::Registration::getLimit() const {
+    return pool_ ? pool_->limit.load(std::memory_order_relaxed) : UINT64_MAX;
+}
+
+// -----------------------------------------------------------------------------
+// Governor
+// -----------------------------------------------------------------------------
+
+MemoryGovernor::MemoryGovernor(uint64_t budget_bytes) : budget_(budget_bytes) {}
+
+MemoryGovernor& MemoryGovernor::instance() {
+    static MemoryGovernor governor;
+    return governor;
+}
+
+MemoryGovernor::Registration MemoryGovernor::registerPool(const std::string& name, MemoryClass memory_class,
+                                                          uint64_t demand_bytes, uint64_t min_bytes) {
+    auto pool = std::make_shared<Pool>();
+    pool->name = name;
+    pool->memory_class = memory_class;
+    pool->demand = demand_bytes;
+    pool->min = std::min(min_bytes, demand_bytes);
+    std::lock_guard<std::mutex> lock(mutex_);
+    pools_.push_back(pool);
+    rebalanceLocked();
+    return Registration(this, pool);
+}
+
+void MemoryGovernor::unregisterPool(const std::shared_ptr<Pool>& pool) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    used_.fetch_sub(pool->used.exchange(0, std::memory_order_relaxed), std::memory_order_relaxed);
+    pools_.erase(std::remove(pools_.begin(), pools_.end(), pool), pools_.end());
+    rebalanceLocked();
+}
+
+void MemoryGovernor::setDemand(Pool& pool, uint64_t demand_bytes, uint64_t min_bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (pool.demand == demand_bytes && pool.min == std::min(min_bytes, demand_bytes)) return;
+    pool.demand = demand_bytes;
+    pool.min = std::min(min_bytes, demand_bytes);
+    rebalanceLocked();
+}
+
+void MemoryGovernor::setUsage(Pool& pool, uint64_t bytes) {
+    const uint64_t prev = pool.used.exchange(bytes, std::memory_order_relaxed);
+    raisePeak(pool.peak, bytes);
+    const uint64_t total = bytes >= prev
+        ? used_.fetch_add(bytes - prev, std::memory_order_relaxed) + (bytes - prev)
+        : used_.fetch_sub(prev - bytes, std::memory_order_relaxed) - (prev - bytes);
+    raisePeak(peak_, total);
+}
+
+void MemoryGovernor::setBudget(uint64_t budget_bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    budget_ = budget_bytes;
+    rebalanceLocked();
+}
+
+uint64_t MemoryGovernor::getBudget() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return budget_;
+}
+
+void MemoryGovernor::rebalanceLocked() {
+    /* Fixed pools come off the top; the rest share what is left */
+    uint64_t fixed = 0, wanted = 0;
+    for (const auto& p : pools_) {
+        if (p->memory_class == MemoryClass::FIXED)
+            fixed += std::max(p->demand, p->used.load(std::memory_order_relaxed));
+        else
+            wanted += p->demand;
+    }
+    const uint64_t available = budget_ > fixed ? budget_ - fixed : 0;
+    uint64_t excess = wanted > available ? wanted - available : 0;
+    const bool pressure = excess > 0;
+
+    for (const auto& p : pools_) p->limit.store(p->memory_class == MemoryClass::FIXED ? UINT64_MAX : p->demand,
+                                                std::memory_order_relaxed);
+    /* Cheapest memory first; within a class every pool gives up the same share of its slack */
+    for (MemoryClass c : {MemoryClass::READ_AHEAD, MemoryClass::QUEUE, MemoryClass::FRAMES}) {
+        if (excess == 0) break;
+        uint64_t slack = 0;
+        for (const auto& p : pools_)
+            if (p->memory_class == c) slack += p->demand - p->min;
+        if (slack == 0) continue;
+        const uint64_t take = std::min(excess, slack);
+        const double share = static_cast<double>(take) / static_cast<double>(slack);
+        for (const auto& p : pools_) {
+            if (p->memory_class != c) continue;
+            const auto cut = std::min<uint64_t>(p->demand - p->min,
+                static_cast<uint64_t>(std::ceil(static_cast<double>(p->demand - p->min) * share)));
+            p->limit.store(p->demand - cut, std::memory_order_relaxed);
+        }
+        excess -= take;
+    }
+
+    if (pressure && !under_pressure_) {
+        pressure_events_++;
+        LOG_WARN("MemoryGovernor", "Demand", wanted + fixed, "over budget", budget_, "- limiting pools");
+    } else if (!pressure && under_pressure_) {
+        LOG_INFO("MemoryGovernor", "Demand back within budget", budget_);
+    }
+    /* Only on the way in: under sustained pressure every rebalance lands here */
+    if (excess > 0 && !over_minimum_)
+        LOG_WARN("MemoryGovernor", "Pools at their minimum still exceed the budget by", excess);
+    else if (excess == 0 && over_minimum_)
+        LOG_INFO("MemoryGovernor", "Pool minimums fit the budget again");
+    over_minimum_ = excess > 0;
+    under_pressure_ = pressure;
+}
+
+MemoryGovernorStats MemoryGovernor::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    MemoryGovernorStats stats;
+    stats.budget = budget_;
+    stats.used = used_.load(std::memory_order_relaxed);
+    stats.peak = peak_.load(std::memory_order_relaxed);
+    stats.pressure_events = pressure_events_;
+    stats.under_pressure = under_pressure_;
+    for (const auto& p : pools_) {
+        MemoryPoolStats ps;
+        ps.name = p->name;
+        ps.memory_class = p->memory_class;
+        ps.used = p->used.load(std::memory_order_relaxed);
+        ps.peak = p->peak.load(std::memory_order_relaxed);
+        ps.demand = p->demand;
+        ps.min = p->min;
+        ps.limit = p->memory_class == MemoryClass::FIXED ? p->demand : p->limit.load(std::memory_order_relaxed);
+        stats.demand += p->demand;
+        stats.pools.push_back(ps);
+    }
+    return stats;
+}
+
+} // namespace streaming::common
@@ -0,0 +1,141 @@
+/**
+ * @file memory_governor.hpp
+ * @brief Device-wide memory budget shared by media buffers
+ *
+ * Every large buffer owner (framebuffers, decoder frame pools, packet
+ * queues, segment read-ahead) registers a pool with its current demand
+ * and the least it can work with. When the demands together exceed the
+ * budget the governor hands out limits below demand, shrinking the
+ * cheapest memory first: read-ahead (refetchable), then packet queues
+ * (re-demuxable), then frame pools. Fixed pools are counted but never
+ * limited. Owners read their limit where they allocate and stay under
+ * it, so the governor never calls back into them.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace streaming::common {
+
+/** What a pool's memory is for; also the shrink order, first to last */
+enum class MemoryClass : uint8_t {
+    READ_AHEAD,   /* Prefetched network data */
+    QUEUE,        /* Demuxed, not yet decoded */
+    FRAMES,       /* Decoded frame buffers */
+    FIXED,        /* Framebuffers and the like: counted, never limited */
+};
+
+/** One registered pool */
+struct MemoryPoolStats {
+    std::string name;
+    MemoryClass memory_class{MemoryClass::FIXED};
+    uint64_t used{0};            /* Bytes allocated now */
+    uint64_t peak{0};
+    uint64_t demand{0};          /* Bytes the pool would use unconstrained */
+    uint64_t min{0};             /* Floor the pool cannot work below */
+    uint64_t limit{0};           /* Granted; below demand under pressure */
+};
+
+struct MemoryGovernorStats {
+    uint64_t budget{0};
+    uint64_t used{0};            /* Sum over pools */
+    uint64_t demand{0};
+    uint64_t peak{0};            /* Highest sum of usage seen */
+    uint64_t pressure_events{0}; /* Times demand went over the budget */
+    bool under_pressure{false};
+    std::vector<MemoryPoolStats> pools;
+};
+
+/**
+ * @brief Memory budget governor
+ *
+ * Thread safe. instance() is the device-wide governor the pipeline
+ * stages register with; separate instances serve tests.
+ */
+class MemoryGovernor {
+    struct Pool;
+
+public:
+    /** Media share of a 1 GB device next to the UI and a running app */
+    static constexpr uint64_t kDefaultBudgetBytes = 256ULL << 20;
+
+    /**
+     * @brief A pool's membership; unregisters on destruction
+     *
+     * setUsage() is cheap (atomics) and may be called per allocation;
+     * setDemand() rebalances every pool's limit.
+     */
+    class Registration {
+    public:
+        Registration() = default;
+        ~Registration();
+        Registration(Registration&& other) noexcept;
+        Registration& operator=(Registration&& other) noexcept;
+        Registration(const Registration&) = delete;
+        Registration& operator=(const Registration&) = delete;
+
+        void setUsage(uint64_t bytes);
+        void setDemand(uint64_t demand_bytes, uint64_t min_bytes);
+
+        /** Bytes the pool may hold; unlimited for an empty registration */
+        uint64_t getLimit() const;
+
+        bool valid() const { return governor_ != nullptr; }
+
+    private:
+        friend class MemoryGovernor;
+        Registration(MemoryGovernor* governor, std::shared_ptr<Pool> pool);
+        void reset();
+
+        MemoryGovernor* governor_{nullptr};
+        std::shared_ptr<Pool> pool_;
+    };
+
+    explicit MemoryGovernor(uint64_t budget_bytes = kDefaultBudgetBytes);
+
+    MemoryGovernor(const MemoryGovernor&) = delete;
+    MemoryGovernor& operator=(const MemoryGovernor&) = delete;
+
+    static MemoryGovernor& instance();
+
+    Registration registerPool(const std::string& name, MemoryClass memory_class,
+                              uint64_t demand_bytes = 0, uint64_t min_bytes = 0);
+
+    void setBudget(uint64_t budget_bytes);
+    uint64_t getBudget() const;
+
+    MemoryGovernorStats getStats() const;
+
+private:
+    struct Pool {
+        std::string name;
+        MemoryClass memory_class{MemoryClass::FIXED};
+        uint64_t demand{0};      /* Under the governor lock */
+        uint64_t min{0};
+        std::atomic<uint64_t> used{0};
+        std::atomic<uint64_t> peak{0};
+        std::atomic<uint64_t> limit{UINT64_MAX};
+    };
+
+    void unregisterPool(const std::shared_ptr<Pool>& pool);
+    void setDemand(Pool& pool, uint64_t demand_bytes, uint64_t min_bytes);
+    void setUsage(Pool& pool, uint64_t bytes);
+    void rebalanceLocked();
+
+    mutable std::mutex mutex_;
+    uint64_t budget_;
+    std::vector<std::shared_ptr<Pool>> pools_;
+    std::atomic<uint64_t> used_{0};
+    std::atomic<uint64_t> peak_{0};
+    uint64_t pressure_events_{0};
+    bool under_pressure_{false};
+    bool over_minimum_{false};     /* Even the pool minimums exceed the budget */
+};
+
+} // namespace streaming::common
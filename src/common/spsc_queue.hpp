@@ -0,0 +1,103 @@
+/**
+ * @file spsc_queue.hpp
+ * @brief Bounded lock-free single-producer/single-consumer queue
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace streaming::common {
+
+/** Destructive interference size used to pad hot atomics apart */
+constexpr size_t kCacheLineSize = 64;
+
+/**
+ * @brief Bounded SPSC ring queue
+ *
+ * Wait-free for exactly one producer thread and one consumer thread.
+ * Capacity is rounded up to a power of two. Head and tail live on separate
+ * cache lines, and each side caches the other's index so the common case
+ * touches no shared line. Callers implement blocking/back-pressure on top
+ * of tryPush/tryPop.
+ */
+template<typename T>
+class SpscQueue {
+public:
+    explicit SpscQueue(size_t capacity)
+        : capacity_(roundUpPow2(capacity < 2 ? 2 : capacity))
+        , mask_(capacity_ - 1)
+        , slots_(new T[capacity_]) {}
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    /** Producer: enqueue, returns false when full */
+    bool tryPush(T&& item) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_cache_ == capacity_) {
+            head_cache_ = head_.load(std::memory_order_acquire);
+            if (tail - head_cache_ == capacity_) return false;
+        }
+        slots_[tail & mask_] = std::move(item);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPush(const T& item) {
+        T copy(item);
+        return tryPush(std::move(copy));
+    }
+
+    /** Consumer: dequeue, returns false when empty */
+    bool tryPop(T& out) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_cache_) {
+            tail_cache_ = tail_.load(std::memory_order_acquire);
+            if (head == tail_cache_) return false;
+        }
+        out = std::move(slots_[head & mask_]);
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /** Consumer: peek at the oldest element without removing it (nullptr if empty) */
+    T* front() {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_cache_) {
+            tail_cache_ = tail_.load(std::memory_order_acquire);
+            if (head == tail_cache_) return nullptr;
+        }
+        return &slots_[head & mask_];
+    }
+
+    /** Approximate element count (exact when both sides are quiescent) */
+    size_t size() const {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+
+    bool empty() const { return size() == 0; }
+    bool full() const { return size() >= capacity_; }
+    size_t capacity() const { return capacity_; }
+
+private:
+    static size_t roundUpPow2(size_t v) {
+        size_t p = 1;
+        while (p < v) p <<= 1;
+        return p;
+    }
+
+    const size_t capacity_;
+    const size_t mask_;
+    std::unique_ptr<T[]> slots_;
+
+    alignas(kCacheLineSize) std::atomic<size_t> head_{0};   /* Written by consumer */
+    size_t tail_cache_{0};                                  /* Consumer's view of tail */
+    alignas(kCacheLineSize) std::atomic<size_t> tail_{0};   /* Written by producer */
+    size_t head_cache_{0};                                  /* Producer's view of head */
+};
+
+} // namespace streaming::common
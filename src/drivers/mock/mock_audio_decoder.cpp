@@ -0,0 +1,63 @@
+#include "mock_audio_decoder.hpp"
+#include <cmath>
+
+namespace streaming::drivers::mock {
+
+static uint32_t samplesPerFrame(media::AudioCodec codec) {
+    switch (codec) {
+        case media::AudioCodec::AC3:
+        case media::AudioCodec::EAC3: return 1536;
+        default: return 1024;
+    }
+}
+
+device::Result MockAudioDecoder::initialize(media::AudioCodec codec,
+                                            const media::AudioTrackInfo& track_info) {
+    if (!supports(codec) || track_info.sample_rate == 0 || track_info.channels == 0)
+        return device::Result::ERROR_INVALID_PARAM;
+    codec_ = codec;
+    track_info_ = track_info;
+    last_error_ = media::DecodeError::NONE;
+    phase_ = 0;
+    return device::Result::OK;
+}
+
+device::Result MockAudioDecoder::shutdown() { return device::Result::OK; }
+
+hal::AudioDecodeResult MockAudioDecoder::decode(const media::EncodedPacket& packet) {
+    hal::AudioDecodeResult result;
+    result.frame_ready = !packet.data.empty();
+    if (!result.frame_ready) return result;
+
+    const uint32_t frames = samplesPerFrame(codec_);
+    const uint32_t channels = track_info_.channels;
+    result.pcm.sample_rate = track_info_.sample_rate;
+    result.pcm.channels = channels;
+    result.pcm.timing = packet.timing;
+    result.pcm.timing.duration_us = static_cast<int64_t>(frames) * 1000000 / track_info_.sample_rate;
+    result.pcm.samples.resize(static_cast<size_t>(frames) * channels);
+
+    const double step = 2.0 * M_PI * 1000.0 / track_info_.sample_rate;
+    for (uint32_t i = 0; i < frames; ++i, ++phase_) {
+        const auto v = static_cast<int16_t>(8192.0 * std::sin(step * static_cast<double>(phase_)));
+        for (uint32_t ch = 0; ch < channels; ++ch) result.pcm.samples[i * channels + ch] = v;
+    }
+    return result;
+}
+
+device::Result MockAudioDecoder::flush() {
+    phase_ = 0;
+    return device::Result::OK;
+}
+
+device::Result MockAudioDecoder::reset() { return flush(); }
+
+media::DecodeError MockAudioDecoder::getError() const { return last_error_; }
+
+bool MockAudioDecoder::supports(media::AudioCodec codec) const {
+    return codec == media::AudioCodec::AAC ||
+           codec == media::AudioCodec::AC3 ||
+           codec == media::AudioCodec::EAC3;
+}
+
+} // namespace streaming::drivers::mock
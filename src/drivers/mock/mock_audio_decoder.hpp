@@ -0,0 +1,26 @@
+#pragma once
+
+#include "../../hal/audio_decoder_hal.hpp"
+
+namespace streaming::drivers::mock {
+
+/** Mock audio decoder: emits a 1 kHz tone per packet at the track format */
+class MockAudioDecoder : public hal::IAudioDecoder {
+public:
+    device::Result initialize(media::AudioCodec codec,
+                              const media::AudioTrackInfo& track_info) override;
+    device::Result shutdown() override;
+    hal::AudioDecodeResult decode(const media::EncodedPacket& packet) override;
+    device::Result flush() override;
+    device::Result reset() override;
+    media::DecodeError getError() const override;
+    bool supports(media::AudioCodec codec) const override;
+
+private:
+    media::AudioCodec codec_{media::AudioCodec::UNKNOWN};
+    media::AudioTrackInfo track_info_;
+    media::DecodeError last_error_{media::DecodeError::NONE};
+    uint64_t phase_{0};   /* Samples generated, keeps the tone continuous */
+};
+
+} // namespace streaming::drivers::mock
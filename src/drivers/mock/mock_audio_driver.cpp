@@ -1,17 +1,151 @@
 #include "mock_audio_driver.hpp"
+#include <chrono>
+#include <thread>
 
 namespace streaming::drivers::mock {
 
+static int64_t nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static uint32_t bytesPerFrame(const hal::AudioBuffer& buffer) {
+    switch (buffer.format) {
+        case hal::AudioFormat::PCM_16BIT_STEREO: return 4;
+        case hal::AudioFormat::PCM_24BIT_STEREO: return 6;
+        case hal::AudioFormat::PCM_16BIT_MULTICHANNEL: return 2 * buffer.channels;
+        case hal::AudioFormat::AC3:
+        case hal::AudioFormat::EAC3: return 4;   /* IEC 61937 in stereo 16-bit slots */
+        default: return 0;  /* Compressed: duration unknown to the mock */
+    }
+}
+
 device::Result MockAudioDriver::initialize() { return device::Result::OK; }
-device::Result MockAudioDriver::shutdown() { return device::Result::OK; }
+device::Result MockAudioDriver::shutdown() { return stop(); }
 
 device::Result MockAudioDriver::setSink(hal::AudioSink sink) {
     sink_ = sink;
     return device::Result::OK;
 }
 
-device::Result MockAudioDriver::play(const hal::AudioBuffer&) { return device::Result::OK; }
-device::Result MockAudioDriver::stop() { return device::Result::OK; }
+hal::AudioSink MockAudioDriver::getSink() const { return sink_; }
+
+hal::AudioSinkCapabilities MockAudioDriver::getSinkCapabilities(hal::AudioSink sink) const {
+    hal::AudioSinkCapabilities caps;
+    if (sink == hal::AudioSink::HDMI) {
+        /* Typical AVR/TV EDID: 8-channel LPCM up to 192 kHz, AC3 and E-AC3 */
+        caps.sample_rates = {32000, 44100, 48000, 88200, 96000, 176400, 192000};
+        caps.max_channels = 8;
+        caps.ac3_passthrough = true;
+        caps.eac3_passthrough = true;
+    } else {
+        /* A2DP SBC link as negotiated by the mock Bluetooth stack */
+        caps.sample_rates = {48000};
+        caps.max_channels = 2;
+    }
+    return caps;
+}
+
+int64_t MockAudioDriver::getOutputLatencyUs(hal::AudioSink sink) const {
+    return sink == hal::AudioSink::HDMI ? hdmi_latency_us_.load() : a2dp_latency_us_.load();
+}
+
+void MockAudioDriver::setOutputLatencyUs(hal::AudioSink sink, int64_t latency_us) {
+    (sink == hal::AudioSink::HDMI ? hdmi_latency_us_ : a2dp_latency_us_).store(latency_us);
+}
+
+int64_t MockAudioDriver::outputNow() const { return paused_ ? paused_at_us_ : nowUs(); }
+
+device::Result MockAudioDriver::play(const hal::AudioBuffer& buffer) {
+    const uint32_t bpf = bytesPerFrame(buffer);
+    const bool bitstream = buffer.format == hal::AudioFormat::AC3 || buffer.format == hal::AudioFormat::EAC3;
+    if (bitstream && sink_ != hal::AudioSink::HDMI) return device::Result::ERROR_NOT_SUPPORTED;
+    std::unique_lock<std::mutex> lock(mutex_);
+    play_calls_++;
+    bytes_played_ += buffer.size;
+    if (buffer.pts_us < 0 || bpf == 0 || buffer.sample_rate_hz == 0) return device::Result::OK;
+
+    /* Block like a full hardware FIFO until the queued audio drains below kFifoUs */
+    const uint64_t generation = generation_;
+    for (;;) {
+        const int64_t now = outputNow();
+        retire(now);
+        const int64_t queued = segments_.empty()
+            ? 0 : segments_.back().start_us + segments_.back().duration_us - now;
+        if (queued < kFifoUs) break;
+        lock.unlock();
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        lock.lock();
+        if (generation != generation_) return device::Result::OK;  /* Flushed while waiting */
+    }
+
+    const int64_t now = outputNow();
+    Segment seg;
+    seg.pts_us = buffer.pts_us;
+    seg.duration_us = static_cast<int64_t>(buffer.size / bpf) * 1000000 / buffer.sample_rate_hz;
+    /* Back to back with the previous buffer, or now if the output ran dry */
+    seg.start_us = segments_.empty() ? now
+                                     : segments_.back().start_us + segments_.back().duration_us;
+    segments_.push_back(seg);
+    return device::Result::OK;
+}
+
+device::Result MockAudioDriver::setPaused(bool paused) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (paused == paused_) return device::Result::OK;
+    const int64_t now = nowUs();
+    if (paused) {
+        paused_at_us_ = now;
+    } else {
+        /* Queued audio resumes exactly where it stopped */
+        for (auto& seg : segments_) seg.start_us += now - paused_at_us_;
+    }
+    paused_ = paused;
+    return device::Result::OK;
+}
+
+device::Result MockAudioDriver::stop() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    segments_.clear();
+    last_pts_us_ = -1;
+    generation_++;
+    return device::Result::OK;
+}
+
+void MockAudioDriver::retire(int64_t now_us) const {
+    while (!segments_.empty() &&
+           segments_.front().start_us + segments_.front().duration_us <= now_us) {
+        const Segment& s = segments_.front();
+        last_pts_us_ = s.pts_us + s.duration_us;
+        segments_.pop_front();
+    }
+}
+
+device::Result MockAudioDriver::getRenderPosition(hal::AudioRenderPosition& out) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const int64_t now = outputNow();
+    retire(now);
+    out.timestamp_us = nowUs();
+    if (!segments_.empty() && segments_.front().start_us <= now) {
+        out.pts_us = segments_.front().pts_us + (now - segments_.front().start_us);
+        return device::Result::OK;
+    }
+    if (last_pts_us_ >= 0) {
+        out.pts_us = last_pts_us_;  /* Underrun: position holds at the last sample */
+        return device::Result::OK;
+    }
+    return device::Result::ERROR_NOT_FOUND;
+}
+
+uint64_t MockAudioDriver::getBytesPlayed() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bytes_played_;
+}
+
+uint64_t MockAudioDriver::getPlayCalls() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return play_calls_;
+}
 
 device::Result MockAudioDriver::setVolume(uint8_t percent) {
     volume_ = percent;
@@ -1,23 +1,67 @@
 #pragma once
 
 #include "../../hal/audio_hal.hpp"
+#include <atomic>
+#include <deque>
+#include <mutex>
 
 namespace streaming::drivers::mock {
 
+/**
+ * Mock audio output. Timed buffers are "rendered" back to back in real
+ * time at their sample rate, so getRenderPosition() behaves like a DAC
+ * and play() blocks like a hardware FIFO once kFifoUs is queued.
+ */
 class MockAudioDriver : public hal::IAudioHal {
 public:
+    static constexpr int64_t kFifoUs = 200000;
+    static constexpr int64_t kHdmiLatencyUs = 20000;    /* TV/AVR audio path */
+    static constexpr int64_t kA2dpLatencyUs = 200000;   /* SBC encode + radio + headset buffer */
+
     device::Result initialize() override;
     device::Result shutdown() override;
     device::Result setSink(hal::AudioSink sink) override;
+    hal::AudioSink getSink() const override;
+    hal::AudioSinkCapabilities getSinkCapabilities(hal::AudioSink sink) const override;
+    int64_t getOutputLatencyUs(hal::AudioSink sink) const override;
     device::Result play(const hal::AudioBuffer& buffer) override;
+    device::Result setPaused(bool paused) override;
     device::Result stop() override;
+    device::Result getRenderPosition(hal::AudioRenderPosition& out) const override;
     device::Result setVolume(uint8_t percent) override;
     uint8_t getVolume() const override;
     device::Result setMute(bool mute) override;
     bool isMuted() const override;
 
+    /** Test helper: total bytes and play() calls accepted */
+    uint64_t getBytesPlayed() const;
+    uint64_t getPlayCalls() const;
+
+    /** Test helper: override the latency reported for a sink */
+    void setOutputLatencyUs(hal::AudioSink sink, int64_t latency_us);
+
 private:
-    hal::AudioSink sink_{hal::AudioSink::HDMI};
+    struct Segment {
+        int64_t pts_us;
+        int64_t start_us;     /* Output time of the first sample */
+        int64_t duration_us;
+    };
+
+    /** Output time: wall clock, frozen while paused */
+    int64_t outputNow() const;
+    void retire(int64_t now_us) const;
+
+    mutable std::mutex mutex_;
+    mutable std::deque<Segment> segments_;
+    mutable int64_t last_pts_us_{-1};   /* End of the most recently retired segment */
+    bool paused_{false};
+    int64_t paused_at_us_{0};
+    uint64_t generation_{0};             /* Bumped by stop() to abort blocked play() */
+    uint64_t bytes_played_{0};
+    uint64_t play_calls_{0};
+    std::atomic<hal::AudioSink> sink_{hal::AudioSink::HDMI};
+    std::atomic<int64_t> hdmi_latency_us_{kHdmiLatencyUs};
+    std::atomic<int64_t> a2dp_latency_us_{kA2dpLatencyUs};
     uint8_t volume_{80};
     bool muted_{false};
 };
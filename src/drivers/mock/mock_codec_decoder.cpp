@@ -28,6 +28,11 @@ hal::DecodeResult MockCodecDecoder::decodeFrame(const media::EncodedPacket& pack
         result.frame.timing = packet.timing;
         result.frame.hdr = track_info_.hdr;
         result.frame.size = result.frame.width * result.frame.height * 4;
+        if (output_pool_ &&
+            output_pool_->acquire(result.frame.size, result.frame) != device::Result::OK) {
+            result.status = device::Result::ERROR_BUSY;
+            result.frame_ready = false;
+        }
     }
     return result;
 }
@@ -68,4 +73,8 @@ bool MockCodecDecoder::supports(media::VideoCodec codec) const {
     }
 }
 
+void MockCodecDecoder::setOutputPool(std::shared_ptr<hal::IFrameBufferPool> pool) {
+    output_pool_ = std::move(pool);
+}
+
 } // namespace streaming::drivers::mock
@@ -19,12 +19,14 @@ public:
     media::DecodeError getError() const override;
     void setHardwareAcceleration(bool enabled) override;
     bool supports(media::VideoCodec codec) const override;
+    void setOutputPool(std::shared_ptr<hal::IFrameBufferPool> pool) override;
 
 private:
     media::VideoCodec codec_{media::VideoCodec::UNKNOWN};
     media::VideoTrackInfo track_info_;
     media::DecodeError last_error_{media::DecodeError::NONE};
     bool hw_accel_{false};
+    std::shared_ptr<hal::IFrameBufferPool> output_pool_;
 };
 
 } // namespace streaming::drivers::mock
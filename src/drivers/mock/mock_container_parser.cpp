@@ -1,4 +1,9 @@
 #include "mock_container_parser.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <mutex>
 
 namespace streaming::drivers::mock {
 
@@ -10,44 +15,309 @@ static media::ContainerFormat detectFormat(const std::string& path) {
     return media::ContainerFormat::MP4;  /* default for testing */
 }
 
+/* Synthetic stream layout: 24p video, 48 kHz audio. AAC frames carry 1024
+ * samples; AC3/E-AC3 streams carry 5.1 Dolby syncframes of 1536 samples. */
+static constexpr uint32_t kFrameRateNum = 24;
+static constexpr uint32_t kFrameRateDen = 1;
+static constexpr uint32_t kAudioSampleRate = 48000;
+
+/* setStream() registrations, shared by every parser instance */
+static std::mutex g_streams_mutex;
+static std::map<std::string, MockStreamConfig> g_streams;
+
+static MockStreamConfig streamFor(const std::string& path) {
+    std::lock_guard<std::mutex> lock(g_streams_mutex);
+    auto it = g_streams.find(path);
+    return it != g_streams.end() ? it->second : MockStreamConfig{};
+}
+
+void MockContainerParser::setStream(const std::string& path, const MockStreamConfig& config) {
+    std::lock_guard<std::mutex> lock(g_streams_mutex);
+    g_streams[path] = config;
+}
+
+void MockContainerParser::clearStreams() {
+    std::lock_guard<std::mutex> lock(g_streams_mutex);
+    g_streams.clear();
+}
+
+/* The mock's init segment: a line of text standing in for moov/tkhd */
+static constexpr const char* kInitFormat = "mock-init %ux%u";
+
+std::vector<uint8_t> MockContainerParser::makeInitSegment(uint32_t width, uint32_t height) {
+    char text[64];
+    const int n = std::snprintf(text, sizeof(text), kInitFormat, width, height);
+    return std::vector<uint8_t>(text, text + n);
+}
+
+/* A syncframe with a valid header and silent payload */
+static std::vector<uint8_t> makeAudioFrame(media::AudioCodec codec) {
+    std::vector<uint8_t> frame;
+    if (codec == media::AudioCodec::AC3) {
+        frame.assign(1536, 0);                  /* 384 kbit/s at 48 kHz */
+        frame[0] = 0x0B;
+        frame[1] = 0x77;
+        frame[4] = 28;                          /* fscod 48 kHz, frmsizecod 384 kbit/s */
+        frame[5] = 8 << 3;                      /* bsid 8, bsmod 0 */
+        frame[6] = (7 << 5) | 0x01;             /* acmod 3/2, lfeon */
+    } else if (codec == media::AudioCodec::EAC3) {
+        const uint16_t frmsiz = 2560 / 2 - 1;   /* 640 kbit/s, six blocks */
+        frame.assign(2560, 0);
+        frame[0] = 0x0B;
+        frame[1] = 0x77;
+        frame[2] = static_cast<uint8_t>(frmsiz >> 8);
+        frame[3] = static_cast<uint8_t>(frmsiz & 0xFF);
+        frame[4] = (3 << 4) | (7 << 1) | 0x01;  /* 48 kHz, numblkscod 3, acmod 3/2, lfeon */
+        frame[5] = 16 << 3;                     /* bsid 16 */
+    } else {
+        frame.assign(384, 0);
+    }
+    return frame;
+}
+
 device::Result MockContainerParser::openContainer(const std::string& path_or_uri) {
+    const MockStreamConfig config = streamFor(path_or_uri);
     format_ = detectFormat(path_or_uri);
     open_ = true;
-    duration_us_ = 120000000;  /* 2 minutes */
+    duration_us_ = config.duration_us;
+    next_video_ = 0;
+    next_audio_ = 0;
+    stall_ = config.stall;
+    stall_until_us_ = 0;
+    dropAppended();
+    appended_ = false;
+    tracks_.clear();
+    audio_codec_ = config.audio_codec;
+    audio_frame_samples_ = audio_codec_ == media::AudioCodec::AAC ? 1024 : 1536;
+    audio_frame_ = makeAudioFrame(audio_codec_);
 
     media::TrackMetadata video;
     video.type = media::TrackType::VIDEO;
-    video.track_id = 1;
+    video.track_id = kVideoTrackId;
     video.duration_us = duration_us_;
     video.video.codec = media::VideoCodec::H265_HEVC;
     video.video.width = 1920;
     video.video.height = 1080;
-    video.video.frame_rate_num = 24;
-    video.video.frame_rate_den = 1;
+    video.video.frame_rate_num = kFrameRateNum;
+    video.video.frame_rate_den = kFrameRateDen;
     tracks_.push_back(video);
 
     media::TrackMetadata audio;
     audio.type = media::TrackType::AUDIO;
-    audio.track_id = 2;
+    audio.track_id = kAudioTrackId;
     audio.duration_us = duration_us_;
-    audio.audio.codec = media::AudioCodec::AAC;
-    audio.audio.sample_rate = 48000;
-    audio.audio.channels = 2;
+    audio.audio.codec = audio_codec_;
+    audio.audio.sample_rate = kAudioSampleRate;
+    audio.audio.channels = audio_codec_ == media::AudioCodec::AAC ? 2 : 6;
     tracks_.push_back(audio);
 
     return device::Result::OK;
 }
 
+int64_t MockContainerParser::videoPts(uint64_t index) const {
+    return static_cast<int64_t>(index * 1000000ULL * kFrameRateDen / kFrameRateNum);
+}
+
+int64_t MockContainerParser::audioPts(uint64_t index) const {
+    return static_cast<int64_t>(index * 1000000ULL * audio_frame_samples_ / kAudioSampleRate);
+}
+
+uint64_t MockContainerParser::videoIndexAt(int64_t pts_us) const {
+    if (pts_us <= 0) return 0;
+    const uint64_t den = 1000000ULL * kFrameRateDen;
+    return (static_cast<uint64_t>(pts_us) * kFrameRateNum + den - 1) / den;
+}
+
+uint64_t MockContainerParser::audioIndexAt(int64_t pts_us) const {
+    if (pts_us <= 0) return 0;
+    const uint64_t den = 1000000ULL * audio_frame_samples_;
+    return (static_cast<uint64_t>(pts_us) * kAudioSampleRate + den - 1) / den;
+}
+
 device::Result MockContainerParser::readPacket(media::EncodedPacket& packet_out) {
-    if (!open_ || packet_queue_.empty()) return device::Result::ERROR_TIMEOUT;
-    packet_out = packet_queue_.front();
-    packet_queue_.pop();
+    if (!open_) return device::Result::ERROR_TIMEOUT;
+    if (!packet_queue_.empty()) {
+        packet_out = packet_queue_.front();
+        packet_queue_.pop();
+        return device::Result::OK;
+    }
+    if (appended_) return readAppended(packet_out);
+
+    /* Interleave synthesized video and audio in timestamp order */
+    const int64_t vpts = videoPts(next_video_);
+    const int64_t apts = audioPts(next_audio_);
+    if (vpts >= duration_us_ && apts >= duration_us_) return device::Result::ERROR_END_OF_STREAM;
+    if (stall_ && std::min(vpts, apts) >= kStallAtUs) {
+        const int64_t now = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+        if (stall_until_us_ == 0) stall_until_us_ = now + kStallUs;
+        if (now < stall_until_us_) return device::Result::ERROR_TIMEOUT;
+    }
+
+    packet_out = {};
+    if (vpts <= apts) {
+        packet_out.track_id = kVideoTrackId;
+        packet_out.is_keyframe = (next_video_ % framesPerGop()) == 0;
+        packet_out.timing.pts = vpts;
+        packet_out.timing.dts = vpts;
+        packet_out.timing.duration_us = videoPts(next_video_ + 1) - vpts;
+        packet_out.data.assign(packet_out.is_keyframe ? 60000 : 12000, 0);
+        ++next_video_;
+    } else {
+        packet_out.track_id = kAudioTrackId;
+        packet_out.is_keyframe = true;
+        packet_out.timing.pts = apts;
+        packet_out.timing.dts = apts;
+        packet_out.timing.duration_us = audioPts(next_audio_ + 1) - apts;
+        packet_out.data = audio_frame_;
+        ++next_audio_;
+    }
     return device::Result::OK;
 }
 
+device::Result MockContainerParser::appendSegment(const hal::ContainerSegment& segment) {
+    if (!open_) return device::Result::ERROR_TIMEOUT;
+    if (!segment.init && segment.duration_us <= 0) return device::Result::ERROR_INVALID_PARAM;
+    appended_ = true;
+
+    Appended a;
+    a.init = segment.init;
+    a.start_us = segment.start_us;
+    a.end_us = segment.start_us + segment.duration_us;
+    if (segment.init) {
+        /* Anything else is an init segment the mock cannot read: the tracks stay */
+        const std::string text(segment.data.begin(), segment.data.begin() +
+                               static_cast<std::ptrdiff_t>(std::min<size_t>(segment.data.size(), 63)));
+        if (segment.video && std::sscanf(text.c_str(), kInitFormat, &a.width, &a.height) == 2 &&
+            a.width > 0 && a.height > 0)
+            appended_video_.push_back(std::move(a));
+        return device::Result::OK;
+    }
+    if (segment.audio) appended_audio_.push_back(a);
+    if (segment.video) {
+        a.data = segment.data;
+        appended_video_.push_back(std::move(a));
+    }
+    return device::Result::OK;
+}
+
+bool MockContainerParser::nextAppendedVideo() {
+    while (!appended_video_.empty()) {
+        Appended& a = appended_video_.front();
+        if (a.init) {
+            for (auto& t : tracks_) {
+                if (t.type != media::TrackType::VIDEO) continue;
+                t.video.width = a.width;
+                t.video.height = a.height;
+            }
+        } else {
+            if (!a.entered) next_video_ = videoIndexAt(a.start_us);
+            a.entered = true;
+            if (videoPts(next_video_) < a.end_us) return true;
+        }
+        appended_video_.pop_front();
+    }
+    return false;
+}
+
+bool MockContainerParser::nextAppendedAudio() {
+    while (!appended_audio_.empty()) {
+        Appended& a = appended_audio_.front();
+        if (!a.entered) next_audio_ = audioIndexAt(a.start_us);
+        a.entered = true;
+        if (audioPts(next_audio_) < a.end_us) return true;
+        appended_audio_.pop_front();
+    }
+    return false;
+}
+
+device::Result MockContainerParser::readAppended(media::EncodedPacket& packet_out) {
+    const bool video = nextAppendedVideo();
+    const bool audio = nextAppendedAudio();
+    if (!video && !audio) return device::Result::ERROR_TIMEOUT;
+    const int64_t vpts = videoPts(next_video_);
+    const int64_t apts = audioPts(next_audio_);
+
+    packet_out = {};
+    if (video && (!audio || vpts <= apts)) {
+        /* Segments start on a keyframe; the payload is this frame's share of the segment */
+        const Appended& a = appended_video_.front();
+        const uint64_t first = videoIndexAt(a.start_us);
+        const uint64_t frames = std::max<uint64_t>(videoIndexAt(a.end_us) - first, 1);
+        const uint64_t k = next_video_ - first;
+        const size_t size = a.data.size();
+        const size_t begin = std::min<size_t>(k * size / frames, size);
+        const size_t end = std::min<size_t>((k + 1) * size / frames, size);
+        packet_out.track_id = kVideoTrackId;
+        packet_out.is_keyframe = k == 0 || next_video_ % framesPerGop() == 0;
+        packet_out.timing.pts = vpts;
+        packet_out.timing.dts = vpts;
+        packet_out.timing.duration_us = videoPts(next_video_ + 1) - vpts;
+        if (end > begin) packet_out.data.assign(a.data.begin() + begin, a.data.begin() + end);
+        else packet_out.data.assign(1, size > 0 ? a.data[size - 1] : 0);
+        ++next_video_;
+    } else {
+        packet_out.track_id = kAudioTrackId;
+        packet_out.is_keyframe = true;
+        packet_out.timing.pts = apts;
+        packet_out.timing.dts = apts;
+        packet_out.timing.duration_us = audioPts(next_audio_ + 1) - apts;
+        packet_out.data = audio_frame_;
+        ++next_audio_;
+    }
+    return device::Result::OK;
+}
+
+void MockContainerParser::dropAppended() {
+    appended_video_.clear();
+    appended_audio_.clear();
+}
+
 device::Result MockContainerParser::seek(int64_t timestamp_us) {
+    if (appended_) {
+        /* The segments for the new position are appended next */
+        while (!packet_queue_.empty()) packet_queue_.pop();
+        dropAppended();
+        return device::Result::OK;
+    }
+    if (timestamp_us < 0 || timestamp_us > duration_us_) return device::Result::ERROR_INVALID_PARAM;
     seek_pts_ = timestamp_us;
     while (!packet_queue_.empty()) packet_queue_.pop();
+
+    /* Like a real demuxer, land on the keyframe at or before the target */
+    const int64_t keyframe_pts = (timestamp_us / kKeyframeIntervalUs) * kKeyframeIntervalUs;
+    next_video_ = static_cast<uint64_t>(keyframe_pts) * kFrameRateNum / (1000000ULL * kFrameRateDen);
+    next_audio_ = static_cast<uint64_t>(keyframe_pts) * kAudioSampleRate / (1000000ULL * audio_frame_samples_);
+    return device::Result::OK;
+}
+
+uint64_t MockContainerParser::framesPerGop() const {
+    return kKeyframeIntervalUs * kFrameRateNum / (1000000ULL * kFrameRateDen);
+}
+
+device::Result MockContainerParser::readKeyframe(int64_t from_us, bool forward,
+                                                 media::EncodedPacket& packet_out) {
+    if (!open_) return device::Result::ERROR_TIMEOUT;
+
+    /* The sync-sample index is every kKeyframeIntervalUs */
+    int64_t index;
+    if (forward) {
+        index = from_us < 0 ? 0 : from_us / kKeyframeIntervalUs + 1;
+    } else {
+        if (from_us <= 0) return device::Result::ERROR_END_OF_STREAM;
+        index = (from_us - 1) / kKeyframeIntervalUs;
+    }
+    const uint64_t frame = static_cast<uint64_t>(index) * framesPerGop();
+    const int64_t pts = videoPts(frame);
+    if (pts >= duration_us_) return device::Result::ERROR_END_OF_STREAM;
+
+    packet_out = {};
+    packet_out.track_id = kVideoTrackId;
+    packet_out.is_keyframe = true;
+    packet_out.timing.pts = pts;
+    packet_out.timing.dts = pts;
+    packet_out.timing.duration_us = videoPts(frame + 1) - pts;
+    packet_out.data.assign(60000, 0);
     return device::Result::OK;
 }
 
@@ -84,6 +354,8 @@ int64_t MockContainerParser::getDurationUs() const { return duration_us_; }
 
 device::Result MockContainerParser::closeContainer() {
     open_ = false;
+    appended_ = false;
+    dropAppended();
     while (!packet_queue_.empty()) packet_queue_.pop();
     return device::Result::OK;
 }
@@ -98,4 +370,9 @@ void MockContainerParser::injectPacket(const media::EncodedPacket& packet) {
     packet_queue_.push(packet);
 }
 
+void MockContainerParser::setDurationUs(int64_t duration_us) {
+    duration_us_ = duration_us;
+    for (auto& t : tracks_) t.duration_us = duration_us;
+}
+
 } // namespace streaming::drivers::mock
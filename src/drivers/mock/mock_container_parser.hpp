@@ -1,18 +1,41 @@
 #pragma once
 
 #include "../../hal/container_hal.hpp"
+#include <deque>
 #include <queue>
+#include <string>
 #include <vector>
 
 namespace streaming::drivers::mock {
 
-/** Mock container parser for MP4, MOV, MKV - unit testing */
+/** Layout of a synthesized stream (MockContainerParser::setStream) */
+struct MockStreamConfig {
+    int64_t duration_us{120000000};                          /* 2 minutes */
+    media::AudioCodec audio_codec{media::AudioCodec::AAC};   /* AAC stereo, or 5.1 AC3 / E-AC3 */
+    bool stall{false};   /* Runs dry for kStallUs of wall time once it reaches kStallAtUs */
+};
+
+/**
+ * Mock container parser for MP4, MOV, MKV - unit testing.
+ * Synthesizes an interleaved 24p HEVC + audio stream with a keyframe
+ * every two seconds; injected packets are delivered first. What is
+ * synthesized for a path is set up front with setStream(), since the
+ * pipelines create their parsers themselves; other paths get the default
+ * MockStreamConfig. A stall looks like a network outage: reads return
+ * ERROR_TIMEOUT until it is over. Appended segments are demuxed instead:
+ * their frames, each starting on a keyframe, cover the segment's time
+ * range, video payloads are cut from the segment bytes, and an init
+ * segment from makeInitSegment() resizes the video track.
+ */
 class MockContainerParser : public hal::IContainerParser {
 public:
     device::Result openContainer(const std::string& path_or_uri) override;
     device::Result readPacket(media::EncodedPacket& packet_out) override;
     device::Result seek(int64_t timestamp_us) override;
     device::Result seekToByte(uint64_t offset) override;
+    device::Result readKeyframe(int64_t from_us, bool forward,
+                                media::EncodedPacket& packet_out) override;
+    device::Result appendSegment(const hal::ContainerSegment& segment) override;
     std::vector<media::TrackMetadata> getTracks() const override;
     std::vector<media::TrackMetadata> getVideoTracks() const override;
     std::vector<media::TrackMetadata> getAudioTracks() const override;
@@ -24,13 +47,63 @@ public:
     /** Test helper: inject packets */
     void injectPacket(const media::EncodedPacket& packet);
 
+    /** Test helper: shorten the synthesized stream */
+    void setDurationUs(int64_t duration_us);
+
+    /** Test helper: the stream any parser synthesizes when it opens exactly path */
+    static void setStream(const std::string& path, const MockStreamConfig& config);
+
+    /** Test helper: forget every setStream() */
+    static void clearStreams();
+
+    /** Test helper: init segment bytes declaring a width x height video track */
+    static std::vector<uint8_t> makeInitSegment(uint32_t width, uint32_t height);
+
+    static constexpr uint32_t kVideoTrackId = 1;
+    static constexpr uint32_t kAudioTrackId = 2;
+    static constexpr int64_t kKeyframeIntervalUs = 2000000;
+    static constexpr int64_t kStallAtUs = 1000000;
+    static constexpr int64_t kStallUs = 1500000;
+
 private:
+    /** An appended segment awaiting demux; an init one only carries the video size */
+    struct Appended {
+        bool init{false};
+        bool entered{false};       /* The read position has been moved to its start */
+        int64_t start_us{0};
+        int64_t end_us{0};
+        uint32_t width{0};
+        uint32_t height{0};
+        std::vector<uint8_t> data;
+    };
+
+    device::Result readAppended(media::EncodedPacket& packet_out);
+    /** Move next_video_ to the next frame inside the appended segments, applying inits */
+    bool nextAppendedVideo();
+    bool nextAppendedAudio();
+    void dropAppended();
+    int64_t videoPts(uint64_t index) const;
+    int64_t audioPts(uint64_t index) const;
+    uint64_t videoIndexAt(int64_t pts_us) const;   /* First frame at or after pts_us */
+    uint64_t audioIndexAt(int64_t pts_us) const;
+    uint64_t framesPerGop() const;
+
     media::ContainerFormat format_{media::ContainerFormat::UNKNOWN};
     std::vector<media::TrackMetadata> tracks_;
     std::queue<media::EncodedPacket> packet_queue_;
     int64_t duration_us_{0};
     int64_t seek_pts_{0};
     bool open_{false};
+    bool stall_{false};
+    int64_t stall_until_us_{0};   /* Steady clock end of the outage, 0 before it */
+    uint64_t next_video_{0};   /* Next synthesized video frame index */
+    uint64_t next_audio_{0};   /* Next synthesized audio frame index */
+    bool appended_{false};          /* Demuxing appendSegment() data since open */
+    std::deque<Appended> appended_video_;
+    std::deque<Appended> appended_audio_;
+    media::AudioCodec audio_codec_{media::AudioCodec::AAC};
+    uint32_t audio_frame_samples_{1024};
+    std::vector<uint8_t> audio_frame_;
 };
 
 } // namespace streaming::drivers::mock
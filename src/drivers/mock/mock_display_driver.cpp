@@ -1,39 +1,167 @@
 #include "mock_display_driver.hpp"
+#include <algorithm>
+#include <chrono>
 #include <cstring>
 
 namespace streaming::drivers::mock {
 
+static int64_t nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+MockDisplayDriver::~MockDisplayDriver() { stopVblankThread(); }
+
 device::Result MockDisplayDriver::initialize() {
-    mode_ = {1920, 1080, 60, hal::PixelFormat::RGBA8888, false};
-    framebuffer_.resize(1920 * 1080 * 4, 0);
-    connected_ = true;
+    stopVblankThread();
+    std::deque<PendingFlip> dropped;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        mode_ = {1920, 1080, 60, hal::PixelFormat::RGBA8888, false};
+        allocateLocked();
+        dropped = takeFlipsLocked();
+        buffer_state_.fill(BufferState::FREE);
+        front_ = 0;
+        buffer_state_[front_] = BufferState::SCANOUT;
+        connected_ = true;
+        running_ = true;
+        vblank_thread_ = std::thread(&MockDisplayDriver::vblankLoop, this);
+    }
+    dropFlips(std::move(dropped));
     return device::Result::OK;
 }
 
 device::Result MockDisplayDriver::shutdown() {
-    framebuffer_.clear();
+    stopVblankThread();
+    std::deque<PendingFlip> dropped;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& b : buffers_) std::vector<uint8_t>().swap(b);
+        memory_.setDemand(0, 0);
+        memory_.setUsage(0);
+        dropped = takeFlipsLocked();
+    }
+    dropFlips(std::move(dropped));
     return device::Result::OK;
 }
 
-hal::DisplayMode MockDisplayDriver::getDisplayMode() const { return mode_; }
+void MockDisplayDriver::stopVblankThread() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    vblank_cv_.notify_all();
+    if (vblank_thread_.joinable()) vblank_thread_.join();
+}
+
+std::deque<MockDisplayDriver::PendingFlip> MockDisplayDriver::takeFlipsLocked() {
+    std::deque<PendingFlip> flips;
+    flips.swap(flip_queue_);
+    for (const PendingFlip& flip : flips) buffer_state_[flip.index] = BufferState::FREE;
+    return flips;
+}
+
+void MockDisplayDriver::dropFlips(std::deque<PendingFlip> flips) const {
+    hal::VblankInfo vblank;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        vblank = last_vblank_;
+    }
+    vblank.dropped = true;
+    for (PendingFlip& flip : flips)
+        if (flip.on_flip) flip.on_flip(vblank);
+}
+
+void MockDisplayDriver::vblankLoop() {
+    auto next = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_) {
+        const uint32_t hz = mode_.refresh_rate_hz ? mode_.refresh_rate_hz : 60;
+        next += std::chrono::microseconds(1000000 / hz);
+        vblank_cv_.wait_until(lock, next, [this] { return !running_; });
+        if (!running_) break;
+
+        last_vblank_.sequence++;
+        last_vblank_.timestamp_us = nowUs();
+
+        /* Latch at most one flip per vblank; the retired front buffer becomes free */
+        hal::PageFlipCallback on_flip;
+        if (!flip_queue_.empty()) {
+            PendingFlip flip = std::move(flip_queue_.front());
+            flip_queue_.pop_front();
+            buffer_state_[front_] = BufferState::FREE;
+            front_ = flip.index;
+            buffer_state_[front_] = BufferState::SCANOUT;
+            on_flip = std::move(flip.on_flip);
+        }
+        const hal::VblankInfo vblank = last_vblank_;
+        vblank_cv_.notify_all();
+
+        if (on_flip) {
+            lock.unlock();
+            on_flip(vblank);
+            lock.lock();
+        }
+    }
+}
+
+hal::DisplayMode MockDisplayDriver::getDisplayMode() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return mode_;
+}
 
 device::Result MockDisplayDriver::setDisplayMode(const hal::DisplayMode& mode) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto acquired = [this] {
+        return std::find(buffer_state_.begin(), buffer_state_.end(), BufferState::ACQUIRED) != buffer_state_.end();
+    };
+    /* A renderer is drawing into a back buffer: reallocating would pull it out from under it */
+    if (acquired()) return device::Result::ERROR_BUSY;
+
+    /* Let the queued flips reach the screen first, one per vblank */
+    const uint32_t hz = mode_.refresh_rate_hz ? mode_.refresh_rate_hz : 60;
+    vblank_cv_.wait_for(lock, std::chrono::microseconds(1000000 / hz * (kSwapChainLength + 1)),
+                        [this] { return flip_queue_.empty() || !running_; });
+    if (acquired()) return device::Result::ERROR_BUSY;   /* Taken while we waited */
+
     mode_ = mode;
-    framebuffer_.resize(mode.width * mode.height * 4, 0);
+    allocateLocked();
+    /* Left over when vblank is stopped or ran late: their buffers are gone now */
+    std::deque<PendingFlip> dropped = takeFlipsLocked();
+    buffer_state_.fill(BufferState::FREE);
+    buffer_state_[front_] = BufferState::SCANOUT;
+    vblank_cv_.notify_all();
+    lock.unlock();
+    dropFlips(std::move(dropped));
     return device::Result::OK;
 }
 
-hal::FramebufferInfo MockDisplayDriver::getFramebuffer() {
+void MockDisplayDriver::allocateLocked() {
+    const uint64_t size = static_cast<uint64_t>(mode_.width) * mode_.height * 4;
+    for (auto& b : buffers_) {
+        b.assign(size, 0);
+        b.shrink_to_fit();   /* Going down from 4K must give the memory back */
+    }
+    memory_.setDemand(size * kSwapChainLength, size * kSwapChainLength);
+    memory_.setUsage(size * kSwapChainLength);
+}
+
+hal::FramebufferInfo MockDisplayDriver::describe(uint32_t index) const {
     hal::FramebufferInfo info;
-    info.base_address = framebuffer_.data();
+    info.base_address = const_cast<uint8_t*>(buffers_[index].data());
     info.width = mode_.width;
     info.height = mode_.height;
     info.stride = mode_.width * 4;
     info.format = mode_.format;
-    info.size_bytes = static_cast<uint32_t>(framebuffer_.size());
+    info.size_bytes = static_cast<uint32_t>(buffers_[index].size());
     return info;
 }
 
+hal::FramebufferInfo MockDisplayDriver::getFramebuffer() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return describe(front_);
+}
+
 device::Result MockDisplayDriver::present(hal::PresentCallback on_complete) {
     if (on_complete) on_complete();
     return device::Result::OK;
@@ -42,16 +170,66 @@ device::Result MockDisplayDriver::present(hal::PresentCallback on_complete) {
 bool MockDisplayDriver::isConnected() const { return connected_; }
 
 std::vector<hal::DisplayMode> MockDisplayDriver::getSupportedModes() const {
-    return {
-        {1280, 720, 60, hal::PixelFormat::RGBA8888, false},
-        {1920, 1080, 60, hal::PixelFormat::RGBA8888, false},
-        {3840, 2160, 60, hal::PixelFormat::RGBA8888, false}
-    };
+    std::vector<hal::DisplayMode> modes = {{1280, 720, 60, hal::PixelFormat::RGBA8888, false}};
+    for (uint32_t height : {1080u, 2160u}) {
+        for (uint32_t hz : {24u, 25u, 30u, 50u, 60u})
+            modes.push_back({height * 16 / 9, height, hz, hal::PixelFormat::RGBA8888, false});
+    }
+    return modes;
 }
 
 device::Result MockDisplayDriver::clear() {
-    memset(framebuffer_.data(), 0, framebuffer_.size());
+    std::lock_guard<std::mutex> lock(mutex_);
+    memset(buffers_[front_].data(), 0, buffers_[front_].size());
     return device::Result::OK;
 }
 
+uint32_t MockDisplayDriver::getSwapChainLength() const { return kSwapChainLength; }
+
+device::Result MockDisplayDriver::acquireBackBuffer(hal::SwapChainBuffer& out, uint32_t timeout_ms) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto find_free = [this]() -> int {
+        for (uint32_t i = 0; i < kSwapChainLength; ++i)
+            if (buffer_state_[i] == BufferState::FREE) return static_cast<int>(i);
+        return -1;
+    };
+    int index = find_free();
+    if (index < 0 && timeout_ms > 0) {
+        vblank_cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms),
+                            [&] { return (index = find_free()) >= 0 || !running_; });
+    }
+    if (index < 0) return device::Result::ERROR_TIMEOUT;
+
+    buffer_state_[index] = BufferState::ACQUIRED;
+    out.index = static_cast<uint32_t>(index);
+    out.framebuffer = describe(out.index);
+    return device::Result::OK;
+}
+
+device::Result MockDisplayDriver::queuePresent(uint32_t index, hal::PageFlipCallback on_flip) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (index >= kSwapChainLength || buffer_state_[index] != BufferState::ACQUIRED)
+        return device::Result::ERROR_INVALID_PARAM;
+    buffer_state_[index] = BufferState::QUEUED;
+    flip_queue_.push_back({index, std::move(on_flip)});
+    return device::Result::OK;
+}
+
+device::Result MockDisplayDriver::waitForVblank(hal::VblankInfo& out, uint32_t timeout_ms) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!running_) return device::Result::ERROR_GENERIC;
+    const uint64_t seq = last_vblank_.sequence;
+    if (!vblank_cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms),
+                             [&] { return last_vblank_.sequence != seq || !running_; }))
+        return device::Result::ERROR_TIMEOUT;
+    if (!running_) return device::Result::ERROR_GENERIC;
+    out = last_vblank_;
+    return device::Result::OK;
+}
+
+uint32_t MockDisplayDriver::getScanoutIndex() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return front_;
+}
+
 } // namespace streaming::drivers::mock
@@ -1,12 +1,28 @@
 #pragma once
 
 #include "../../hal/display_hal.hpp"
+#include "../../common/memory_governor.hpp"
+#include <array>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 namespace streaming::drivers::mock {
 
+/**
+ * Mock display with a triple-buffered swap chain. A background thread
+ * emulates the vblank interrupt at the current mode's refresh rate and
+ * latches at most one queued flip per vblank. The swap chain is
+ * registered with the MemoryGovernor as FIXED memory.
+ */
 class MockDisplayDriver : public hal::IDisplayHal {
 public:
+    static constexpr uint32_t kSwapChainLength = 3;
+
+    ~MockDisplayDriver() override;
+
     device::Result initialize() override;
     device::Result shutdown() override;
     hal::DisplayMode getDisplayMode() const override;
@@ -16,11 +32,45 @@ public:
     bool isConnected() const override;
     std::vector<hal::DisplayMode> getSupportedModes() const override;
     device::Result clear() override;
+    uint32_t getSwapChainLength() const override;
+    device::Result acquireBackBuffer(hal::SwapChainBuffer& out, uint32_t timeout_ms) override;
+    device::Result queuePresent(uint32_t index, hal::PageFlipCallback on_flip) override;
+    device::Result waitForVblank(hal::VblankInfo& out, uint32_t timeout_ms) override;
+
+    /** Index of the buffer currently being scanned out */
+    uint32_t getScanoutIndex() const;
 
 private:
+    enum class BufferState : uint8_t { FREE, ACQUIRED, QUEUED, SCANOUT };
+
+    struct PendingFlip {
+        uint32_t index;
+        hal::PageFlipCallback on_flip;
+    };
+
+    void vblankLoop();
+    void stopVblankThread();
+    /** Take the flips that will never latch; run the result with dropFlips() unlocked */
+    std::deque<PendingFlip> takeFlipsLocked();
+    void dropFlips(std::deque<PendingFlip> flips) const;
+    hal::FramebufferInfo describe(uint32_t index) const;
+    /** (Re)allocate the swap chain for mode_ and report it to the governor */
+    void allocateLocked();
+
     hal::DisplayMode mode_;
-    std::vector<uint8_t> framebuffer_;
+    std::array<std::vector<uint8_t>, kSwapChainLength> buffers_;
+    std::array<BufferState, kSwapChainLength> buffer_state_{};
+    common::MemoryGovernor::Registration memory_{
+        common::MemoryGovernor::instance().registerPool("framebuffers", common::MemoryClass::FIXED)};
+    std::deque<PendingFlip> flip_queue_;
+    uint32_t front_{0};
+    hal::VblankInfo last_vblank_;
     bool connected_{false};
+    bool running_{false};
+
+    mutable std::mutex mutex_;
+    std::condition_variable vblank_cv_;
+    std::thread vblank_thread_;
 };
 
 } // namespace streaming::drivers::mock
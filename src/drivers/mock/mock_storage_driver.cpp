@@ -20,6 +20,7 @@ device::Result MockStorageDriver::write(const std::string& key, const std::strin
 device::Result MockStorageDriver::readBytes(const std::string& key, std::vector<uint8_t>& data_out) {
     auto it = blob_store_.find(key);
     if (it == blob_store_.end()) return device::Result::ERROR_NOT_FOUND;
+    ++blob_reads_;
     data_out = it->second;
     return device::Result::OK;
 }
@@ -50,9 +51,14 @@ device::Result MockStorageDriver::listKeys(const std::string& prefix, std::vecto
 }
 
 device::Result MockStorageDriver::getSpace(uint64_t& total_bytes, uint64_t& free_bytes) {
-    total_bytes = 1024ULL * 1024 * 1024;
-    free_bytes = 512ULL * 1024 * 1024;
+    total_bytes = total_bytes_;
+    free_bytes = free_bytes_;
     return device::Result::OK;
 }
 
+void MockStorageDriver::setSpace(uint64_t total_bytes, uint64_t free_bytes) {
+    total_bytes_ = total_bytes;
+    free_bytes_ = free_bytes;
+}
+
 } // namespace streaming::drivers::mock
@@ -18,9 +18,18 @@ public:
     device::Result listKeys(const std::string& prefix, std::vector<std::string>& keys_out) override;
     device::Result getSpace(uint64_t& total_bytes, uint64_t& free_bytes) override;
 
+    /** Test helper: partition size reported by getSpace() */
+    void setSpace(uint64_t total_bytes, uint64_t free_bytes);
+
+    /** Test helper: blob reads served so far */
+    uint32_t getBlobReads() const { return blob_reads_; }
+
 private:
     std::map<std::string, std::string> string_store_;
     std::map<std::string, std::vector<uint8_t>> blob_store_;
+    uint64_t total_bytes_{1024ULL * 1024 * 1024};
+    uint64_t free_bytes_{512ULL * 1024 * 1024};
+    uint32_t blob_reads_{0};
 };
 
 } // namespace streaming::drivers::mock
@@ -8,10 +8,18 @@ device::Result MockVideoPipeline::initialize(uint32_t output_width, uint32_t out
     return device::Result::OK;
 }
 
-device::Result MockVideoPipeline::shutdown() { return device::Result::OK; }
+device::Result MockVideoPipeline::shutdown() {
+    releasePlane();
+    return device::Result::OK;
+}
 
-device::Result MockVideoPipeline::submitFrame(const media::DecodedFrame& /*frame*/,
+device::Result MockVideoPipeline::submitFrame(const media::DecodedFrame& frame,
                                             hal::FramePresentCallback on_present) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.frames_copied++;
+        stats_.bytes_copied += frame.size;
+    }
     if (on_present) on_present(device::Result::OK);
     return device::Result::OK;
 }
@@ -30,6 +38,71 @@ device::Result MockVideoPipeline::setUpscalingEnabled(bool enabled) {
     return device::Result::OK;
 }
 
-device::Result MockVideoPipeline::reset() { return device::Result::OK; }
+device::Result MockVideoPipeline::reset() {
+    releasePlane();
+    return device::Result::OK;
+}
+
+bool MockVideoPipeline::supportsDirectScanout(media::PixelFormat format) const {
+    switch (format) {
+        case media::PixelFormat::NV12:
+        case media::PixelFormat::P010:
+        case media::PixelFormat::RGBA8888:
+        case media::PixelFormat::BGRA8888:
+            return true;
+        default:
+            return false;
+    }
+}
+
+device::Result MockVideoPipeline::scanoutFrame(const media::DecodedFrame& frame,
+                                             hal::BufferReleaseCallback on_release) {
+    if (!frame.handle.valid() || !supportsDirectScanout(frame.format)) {
+        /* Copy path: the source buffer is free as soon as the copy completes */
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stats_.frames_copied++;
+            stats_.bytes_copied += frame.size;
+        }
+        if (on_release) on_release(frame.handle);
+        return device::Result::OK;
+    }
+
+    media::BufferHandle retired;
+    hal::BufferReleaseCallback retired_cb;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        retired = plane_handle_;
+        retired_cb = std::move(plane_release_);
+        plane_handle_ = frame.handle;
+        plane_release_ = std::move(on_release);
+        stats_.frames_scanned_out++;
+    }
+    if (retired.valid() && retired_cb) retired_cb(retired);
+    return device::Result::OK;
+}
+
+hal::VideoPipelineStats MockVideoPipeline::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+media::BufferHandle MockVideoPipeline::getScanoutHandle() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return plane_handle_;
+}
+
+void MockVideoPipeline::releasePlane() {
+    media::BufferHandle retired;
+    hal::BufferReleaseCallback retired_cb;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        retired = plane_handle_;
+        retired_cb = std::move(plane_release_);
+        plane_handle_ = {};
+        plane_release_ = nullptr;
+    }
+    if (retired.valid() && retired_cb) retired_cb(retired);
+}
 
 } // namespace streaming::drivers::mock
@@ -1,9 +1,11 @@
 #pragma once
 
 #include "../../hal/video_pipeline_hal.hpp"
+#include <mutex>
 
 namespace streaming::drivers::mock {
 
+/** Mock video pipeline; emulates a video plane holding one imported buffer */
 class MockVideoPipeline : public hal::IVideoPipeline {
 public:
     device::Result initialize(uint32_t output_width, uint32_t output_height) override;
@@ -15,10 +17,23 @@ public:
     device::Result setHdrMetadata(const media::HdrMetadata& metadata) override;
     device::Result setUpscalingEnabled(bool enabled) override;
     device::Result reset() override;
+    bool supportsDirectScanout(media::PixelFormat format) const override;
+    device::Result scanoutFrame(const media::DecodedFrame& frame,
+                                hal::BufferReleaseCallback on_release) override;
+    hal::VideoPipelineStats getStats() const override;
+
+    /** Handle currently on the video plane (fd -1 if none) */
+    media::BufferHandle getScanoutHandle() const;
 
 private:
+    void releasePlane();
+
+    mutable std::mutex mutex_;
     uint32_t out_w_{0}, out_h_{0};
     bool upscaling_{true};
+    media::BufferHandle plane_handle_;
+    hal::BufferReleaseCallback plane_release_;
+    hal::VideoPipelineStats stats_;
 };
 
 } // namespace streaming::drivers::mock
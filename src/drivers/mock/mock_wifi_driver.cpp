@@ -1,4 +1,6 @@
 #include "mock_wifi_driver.hpp"
+#include <chrono>
+#include <thread>
 
 namespace streaming::drivers::mock {
 
@@ -6,7 +8,16 @@ device::Result MockWifiDriver::initialize() { return device::Result::OK; }
 device::Result MockWifiDriver::shutdown() { return device::Result::OK; }
 
 device::Result MockWifiDriver::scan(std::vector<hal::WifiScanResult>& results) {
-    results = {{"TestNetwork", "aa:bb:cc:dd:ee:ff", -55, 2}};
+    ++scan_count_;
+    results = {{"TestNetwork", "aa:bb:cc:dd:ee:ff", rssi_.load(), 2}};
+    return device::Result::OK;
+}
+
+device::Result MockWifiDriver::getLinkInfo(hal::WifiLinkInfo& info) {
+    if (state_ != device::WifiState::CONNECTED) return device::Result::ERROR_NOT_FOUND;
+    info.rssi = rssi_;
+    info.tx_rate_mbps = tx_rate_mbps_;
+    info.frequency_mhz = 5180;
     return device::Result::OK;
 }
 
@@ -35,10 +46,34 @@ void MockWifiDriver::setStateCallback(hal::WifiStateCallback callback) {
 std::string MockWifiDriver::getLocalIp() const { return local_ip_; }
 
 device::Result MockWifiDriver::resolveHost(const std::string& hostname, std::string& ip_out) {
+    ++resolve_count_;
+    if (resolve_delay_ms_ > 0) std::this_thread::sleep_for(std::chrono::milliseconds(resolve_delay_ms_.load()));
+    if (resolve_fail_) return device::Result::ERROR_NETWORK;
+    {
+        std::lock_guard<std::mutex> lock(hosts_mutex_);
+        auto it = hosts_.find(hostname);
+        if (it != hosts_.end()) { ip_out = it->second; return device::Result::OK; }
+    }
     if (hostname == "api.netflix.com") { ip_out = "52.1.2.3"; return device::Result::OK; }
     if (hostname == "api.amazon.com") { ip_out = "54.2.3.4"; return device::Result::OK; }
     ip_out = "127.0.0.1";
     return device::Result::OK;
 }
 
+void MockWifiDriver::setHostAddress(const std::string& hostname, const std::string& ip) {
+    std::lock_guard<std::mutex> lock(hosts_mutex_);
+    hosts_[hostname] = ip;
+}
+
+void MockWifiDriver::setResolveDelayMs(uint32_t delay_ms) { resolve_delay_ms_ = delay_ms; }
+void MockWifiDriver::setResolveFailure(bool fail) { resolve_fail_ = fail; }
+uint32_t MockWifiDriver::getResolveCount() const { return resolve_count_; }
+
+void MockWifiDriver::setLinkInfo(int32_t rssi, uint32_t tx_rate_mbps) {
+    rssi_ = rssi;
+    tx_rate_mbps_ = tx_rate_mbps;
+}
+
+uint32_t MockWifiDriver::getScanCount() const { return scan_count_; }
+
 } // namespace streaming::drivers::mock
@@ -1,6 +1,9 @@
 #pragma once
 
 #include "../../hal/wifi_hal.hpp"
+#include <atomic>
+#include <map>
+#include <mutex>
 
 namespace streaming::drivers::mock {
 
@@ -9,6 +12,7 @@ public:
     device::Result initialize() override;
     device::Result shutdown() override;
     device::Result scan(std::vector<hal::WifiScanResult>& results) override;
+    device::Result getLinkInfo(hal::WifiLinkInfo& info) override;
     device::Result connect(const std::string& ssid, const std::string& password) override;
     device::Result disconnect() override;
     device::WifiState getState() const override;
@@ -17,11 +21,35 @@ public:
     std::string getLocalIp() const override;
     device::Result resolveHost(const std::string& hostname, std::string& ip_out) override;
 
+    /** Test helper: answer for hostname (overrides the built-in table) */
+    void setHostAddress(const std::string& hostname, const std::string& ip);
+
+    /** Test helper: make every lookup take this long / fail */
+    void setResolveDelayMs(uint32_t delay_ms);
+    void setResolveFailure(bool fail);
+
+    /** Test helper: lookups served so far */
+    uint32_t getResolveCount() const;
+
+    /** Test helper: signal (also the scan RSSI) and PHY rate of the link */
+    void setLinkInfo(int32_t rssi, uint32_t tx_rate_mbps);
+
+    /** Test helper: scans run so far */
+    uint32_t getScanCount() const;
+
 private:
-    device::WifiState state_{device::WifiState::DISCONNECTED};
+    std::atomic<device::WifiState> state_{device::WifiState::DISCONNECTED};   /* Read by monitor threads */
     std::string ssid_;
     std::string local_ip_;
     hal::WifiStateCallback state_cb_;
+    mutable std::mutex hosts_mutex_;
+    std::map<std::string, std::string> hosts_;
+    std::atomic<uint32_t> resolve_delay_ms_{0};
+    std::atomic<bool> resolve_fail_{false};
+    std::atomic<uint32_t> resolve_count_{0};
+    std::atomic<int32_t> rssi_{-55};
+    std::atomic<uint32_t> tx_rate_mbps_{433};
+    std::atomic<uint32_t> scan_count_{0};
 };
 
 } // namespace streaming::drivers::mock
@@ -0,0 +1,62 @@
+/**
+ * @file audio_decoder_hal.hpp
+ * @brief Audio decoding HAL - abstract decoder interface for audio codecs
+ * @copyright 2025 Streaming Device Project
+ *
+ * Decodes AAC, AC3 and E-AC3 access units to interleaved 16-bit PCM at
+ * the track's sample rate and channel count.
+ */
+
+#pragma once
+
+#include <streaming_device/types.hpp>
+#include <streaming_device/media_types.hpp>
+#include <memory>
+
+namespace streaming::hal {
+
+/** Audio decode result */
+struct AudioDecodeResult {
+    device::Result status{device::Result::OK};
+    media::DecodeError decode_error{media::DecodeError::NONE};
+    bool frame_ready{false};
+    media::DecodedAudio pcm;
+};
+
+/**
+ * @brief Audio Decoder Interface
+ *
+ * One packet in, at most one block of PCM out (1024 samples per channel
+ * for AAC, 1536 for AC3/E-AC3).
+ */
+class IAudioDecoder {
+public:
+    virtual ~IAudioDecoder() = default;
+
+    /** Initialize decoder for given codec and track */
+    virtual device::Result initialize(media::AudioCodec codec,
+                                      const media::AudioTrackInfo& track_info) = 0;
+
+    /** Shutdown and release resources */
+    virtual device::Result shutdown() = 0;
+
+    /** Decode one access unit */
+    virtual AudioDecodeResult decode(const media::EncodedPacket& packet) = 0;
+
+    /** Discard decoder state (seek) */
+    virtual device::Result flush() = 0;
+
+    /** Reset decoder to initial state */
+    virtual device::Result reset() = 0;
+
+    /** Get last decode error */
+    virtual media::DecodeError getError() const = 0;
+
+    /** Check if decoder supports given codec */
+    virtual bool supports(media::AudioCodec codec) const = 0;
+};
+
+/** Factory signature for platform-specific audio decoders */
+using AudioDecoderFactory = std::unique_ptr<IAudioDecoder> (*)();
+
+} // namespace streaming::hal
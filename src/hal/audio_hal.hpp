@@ -3,7 +3,9 @@
  * @brief Hardware Abstraction Layer for Audio output
  * @copyright 2025 Streaming Device Project
  * 
- * Abstracts HDMI audio passthrough, Bluetooth A2DP output.
+ * Abstracts HDMI audio passthrough, Bluetooth A2DP output. AC3/EAC3
+ * buffers are IEC 61937 bursts: sample_rate_hz is the link rate and the
+ * data is framed as 16-bit stereo, so sizes and durations work like PCM.
  */
 
 #pragma once
@@ -27,7 +29,9 @@ enum class AudioFormat : uint8_t {
     PCM_16BIT_STEREO,
     PCM_24BIT_STEREO,
     AAC,
-    AC3
+    AC3,                     /* IEC 61937 bursts in 16-bit stereo framing (HDMI passthrough) */
+    PCM_16BIT_MULTICHANNEL,  /* Interleaved 16-bit, AudioBuffer::channels wide */
+    EAC3                     /* IEC 61937 bursts at 4x the stream rate (HDMI passthrough) */
 };
 
 /** Audio buffer descriptor */
@@ -36,6 +40,27 @@ struct AudioBuffer {
     size_t size{0};
     uint32_t sample_rate_hz{48000};
     AudioFormat format{AudioFormat::PCM_16BIT_STEREO};
+    uint32_t channels{2};
+    int64_t pts_us{-1};      /* Media time of the first sample, -1 if untimed */
+};
+
+/** What a sink accepts without conversion */
+struct AudioSinkCapabilities {
+    std::vector<uint32_t> sample_rates;   /* PCM rates, Hz */
+    uint32_t max_channels{2};             /* PCM channels */
+    bool ac3_passthrough{false};
+    bool eac3_passthrough{false};
+
+    bool supportsRate(uint32_t rate) const {
+        for (uint32_t r : sample_rates) if (r == rate) return true;
+        return false;
+    }
+};
+
+/** Which media sample is leaving the output right now (for A/V sync) */
+struct AudioRenderPosition {
+    int64_t pts_us{0};        /* Media time of the sample at the DAC/HDMI serializer */
+    int64_t timestamp_us{0};  /* Monotonic (steady clock) time the position was sampled */
 };
 
 /**
@@ -56,12 +81,40 @@ public:
     /** Set output sink (HDMI or Bluetooth) */
     virtual device::Result setSink(AudioSink sink) = 0;
 
-    /** Play audio buffer */
+    /** Get the current output sink */
+    virtual AudioSink getSink() const = 0;
+
+    /**
+     * Formats a sink accepts natively. Callers convert anything else
+     * (e.g. resample and downmix for a 48 kHz stereo A2DP link).
+     */
+    virtual AudioSinkCapabilities getSinkCapabilities(AudioSink sink) const = 0;
+
+    /**
+     * Time from a sample's render position to it being heard on the given
+     * sink, microseconds: HDMI/AVR processing, or the A2DP encode, radio
+     * and headset buffering (typically 150-250 ms).
+     */
+    virtual int64_t getOutputLatencyUs(AudioSink sink) const = 0;
+
+    /**
+     * Play audio buffer. Blocks while the output FIFO is full, which paces
+     * the caller at the output rate; returns early if stop() is called.
+     */
     virtual device::Result play(const AudioBuffer& buffer) = 0;
 
-    /** Stop playback */
+    /** Pause/resume output, keeping queued audio */
+    virtual device::Result setPaused(bool paused) = 0;
+
+    /** Stop playback and discard queued audio */
     virtual device::Result stop() = 0;
 
+    /**
+     * Get the render position of timed buffers. Returns ERROR_NOT_FOUND
+     * until a buffer with a valid pts_us has started playing.
+     */
+    virtual device::Result getRenderPosition(AudioRenderPosition& out) const = 0;
+
     /** Set volume 0-100 */
     virtual device::Result setVolume(uint8_t percent) = 0;
 
@@ -29,6 +29,24 @@ struct DecodeResult {
 /** Decode callback for async/streaming decode */
 using DecodeCallback = std::function<void(const DecodeResult&)>;
 
+/**
+ * @brief Decoder output buffer pool
+ *
+ * Decoders write into pooled buffers exported as media::BufferHandle so the
+ * display can scan them out directly. A buffer returns to the pool once the
+ * display releases it.
+ */
+class IFrameBufferPool {
+public:
+    virtual ~IFrameBufferPool() = default;
+
+    /** Acquire a buffer of at least size bytes; fills frame data, size and handle */
+    virtual device::Result acquire(size_t size, media::DecodedFrame& frame) = 0;
+
+    /** Return a buffer to the pool */
+    virtual void release(const media::BufferHandle& handle) = 0;
+};
+
 /**
  * @brief Codec Decoder Interface
  *
@@ -69,6 +87,12 @@ public:
 
     /** Check if decoder supports given codec */
     virtual bool supports(media::VideoCodec codec) const = 0;
+
+    /**
+     * Decode into buffers from pool (zero-copy output). decodeFrame returns
+     * ERROR_BUSY while the pool is exhausted. nullptr restores internal buffers.
+     */
+    virtual void setOutputPool(std::shared_ptr<IFrameBufferPool> pool) = 0;
 };
 
 /** Factory signature for platform-specific decoders */
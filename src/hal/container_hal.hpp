@@ -18,6 +18,16 @@
 
 namespace streaming::hal {
 
+/** A downloaded HLS / DASH segment (IContainerParser::appendSegment) */
+struct ContainerSegment {
+    std::vector<uint8_t> data;
+    bool init{false};          /* Initialization segment: track setup, no samples */
+    bool video{false};         /* Carries the video track */
+    bool audio{false};         /* Carries audio, muxed with the video or on its own */
+    int64_t start_us{0};       /* Where the manifest places it */
+    int64_t duration_us{0};
+};
+
 /**
  * @brief Container Parser Interface
  *
@@ -39,6 +49,26 @@ public:
     /** Seek to byte offset (for progressive/streaming) */
     virtual device::Result seekToByte(uint64_t offset) = 0;
 
+    /**
+     * Trick play: read the video keyframe strictly after (forward) or
+     * before (!forward) from_us, located through the sample index
+     * (stss / Cues / sidx) so nothing in between is read. ERROR_END_OF_STREAM
+     * past either end. Leaves the readPacket() position undefined; seek()
+     * before resuming normal reads.
+     */
+    virtual device::Result readKeyframe(int64_t from_us, bool forward,
+                                        media::EncodedPacket& packet_out) = 0;
+
+    /**
+     * Segmented sources: demux the segments appended here instead of the
+     * opened resource, from the first append until the next open. An init
+     * segment applies to the media after it, as on a rendition switch;
+     * packets carry the manifest's timeline. readPacket() returns
+     * ERROR_TIMEOUT once the appended data is used up; seek() drops it.
+     * ERROR_NOT_SUPPORTED where the source cannot be segmented.
+     */
+    virtual device::Result appendSegment(const ContainerSegment& segment) = 0;
+
     /** Get all track metadata */
     virtual std::vector<media::TrackMetadata> getTracks() const = 0;
 
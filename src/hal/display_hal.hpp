@@ -13,6 +13,7 @@
 #include <cstdint>
 #include <functional>
 #include <memory>
+#include <vector>
 
 namespace streaming::hal {
 
@@ -47,6 +48,22 @@ struct FramebufferInfo {
 /** Callback for vsync/present completion */
 using PresentCallback = std::function<void()>;
 
+/** Vertical blank event */
+struct VblankInfo {
+    uint64_t sequence{0};       /* Monotonic vblank counter */
+    int64_t timestamp_us{0};    /* steady_clock time of the vblank */
+    bool dropped{false};        /* Flip cancelled by a mode switch or shutdown: never shown */
+};
+
+/** Swap chain back buffer handed to the renderer */
+struct SwapChainBuffer {
+    uint32_t index{0};
+    FramebufferInfo framebuffer;
+};
+
+/** Callback fired at the vblank where a queued buffer becomes visible */
+using PageFlipCallback = std::function<void(const VblankInfo&)>;
+
 /**
  * @brief Display HAL Interface
  * 
@@ -66,7 +83,11 @@ public:
     /** Get current display mode */
     virtual DisplayMode getDisplayMode() const = 0;
 
-    /** Set display resolution and refresh rate */
+    /**
+     * Set display resolution and refresh rate. Queued flips are shown
+     * first and the swap chain is reallocated; ERROR_BUSY while a back
+     * buffer is acquired.
+     */
     virtual device::Result setDisplayMode(const DisplayMode& mode) = 0;
 
     /** Get framebuffer for rendering */
@@ -75,6 +96,31 @@ public:
     /** Present current framebuffer to HDMI output (vsync) */
     virtual device::Result present(PresentCallback on_complete = nullptr) = 0;
 
+    // --- Swap chain (triple buffered, asynchronous page flip) ---
+
+    /** Number of buffers in the swap chain */
+    virtual uint32_t getSwapChainLength() const = 0;
+
+    /**
+     * Acquire the next free back buffer for rendering.
+     * Waits up to timeout_ms for a buffer to retire from scan-out;
+     * returns ERROR_TIMEOUT if none became free.
+     */
+    virtual device::Result acquireBackBuffer(SwapChainBuffer& out,
+                                             uint32_t timeout_ms = 0) = 0;
+
+    /**
+     * Queue an acquired buffer for display. The flip is latched at the next
+     * free vblank; on_flip runs on the display thread once it is visible,
+     * or with VblankInfo::dropped set if a mode switch or shutdown
+     * discards the flip first.
+     */
+    virtual device::Result queuePresent(uint32_t index,
+                                        PageFlipCallback on_flip = nullptr) = 0;
+
+    /** Block until the next vblank (or timeout_ms elapses) */
+    virtual device::Result waitForVblank(VblankInfo& out, uint32_t timeout_ms) = 0;
+
     /** Check if display is connected (HDMI hot-plug) */
     virtual bool isConnected() const = 0;
 
@@ -1,11 +1,13 @@
 /**
  * @file media_hal_factory.cpp
- * @brief Factory for container parser and DRM HAL (mock implementations)
+ * @brief Factory for container parser, video pipeline and DRM HAL (mock implementations)
  */
 
 #include "container_hal.hpp"
 #include "drm_hal.hpp"
+#include "video_pipeline_hal.hpp"
 #include "../drivers/mock/mock_container_parser.hpp"
+#include "../drivers/mock/mock_video_pipeline.hpp"
 
 namespace streaming::hal {
 
@@ -13,6 +15,10 @@ std::unique_ptr<IContainerParser> createContainerParser() {
     return std::make_unique<drivers::mock::MockContainerParser>();
 }
 
+std::unique_ptr<IVideoPipeline> createVideoPipeline() {
+    return std::make_unique<drivers::mock::MockVideoPipeline>();
+}
+
 /** Null DRM implementation - no content protection */
 class NullDrmHal : public IDrmHal {
 public:
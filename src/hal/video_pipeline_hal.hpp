@@ -5,6 +5,10 @@
  *
  * Feed decoded frames to HDMI/framebuffer compositor with proper
  * color space conversion, HDR metadata, and upscaling.
+ *
+ * Decoded frames in shareable buffers are scanned out directly on the
+ * video plane; the UI renders into the display HAL framebuffer, which the
+ * display controller composites above video as the overlay plane.
  */
 
 #pragma once
@@ -19,6 +23,16 @@ namespace streaming::hal {
 /** Frame presentation callback */
 using FramePresentCallback = std::function<void(device::Result)>;
 
+/** Called once the display no longer references a scanned-out buffer */
+using BufferReleaseCallback = std::function<void(const media::BufferHandle&)>;
+
+/** Frame transfer statistics */
+struct VideoPipelineStats {
+    uint64_t frames_scanned_out{0};  /* Zero-copy plane flips */
+    uint64_t frames_copied{0};       /* Frames that went through a framebuffer copy */
+    uint64_t bytes_copied{0};
+};
+
 /**
  * @brief Video Pipeline Interface
  *
@@ -52,6 +66,24 @@ public:
 
     /** Reset pipeline state */
     virtual device::Result reset() = 0;
+
+    /** Check if frames of this format can be scanned out without conversion */
+    virtual bool supportsDirectScanout(media::PixelFormat format) const = 0;
+
+    /**
+     * Scan out frame.handle directly on the video plane (zero-copy).
+     * The previously shown buffer is passed to its on_release once the new
+     * one is latched. Frames without a valid handle fall back to a copy and
+     * are released immediately.
+     */
+    virtual device::Result scanoutFrame(const media::DecodedFrame& frame,
+                                        BufferReleaseCallback on_release) = 0;
+
+    /** Get frame transfer statistics */
+    virtual VideoPipelineStats getStats() const = 0;
 };
 
+/** Factory for creating platform-specific video pipeline */
+std::unique_ptr<IVideoPipeline> createVideoPipeline();
+
 } // namespace streaming::hal
@@ -25,6 +25,13 @@ struct WifiScanResult {
     uint8_t security{0};  // 0=open, 1=WEP, 2=WPA, 3=WPA2
 };
 
+/** Associated link as the driver reports it (station info; no scan involved) */
+struct WifiLinkInfo {
+    int32_t rssi{0};              /* dBm */
+    uint32_t tx_rate_mbps{0};     /* Current PHY transmit rate */
+    uint32_t frequency_mhz{0};
+};
+
 /** Connection callback */
 using WifiStateCallback = std::function<void(device::WifiState)>;
 
@@ -47,6 +54,13 @@ public:
     /** Scan for available networks */
     virtual device::Result scan(std::vector<WifiScanResult>& results) = 0;
 
+    /**
+     * Signal and rate of the current association. Cheap, unlike scan(),
+     * which leaves the channel and dents throughput while it runs.
+     * ERROR_NOT_FOUND when not connected.
+     */
+    virtual device::Result getLinkInfo(WifiLinkInfo& info) = 0;
+
     /** Connect to network with SSID and password */
     virtual device::Result connect(const std::string& ssid,
                                    const std::string& password) = 0;
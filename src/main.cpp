@@ -15,8 +15,12 @@
 #include "services/streaming_service.hpp"
 #include "services/hdmi_cec_service.hpp"
 #include "services/config_service.hpp"
+#include "services/dns_cache_service.hpp"
+#include "services/network_monitor_service.hpp"
+#include "media/http_client.hpp"
 #include "common/event_bus.hpp"
 #include "common/logger.hpp"
+#include "common/memory_governor.hpp"
 #include <chrono>
 #include <csignal>
 #include <iostream>
@@ -52,22 +56,41 @@ int main(int argc, char* argv[]) {
     if (cec->initialize() != streaming::device::Result::OK) {
         LOG_ERROR("Main", "HDMI-CEC init failed");
     }
-    if (wifi->initialize() != streaming::device::Result::OK) {
+
+    // Initialize services
+    auto dns = streaming::services::createDnsCacheService();
+    dns->initialize();
+    streaming::media::HttpClient http({}, dns->resolver());   /* Segment fetches hit the DNS cache */
+    /* The monitor takes over the Wi-Fi HAL: it samples the driver that associates */
+    auto net_monitor = streaming::services::createNetworkMonitorService(std::move(wifi));
+    if (net_monitor->initialize() != streaming::device::Result::OK) {
         LOG_ERROR("Main", "Wi-Fi init failed");
     }
 
-    // Initialize services
     auto app_launcher = streaming::services::createAppLauncherService();
     auto ui = streaming::services::createUiService();
-    auto streaming_svc = streaming::services::createStreamingService();
+    auto streaming_svc = streaming::services::createStreamingService(
+        *display,                                  /* Video plays on the display the UI draws on */
+        net_monitor->instrument(http.loader()));   /* Segment downloads feed the bandwidth prediction */
     auto cec_svc = streaming::services::createHdmiCecService();
     auto config = streaming::services::createConfigService();
 
     app_launcher->initialize();
     config->initialize();
+    int32_t media_memory_mb = 0;   /* Frame pools, packet queues and read-ahead shrink to fit */
+    if (config->getInt("media.memory_budget_mb", media_memory_mb) == streaming::device::Result::OK &&
+        media_memory_mb > 0)
+        streaming::common::MemoryGovernor::instance().setBudget(static_cast<uint64_t>(media_memory_mb) << 20);
     cec_svc->initialize();
     ui->initialize();
     streaming_svc->initialize();
+    streaming_svc->setStatusCallback([&net_monitor](streaming::services::StreamState state, const std::string&) {
+        using streaming::services::StreamState;
+        /* No background scans while a stream is starting, buffering or playing */
+        net_monitor->setPlaybackActive(state == StreamState::CONNECTING ||
+                                       state == StreamState::BUFFERING ||
+                                       state == StreamState::PLAYING);
+    });
 
     // Register streaming apps (example config)
     app_launcher->registerApp({"netflix", "Netflix", "/icons/netflix.png",
@@ -80,6 +103,7 @@ int main(int argc, char* argv[]) {
         "https://www.disneyplus.com", "", true});
 
     auto apps = app_launcher->getApps();
+    dns->prefetchApps(apps);   /* Warm the cache so launching an app never waits on DNS */
     std::vector<std::string> ids, labels;
     for (const auto& a : apps) {
         ids.push_back(a.id);
@@ -148,9 +172,10 @@ int main(int argc, char* argv[]) {
     app_launcher->shutdown();
     config->shutdown();
     cec_svc->shutdown();
+    net_monitor->shutdown();
+    dns->shutdown();
     display->shutdown();
     input->shutdown();
-    wifi->shutdown();
     cec->shutdown();
 
     return 0;
@@ -0,0 +1,202 @@
+/**
+ * @file abr_controller.cpp
+ * @brief AbrController implementation
+ */
+
+#include "abr_controller.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace streaming::media {
+
+namespace {
+
+constexpr uint64_t kMinSampleBytes = 16 * 1024;     /* Smaller downloads are mostly latency */
+constexpr int64_t kBufferPerLevelUs = 2000000;     /* BOLA target grows with the ladder */
+
+uint32_t maxHeight(device::StreamQuality cap) {
+    switch (cap) {
+        case device::StreamQuality::LOW: return 480;
+        case device::StreamQuality::MEDIUM: return 720;
+        case device::StreamQuality::HIGH: return 1080;
+        default: return UINT32_MAX;
+    }
+}
+
+} // namespace
+
+void AbrController::Ewma::sample(double weight_s, double value) {
+    const double alpha = std::exp(std::log(0.5) / half_life_s);
+    const double a = std::pow(alpha, weight_s);
+    estimate = a * estimate + (1.0 - a) * value;
+    total_weight += weight_s;
+}
+
+double AbrController::Ewma::get() const {
+    /* Undo the bias towards the zero the average started from */
+    const double alpha = std::exp(std::log(0.5) / half_life_s);
+    const double zero_factor = 1.0 - std::pow(alpha, total_weight);
+    return zero_factor > 0.0 ? estimate / zero_factor : 0.0;
+}
+
+AbrController::AbrController(AbrConfig config)
+    : config_(config), fast_{config.fast_half_life_s}, slow_{config.slow_half_life_s} {}
+
+void AbrController::setRenditions(std::vector<Rendition> renditions) {
+    std::sort(renditions.begin(), renditions.end(),
+              [](const Rendition& a, const Rendition& b) { return a.bandwidth_bps < b.bandwidth_bps; });
+    std::lock_guard<std::mutex> lock(mutex_);
+    ladder_ = std::move(renditions);
+    current_ = 0;
+    up_votes_ = 0;
+    started_ = false;
+    stats_.selected = 0;
+}
+
+std::vector<Rendition> AbrController::getRenditions() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return ladder_;
+}
+
+void AbrController::setQualityCap(device::StreamQuality cap) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cap_ = cap;
+    stats_.cap = cap;
+}
+
+size_t AbrController::capIndex(const std::vector<Rendition>& ladder, device::StreamQuality cap) {
+    const uint32_t limit = maxHeight(cap);
+    size_t index = 0;
+    for (size_t i = 0; i < ladder.size(); ++i)
+        if (ladder[i].height <= limit) index = i;
+    return index;
+}
+
+void AbrController::onDownload(uint64_t bytes, int64_t duration_us) {
+    if (bytes < kMinSampleBytes || duration_us <= 0) return;
+    const double seconds = static_cast<double>(duration_us) / 1e6;
+    const double bps = static_cast<double>(bytes) * 8.0 / seconds;
+    std::lock_guard<std::mutex> lock(mutex_);
+    fast_.sample(seconds, bps);
+    slow_.sample(seconds, bps);
+    stats_.samples++;
+    stats_.estimate_bps = estimateLocked();
+}
+
+uint32_t AbrController::estimateLocked() const {
+    if (stats_.samples == 0) return config_.initial_estimate_bps;
+    /* The lower average: quick to fall on a drop, slow to trust a spike */
+    const double estimate = std::min(fast_.get(), slow_.get());
+    return static_cast<uint32_t>(std::min<double>(estimate, UINT32_MAX));
+}
+
+uint32_t AbrController::getEstimate() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return estimateLocked();
+}
+
+size_t AbrController::throughputIndexLocked() const {
+    const double budget = estimateLocked() * config_.safety_factor;
+    size_t index = 0;
+    for (size_t i = 0; i < ladder_.size(); ++i)
+        if (ladder_[i].bandwidth_bps <= budget) index = i;
+    return index;
+}
+
+void AbrController::setBufferCeiling(int64_t ceiling_us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ceiling_us_ = std::max<int64_t>(ceiling_us, 0);
+}
+
+void AbrController::bolaLevelsLocked(int64_t& low_us, int64_t& target_us) const {
+    low_us = config_.buffer_low_us;
+    target_us = std::max<int64_t>(config_.buffer_target_us,
+                                  low_us + kBufferPerLevelUs * static_cast<int64_t>(ladder_.size()));
+    if (ceiling_us_ > 0 && target_us > ceiling_us_) {
+        low_us = std::max<int64_t>(low_us * ceiling_us_ / target_us, 1);
+        target_us = ceiling_us_;
+    }
+}
+
+size_t AbrController::bolaIndexLocked(int64_t buffer_us) const {
+    if (ladder_.size() < 2 || ladder_[0].bandwidth_bps == 0) return 0;
+
+    /* BOLA-BASIC: utility ln(S_m / S_0) + 1, with V and gamma*p chosen so the
+     * lowest rendition wins at the minimum buffer and the highest at the target */
+    int64_t low_us, target_us;
+    bolaLevelsLocked(low_us, target_us);
+    const double q_min = static_cast<double>(low_us) / 1e6;
+    const double target = static_cast<double>(target_us) / 1e6;
+    const double base = ladder_[0].bandwidth_bps;
+    const double top_utility = std::log(ladder_.back().bandwidth_bps / base) + 1.0;
+    const double gp = (top_utility - 1.0) / (target / q_min - 1.0);
+    const double vp = q_min / gp;
+    const double level = static_cast<double>(buffer_us) / 1e6;
+
+    size_t best = 0;
+    double best_score = -1e300;
+    for (size_t i = 0; i < ladder_.size(); ++i) {
+        const double utility = std::log(ladder_[i].bandwidth_bps / base) + 1.0;
+        const double score = (vp * (utility + gp) - level) / ladder_[i].bandwidth_bps;
+        if (score >= best_score) {
+            best_score = score;
+            best = i;
+        }
+    }
+    return best;
+}
+
+void AbrController::switchToLocked(size_t index) {
+    if (index > current_) stats_.switches_up++;
+    else if (index < current_) stats_.switches_down++;
+    current_ = index;
+    up_votes_ = 0;
+    stats_.selected = index;
+}
+
+size_t AbrController::selectRendition(int64_t buffer_us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (ladder_.empty()) return 0;
+    const size_t cap = capIndex(ladder_, cap_);
+    const size_t throughput = throughputIndexLocked();
+
+    if (!started_) {
+        started_ = true;
+        current_ = std::min(throughput, cap);
+        stats_.selected = current_;
+        return current_;
+    }
+
+    int64_t low_us, target_us;
+    bolaLevelsLocked(low_us, target_us);
+    size_t candidate = throughput;
+    if (buffer_us >= low_us) {
+        /* BOLA, but never above what the network sustains (BOLA-O) */
+        candidate = std::min(bolaIndexLocked(buffer_us), std::max(throughput, current_));
+    }
+    candidate = std::min(candidate, cap);
+
+    if (current_ > cap) {
+        switchToLocked(cap);   /* Cap lowered: obey at once */
+    } else if (candidate > current_) {
+        if (++up_votes_ >= config_.up_switch_decisions) switchToLocked(candidate);
+    } else {
+        up_votes_ = 0;
+        if (candidate < current_) {
+            /* Hold while the buffer is healthy and the network carries the current bitrate */
+            const bool sustainable =
+                estimateLocked() * config_.safety_factor >= ladder_[current_].bandwidth_bps;
+            if (buffer_us < low_us || !sustainable) switchToLocked(candidate);
+        }
+    }
+    return current_;
+}
+
+AbrStats AbrController::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    AbrStats stats = stats_;
+    stats.estimate_bps = estimateLocked();
+    return stats;
+}
+
+} // namespace streaming::media
@@ -0,0 +1,126 @@
+/**
+ * @file abr_controller.hpp
+ * @brief Adaptive bitrate selection for segmented streams (HLS / DASH)
+ * @copyright 2025 Streaming Device Project
+ *
+ * Two signals pick the rendition of the next segment. A throughput
+ * estimate (the lower of a fast and a slow EWMA over segment downloads)
+ * drives startup and low buffer, where a wrong guess means a stall. Once
+ * the buffer is healthy a BOLA buffer-occupancy rule takes over: it is
+ * immune to bursty throughput samples and fills the buffer towards its
+ * target. The BOLA choice never exceeds what the network sustains, and
+ * hysteresis (several agreeing decisions to go up, no drop while the
+ * buffer is healthy and the current bitrate sustainable) stops the choice
+ * flapping between neighbours. StreamQuality LOW..ULTRA caps the ladder.
+ *
+ * BOLA's buffer targets assume the player can hold that much media
+ * ahead. When it cannot (a few prefetched segments), setBufferCeiling()
+ * scales them down so the top rendition stays reachable.
+ */
+
+#pragma once
+
+#include <streaming_device/types.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace streaming::media {
+
+/** One variant of the ladder */
+struct Rendition {
+    uint32_t bandwidth_bps{0};   /* Peak (HLS BANDWIDTH) or declared bitrate */
+    uint32_t width{0};
+    uint32_t height{0};
+};
+
+/** Tuning; defaults follow common player practice */
+struct AbrConfig {
+    double fast_half_life_s{2.0};
+    double slow_half_life_s{5.0};
+    double safety_factor{0.9};          /* Fraction of the estimate a rendition may use */
+    uint32_t initial_estimate_bps{2000000};
+    int64_t buffer_low_us{10000000};    /* Below: throughput rule only */
+    int64_t buffer_target_us{24000000}; /* BOLA reaches the top rendition here, or at the ceiling */
+    uint32_t up_switch_decisions{2};    /* Consecutive decisions wanting more before going up */
+};
+
+/** Controller counters */
+struct AbrStats {
+    size_t selected{0};           /* Index into the ladder, lowest first */
+    uint32_t estimate_bps{0};
+    uint64_t samples{0};          /* Downloads that fed the estimate */
+    uint64_t switches_up{0};
+    uint64_t switches_down{0};
+    device::StreamQuality cap{device::StreamQuality::AUTO};
+};
+
+/**
+ * @brief Rendition selection
+ *
+ * Thread safe: downloads are reported from the fetch thread while the
+ * quality cap is set from the service.
+ */
+class AbrController {
+public:
+    explicit AbrController(AbrConfig config = {});
+
+    /** Replace the ladder (sorted here by bandwidth); restarts at the estimate */
+    void setRenditions(std::vector<Rendition> renditions);
+    std::vector<Rendition> getRenditions() const;
+
+    /** AUTO and ULTRA leave the ladder open; LOW/MEDIUM/HIGH cap at 480p/720p/1080p */
+    void setQualityCap(device::StreamQuality cap);
+
+    /**
+     * Most media the player can buffer ahead, 0 for no limit. BOLA's low
+     * and target levels shrink in proportion to fit under it.
+     */
+    void setBufferCeiling(int64_t ceiling_us);
+
+    /** Feed one completed download; samples under 16 KB are too noisy and ignored */
+    void onDownload(uint64_t bytes, int64_t duration_us);
+
+    /** Rendition for the next segment given the media buffered ahead of playback */
+    size_t selectRendition(int64_t buffer_us);
+
+    /** Current throughput estimate in bits per second */
+    uint32_t getEstimate() const;
+
+    AbrStats getStats() const;
+
+    /** Highest ladder index at or below the cap height */
+    static size_t capIndex(const std::vector<Rendition>& ladder, device::StreamQuality cap);
+
+private:
+    /** Zero-bias-corrected EWMA weighted by sample duration */
+    struct Ewma {
+        double half_life_s;
+        double estimate{0.0};
+        double total_weight{0.0};
+        void sample(double weight_s, double value);
+        double get() const;
+    };
+
+    uint32_t estimateLocked() const;
+    size_t throughputIndexLocked() const;
+    /** BOLA's low and target buffer levels for this ladder and ceiling */
+    void bolaLevelsLocked(int64_t& low_us, int64_t& target_us) const;
+    size_t bolaIndexLocked(int64_t buffer_us) const;
+    void switchToLocked(size_t index);
+
+    const AbrConfig config_;
+    mutable std::mutex mutex_;
+    std::vector<Rendition> ladder_;
+    Ewma fast_;
+    Ewma slow_;
+    device::StreamQuality cap_{device::StreamQuality::AUTO};
+    int64_t ceiling_us_{0};
+    size_t current_{0};
+    uint32_t up_votes_{0};
+    bool started_{false};
+    AbrStats stats_;
+};
+
+} // namespace streaming::media
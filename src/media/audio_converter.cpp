@@ -0,0 +1,333 @@
+/**
+ * @file audio_converter.cpp
+ * @brief AudioConverter implementation - downmix matrices and polyphase filter
+ */
+
+#include "audio_converter.hpp"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define STREAMING_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+namespace streaming::media {
+
+namespace {
+
+constexpr uint32_t kMaxChannels = 8;
+constexpr uint32_t kMaxPhases = 2048;
+constexpr float kPassband = 0.92f;   /* Cutoff as a fraction of the lower Nyquist */
+
+/* Downmix to stereo, WAVE channel order, before normalization. Rows: L then R. */
+const float kDownmix[kMaxChannels + 1][2][kMaxChannels] = {
+    {}, {}, {},
+    /* 3.0: FL FR FC */
+    {{1, 0, 0.7071f}, {0, 1, 0.7071f}},
+    /* 4.0: FL FR BL BR */
+    {{1, 0, 0.7071f, 0}, {0, 1, 0, 0.7071f}},
+    /* 5.0: FL FR FC BL BR */
+    {{1, 0, 0.7071f, 0.7071f, 0}, {0, 1, 0.7071f, 0, 0.7071f}},
+    /* 5.1: FL FR FC LFE SL SR */
+    {{1, 0, 0.7071f, 0, 0.7071f, 0}, {0, 1, 0.7071f, 0, 0, 0.7071f}},
+    /* 6.1: FL FR FC LFE BC SL SR */
+    {{1, 0, 0.7071f, 0, 0.5f, 0.7071f, 0}, {0, 1, 0.7071f, 0, 0.5f, 0, 0.7071f}},
+    /* 7.1: FL FR FC LFE BL BR SL SR */
+    {{1, 0, 0.7071f, 0, 0.7071f, 0, 0.7071f, 0}, {0, 1, 0.7071f, 0, 0, 0.7071f, 0, 0.7071f}},
+};
+
+inline int16_t toS16(float v) {
+    const long r = std::lrintf(v);
+    return static_cast<int16_t>(std::clamp<long>(r, -32768, 32767));
+}
+
+float dotScalar(const float* x, const float* h, uint32_t n) {
+    float acc = 0;
+    for (uint32_t i = 0; i < n; ++i) acc += x[i] * h[i];
+    return acc;
+}
+
+/* Mix one interleaved frame (channels <= 8) with two zero-padded rows */
+void mixFrameScalar(const int16_t* in, uint32_t channels, const float* rows, float& l, float& r) {
+    l = 0;
+    r = 0;
+    for (uint32_t c = 0; c < channels; ++c) {
+        l += in[c] * rows[c];
+        r += in[c] * rows[kMaxChannels + c];
+    }
+}
+
+#ifdef STREAMING_X86_SIMD
+
+__attribute__((target("sse2")))
+inline float hsumSse2(__m128 v) {
+    __m128 shuf = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+    __m128 sums = _mm_add_ps(v, shuf);
+    shuf = _mm_movehl_ps(shuf, sums);
+    return _mm_cvtss_f32(_mm_add_ss(sums, shuf));
+}
+
+__attribute__((target("sse2")))
+float dotSse2(const float* x, const float* h, uint32_t n) {
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    uint32_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(x + i), _mm_loadu_ps(h + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(x + i + 4), _mm_loadu_ps(h + i + 4)));
+    }
+    return hsumSse2(_mm_add_ps(acc0, acc1)) + dotScalar(x + i, h + i, n - i);
+}
+
+/* Eight int16 lanes to two float vectors */
+__attribute__((target("sse2")))
+inline void loadS16x8Sse2(const int16_t* in, __m128& lo, __m128& hi) {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+    const __m128i sign = _mm_srai_epi16(v, 15);
+    lo = _mm_cvtepi32_ps(_mm_unpacklo_epi16(v, sign));
+    hi = _mm_cvtepi32_ps(_mm_unpackhi_epi16(v, sign));
+}
+
+/* Reads 8 samples; caller guarantees they are addressable */
+__attribute__((target("sse2")))
+void mixFrameSse2(const int16_t* in, uint32_t /*channels*/, const float* rows, float& l, float& r) {
+    __m128 lo, hi;
+    loadS16x8Sse2(in, lo, hi);
+    l = hsumSse2(_mm_add_ps(_mm_mul_ps(lo, _mm_loadu_ps(rows)),
+                            _mm_mul_ps(hi, _mm_loadu_ps(rows + 4))));
+    r = hsumSse2(_mm_add_ps(_mm_mul_ps(lo, _mm_loadu_ps(rows + kMaxChannels)),
+                            _mm_mul_ps(hi, _mm_loadu_ps(rows + kMaxChannels + 4))));
+}
+
+__attribute__((target("avx2")))
+inline float hsumAvx2(__m256 v) {
+    const __m128 lo = _mm256_castps256_ps128(v);
+    const __m128 hi = _mm256_extractf128_ps(v, 1);
+    __m128 s = _mm_add_ps(lo, hi);
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 0x55));
+    return _mm_cvtss_f32(s);
+}
+
+__attribute__((target("avx2")))
+float dotAvx2(const float* x, const float* h, uint32_t n) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    uint32_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(h + i)));
+        acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(_mm256_loadu_ps(x + i + 8), _mm256_loadu_ps(h + i + 8)));
+    }
+    return hsumAvx2(_mm256_add_ps(acc0, acc1)) + dotScalar(x + i, h + i, n - i);
+}
+
+__attribute__((target("avx2")))
+void mixFrameAvx2(const int16_t* in, uint32_t /*channels*/, const float* rows, float& l, float& r) {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+    const __m256 f = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(v));
+    l = hsumAvx2(_mm256_mul_ps(f, _mm256_loadu_ps(rows)));
+    r = hsumAvx2(_mm256_mul_ps(f, _mm256_loadu_ps(rows + kMaxChannels)));
+}
+
+#endif
+
+using DotFn = float (*)(const float*, const float*, uint32_t);
+using MixFrameFn = void (*)(const int16_t*, uint32_t, const float*, float&, float&);
+
+DotFn dotKernel(DspKernel kernel) {
+#ifdef STREAMING_X86_SIMD
+    if (kernel == DspKernel::AVX2) return dotAvx2;
+    if (kernel == DspKernel::SSE2) return dotSse2;
+#endif
+    (void)kernel;
+    return dotScalar;
+}
+
+MixFrameFn mixKernel(DspKernel kernel) {
+#ifdef STREAMING_X86_SIMD
+    if (kernel == DspKernel::AVX2) return mixFrameAvx2;
+    if (kernel == DspKernel::SSE2) return mixFrameSse2;
+#endif
+    (void)kernel;
+    return mixFrameScalar;
+}
+
+} // namespace
+
+bool AudioConverter::isKernelSupported(DspKernel kernel) {
+    switch (kernel) {
+        case DspKernel::SCALAR: return true;
+#ifdef STREAMING_X86_SIMD
+        case DspKernel::SSE2: return __builtin_cpu_supports("sse2");
+        case DspKernel::AVX2: return __builtin_cpu_supports("avx2");
+#endif
+        default: return false;
+    }
+}
+
+bool AudioConverter::isSupported(uint32_t in_rate, uint32_t in_channels,
+                                 uint32_t out_rate, uint32_t out_channels) {
+    const bool channels_ok = in_channels == out_channels ||
+                             (in_channels == 1 && out_channels == 2) ||
+                             (out_channels == 2 && in_channels >= 3 && in_channels <= kMaxChannels);
+    if (!channels_ok || in_rate == 0 || out_rate == 0 || in_channels == 0 || in_channels > kMaxChannels)
+        return false;
+    return out_rate / std::gcd(in_rate, out_rate) <= kMaxPhases;
+}
+
+AudioConverter::AudioConverter(uint32_t in_rate, uint32_t in_channels,
+                               uint32_t out_rate, uint32_t out_channels)
+    : in_rate_(in_rate)
+    , in_channels_(in_channels)
+    , out_rate_(out_rate)
+    , out_channels_(out_channels) {
+    if (isKernelSupported(DspKernel::AVX2)) kernel_ = DspKernel::AVX2;
+    else if (isKernelSupported(DspKernel::SSE2)) kernel_ = DspKernel::SSE2;
+
+    valid_ = isSupported(in_rate, in_channels, out_rate, out_channels);
+    if (!valid_) return;
+
+    const uint32_t g = std::gcd(in_rate, out_rate);
+    up_ = out_rate / g;
+    down_ = in_rate / g;
+    buildMatrix();
+    buildFilter();
+    reset();
+}
+
+bool AudioConverter::isIdentity() const {
+    return in_rate_ == out_rate_ && in_channels_ == out_channels_;
+}
+
+void AudioConverter::setKernel(DspKernel kernel) {
+    kernel_ = isKernelSupported(kernel) ? kernel : DspKernel::SCALAR;
+}
+
+void AudioConverter::buildMatrix() {
+    matrix_.assign(2 * kMaxChannels, 0.0f);
+    if (out_channels_ != 2 || in_channels_ < 3) return;
+    for (uint32_t row = 0; row < 2; ++row) {
+        const float* coeffs = kDownmix[in_channels_][row];
+        float sum = 0;
+        for (uint32_t c = 0; c < in_channels_; ++c) sum += coeffs[c];
+        for (uint32_t c = 0; c < in_channels_; ++c) matrix_[row * kMaxChannels + c] = coeffs[c] / sum;
+    }
+}
+
+void AudioConverter::buildFilter() {
+    phases_.clear();
+    if (up_ == down_) return;
+
+    /* Prototype low-pass at L * in_rate, Blackman-windowed sinc */
+    const uint32_t length = up_ * kTaps;
+    const double cutoff = kPassband * 0.5 / std::max(up_, down_);  /* cycles per prototype sample */
+    const double center = (length - 1) / 2.0;
+    std::vector<double> proto(length);
+    for (uint32_t n = 0; n < length; ++n) {
+        const double t = n - center;
+        const double sinc = (t == 0) ? 2 * cutoff : std::sin(2 * M_PI * cutoff * t) / (M_PI * t);
+        const double w = 0.42 - 0.5 * std::cos(2 * M_PI * n / (length - 1)) +
+                         0.08 * std::cos(4 * M_PI * n / (length - 1));
+        proto[n] = sinc * w * up_;
+    }
+
+    /* Phase p uses taps p, p+L, p+2L...; store reversed for a forward dot product */
+    phases_.resize(static_cast<size_t>(up_) * kTaps);
+    for (uint32_t p = 0; p < up_; ++p)
+        for (uint32_t k = 0; k < kTaps; ++k)
+            phases_[p * kTaps + (kTaps - 1 - k)] = static_cast<float>(proto[p + k * up_]);
+}
+
+void AudioConverter::reset() {
+    planes_.assign(out_channels_, std::vector<float>());
+    if (up_ != down_)
+        for (auto& plane : planes_) plane.assign(kTaps - 1, 0.0f);
+    phase_ = 0;
+    pos_ = kTaps - 1;
+}
+
+size_t AudioConverter::estimateOutputFrames(size_t in_frames) const {
+    return static_cast<size_t>(static_cast<uint64_t>(in_frames) * up_ / down_);
+}
+
+void AudioConverter::mix(const int16_t* in, size_t frames) {
+    const size_t base = planes_[0].size();
+    for (auto& plane : planes_) plane.resize(base + frames);
+
+    if (in_channels_ == out_channels_) {
+        for (uint32_t c = 0; c < in_channels_; ++c) {
+            float* dst = planes_[c].data() + base;
+            for (size_t f = 0; f < frames; ++f) dst[f] = in[f * in_channels_ + c];
+        }
+        return;
+    }
+    float* left = planes_[0].data() + base;
+    float* right = planes_[1].data() + base;
+    if (in_channels_ == 1) {
+        for (size_t f = 0; f < frames; ++f) left[f] = right[f] = in[f];
+        return;
+    }
+
+    /* Vector kernels load 8 samples per frame; the tail of the buffer goes scalar */
+    const MixFrameFn vec = mixKernel(kernel_);
+    const size_t total = frames * in_channels_;
+    for (size_t f = 0; f < frames; ++f) {
+        const int16_t* frame = in + f * in_channels_;
+        if (f * in_channels_ + kMaxChannels <= total) vec(frame, in_channels_, matrix_.data(), left[f], right[f]);
+        else mixFrameScalar(frame, in_channels_, matrix_.data(), left[f], right[f]);
+    }
+}
+
+void AudioConverter::resample(std::vector<int16_t>& out, size_t& produced) {
+    const size_t available = planes_[0].size();
+    const size_t base = out.size();
+    if (up_ == down_) {
+        out.resize(base + available * out_channels_);
+        int16_t* dst = out.data() + base;
+        for (size_t i = 0; i < available; ++i)
+            for (uint32_t c = 0; c < out_channels_; ++c) *dst++ = toS16(planes_[c][i]);
+        produced += available;
+        for (auto& plane : planes_) plane.clear();
+        return;
+    }
+
+    /* Upper bound on the outputs this call can produce, trimmed afterwards */
+    const size_t max_frames = (available * up_) / down_ + 2;
+    out.resize(base + max_frames * out_channels_);
+    int16_t* dst = out.data() + base;
+    const DotFn dot = dotKernel(kernel_);
+    size_t frames = 0;
+    while (pos_ < available && frames < max_frames) {
+        const float* taps = phases_.data() + static_cast<size_t>(phase_) * kTaps;
+        const size_t first = pos_ + 1 - kTaps;
+        for (uint32_t c = 0; c < out_channels_; ++c)
+            *dst++ = toS16(dot(planes_[c].data() + first, taps, kTaps));
+        ++frames;
+        phase_ += down_;
+        pos_ += phase_ / up_;
+        phase_ %= up_;
+    }
+    out.resize(base + frames * out_channels_);
+    produced += frames;
+
+    /* Keep the kTaps - 1 samples the next output still needs */
+    const size_t drop = std::min(pos_ + 1 - kTaps, available);
+    for (auto& plane : planes_) plane.erase(plane.begin(), plane.begin() + static_cast<std::ptrdiff_t>(drop));
+    pos_ -= drop;
+}
+
+size_t AudioConverter::process(const int16_t* in, size_t frames, std::vector<int16_t>& out) {
+    if (!valid_ || !in || frames == 0) return 0;
+    if (isIdentity()) {
+        out.insert(out.end(), in, in + frames * in_channels_);
+        return frames;
+    }
+    mix(in, frames);
+    size_t produced = 0;
+    resample(out, produced);
+    return produced;
+}
+
+} // namespace streaming::media
@@ -0,0 +1,110 @@
+/**
+ * @file audio_converter.hpp
+ * @brief PCM format conversion - channel downmix and polyphase resampling
+ * @copyright 2025 Streaming Device Project
+ *
+ * Runs between audio decode and the sink when the sink cannot take the
+ * decoded format (e.g. 44.1 kHz 5.1 content on a 48 kHz stereo A2DP link).
+ * Channels are mixed down first so the resampler filters as few channels
+ * as possible. The resampler is a windowed-sinc polyphase filter: the
+ * rate ratio is reduced to L/M (44.1 -> 48 kHz is 160/147) and every
+ * output sample is one dot product of kTaps input samples with one of the
+ * L filter phases. Dot products and the downmix use AVX2 or SSE2 when the
+ * CPU has them, with a scalar fallback.
+ */
+
+#pragma once
+
+#include <streaming_device/types.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace streaming::media {
+
+/** DSP kernel implementation */
+enum class DspKernel : uint8_t {
+    SCALAR,
+    SSE2,
+    AVX2
+};
+
+/**
+ * @brief Streaming PCM converter
+ *
+ * Input and output are interleaved signed 16-bit. Channel layouts follow
+ * WAVE order: 5.1 is FL FR FC LFE SL SR, 7.1 is FL FR FC LFE BL BR SL SR.
+ * Supported channel conversions: identity, mono to stereo, and 3..8
+ * channels to stereo (ITU-R BS.775 coefficients, LFE dropped, normalized
+ * so a full-scale input cannot clip).
+ */
+class AudioConverter {
+public:
+    /** Filter taps per polyphase branch */
+    static constexpr uint32_t kTaps = 32;
+
+    AudioConverter(uint32_t in_rate, uint32_t in_channels,
+                   uint32_t out_rate, uint32_t out_channels);
+
+    /** True if a converter between these formats would be valid */
+    static bool isSupported(uint32_t in_rate, uint32_t in_channels,
+                            uint32_t out_rate, uint32_t out_channels);
+
+    /** False if the channel conversion is unsupported */
+    bool isValid() const { return valid_; }
+
+    /** True when input and output formats match (process() only copies) */
+    bool isIdentity() const;
+
+    /**
+     * Convert frames of input, appending to out. Filter state carries
+     * across calls, so a stream can be fed in arbitrary chunks. Returns
+     * the output frames produced.
+     */
+    size_t process(const int16_t* in, size_t frames, std::vector<int16_t>& out);
+
+    /** Drop filter history (seek) */
+    void reset();
+
+    /** Output frames that will be produced for in_frames of input (+-1) */
+    size_t estimateOutputFrames(size_t in_frames) const;
+
+    uint32_t getInputRate() const { return in_rate_; }
+    uint32_t getOutputRate() const { return out_rate_; }
+    uint32_t getInputChannels() const { return in_channels_; }
+    uint32_t getOutputChannels() const { return out_channels_; }
+
+    /** Force a kernel (tests, benchmarks); falls back if unsupported */
+    void setKernel(DspKernel kernel);
+    DspKernel getKernel() const { return kernel_; }
+
+    static bool isKernelSupported(DspKernel kernel);
+
+private:
+    void buildMatrix();
+    void buildFilter();
+    void mix(const int16_t* in, size_t frames);
+    void resample(std::vector<int16_t>& out, size_t& produced);
+
+    uint32_t in_rate_;
+    uint32_t in_channels_;
+    uint32_t out_rate_;
+    uint32_t out_channels_;
+    bool valid_{true};
+    DspKernel kernel_{DspKernel::SCALAR};
+
+    /* Downmix: out_channels x 8 coefficients, rows zero padded to 8 */
+    std::vector<float> matrix_;
+
+    /* Polyphase filter: up_ phases of kTaps coefficients, reversed for a forward dot product */
+    uint32_t up_{1};
+    uint32_t down_{1};
+    std::vector<float> phases_;
+
+    /* Planar float history per output channel: kTaps - 1 old samples + new input */
+    std::vector<std::vector<float>> planes_;
+    uint32_t phase_{0};
+    size_t pos_{kTaps - 1};   /* Newest input sample used by the next output */
+};
+
+} // namespace streaming::media
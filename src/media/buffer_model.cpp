@@ -0,0 +1,118 @@
+/**
+ * @file buffer_model.cpp
+ * @brief BufferModel implementation
+ */
+
+#include "buffer_model.hpp"
+#include <algorithm>
+
+namespace streaming::media {
+
+int64_t TrackBuffer::durationUs() const {
+    int64_t total = 0;
+    for (const auto& l : levels) total += l.duration_us;
+    return total;
+}
+
+uint64_t TrackBuffer::bytes() const {
+    uint64_t total = 0;
+    for (const auto& l : levels) total += l.bytes;
+    return total;
+}
+
+BufferModel::BufferModel(BufferWatermarks watermarks) : watermarks_(sanitize(watermarks)) {}
+
+BufferWatermarks BufferModel::sanitize(BufferWatermarks w) {
+    w.low_us = std::max<int64_t>(w.low_us, 0);
+    w.start_us = std::max(w.start_us, w.low_us);
+    w.resume_us = std::max(w.resume_us, w.start_us);
+    return w;
+}
+
+void BufferModel::setWatermarks(BufferWatermarks watermarks) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    watermarks_ = sanitize(watermarks);
+}
+
+BufferWatermarks BufferModel::getWatermarks() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return watermarks_;
+}
+
+void BufferModel::restart(int64_t now_us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (phase_ == Phase::STALLED) stats_.rebuffer_us += now_us - phase_since_us_;
+    phase_ = Phase::STARTING;
+    phase_since_us_ = now_us;
+    stats_.waiting = true;
+    stats_.progress = 0;
+}
+
+bool BufferModel::evaluate(const BufferSnapshot& snapshot, int64_t now_us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    int64_t buffered = snapshot.video.durationUs();
+    if (snapshot.has_audio) buffered = std::min(buffered, snapshot.audio.durationUs());
+    stats_.video = snapshot.video;
+    stats_.audio = snapshot.audio;
+    stats_.buffered_us = buffered;
+
+    /* A full pipeline or a finished stream cannot buffer more: good enough for any watermark */
+    const bool complete = snapshot.saturated || snapshot.end_of_stream;
+    int64_t target = 0;
+    switch (phase_) {
+        case Phase::STARTING:
+            target = watermarks_.start_us;
+            if (complete || buffered >= target) {
+                stats_.last_start_us = now_us - phase_since_us_;
+                phase_ = Phase::PLAYABLE;
+                phase_since_us_ = now_us;
+            }
+            break;
+        case Phase::PLAYABLE:
+            if (!complete && buffered < watermarks_.low_us) {
+                stats_.rebuffers++;
+                phase_ = Phase::STALLED;
+                phase_since_us_ = now_us;
+                target = watermarks_.resume_us;
+            }
+            break;
+        case Phase::STALLED:
+            target = watermarks_.resume_us;
+            if (complete || buffered >= target) {
+                stats_.rebuffer_us += now_us - phase_since_us_;
+                phase_ = Phase::PLAYABLE;
+                phase_since_us_ = now_us;
+            }
+            break;
+    }
+
+    stats_.waiting = phase_ != Phase::PLAYABLE;
+    stats_.progress = !stats_.waiting || target <= 0
+        ? 100
+        : static_cast<uint8_t>(std::clamp<int64_t>(buffered * 100 / target, 0, 99));
+    return stats_.waiting;
+}
+
+bool BufferModel::isWaiting() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_.waiting;
+}
+
+uint8_t BufferModel::getProgress() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_.progress;
+}
+
+BufferStats BufferModel::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void BufferModel::reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    phase_ = Phase::STARTING;
+    phase_since_us_ = 0;
+    stats_ = {};
+}
+
+} // namespace streaming::media
@@ -0,0 +1,128 @@
+/**
+ * @file buffer_model.hpp
+ * @brief Buffer occupancy model and rebuffering decisions for playback
+ * @copyright 2025 Streaming Device Project
+ *
+ * Media ahead of the playhead sits at three levels: downloaded but not
+ * yet demuxed (NETWORK), demuxed packets waiting for a decoder (DEMUX),
+ * and decoded frames / PCM waiting for presentation (DECODED). The model
+ * sums duration and bytes over the levels per track; the playable buffer
+ * is that of the track with the least, since playback stops when either
+ * runs dry.
+ *
+ * Three watermarks turn occupancy into decisions. Playback starts (after
+ * open or a seek) once the start watermark is buffered, stalls when the
+ * buffer falls under the low watermark, and resumes from a stall at the
+ * resume watermark, which sits above start so a marginal network does
+ * not stall again straight away. A full pipeline (nothing more can be
+ * buffered) or the end of the stream satisfies any watermark.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+namespace streaming::media {
+
+/** Where buffered media sits, upstream first */
+enum class BufferLevel : uint8_t {
+    NETWORK = 0,   /* Downloaded segments not yet handed to the demuxer */
+    DEMUX = 1,     /* Encoded packets queued for a decoder */
+    DECODED = 2,   /* Frames and PCM queued for presentation */
+};
+
+constexpr size_t kBufferLevelCount = 3;
+
+/** Media held at one level */
+struct BufferOccupancy {
+    int64_t duration_us{0};
+    uint64_t bytes{0};
+};
+
+/** One track across every level */
+struct TrackBuffer {
+    BufferOccupancy levels[kBufferLevelCount];
+
+    BufferOccupancy& at(BufferLevel level) { return levels[static_cast<size_t>(level)]; }
+    const BufferOccupancy& at(BufferLevel level) const { return levels[static_cast<size_t>(level)]; }
+    int64_t durationUs() const;
+    uint64_t bytes() const;
+};
+
+/** Occupancy sample taken from the pipeline */
+struct BufferSnapshot {
+    TrackBuffer video;
+    TrackBuffer audio;
+    bool has_audio{false};
+    bool end_of_stream{false};   /* Demux has read the last packet */
+    bool saturated{false};       /* Queues full: nothing more can be buffered now */
+};
+
+/** Watermarks, in media time buffered ahead of the playhead */
+struct BufferWatermarks {
+    int64_t start_us{1000000};    /* Needed to start after open or a seek */
+    int64_t resume_us{1500000};   /* Needed to leave a stall */
+    int64_t low_us{500000};       /* Stall below this while playing */
+};
+
+/** Model counters and the latest sample */
+struct BufferStats {
+    TrackBuffer video;
+    TrackBuffer audio;
+    int64_t buffered_us{0};      /* Playable: the lesser of video and audio */
+    uint8_t progress{0};         /* 0-100 towards the watermark being waited for, 100 when playable */
+    bool waiting{true};          /* Playback must wait for data */
+    uint64_t rebuffers{0};       /* Stalls under the low watermark (start and seeks excluded) */
+    int64_t rebuffer_us{0};      /* Total time spent in those stalls */
+    int64_t last_start_us{0};    /* Time the last start or seek waited for the start watermark */
+};
+
+/**
+ * @brief Watermark state machine over occupancy samples
+ *
+ * Thread safe: the pipeline feeds samples from its monitor while stats
+ * and progress are read from the service.
+ */
+class BufferModel {
+public:
+    explicit BufferModel(BufferWatermarks watermarks = {});
+
+    /** Replace the watermarks; low <= start <= resume is enforced by raising */
+    void setWatermarks(BufferWatermarks watermarks);
+    BufferWatermarks getWatermarks() const;
+
+    /** Queues were flushed (open, seek): wait for the start watermark again */
+    void restart(int64_t now_us);
+
+    /**
+     * Feed one sample taken at now_us. Returns true while playback has to
+     * wait for data: before the start watermark, and from an underrun
+     * until the resume watermark.
+     */
+    bool evaluate(const BufferSnapshot& snapshot, int64_t now_us);
+
+    bool isWaiting() const;
+
+    /** Progress towards playable, 0-100 */
+    uint8_t getProgress() const;
+
+    BufferStats getStats() const;
+
+    /** Forget counters and samples */
+    void reset();
+
+private:
+    enum class Phase : uint8_t { STARTING, PLAYABLE, STALLED };
+
+    static BufferWatermarks sanitize(BufferWatermarks w);
+
+    mutable std::mutex mutex_;
+    BufferWatermarks watermarks_;
+    Phase phase_{Phase::STARTING};
+    int64_t phase_since_us_{0};
+    BufferStats stats_;
+};
+
+} // namespace streaming::media
@@ -0,0 +1,105 @@
+/**
+ * @file compositor.hpp
+ * @brief Software compositor - alpha-blends the UI layer over video
+ * @copyright 2025 Streaming Device Project
+ *
+ * Fallback for displays without a hardware overlay plane: menus and OSD
+ * rendered by the UI are blended into the video frame in place. The frame
+ * is processed in tiles; fully transparent UI tiles are skipped and fully
+ * opaque tiles are copied, so a small OSD over full-screen video only pays
+ * for the pixels it covers. Blend kernels use AVX2 or SSE2 when the CPU
+ * has them, with a scalar fallback.
+ *
+ * The playback engine's present stage runs it on every frame shown while
+ * an OverlayImage is set on the pipeline (IStreamPipeline::setOverlay).
+ * A UI layer drawn at another resolution than the video is rescaled once
+ * (nearest neighbour) and the result reused until either size changes.
+ */
+
+#pragma once
+
+#include <streaming_device/types.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace streaming::media {
+
+/**
+ * 32-bit pixel surface. Pixels are ARGB8888 words in native (little-endian)
+ * order, i.e. alpha is the fourth byte of every pixel.
+ */
+struct Surface {
+    uint8_t* pixels{nullptr};
+    uint32_t width{0};
+    uint32_t height{0};
+    uint32_t stride{0};   /* Bytes per row */
+};
+
+/** How the UI layer's color channels relate to its alpha */
+enum class AlphaMode : uint8_t {
+    STRAIGHT,        /* Color not yet multiplied by alpha */
+    PREMULTIPLIED
+};
+
+/** Blend kernel implementation */
+enum class BlendKernel : uint8_t {
+    SCALAR,
+    SSE2,
+    AVX2
+};
+
+/**
+ * A UI layer handed to the video path. Immutable once shared, so the
+ * present stage reads it without racing the renderer; publish a new one
+ * to change what is shown.
+ */
+struct OverlayImage {
+    std::vector<uint8_t> pixels;   /* width * height 32-bit pixels, rows packed, alpha fourth */
+    uint32_t width{0};
+    uint32_t height{0};
+    AlphaMode mode{AlphaMode::PREMULTIPLIED};
+};
+
+/** Per-tile work counters */
+struct CompositorStats {
+    uint64_t tiles_blended{0};
+    uint64_t tiles_copied{0};    /* Fully opaque UI */
+    uint64_t tiles_skipped{0};   /* Fully transparent UI */
+    uint64_t layers_scaled{0};   /* UI layers resampled to the video size */
+    uint64_t layers_rejected{0}; /* Blends or scales refused: bad or mismatched surfaces */
+};
+
+/**
+ * @brief Alpha-blending compositor
+ */
+class Compositor {
+public:
+    static constexpr uint32_t kTileWidth = 64;
+    static constexpr uint32_t kTileHeight = 16;
+
+    /** Selects the fastest kernel the CPU supports */
+    Compositor();
+
+    /** Blend overlay over video in place; both surfaces must be the same size */
+    device::Result blend(const Surface& overlay, AlphaMode mode, Surface& video);
+
+    /** Resample overlay to width x height (nearest neighbour) into out */
+    device::Result scale(const OverlayImage& overlay, uint32_t width, uint32_t height,
+                         OverlayImage& out);
+
+    /** Force a kernel (tests, benchmarks); falls back if unsupported */
+    void setKernel(BlendKernel kernel);
+    BlendKernel getKernel() const { return kernel_; }
+
+    /** Check if a kernel can run on this CPU */
+    static bool isKernelSupported(BlendKernel kernel);
+
+    CompositorStats getStats() const { return stats_; }
+    void resetStats() { stats_ = {}; }
+
+private:
+    BlendKernel kernel_{BlendKernel::SCALAR};
+    CompositorStats stats_;
+};
+
+} // namespace streaming::media
@@ -0,0 +1,95 @@
+/**
+ * @file frame_pool.cpp
+ * @brief FramePool implementation
+ */
+
+#include "frame_pool.hpp"
+#include <algorithm>
+
+namespace streaming::media {
+
+FramePool::FramePool(uint32_t buffer_count, common::MemoryGovernor& governor)
+    : slots_(buffer_count), memory_(governor.registerPool("frame pool", common::MemoryClass::FRAMES)) {}
+
+device::Result FramePool::acquire(size_t size, DecodedFrame& frame) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (size > buffer_size_) {
+        buffer_size_ = size;
+        memory_.setDemand(static_cast<uint64_t>(slots_.size()) * size,
+                          static_cast<uint64_t>(std::min<size_t>(kMinBuffers, slots_.size())) * size);
+    }
+    uint32_t in_use = 0;
+    for (const auto& s : slots_) in_use += s.in_use ? 1 : 0;
+    if (in_use >= usableLocked()) return device::Result::ERROR_BUSY;
+
+    /* Reuse an allocated buffer before allocating another */
+    size_t pick = slots_.size();
+    for (size_t i = 0; i < slots_.size(); ++i) {
+        if (slots_[i].in_use) continue;
+        if (pick == slots_.size() || slots_[i].storage.size() > slots_[pick].storage.size()) pick = i;
+    }
+    Slot& slot = slots_[pick];
+    if (slot.storage.size() < size) slot.storage.resize(size);
+    slot.in_use = true;
+    slot.id = next_id_++;
+    frame.data = slot.storage.data();
+    frame.size = size;
+    frame.handle.fd = kFdBase + static_cast<int32_t>(pick);
+    frame.handle.id = slot.id;
+    frame.handle.offset = 0;
+    frame.handle.modifier = 0;
+    memory_.setUsage(allocatedLocked());
+    return device::Result::OK;
+}
+
+void FramePool::release(const BufferHandle& handle) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const int32_t index = handle.fd - kFdBase;
+    if (index < 0 || index >= static_cast<int32_t>(slots_.size())) return;
+    Slot& slot = slots_[index];
+    /* Ignore stale releases for a buffer that has since been re-acquired */
+    if (!slot.in_use || slot.id != handle.id) return;
+    slot.in_use = false;
+    /* Give memory back while over the limit */
+    if (allocatedLocked() > memory_.getLimit()) {
+        std::vector<uint8_t>().swap(slot.storage);
+        memory_.setUsage(allocatedLocked());
+    }
+}
+
+uint32_t FramePool::usableLocked() const {
+    const auto count = static_cast<uint32_t>(slots_.size());
+    if (buffer_size_ == 0) return count;
+    const uint64_t fit = memory_.getLimit() / buffer_size_;
+    return std::min<uint32_t>(count, static_cast<uint32_t>(std::max<uint64_t>(fit, kMinBuffers)));
+}
+
+size_t FramePool::allocatedLocked() const {
+    size_t bytes = 0;
+    for (const auto& s : slots_) bytes += s.storage.size();
+    return bytes;
+}
+
+uint32_t FramePool::getBufferCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return static_cast<uint32_t>(slots_.size());
+}
+
+uint32_t FramePool::getBuffersInUse() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint32_t n = 0;
+    for (const auto& s : slots_) n += s.in_use ? 1 : 0;
+    return n;
+}
+
+size_t FramePool::getAllocatedBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return allocatedLocked();
+}
+
+uint32_t FramePool::getUsableBuffers() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return usableLocked();
+}
+
+} // namespace streaming::media
@@ -0,0 +1,69 @@
+/**
+ * @file frame_pool.hpp
+ * @brief Pooled decoder output buffers exported as dma-buf style handles
+ * @copyright 2025 Streaming Device Project
+ */
+
+#pragma once
+
+#include "hal/codec_hal.hpp"
+#include "common/memory_governor.hpp"
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace streaming::media {
+
+/**
+ * @brief Fixed-size frame buffer pool
+ *
+ * Buffers are allocated on first use at the requested size and reused
+ * until a larger size is requested (resolution change). Handles carry an
+ * emulated fd so the video plane can import them; on platforms with a
+ * dma-buf heap this is where the real export would happen.
+ *
+ * The pool registers with a MemoryGovernor as FRAMES. Under pressure
+ * fewer buffers circulate (never fewer than kMinBuffers) and buffers
+ * over the limit are freed as they come back.
+ */
+class FramePool : public hal::IFrameBufferPool {
+public:
+    explicit FramePool(uint32_t buffer_count,
+                       common::MemoryGovernor& governor = common::MemoryGovernor::instance());
+
+    device::Result acquire(size_t size, DecodedFrame& frame) override;
+    void release(const BufferHandle& handle) override;
+
+    uint32_t getBufferCount() const;
+    uint32_t getBuffersInUse() const;
+
+    /** Bytes currently allocated for pooled buffers */
+    size_t getAllocatedBytes() const;
+
+    /** Buffers that may be in use at once under the current memory limit */
+    uint32_t getUsableBuffers() const;
+
+    /** One on screen, one queued, one being decoded */
+    static constexpr uint32_t kMinBuffers = 3;
+
+private:
+    struct Slot {
+        std::vector<uint8_t> storage;
+        uint64_t id{0};
+        bool in_use{false};
+    };
+
+    static constexpr int32_t kFdBase = 1000;  /* Emulated fd range */
+
+    uint32_t usableLocked() const;
+    size_t allocatedLocked() const;
+
+    mutable std::mutex mutex_;
+    std::vector<Slot> slots_;
+    uint64_t next_id_{1};
+    size_t buffer_size_{0};   /* Largest size requested, for the governor's demand */
+    common::MemoryGovernor::Registration memory_;
+};
+
+} // namespace streaming::media
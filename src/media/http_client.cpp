@@ -0,0 +1,582 @@
+/**
+ * @file http_client.cpp
+ * @brief HttpClient / HttpByteSource implementation (POSIX sockets)
+ */
+
+#include "http_client.hpp"
+#include "../common/logger.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace streaming::media {
+
+namespace {
+
+constexpr size_t kReadChunk = 16 * 1024;
+constexpr size_t kMaxHeadBytes = 64 * 1024;
+
+int64_t nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::string lower(std::string s) {
+    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return s;
+}
+
+std::string trim(const std::string& s) {
+    const size_t b = s.find_first_not_of(" \t");
+    if (b == std::string::npos) return "";
+    return s.substr(b, s.find_last_not_of(" \t\r") - b + 1);
+}
+
+device::Result defaultResolve(const std::string& host, std::string& ip_out) {
+    in_addr addr{};
+    if (inet_pton(AF_INET, host.c_str(), &addr) == 1) {
+        ip_out = host;
+        return device::Result::OK;
+    }
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* res = nullptr;
+    if (getaddrinfo(host.c_str(), nullptr, &hints, &res) != 0 || !res) return device::Result::ERROR_NETWORK;
+    char buf[INET_ADDRSTRLEN] = {};
+    inet_ntop(AF_INET, &reinterpret_cast<sockaddr_in*>(res->ai_addr)->sin_addr, buf, sizeof(buf));
+    freeaddrinfo(res);
+    ip_out = buf;
+    return device::Result::OK;
+}
+
+device::Result statusResult(int status) {
+    if (status == 200 || status == 206) return device::Result::OK;
+    if (status == 404 || status == 410) return device::Result::ERROR_NOT_FOUND;
+    if (status == 401 || status == 403) return device::Result::ERROR_AUTH_FAILED;
+    if (status == 416) return device::Result::ERROR_INVALID_PARAM;
+    return device::Result::ERROR_NETWORK;
+}
+
+} // namespace
+
+HttpClient::Connection::~Connection() {
+    if (fd >= 0) ::close(fd);
+}
+
+HttpClient::HttpClient(HttpClientConfig config, HostResolver resolver)
+    : config_(config), resolver_(resolver ? std::move(resolver) : HostResolver(defaultResolve)) {}
+
+HttpClient::~HttpClient() { closeIdle(); }
+
+device::Result HttpClient::parseUrl(const std::string& uri, Url& out) {
+    const size_t scheme_end = uri.find("://");
+    if (scheme_end == std::string::npos) return device::Result::ERROR_INVALID_PARAM;
+    const std::string scheme = lower(uri.substr(0, scheme_end));
+    if (scheme == "https") return device::Result::ERROR_NOT_SUPPORTED;
+    if (scheme != "http") return device::Result::ERROR_INVALID_PARAM;
+
+    const size_t host_begin = scheme_end + 3;
+    size_t path_begin = uri.find_first_of("/?#", host_begin);
+    if (path_begin == std::string::npos) path_begin = uri.size();
+    std::string authority = uri.substr(host_begin, path_begin - host_begin);
+    const size_t at = authority.rfind('@');
+    if (at != std::string::npos) authority.erase(0, at + 1);
+    out = {};
+    const size_t colon = authority.rfind(':');
+    if (colon != std::string::npos) {
+        const int port = std::atoi(authority.c_str() + colon + 1);
+        if (port <= 0 || port > 65535) return device::Result::ERROR_INVALID_PARAM;
+        out.port = static_cast<uint16_t>(port);
+        authority.erase(colon);
+    }
+    if (authority.empty()) return device::Result::ERROR_INVALID_PARAM;
+    out.host = authority;
+    out.target = uri.substr(path_begin, uri.find('#', path_begin) - path_begin);
+    if (out.target.empty() || out.target[0] != '/') out.target.insert(0, "/");
+    return device::Result::OK;
+}
+
+std::string HttpClient::requestText(const Url& url, const HttpRange& range) {
+    std::string req = "GET " + url.target + " HTTP/1.1\r\nHost: " + url.host;
+    if (url.port != 80) req += ":" + std::to_string(url.port);
+    req += "\r\nUser-Agent: StreamingDevice/1.0\r\nAccept-Encoding: identity\r\n";
+    if (range.offset != 0 || range.length != 0) {
+        req += "Range: bytes=" + std::to_string(range.offset) + "-";
+        if (range.length != 0) req += std::to_string(range.offset + range.length - 1);
+        req += "\r\n";
+    }
+    return req + "\r\n";
+}
+
+// -----------------------------------------------------------------------------
+// Connection pool
+// -----------------------------------------------------------------------------
+
+device::Result HttpClient::acquire(const Url& url, std::unique_ptr<Connection>& conn) {
+    const std::string key = url.host + ":" + std::to_string(url.port);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = idle_.find(key);
+        const int64_t now = nowUs();
+        while (it != idle_.end() && !it->second.empty()) {
+            std::unique_ptr<Connection> candidate = std::move(it->second.back());
+            it->second.pop_back();
+            if (now - candidate->last_used_us > config_.idle_timeout_us) continue;
+            /* Readable while idle means the server closed it (or sent garbage): not reusable */
+            pollfd pfd{candidate->fd, POLLIN, 0};
+            if (::poll(&pfd, 1, 0) != 0) continue;
+            candidate->reused = true;
+            conn = std::move(candidate);
+            return device::Result::OK;
+        }
+    }
+    return connectTo(url, conn);
+}
+
+device::Result HttpClient::connectTo(const Url& url, std::unique_ptr<Connection>& conn) {
+    std::string ip;
+    if (resolver_(url.host, ip) != device::Result::OK) {
+        LOG_WARN("HttpClient", "Cannot resolve", url.host);
+        return device::Result::ERROR_NETWORK;
+    }
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(url.port);
+    if (inet_pton(AF_INET, ip.c_str(), &addr.sin_addr) != 1) return device::Result::ERROR_NETWORK;
+
+    auto c = std::make_unique<Connection>();
+    c->fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (c->fd < 0) return device::Result::ERROR_NETWORK;
+
+    /* Non-blocking connect bounded by connect_timeout_ms */
+    const int flags = fcntl(c->fd, F_GETFL, 0);
+    fcntl(c->fd, F_SETFL, flags | O_NONBLOCK);
+    if (::connect(c->fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        if (errno != EINPROGRESS) return device::Result::ERROR_NETWORK;
+        pollfd pfd{c->fd, POLLOUT, 0};
+        if (::poll(&pfd, 1, config_.connect_timeout_ms) <= 0) return device::Result::ERROR_TIMEOUT;
+        int err = 0;
+        socklen_t len = sizeof(err);
+        if (getsockopt(c->fd, SOL_SOCKET, SO_ERROR, &err, &len) != 0 || err != 0)
+            return device::Result::ERROR_NETWORK;
+    }
+    fcntl(c->fd, F_SETFL, flags);
+
+    timeval tv{config_.io_timeout_ms / 1000, (config_.io_timeout_ms % 1000) * 1000};
+    setsockopt(c->fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(c->fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    const int one = 1;
+    setsockopt(c->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    c->key = url.host + ":" + std::to_string(url.port);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.connects++;
+    }
+    conn = std::move(c);
+    return device::Result::OK;
+}
+
+void HttpClient::release(std::unique_ptr<Connection> conn) {
+    if (!conn || !conn->rx.empty()) return;   /* Unparsed bytes left: not in a known state */
+    conn->last_used_us = nowUs();
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& pool = idle_[conn->key];
+    if (pool.size() < config_.max_idle_per_host) pool.push_back(std::move(conn));
+}
+
+void HttpClient::closeIdle() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    idle_.clear();
+}
+
+size_t HttpClient::getIdleConnections() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t n = 0;
+    for (const auto& entry : idle_) n += entry.second.size();
+    return n;
+}
+
+HttpClientStats HttpClient::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+// -----------------------------------------------------------------------------
+// Wire I/O
+// -----------------------------------------------------------------------------
+
+device::Result HttpClient::sendAll(Connection& conn, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        const ssize_t n = ::send(conn.fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return errno == EAGAIN ? device::Result::ERROR_TIMEOUT : device::Result::ERROR_NETWORK;
+        sent += static_cast<size_t>(n);
+    }
+    return device::Result::OK;
+}
+
+device::Result HttpClient::fill(Connection& conn) {
+    const size_t old = conn.rx.size();
+    conn.rx.resize(old + kReadChunk);
+    ssize_t n;
+    do {
+        n = ::recv(conn.fd, conn.rx.data() + old, kReadChunk, 0);
+    } while (n < 0 && errno == EINTR);
+    conn.rx.resize(old + static_cast<size_t>(std::max<ssize_t>(n, 0)));
+    if (n == 0) return device::Result::ERROR_END_OF_STREAM;   /* Peer closed */
+    if (n < 0) return errno == EAGAIN ? device::Result::ERROR_TIMEOUT : device::Result::ERROR_NETWORK;
+    return device::Result::OK;
+}
+
+device::Result HttpClient::readHead(Connection& conn, Response& resp, int64_t& content_length, bool& chunked) {
+    static const char kEnd[] = "\r\n\r\n";
+    auto end = conn.rx.end();
+    while ((end = std::search(conn.rx.begin(), conn.rx.end(), kEnd, kEnd + 4)) == conn.rx.end()) {
+        if (conn.rx.size() > kMaxHeadBytes) return device::Result::ERROR_NETWORK;
+        const device::Result r = fill(conn);
+        if (r != device::Result::OK) return r;
+    }
+    const std::string head(conn.rx.begin(), end);
+    conn.rx.erase(conn.rx.begin(), end + 4);
+
+    size_t line_end = head.find("\r\n");
+    const std::string status_line = head.substr(0, line_end);
+    if (status_line.compare(0, 5, "HTTP/") != 0 || status_line.size() < 12) return device::Result::ERROR_NETWORK;
+    resp = {};
+    resp.status = std::atoi(status_line.c_str() + 9);
+    resp.keep_alive = status_line.compare(5, 3, "1.0") != 0;
+    content_length = -1;
+    chunked = false;
+
+    while (line_end != std::string::npos) {
+        const size_t begin = line_end + 2;
+        line_end = head.find("\r\n", begin);
+        const std::string line = head.substr(begin, line_end == std::string::npos ? std::string::npos : line_end - begin);
+        const size_t colon = line.find(':');
+        if (colon == std::string::npos) continue;
+        const std::string name = lower(trim(line.substr(0, colon)));
+        const std::string value = trim(line.substr(colon + 1));
+        if (name == "content-length") {
+            /* Digits only: a sign, garbage or overflow is a broken response */
+            if (value.empty() || value.find_first_not_of("0123456789") != std::string::npos)
+                return device::Result::ERROR_IO;
+            errno = 0;
+            const unsigned long long n = std::strtoull(value.c_str(), nullptr, 10);
+            if (errno == ERANGE || n > static_cast<unsigned long long>(INT64_MAX)) return device::Result::ERROR_IO;
+            content_length = static_cast<int64_t>(n);
+        } else if (name == "transfer-encoding") {
+            chunked = lower(value).find("chunked") != std::string::npos;
+        } else if (name == "connection") {
+            const std::string v = lower(value);
+            if (v.find("close") != std::string::npos) resp.keep_alive = false;
+            if (v.find("keep-alive") != std::string::npos) resp.keep_alive = true;
+        } else if (name == "content-range") {
+            /* bytes first-last/total or bytes * /total */
+            const size_t space = value.find(' ');
+            const size_t slash = value.find('/');
+            if (space != std::string::npos && value[space + 1] != '*')
+                resp.range_start = std::strtoull(value.c_str() + space + 1, nullptr, 10);
+            if (slash != std::string::npos && value[slash + 1] != '*')
+                resp.total_length = std::strtoull(value.c_str() + slash + 1, nullptr, 10);
+        }
+    }
+    resp.partial = resp.status == 206;
+    if (resp.status == 204 || resp.status == 304 || (resp.status >= 100 && resp.status < 200)) content_length = 0;
+    return device::Result::OK;
+}
+
+device::Result HttpClient::readBody(Connection& conn, int64_t content_length, bool chunked,
+                                    uint64_t limit, std::vector<uint8_t>& body) {
+    /* Append n bytes to body: what was already received, then recv() straight into it */
+    auto take = [&](size_t n) {
+        const size_t old = body.size();
+        body.resize(old + n);
+        const size_t from_rx = std::min(n, conn.rx.size());
+        std::memcpy(body.data() + old, conn.rx.data(), from_rx);
+        conn.rx.erase(conn.rx.begin(), conn.rx.begin() + static_cast<std::ptrdiff_t>(from_rx));
+        size_t got = from_rx;
+        while (got < n) {
+            const ssize_t r = ::recv(conn.fd, body.data() + old + got, n - got, 0);
+            if (r < 0 && errno == EINTR) continue;
+            if (r == 0) return device::Result::ERROR_NETWORK;
+            if (r < 0) return errno == EAGAIN ? device::Result::ERROR_TIMEOUT : device::Result::ERROR_NETWORK;
+            got += static_cast<size_t>(r);
+        }
+        return device::Result::OK;
+    };
+    auto line = [&](std::string& out) {
+        static const char kCrlf[] = "\r\n";
+        auto end = conn.rx.end();
+        while ((end = std::search(conn.rx.begin(), conn.rx.end(), kCrlf, kCrlf + 2)) == conn.rx.end()) {
+            if (conn.rx.size() > kMaxHeadBytes) return device::Result::ERROR_NETWORK;
+            const device::Result r = fill(conn);
+            if (r != device::Result::OK) return device::Result::ERROR_NETWORK;
+        }
+        out.assign(conn.rx.begin(), end);
+        conn.rx.erase(conn.rx.begin(), end + 2);
+        return device::Result::OK;
+    };
+
+    body.clear();
+    if (chunked) {
+        std::string size_line;
+        for (;;) {
+            if (line(size_line) != device::Result::OK) return device::Result::ERROR_NETWORK;
+            const uint64_t size = std::strtoull(size_line.c_str(), nullptr, 16);
+            if (size == 0) break;
+            if (size > limit - body.size()) return device::Result::ERROR_IO;
+            const device::Result r = take(static_cast<size_t>(size));
+            if (r != device::Result::OK) return r;
+            if (line(size_line) != device::Result::OK) return device::Result::ERROR_NETWORK;
+        }
+        do {   /* Trailer section up to the empty line */
+            if (line(size_line) != device::Result::OK) return device::Result::ERROR_NETWORK;
+        } while (!size_line.empty());
+        return device::Result::OK;
+    }
+    if (content_length >= 0) {
+        if (static_cast<uint64_t>(content_length) > limit) return device::Result::ERROR_IO;
+        return take(static_cast<size_t>(content_length));
+    }
+
+    /* Neither length nor chunked: the body runs to connection close */
+    for (;;) {
+        const device::Result r = fill(conn);
+        if (r == device::Result::ERROR_END_OF_STREAM) break;
+        if (r != device::Result::OK) return r;
+        if (conn.rx.size() > limit) return device::Result::ERROR_IO;
+    }
+    body.insert(body.end(), conn.rx.begin(), conn.rx.end());
+    conn.rx.clear();
+    return device::Result::OK;
+}
+
+device::Result HttpClient::readResponse(Connection& conn, const HttpRange& range, std::vector<uint8_t>& body,
+                                        Response& resp) {
+    int64_t content_length = -1;
+    bool chunked = false;
+    device::Result r = readHead(conn, resp, content_length, chunked);
+    if (r != device::Result::OK) {
+        resp.status = 0;   /* Nothing of this response arrived */
+        return r;
+    }
+    if (content_length < 0 && !chunked) resp.keep_alive = false;
+    /* A 206 is at most the range asked for; anything else at most max_response_bytes */
+    uint64_t limit = config_.max_response_bytes;
+    if (resp.partial && range.length != 0) limit = std::min(limit, range.length);
+    r = readBody(conn, content_length, chunked, limit, body);
+    if (r != device::Result::OK) {
+        resp.keep_alive = false;
+        return r;
+    }
+    resp.complete = true;
+    if (resp.status == 200 && resp.total_length == 0) resp.total_length = body.size();
+
+    r = statusResult(resp.status);
+    if (r != device::Result::OK) return r;
+    const bool ranged = range.offset != 0 || range.length != 0;
+    if (ranged && !resp.partial) {
+        /* Server ignored Range: cut the range out of the full body */
+        if (range.offset >= body.size()) return device::Result::ERROR_INVALID_PARAM;
+        body.erase(body.begin(), body.begin() + static_cast<std::ptrdiff_t>(range.offset));
+        if (range.length != 0 && range.length < body.size()) body.resize(range.length);
+    } else if (ranged && resp.range_start != range.offset) {
+        return device::Result::ERROR_NETWORK;
+    }
+    return device::Result::OK;
+}
+
+// -----------------------------------------------------------------------------
+// Requests
+// -----------------------------------------------------------------------------
+
+device::Result HttpClient::exchange(const Url& url, const std::vector<HttpRange>& ranges,
+                                    const std::vector<std::vector<uint8_t>*>& bodies, uint64_t* total_length) {
+    size_t next = 0;
+    bool retried = false;
+    device::Result result = device::Result::OK;
+    while (next < ranges.size()) {
+        std::unique_ptr<Connection> conn;
+        result = acquire(url, conn);
+        if (result != device::Result::OK) break;
+
+        const size_t batch = std::min(std::max<size_t>(config_.pipeline_depth, 1), ranges.size() - next);
+        std::string wire;
+        for (size_t i = 0; i < batch; ++i) wire += requestText(url, ranges[next + i]);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stats_.requests += batch;
+            stats_.pipelined += batch - 1;
+            if (conn->reused) stats_.reuses += batch;
+        }
+        result = sendAll(*conn, wire);
+
+        size_t done = 0;
+        Response resp;
+        while (result == device::Result::OK && done < batch) {
+            result = readResponse(*conn, ranges[next + done], *bodies[next + done], resp);
+            if (result != device::Result::OK) break;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stats_.bytes += bodies[next + done]->size();
+            }
+            if (total_length) *total_length = resp.total_length;
+            ++done;
+            if (!resp.keep_alive) break;
+        }
+        next += done;
+
+        if (result == device::Result::OK) {
+            if (resp.keep_alive) release(std::move(conn));
+            retried = false;
+            continue;   /* A Connection: close mid-batch resumes on a new connection */
+        }
+        /* A pooled connection the server dropped, or the server closing after
+         * some of a pipelined batch: resend what is left, once, on a new one */
+        const bool dropped = resp.status == 0 && (conn->reused || done > 0);
+        if (resp.complete && resp.keep_alive && done + 1 == batch)
+            release(std::move(conn));   /* An error status with its body read leaves it usable */
+        if (dropped && !retried &&
+            (result == device::Result::ERROR_END_OF_STREAM || result == device::Result::ERROR_NETWORK)) {
+            retried = done == 0;
+            std::lock_guard<std::mutex> lock(mutex_);
+            stats_.retries++;
+            continue;
+        }
+        break;
+    }
+
+    if (result != device::Result::OK) {
+        if (result == device::Result::ERROR_END_OF_STREAM) result = device::Result::ERROR_NETWORK;
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.errors++;
+    }
+    return result;
+}
+
+device::Result HttpClient::get(const std::string& uri, const HttpRange& range, std::vector<uint8_t>& body) {
+    Url url;
+    const device::Result r = parseUrl(uri, url);
+    if (r != device::Result::OK) return r;
+    return exchange(url, {range}, {&body}, nullptr);
+}
+
+device::Result HttpClient::getRanges(const std::string& uri, const std::vector<HttpRange>& ranges,
+                                     std::vector<std::vector<uint8_t>>& bodies) {
+    Url url;
+    const device::Result r = parseUrl(uri, url);
+    if (r != device::Result::OK) return r;
+    bodies.resize(ranges.size());
+    std::vector<std::vector<uint8_t>*> out;
+    out.reserve(bodies.size());
+    for (auto& b : bodies) out.push_back(&b);
+    return exchange(url, ranges, out, nullptr);
+}
+
+device::Result HttpClient::getLength(const std::string& uri, uint64_t& length) {
+    Url url;
+    device::Result r = parseUrl(uri, url);
+    if (r != device::Result::OK) return r;
+    std::vector<uint8_t> body;
+    uint64_t total = 0;
+    r = exchange(url, {HttpRange{0, 1}}, {&body}, &total);
+    if (r != device::Result::OK) return r;
+    if (total == 0) return device::Result::ERROR_NOT_SUPPORTED;   /* Server gave no size */
+    length = total;
+    return device::Result::OK;
+}
+
+SegmentLoader HttpClient::loader() {
+    return [this](const SegmentRequest& request, std::vector<uint8_t>& body) {
+        return get(request.uri, HttpRange{request.offset, request.length}, body);
+    };
+}
+
+// -----------------------------------------------------------------------------
+// HttpByteSource
+// -----------------------------------------------------------------------------
+
+HttpByteSource::HttpByteSource(HttpClient& client, size_t chunk_size)
+    : client_(client), chunk_size_(std::max<size_t>(chunk_size, 1)) {}
+
+device::Result HttpByteSource::open(const std::string& uri) {
+    uint64_t length = 0;
+    const device::Result r = client_.getLength(uri, length);
+    if (r != device::Result::OK) return r;
+    uri_ = uri;
+    length_ = length;
+    position_ = 0;
+    window_offset_ = 0;
+    chunks_.clear();
+    return device::Result::OK;
+}
+
+uint64_t HttpByteSource::windowEnd() const {
+    uint64_t end = window_offset_;
+    for (const auto& c : chunks_) end += c.size();
+    return end;
+}
+
+device::Result HttpByteSource::seekToByte(uint64_t offset) {
+    if (uri_.empty()) return device::Result::ERROR_INVALID_PARAM;
+    if (offset > length_) return device::Result::ERROR_INVALID_PARAM;
+    position_ = offset;
+    if (offset < window_offset_ || offset >= windowEnd()) chunks_.clear();
+    return device::Result::OK;
+}
+
+device::Result HttpByteSource::fillWindow() {
+    std::vector<HttpRange> ranges;
+    for (uint64_t at = position_; ranges.size() < 2 && at < length_; at += chunk_size_)
+        ranges.push_back({at, std::min<uint64_t>(chunk_size_, length_ - at)});
+    const device::Result r = client_.getRanges(uri_, ranges, chunks_);
+    fetches_ += ranges.size();
+    if (r != device::Result::OK) {
+        chunks_.clear();
+        return r;
+    }
+    window_offset_ = position_;
+    return device::Result::OK;
+}
+
+device::Result HttpByteSource::read(size_t size, std::vector<uint8_t>& out) {
+    out.clear();
+    if (uri_.empty()) return device::Result::ERROR_INVALID_PARAM;
+    if (position_ >= length_) return device::Result::ERROR_END_OF_STREAM;
+    if (position_ < window_offset_ || position_ >= windowEnd()) {
+        const device::Result r = fillWindow();
+        if (r != device::Result::OK) return r;
+    }
+    /* Copy from the chunks, possibly across into the read-ahead one */
+    const uint64_t end = std::min<uint64_t>(position_ + size, windowEnd());
+    out.reserve(static_cast<size_t>(end - position_));
+    uint64_t chunk_start = window_offset_;
+    for (const auto& c : chunks_) {
+        const uint64_t chunk_end = chunk_start + c.size();
+        if (position_ < chunk_end && chunk_start < end) {
+            const uint64_t from = std::max(position_, chunk_start);
+            const uint64_t to = std::min(end, chunk_end);
+            out.insert(out.end(), c.begin() + static_cast<std::ptrdiff_t>(from - chunk_start),
+                       c.begin() + static_cast<std::ptrdiff_t>(to - chunk_start));
+        }
+        chunk_start = chunk_end;
+    }
+    position_ = end;
+    return device::Result::OK;
+}
+
+} // namespace streaming::media
@@ -0,0 +1,186 @@
+/**
+ * @file http_client.hpp
+ * @brief Keep-alive HTTP/1.1 client for segment, playlist and byte-range fetches
+ * @copyright 2025 Streaming Device Project
+ *
+ * A 2 second segment is often smaller than what a new TCP (and TLS)
+ * handshake costs in round trips, so connections are pooled per host and
+ * reused until the server closes them or they sit idle too long. Several
+ * ranges of one resource go out pipelined on one connection, and response
+ * bodies are received straight into the caller's buffer, so a reused
+ * packet or segment vector costs no allocation and no extra copy.
+ *
+ * Plain http:// only: TLS belongs to the platform network stack behind
+ * IWifiHal and is not emulated here (https:// reports ERROR_NOT_SUPPORTED).
+ */
+
+#pragma once
+
+#include <streaming_device/types.hpp>
+#include "segment_scheduler.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace streaming::media {
+
+/** Byte range of a resource */
+struct HttpRange {
+    uint64_t offset{0};
+    uint64_t length{0};          /* 0: to the end */
+};
+
+/** Host name to dotted IPv4 address */
+using HostResolver = std::function<device::Result(const std::string& host, std::string& ip_out)>;
+
+struct HttpClientConfig {
+    size_t max_idle_per_host{4};
+    int64_t idle_timeout_us{30000000};   /* Pooled connections older than this are closed */
+    int32_t connect_timeout_ms{3000};
+    int32_t io_timeout_ms{5000};
+    size_t pipeline_depth{4};            /* Requests in flight on one connection */
+    uint64_t max_response_bytes{256ULL << 20};   /* Longer bodies fail with ERROR_IO */
+};
+
+struct HttpClientStats {
+    uint64_t requests{0};
+    uint64_t connects{0};        /* New TCP connections */
+    uint64_t reuses{0};          /* Requests sent on a pooled connection */
+    uint64_t pipelined{0};       /* Requests sent before the previous response arrived */
+    uint64_t retries{0};         /* Resent after a pooled connection turned out closed */
+    uint64_t bytes{0};           /* Body bytes received */
+    uint64_t errors{0};
+};
+
+/**
+ * @brief Pooled HTTP/1.1 GET client
+ *
+ * Thread safe; each request holds its connection exclusively, so
+ * concurrent requests to one host open additional connections (up to
+ * max_idle_per_host of them are kept afterwards). Status mapping: 404 is
+ * ERROR_NOT_FOUND, 401/403 ERROR_AUTH_FAILED, 416 ERROR_INVALID_PARAM,
+ * other failures ERROR_NETWORK or ERROR_TIMEOUT.
+ */
+class HttpClient {
+public:
+    explicit HttpClient(HttpClientConfig config = {}, HostResolver resolver = {});
+    ~HttpClient();
+
+    HttpClient(const HttpClient&) = delete;
+    HttpClient& operator=(const HttpClient&) = delete;
+
+    /** GET uri, or the range of it; body is resized to the payload, its capacity reused */
+    device::Result get(const std::string& uri, const HttpRange& range, std::vector<uint8_t>& body);
+
+    /** Several ranges of uri, pipelined; bodies[i] receives ranges[i] */
+    device::Result getRanges(const std::string& uri, const std::vector<HttpRange>& ranges,
+                             std::vector<std::vector<uint8_t>>& bodies);
+
+    /** Resource size from the Content-Range of a one byte request */
+    device::Result getLength(const std::string& uri, uint64_t& length);
+
+    /** This client as the SegmentScheduler / streaming service fetch function */
+    SegmentLoader loader();
+
+    /** Close all pooled connections */
+    void closeIdle();
+
+    size_t getIdleConnections() const;
+    HttpClientStats getStats() const;
+
+private:
+    struct Url {
+        std::string host;
+        uint16_t port{80};
+        std::string target;      /* Path and query */
+    };
+
+    struct Connection {
+        int fd{-1};
+        std::string key;         /* host:port */
+        std::vector<uint8_t> rx; /* Received past the last parsed response */
+        int64_t last_used_us{0};
+        bool reused{false};
+        ~Connection();
+    };
+
+    /** One parsed response */
+    struct Response {
+        int status{0};
+        uint64_t range_start{0};
+        uint64_t total_length{0};    /* From Content-Range, 0 if absent */
+        bool partial{false};
+        bool keep_alive{true};
+        bool complete{false};        /* Body read; the connection is past this response */
+    };
+
+    static device::Result parseUrl(const std::string& uri, Url& out);
+    device::Result acquire(const Url& url, std::unique_ptr<Connection>& conn);
+    device::Result connectTo(const Url& url, std::unique_ptr<Connection>& conn);
+    void release(std::unique_ptr<Connection> conn);
+    device::Result sendAll(Connection& conn, const std::string& data);
+    device::Result fill(Connection& conn);
+    device::Result readHead(Connection& conn, Response& resp, int64_t& content_length, bool& chunked);
+    device::Result readBody(Connection& conn, int64_t content_length, bool chunked, uint64_t limit,
+                            std::vector<uint8_t>& body);
+    device::Result readResponse(Connection& conn, const HttpRange& range, std::vector<uint8_t>& body,
+                                Response& resp);
+    /** Send ranges of url, pipelined up to pipeline_depth per connection; resumes on a new one */
+    device::Result exchange(const Url& url, const std::vector<HttpRange>& ranges,
+                            const std::vector<std::vector<uint8_t>*>& bodies, uint64_t* total_length);
+    static std::string requestText(const Url& url, const HttpRange& range);
+
+    const HttpClientConfig config_;
+    HostResolver resolver_;
+
+    mutable std::mutex mutex_;
+    std::map<std::string, std::vector<std::unique_ptr<Connection>>> idle_;
+    HttpClientStats stats_;
+};
+
+/**
+ * @brief Random access over a progressive (non-segmented) HTTP file
+ *
+ * What a demuxer's IContainerParser::seekToByte() runs on for http://
+ * sources: reads are served from a window of chunk_size fetched ahead of
+ * the position, the following chunk pipelined with it. A seek inside the
+ * window costs nothing; one outside it drops the window.
+ */
+class HttpByteSource {
+public:
+    explicit HttpByteSource(HttpClient& client, size_t chunk_size = 256 * 1024);
+
+    /** Learn the resource size; position 0 */
+    device::Result open(const std::string& uri);
+
+    device::Result seekToByte(uint64_t offset);
+
+    /** Up to size bytes from the position into out; ERROR_END_OF_STREAM at the end */
+    device::Result read(size_t size, std::vector<uint8_t>& out);
+
+    uint64_t position() const { return position_; }
+    uint64_t length() const { return length_; }
+
+    /** Range requests issued so far */
+    uint64_t getFetches() const { return fetches_; }
+
+private:
+    device::Result fillWindow();
+    uint64_t windowEnd() const;
+
+    HttpClient& client_;
+    const size_t chunk_size_;
+    std::string uri_;
+    uint64_t length_{0};
+    uint64_t position_{0};
+    uint64_t window_offset_{0};
+    std::vector<std::vector<uint8_t>> chunks_;   /* Current chunk and the read-ahead one */
+    uint64_t fetches_{0};
+};
+
+} // namespace streaming::media
@@ -0,0 +1,140 @@
+/**
+ * @file iec61937.cpp
+ * @brief Iec61937Packer implementation
+ */
+
+#include "iec61937.hpp"
+#include <algorithm>
+
+namespace streaming::media {
+
+namespace {
+
+constexpr uint32_t kAc3BurstFrames = 1536;   /* One AC3 syncframe of 1536 samples */
+constexpr uint32_t kEac3BurstFrames = 6144;  /* 1536 samples at 4x rate */
+constexpr uint32_t kEac3BlocksPerBurst = 6;
+constexpr uint8_t kEac3Dependent = 1;        /* strmtyp: 0 independent, 1 dependent, 2 AC3 convert */
+
+/* E-AC3 numblkscod -> audio blocks per syncframe */
+constexpr uint32_t kEac3Blocks[4] = {1, 2, 3, 6};
+
+bool hasSync(const uint8_t* frame, size_t size) {
+    return size >= 6 && frame[0] == 0x0B && frame[1] == 0x77;
+}
+
+} // namespace
+
+Iec61937Packer::Iec61937Packer(AudioCodec codec, uint32_t sample_rate) : codec_(codec) {
+    if (sample_rate == 0) return;
+    if (codec == AudioCodec::AC3) {
+        output_rate_ = sample_rate;
+        burst_frames_ = kAc3BurstFrames;
+    } else if (codec == AudioCodec::EAC3) {
+        output_rate_ = sample_rate * 4;
+        burst_frames_ = kEac3BurstFrames;
+    } else {
+        return;
+    }
+    valid_ = true;
+    burst_.assign(static_cast<size_t>(burst_frames_) * 2, 0);
+    payload_.reserve(burst_.size() * 2);
+}
+
+void Iec61937Packer::reset() {
+    payload_.clear();
+    blocks_ = 0;
+}
+
+device::Result Iec61937Packer::pack(const uint8_t* frame, size_t size, Pts pts_us, bool& burst_ready) {
+    burst_ready = false;
+    if (!valid_ || !frame || !hasSync(frame, size)) return device::Result::ERROR_INVALID_PARAM;
+
+    if (codec_ == AudioCodec::AC3) {
+        if (!append(frame, size)) return device::Result::ERROR_INVALID_PARAM;
+        pending_pts_ = pts_us;
+        pc_ = static_cast<uint16_t>(kTypeAc3 | ((frame[5] & 0x07) << 8));   /* bsmod */
+        emit();
+        burst_ready = true;
+        return device::Result::OK;
+    }
+
+    /* A demuxed E-AC3 access unit may hold several syncframes: the
+     * independent one and the dependent substreams that extend it */
+    while (size > 0) {
+        if (!hasSync(frame, size)) {
+            reset();
+            return device::Result::ERROR_INVALID_PARAM;
+        }
+        /* frmsiz splits the unit; if no syncframe follows it, the rest is one frame */
+        const size_t frame_bytes = ((static_cast<size_t>(frame[2] & 0x07) << 8 | frame[3]) + 1) * 2;
+        const size_t n = frame_bytes < size && hasSync(frame + frame_bytes, size - frame_bytes)
+            ? frame_bytes : size;
+        const uint8_t strmtyp = frame[2] >> 6;
+        if (strmtyp == kEac3Dependent) {
+            /* Goes with the independent frame before it and adds no audio blocks.
+             * From now on a full burst waits for the next independent frame; a
+             * dependent frame whose burst already went out is dropped. */
+            hold_for_dependents_ = true;
+            if (!payload_.empty() && !append(frame, n)) return device::Result::ERROR_INVALID_PARAM;
+        } else {
+            if (blocks_ >= kEac3BlocksPerBurst) {
+                emit();   /* Held for dependent frames; this one starts the next burst */
+                burst_ready = true;
+            }
+            if (payload_.empty()) pending_pts_ = pts_us;
+            if (!append(frame, n)) return device::Result::ERROR_INVALID_PARAM;
+            /* fscod 3 (reduced rates) implies six blocks */
+            const uint8_t fscod = frame[4] >> 6;
+            blocks_ += fscod == 3 ? 6 : kEac3Blocks[(frame[4] >> 4) & 0x03];
+            pc_ = kTypeEac3;
+        }
+        frame += n;
+        size -= n;
+    }
+    if (blocks_ >= kEac3BlocksPerBurst && !hold_for_dependents_ && !burst_ready) {
+        emit();
+        burst_ready = true;
+    }
+    return device::Result::OK;
+}
+
+device::Result Iec61937Packer::flush(bool& burst_ready) {
+    burst_ready = false;
+    if (!valid_ || blocks_ < kEac3BlocksPerBurst || payload_.empty()) return device::Result::ERROR_NOT_FOUND;
+    emit();
+    burst_ready = true;
+    return device::Result::OK;
+}
+
+bool Iec61937Packer::append(const uint8_t* frame, size_t size) {
+    const size_t capacity = (burst_.size() - kPreambleWords) * sizeof(int16_t);
+    if (payload_.size() + size > capacity) {
+        reset();
+        return false;
+    }
+    payload_.insert(payload_.end(), frame, frame + size);
+    return true;
+}
+
+void Iec61937Packer::emit() {
+    /* Pd is the payload length in bits for AC3, in bytes for E-AC3 */
+    const size_t length = payload_.size();
+    const size_t pd = codec_ == AudioCodec::AC3 ? length * 8 : length;
+    burst_[0] = static_cast<int16_t>(kSyncPa);
+    burst_[1] = static_cast<int16_t>(kSyncPb);
+    burst_[2] = static_cast<int16_t>(pc_);
+    burst_[3] = static_cast<int16_t>(pd);
+
+    /* Bitstream bytes become 16-bit words MSB first; an odd tail byte is zero padded */
+    size_t w = kPreambleWords;
+    for (size_t i = 0; i < length; i += 2, ++w) {
+        const uint8_t lo = i + 1 < length ? payload_[i + 1] : 0;
+        burst_[w] = static_cast<int16_t>((payload_[i] << 8) | lo);
+    }
+    std::fill(burst_.begin() + static_cast<std::ptrdiff_t>(w), burst_.end(), 0);
+
+    burst_pts_ = pending_pts_;
+    reset();
+}
+
+} // namespace streaming::media
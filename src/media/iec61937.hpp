@@ -0,0 +1,92 @@
+/**
+ * @file iec61937.hpp
+ * @brief IEC 61937 burst packing for compressed audio passthrough over HDMI
+ * @copyright 2025 Streaming Device Project
+ *
+ * An AVR or TV that decodes AC3/E-AC3 itself receives the bitstream inside
+ * what looks like 16-bit stereo PCM: each burst starts with the Pa/Pb sync
+ * words, a Pc data-type word and a Pd length word, carries the syncframe
+ * as big-endian 16-bit words and is zero padded to the repetition period
+ * of the codec (1536 stereo frames for AC3, 6144 at 4x rate for E-AC3).
+ * Nothing is decoded on the device.
+ */
+
+#pragma once
+
+#include <streaming_device/types.hpp>
+#include <streaming_device/media_types.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace streaming::media {
+
+/**
+ * @brief Packs AC3 / E-AC3 syncframes into IEC 61937 bursts
+ *
+ * AC3 is one syncframe per burst. E-AC3 frames of fewer than six audio
+ * blocks are aggregated until a burst holds 1536 samples, as receivers
+ * expect. Only independent substreams (strmtyp 0/2) count towards that;
+ * dependent ones (7.1 extensions) ride in the burst of the independent
+ * frame they follow, so once a stream has shown one, a full burst is
+ * held until the next independent frame (or flush()). Burst samples are
+ * interleaved stereo int16 at getOutputRate().
+ */
+class Iec61937Packer {
+public:
+    static constexpr uint16_t kSyncPa = 0xF872;
+    static constexpr uint16_t kSyncPb = 0x4E1F;
+    static constexpr uint16_t kTypeAc3 = 1;
+    static constexpr uint16_t kTypeEac3 = 21;
+    static constexpr size_t kPreambleWords = 4;
+
+    /** codec must be AC3 or EAC3; sample_rate is the bitstream's rate */
+    Iec61937Packer(AudioCodec codec, uint32_t sample_rate);
+
+    bool isValid() const { return valid_; }
+
+    /**
+     * Add one access unit (a syncframe, or for E-AC3 an independent frame
+     * with its dependent frames) with media time pts_us. burst_ready is
+     * set when a burst is complete in getBurst(); it stays valid until the
+     * next call. ERROR_INVALID_PARAM for data without 0x0B77 sync or too
+     * large for the burst (the frame is dropped and aggregation restarts).
+     */
+    device::Result pack(const uint8_t* frame, size_t size, Pts pts_us, bool& burst_ready);
+
+    /** End of stream: complete a burst held for dependent frames; ERROR_NOT_FOUND if none */
+    device::Result flush(bool& burst_ready);
+
+    /** Interleaved stereo samples of the last completed burst */
+    const std::vector<int16_t>& getBurst() const { return burst_; }
+
+    /** Media time of the first syncframe in the last completed burst */
+    Pts getBurstPts() const { return burst_pts_; }
+
+    /** Stereo frames per burst (the repetition period) */
+    uint32_t getBurstFrames() const { return burst_frames_; }
+
+    /** Link rate: the stream rate for AC3, four times it for E-AC3 */
+    uint32_t getOutputRate() const { return output_rate_; }
+
+    /** Drop a partially aggregated burst (seek) */
+    void reset();
+
+private:
+    bool append(const uint8_t* frame, size_t size);
+    void emit();
+
+    AudioCodec codec_;
+    bool valid_{false};
+    uint32_t output_rate_{0};
+    uint32_t burst_frames_{0};
+    std::vector<int16_t> burst_;
+    std::vector<uint8_t> payload_;   /* Aggregated syncframes */
+    uint32_t blocks_{0};             /* E-AC3 independent audio blocks in payload_ */
+    bool hold_for_dependents_{false};   /* The stream carries dependent substreams */
+    Pts pending_pts_{0};
+    Pts burst_pts_{0};
+    uint16_t pc_{0};
+};
+
+} // namespace streaming::media
@@ -0,0 +1,239 @@
+/**
+ * @file jitter_buffer.cpp
+ * @brief RTP packet parsing and JitterBuffer implementation
+ */
+
+#include "jitter_buffer.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace streaming::media {
+
+namespace {
+
+constexpr uint16_t kOneByteExtensionProfile = 0xBEDE;   /* RFC 8285 */
+constexpr uint64_t kNtpUnixOffsetS = 2208988800ULL;      /* 1900 to 1970 */
+
+uint16_t read16(const uint8_t* p) { return static_cast<uint16_t>((p[0] << 8) | p[1]); }
+
+uint32_t read32(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+void put16(std::vector<uint8_t>& out, uint16_t v) {
+    out.push_back(static_cast<uint8_t>(v >> 8));
+    out.push_back(static_cast<uint8_t>(v));
+}
+
+void put32(std::vector<uint8_t>& out, uint32_t v) {
+    put16(out, static_cast<uint16_t>(v >> 16));
+    put16(out, static_cast<uint16_t>(v));
+}
+
+int64_t ntpToUnixUs(uint64_t ntp) {
+    const int64_t seconds = static_cast<int64_t>(ntp >> 32) - static_cast<int64_t>(kNtpUnixOffsetS);
+    const int64_t fraction_us = static_cast<int64_t>(((ntp & 0xFFFFFFFFULL) * 1000000ULL) >> 32);
+    return seconds * 1000000 + fraction_us;
+}
+
+uint64_t unixUsToNtp(int64_t us) {
+    const uint64_t seconds = static_cast<uint64_t>(us / 1000000) + kNtpUnixOffsetS;
+    const uint64_t fraction = (static_cast<uint64_t>(us % 1000000) << 32) / 1000000;
+    return (seconds << 32) | fraction;
+}
+
+} // namespace
+
+bool RtpPacket::parse(const uint8_t* data, size_t size, RtpPacket& out, uint8_t capture_ext_id) {
+    if (size < 12 || (data[0] >> 6) != 2) return false;
+    const bool padding = (data[0] & 0x20) != 0;
+    const bool extension = (data[0] & 0x10) != 0;
+    const size_t csrc_count = data[0] & 0x0F;
+    out.marker = (data[1] & 0x80) != 0;
+    out.payload_type = data[1] & 0x7F;
+    out.sequence = read16(data + 2);
+    out.timestamp = read32(data + 4);
+    out.ssrc = read32(data + 8);
+    out.capture_time_us = -1;
+
+    size_t offset = 12 + 4 * csrc_count;
+    size_t end = size;
+    if (padding) {
+        if (data[size - 1] == 0 || data[size - 1] > size) return false;
+        end -= data[size - 1];
+    }
+    if (extension) {
+        if (offset + 4 > end) return false;
+        const uint16_t profile = read16(data + offset);
+        const size_t words = read16(data + offset + 2);
+        const size_t ext_begin = offset + 4;
+        const size_t ext_end = ext_begin + 4 * words;
+        if (ext_end > end) return false;
+        if (profile == kOneByteExtensionProfile) {
+            for (size_t i = ext_begin; i < ext_end;) {
+                if (data[i] == 0) { ++i; continue; }   /* Padding between elements */
+                const uint8_t id = data[i] >> 4;
+                const size_t len = (data[i] & 0x0F) + 1u;
+                if (id == 15 || i + 1 + len > ext_end) break;
+                if (id == capture_ext_id && len >= 8) {
+                    const uint64_t ntp = (static_cast<uint64_t>(read32(data + i + 1)) << 32) | read32(data + i + 5);
+                    out.capture_time_us = ntpToUnixUs(ntp);
+                }
+                i += 1 + len;
+            }
+        }
+        offset = ext_end;
+    }
+    if (offset > end) return false;
+    out.payload.assign(data + offset, data + end);
+    return true;
+}
+
+std::vector<uint8_t> RtpPacket::serialize(uint8_t capture_ext_id) const {
+    const bool extension = capture_time_us >= 0;
+    std::vector<uint8_t> out;
+    out.reserve(12 + (extension ? 16 : 0) + payload.size());
+    out.push_back(static_cast<uint8_t>(0x80 | (extension ? 0x10 : 0)));
+    out.push_back(static_cast<uint8_t>((marker ? 0x80 : 0) | (payload_type & 0x7F)));
+    put16(out, sequence);
+    put32(out, timestamp);
+    put32(out, ssrc);
+    if (extension) {
+        /* One 8-byte element plus three bytes of padding: three words */
+        put16(out, kOneByteExtensionProfile);
+        put16(out, 3);
+        out.push_back(static_cast<uint8_t>((capture_ext_id << 4) | 7));
+        const uint64_t ntp = unixUsToNtp(capture_time_us);
+        put32(out, static_cast<uint32_t>(ntp >> 32));
+        put32(out, static_cast<uint32_t>(ntp));
+        out.insert(out.end(), 3, 0);
+    }
+    out.insert(out.end(), payload.begin(), payload.end());
+    return out;
+}
+
+JitterBuffer::JitterBuffer(JitterBufferConfig config)
+    : config_(config), target_delay_us_(std::clamp(config.initial_delay_us, config.min_delay_us,
+                                                   config.max_delay_us)) {}
+
+uint64_t JitterBuffer::unwrap(uint64_t reference, uint32_t value, uint32_t bits) {
+    const uint64_t range = 1ULL << bits;
+    uint64_t candidate = (reference & ~(range - 1)) | value;
+    if (candidate + range / 2 < reference) candidate += range;           /* Wrapped forward */
+    else if (candidate > reference + range / 2 && candidate >= range) candidate -= range;   /* Older */
+    return candidate;
+}
+
+int64_t JitterBuffer::toUs(uint64_t timestamp) const {
+    const int64_t ticks = static_cast<int64_t>(timestamp) - static_cast<int64_t>(base_ts_);
+    return ticks * 1000000 / static_cast<int64_t>(config_.clock_rate);
+}
+
+int64_t JitterBuffer::playoutUsLocked(const Entry& e) const {
+    return toUs(e.timestamp) + min_transit_us_ + target_delay_us_;
+}
+
+void JitterBuffer::updateJitterLocked(uint64_t timestamp, int64_t arrival_us) {
+    const int64_t transit = arrival_us - toUs(timestamp);
+    if (!have_transit_) {
+        have_transit_ = true;
+        prev_transit_us_ = transit;
+    } else {
+        /* RFC 3550 6.4.1: J += (|D| - J) / 16 */
+        const double d = std::fabs(static_cast<double>(transit - prev_transit_us_));
+        jitter_us_ += (d - jitter_us_) / 16.0;
+        prev_transit_us_ = transit;
+    }
+    /* Minimum over a sliding window of arrivals (a monotonic deque): with the
+     * sender's clock running slow, transit creeps up and an all-time minimum
+     * would leave playout anchored ever further behind arrivals */
+    while (!transit_window_.empty() && transit_window_.back().second >= transit) transit_window_.pop_back();
+    transit_window_.emplace_back(arrival_us, transit);
+    while (transit_window_.front().first < arrival_us - config_.transit_window_us) transit_window_.pop_front();
+    min_transit_us_ = transit_window_.front().second;
+    const int64_t wanted = std::clamp(static_cast<int64_t>(jitter_us_ * config_.jitter_multiplier),
+                                      config_.min_delay_us, config_.max_delay_us);
+    if (wanted > target_delay_us_) target_delay_us_ = wanted;
+    else target_delay_us_ -= (target_delay_us_ - wanted) / 64;   /* Shrink slowly */
+}
+
+void JitterBuffer::push(RtpPacket packet, int64_t arrival_us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.received++;
+    if (!started_) {
+        /* Start a full cycle in so packets older than the first unwrap without underflow */
+        started_ = true;
+        highest_seq_ = (1ULL << 16) + packet.sequence;
+        next_seq_ = highest_seq_;
+        highest_ts_ = (1ULL << 32) + packet.timestamp;
+        base_ts_ = highest_ts_;
+    }
+    const uint64_t seq = unwrap(highest_seq_, packet.sequence, 16);
+    const uint64_t ts = unwrap(highest_ts_, packet.timestamp, 32);
+    Entry entry{std::move(packet), ts, arrival_us};
+
+    if (seq < next_seq_) {
+        /* Its slot has gone: make room for this much lateness next time */
+        stats_.late++;
+        const int64_t lateness = arrival_us - playoutUsLocked(entry);
+        if (lateness > 0) target_delay_us_ = std::min(config_.max_delay_us, target_delay_us_ + lateness);
+        return;
+    }
+    if (packets_.count(seq) != 0) {
+        stats_.duplicates++;
+        return;
+    }
+    if (seq < highest_seq_) stats_.reordered++;
+    highest_seq_ = std::max(highest_seq_, seq);
+    highest_ts_ = std::max(highest_ts_, ts);
+    updateJitterLocked(ts, arrival_us);
+    packets_.emplace(seq, std::move(entry));
+    if (packets_.size() > config_.max_packets) {
+        packets_.erase(packets_.begin());
+        stats_.overflow++;
+        next_seq_ = packets_.begin()->first;
+    }
+}
+
+bool JitterBuffer::pop(int64_t now_us, RtpPacket& out, int64_t& media_time_us, uint64_t& gap) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    gap = 0;
+    if (packets_.empty()) return false;
+    auto it = packets_.begin();
+    /* A missing packet is given up on once the next one present is due */
+    if (playoutUsLocked(it->second) > now_us) return false;
+    if (it->first != next_seq_) {
+        gap = it->first - next_seq_;
+        stats_.lost += gap;
+    }
+    media_time_us = toUs(it->second.timestamp);
+    out = std::move(it->second.packet);
+    next_seq_ = it->first + 1;
+    packets_.erase(it);
+    return true;
+}
+
+JitterBufferStats JitterBuffer::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    JitterBufferStats stats = stats_;
+    stats.jitter_us = static_cast<int64_t>(jitter_us_);
+    stats.target_delay_us = target_delay_us_;
+    stats.depth = packets_.size();
+    return stats;
+}
+
+void JitterBuffer::reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    packets_.clear();
+    started_ = false;
+    highest_seq_ = next_seq_ = highest_ts_ = base_ts_ = 0;
+    min_transit_us_ = prev_transit_us_ = 0;
+    transit_window_.clear();
+    have_transit_ = false;
+    jitter_us_ = 0.0;
+    target_delay_us_ = std::clamp(config_.initial_delay_us, config_.min_delay_us, config_.max_delay_us);
+    stats_ = {};
+}
+
+} // namespace streaming::media
@@ -0,0 +1,120 @@
+/**
+ * @file jitter_buffer.hpp
+ * @brief RTP packets and an adaptive jitter buffer for live ingest
+ * @copyright 2025 Streaming Device Project
+ *
+ * Packets are held until their playout time: media timestamp plus the
+ * fastest transit of the last few seconds plus a target delay. The target follows
+ * the RFC 3550 interarrival jitter estimate (a multiple of it, clamped),
+ * growing at once when packets turn up late and shrinking slowly. Out of
+ * order packets are put back in sequence; a gap is declared lost once a
+ * later packet is due, so one missing packet never stalls the stream.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace streaming::media {
+
+/** One RTP packet (RFC 3550) */
+struct RtpPacket {
+    uint8_t payload_type{0};
+    bool marker{false};
+    uint16_t sequence{0};
+    uint32_t timestamp{0};
+    uint32_t ssrc{0};
+    int64_t capture_time_us{-1};   /* abs-capture-time header extension, unix time; -1 if absent */
+    std::vector<uint8_t> payload;
+
+    /**
+     * Parse a datagram. The one-byte header extension element with id
+     * capture_ext_id (RFC 8285) is read as abs-capture-time: a 64-bit NTP
+     * timestamp of when the frame was captured. False if not RTP v2.
+     */
+    static bool parse(const uint8_t* data, size_t size, RtpPacket& out, uint8_t capture_ext_id = 1);
+
+    /** Datagram for this packet; writes the capture time extension if capture_time_us >= 0 */
+    std::vector<uint8_t> serialize(uint8_t capture_ext_id = 1) const;
+};
+
+struct JitterBufferConfig {
+    uint32_t clock_rate{90000};       /* RTP timestamp units per second */
+    int64_t min_delay_us{20000};
+    int64_t max_delay_us{400000};
+    int64_t initial_delay_us{50000};
+    double jitter_multiplier{4.0};    /* Target delay as a multiple of the jitter estimate */
+    size_t max_packets{4096};         /* Oldest are dropped beyond this (reader stalled) */
+    int64_t transit_window_us{2000000};   /* Fastest transit is taken over this much arrival time */
+};
+
+struct JitterBufferStats {
+    uint64_t received{0};
+    uint64_t duplicates{0};
+    uint64_t late{0};                 /* Arrived after their slot was played or skipped */
+    uint64_t lost{0};                 /* Sequence numbers skipped as missing */
+    uint64_t reordered{0};            /* Arrived behind a higher sequence number */
+    uint64_t overflow{0};             /* Dropped at max_packets */
+    int64_t jitter_us{0};             /* RFC 3550 interarrival jitter */
+    int64_t target_delay_us{0};
+    size_t depth{0};                  /* Packets held now */
+};
+
+/**
+ * @brief Reordering, adaptively sized jitter buffer for one RTP stream
+ *
+ * Thread safe: the network thread pushes, the demuxer pops. Arrival and
+ * playout times are on one monotonic clock supplied by the caller.
+ */
+class JitterBuffer {
+public:
+    explicit JitterBuffer(JitterBufferConfig config = {});
+
+    /** Add a packet that arrived at arrival_us */
+    void push(RtpPacket packet, int64_t arrival_us);
+
+    /**
+     * Next packet in sequence order if its playout time has come.
+     * media_time_us is its timestamp in microseconds from the first
+     * packet's; gap is the number of sequence numbers declared lost just
+     * before it.
+     */
+    bool pop(int64_t now_us, RtpPacket& out, int64_t& media_time_us, uint64_t& gap);
+
+    JitterBufferStats getStats() const;
+    void reset();
+
+private:
+    struct Entry {
+        RtpPacket packet;
+        uint64_t timestamp{0};        /* Extended */
+        int64_t arrival_us{0};
+    };
+
+    static uint64_t unwrap(uint64_t reference, uint32_t value, uint32_t bits);
+    int64_t toUs(uint64_t timestamp) const;
+    int64_t playoutUsLocked(const Entry& e) const;
+    void updateJitterLocked(uint64_t timestamp, int64_t arrival_us);
+
+    const JitterBufferConfig config_;
+    mutable std::mutex mutex_;
+    std::map<uint64_t, Entry> packets_;   /* By extended sequence number */
+    bool started_{false};
+    uint64_t highest_seq_{0};
+    uint64_t next_seq_{0};                /* Next to play */
+    uint64_t highest_ts_{0};
+    uint64_t base_ts_{0};                 /* First timestamp: media time zero */
+    int64_t min_transit_us_{0};           /* Fastest arrival minus media time, windowed */
+    std::deque<std::pair<int64_t, int64_t>> transit_window_;   /* (arrival, transit), transit increasing */
+    bool have_transit_{false};
+    int64_t prev_transit_us_{0};
+    double jitter_us_{0.0};
+    int64_t target_delay_us_;
+    JitterBufferStats stats_;
+};
+
+} // namespace streaming::media
@@ -0,0 +1,645 @@
+/**
+ * @file manifest.cpp
+ * @brief ManifestParser implementation
+ */
+
+#include "manifest.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <utility>
+
+namespace streaming::media {
+
+namespace {
+
+using Attributes = std::vector<std::pair<std::string, std::string>>;
+
+std::string trim(const std::string& s) {
+    const size_t b = s.find_first_not_of(" \t\r\n");
+    if (b == std::string::npos) return {};
+    const size_t e = s.find_last_not_of(" \t\r\n");
+    return s.substr(b, e - b + 1);
+}
+
+std::vector<std::string> splitLines(const std::string& text) {
+    std::vector<std::string> lines;
+    size_t pos = 0;
+    while (pos <= text.size()) {
+        size_t end = text.find('\n', pos);
+        if (end == std::string::npos) end = text.size();
+        std::string line = trim(text.substr(pos, end - pos));
+        if (!line.empty()) lines.push_back(std::move(line));
+        pos = end + 1;
+    }
+    return lines;
+}
+
+bool startsWith(const std::string& s, const char* prefix) {
+    return s.compare(0, std::char_traits<char>::length(prefix), prefix) == 0;
+}
+
+/** HLS attribute list: KEY=value,KEY="quoted, value" */
+Attributes parseAttributeList(const std::string& text) {
+    Attributes out;
+    size_t i = 0;
+    while (i < text.size()) {
+        const size_t eq = text.find('=', i);
+        if (eq == std::string::npos) break;
+        std::string key = trim(text.substr(i, eq - i));
+        std::string value;
+        i = eq + 1;
+        if (i < text.size() && text[i] == '"') {
+            const size_t close = text.find('"', i + 1);
+            value = text.substr(i + 1, close == std::string::npos ? std::string::npos : close - i - 1);
+            i = close == std::string::npos ? text.size() : close + 1;
+        } else {
+            const size_t comma = text.find(',', i);
+            value = trim(text.substr(i, comma == std::string::npos ? std::string::npos : comma - i));
+            i = comma == std::string::npos ? text.size() : comma;
+        }
+        out.emplace_back(std::move(key), std::move(value));
+        if (i < text.size() && text[i] == ',') ++i;
+    }
+    return out;
+}
+
+const std::string* findAttr(const Attributes& attrs, const char* key) {
+    for (const auto& kv : attrs)
+        if (kv.first == key) return &kv.second;
+    return nullptr;
+}
+
+std::string attrOr(const Attributes& attrs, const char* key, const std::string& fallback = {}) {
+    const std::string* v = findAttr(attrs, key);
+    return v ? *v : fallback;
+}
+
+uint64_t toU64(const std::string& s) { return std::strtoull(s.c_str(), nullptr, 10); }
+
+/** value * mul / div without intermediate overflow, saturated at UINT64_MAX */
+uint64_t mulDiv(uint64_t value, uint64_t mul, uint64_t div) {
+    const unsigned __int128 r = static_cast<unsigned __int128>(value) * mul / div;
+    return r > UINT64_MAX ? UINT64_MAX : static_cast<uint64_t>(r);
+}
+
+/** HLS BYTERANGE: length[@offset]; without offset the range follows the previous one */
+void parseByteRange(const std::string& text, uint64_t next_offset, uint64_t& offset, uint64_t& length) {
+    const size_t at = text.find('@');
+    length = toU64(text.substr(0, at));
+    offset = at == std::string::npos ? next_offset : toU64(text.substr(at + 1));
+}
+
+// -----------------------------------------------------------------------------
+// Minimal XML reader for MPDs: elements, attributes, text. The tree is
+// discarded once the manifest is built.
+// -----------------------------------------------------------------------------
+
+struct XmlNode {
+    std::string name;
+    Attributes attrs;
+    std::string text;
+    std::vector<XmlNode> children;
+
+    const XmlNode* child(const char* n) const {
+        for (const auto& c : children)
+            if (c.name == n) return &c;
+        return nullptr;
+    }
+    std::string attr(const char* key, const std::string& fallback = {}) const {
+        return attrOr(attrs, key, fallback);
+    }
+    bool has(const char* key) const { return findAttr(attrs, key) != nullptr; }
+};
+
+std::string decodeEntities(const std::string& s) {
+    if (s.find('&') == std::string::npos) return s;
+    static const std::pair<const char*, char> kEntities[] = {
+        {"&amp;", '&'}, {"&lt;", '<'}, {"&gt;", '>'}, {"&quot;", '"'}, {"&apos;", '\''}};
+    std::string out;
+    for (size_t i = 0; i < s.size();) {
+        bool matched = false;
+        if (s[i] == '&') {
+            for (const auto& e : kEntities) {
+                if (s.compare(i, std::char_traits<char>::length(e.first), e.first) == 0) {
+                    out += e.second;
+                    i += std::char_traits<char>::length(e.first);
+                    matched = true;
+                    break;
+                }
+            }
+        }
+        if (!matched) out += s[i++];
+    }
+    return out;
+}
+
+std::string localName(const std::string& qname) {
+    const size_t colon = qname.find(':');
+    return colon == std::string::npos ? qname : qname.substr(colon + 1);
+}
+
+class XmlReader {
+public:
+    explicit XmlReader(const std::string& text) : s_(text) {}
+
+    bool parse(XmlNode& root) {
+        std::vector<XmlNode*> stack;
+        XmlNode document;
+        stack.push_back(&document);
+        while (pos_ < s_.size()) {
+            const size_t lt = s_.find('<', pos_);
+            if (lt == std::string::npos) break;
+            if (lt > pos_) stack.back()->text += decodeEntities(trim(s_.substr(pos_, lt - pos_)));
+            pos_ = lt;
+            if (s_.compare(pos_, 4, "<!--") == 0) {
+                if (!skipPast("-->")) return false;
+            } else if (s_.compare(pos_, 2, "<?") == 0 || s_.compare(pos_, 2, "<!") == 0) {
+                if (!skipPast(">")) return false;
+            } else if (s_.compare(pos_, 2, "</") == 0) {
+                if (!skipPast(">") || stack.size() < 2) return false;
+                stack.pop_back();
+            } else {
+                XmlNode node;
+                bool self_closing = false;
+                if (!readTag(node, self_closing)) return false;
+                stack.back()->children.push_back(std::move(node));
+                if (!self_closing) stack.push_back(&stack.back()->children.back());
+            }
+        }
+        if (document.children.empty()) return false;
+        root = std::move(document.children.front());
+        return true;
+    }
+
+private:
+    bool skipPast(const char* token) {
+        const size_t end = s_.find(token, pos_);
+        if (end == std::string::npos) return false;
+        pos_ = end + std::char_traits<char>::length(token);
+        return true;
+    }
+
+    bool readTag(XmlNode& node, bool& self_closing) {
+        ++pos_;   /* '<' */
+        size_t end = s_.find_first_of(" \t\r\n/>", pos_);
+        if (end == std::string::npos) return false;
+        node.name = localName(s_.substr(pos_, end - pos_));
+        pos_ = end;
+        for (;;) {
+            pos_ = s_.find_first_not_of(" \t\r\n", pos_);
+            if (pos_ == std::string::npos) return false;
+            if (s_[pos_] == '>') { ++pos_; return true; }
+            if (s_.compare(pos_, 2, "/>") == 0) { pos_ += 2; self_closing = true; return true; }
+            const size_t eq = s_.find('=', pos_);
+            if (eq == std::string::npos) return false;
+            std::string key = localName(trim(s_.substr(pos_, eq - pos_)));
+            const size_t quote = s_.find_first_of("\"'", eq + 1);
+            if (quote == std::string::npos) return false;
+            const size_t close = s_.find(s_[quote], quote + 1);
+            if (close == std::string::npos) return false;
+            node.attrs.emplace_back(std::move(key), decodeEntities(s_.substr(quote + 1, close - quote - 1)));
+            pos_ = close + 1;
+        }
+    }
+
+    const std::string& s_;
+    size_t pos_{0};
+};
+
+/** $RepresentationID$, $Bandwidth$, $Number[%0Nd]$, $Time[%0Nd]$, $$ */
+std::string expandTemplate(const std::string& tmpl, const std::string& id, uint32_t bandwidth,
+                           uint64_t number, uint64_t time) {
+    std::string out;
+    size_t i = 0;
+    while (i < tmpl.size()) {
+        const size_t open = tmpl.find('$', i);
+        if (open == std::string::npos) { out += tmpl.substr(i); break; }
+        out += tmpl.substr(i, open - i);
+        const size_t close = tmpl.find('$', open + 1);
+        if (close == std::string::npos) { out += tmpl.substr(open); break; }
+        const std::string token = tmpl.substr(open + 1, close - open - 1);
+        i = close + 1;
+        if (token.empty()) { out += '$'; continue; }
+
+        const size_t fmt = token.find('%');
+        const std::string name = token.substr(0, fmt);
+        int width = 0;
+        if (fmt != std::string::npos) width = std::atoi(token.c_str() + fmt + 2);   /* %0Nd */
+        std::string value;
+        if (name == "RepresentationID") value = id;
+        else if (name == "Bandwidth") value = std::to_string(bandwidth);
+        else if (name == "Number") value = std::to_string(number);
+        else if (name == "Time") value = std::to_string(time);
+        else { out += '$' + token + '$'; continue; }
+        if (static_cast<int>(value.size()) < width) value.insert(0, static_cast<size_t>(width) - value.size(), '0');
+        out += value;
+    }
+    return out;
+}
+
+std::string baseUrlOf(const XmlNode& node, const std::string& base) {
+    const XmlNode* b = node.child("BaseURL");
+    return b && !b->text.empty() ? ManifestParser::resolveUri(base, b->text) : base;
+}
+
+/** Attribute from the Representation's template, falling back to the AdaptationSet's */
+std::string templateAttr(const XmlNode* own, const XmlNode* inherited, const char* key,
+                         const std::string& fallback = {}) {
+    if (own && own->has(key)) return own->attr(key);
+    if (inherited && inherited->has(key)) return inherited->attr(key);
+    return fallback;
+}
+
+device::Result buildTemplateTimeline(const XmlNode* own, const XmlNode* inherited,
+                                     const std::string& id, uint32_t bandwidth,
+                                     const std::string& base, bool live, int64_t period_us,
+                                     MediaTimeline& tl) {
+    const uint64_t timescale = std::max<uint64_t>(toU64(templateAttr(own, inherited, "timescale", "1")), 1);
+    const uint64_t start_number = toU64(templateAttr(own, inherited, "startNumber", "1"));
+    const uint64_t pto = toU64(templateAttr(own, inherited, "presentationTimeOffset", "0"));
+    const std::string media = templateAttr(own, inherited, "media");
+    const std::string init = templateAttr(own, inherited, "initialization");
+    if (media.empty()) return device::Result::ERROR_INVALID_PARAM;
+    if (!init.empty()) tl.init_uri = ManifestParser::resolveUri(base, expandTemplate(init, id, bandwidth, 0, 0));
+
+    auto toUs = [&](uint64_t ticks) {
+        return static_cast<int64_t>(std::min<uint64_t>(mulDiv(ticks, 1000000, timescale), INT64_MAX));
+    };
+    /* Hostile or broken MPDs: S@r or @duration can ask for billions of segments */
+    auto fits = [&](uint64_t more) {
+        return more <= ManifestParser::kMaxTemplateSegments - tl.segments.size();
+    };
+    auto push = [&](uint64_t number, uint64_t time, uint64_t duration) {
+        Segment seg;
+        seg.uri = ManifestParser::resolveUri(base, expandTemplate(media, id, bandwidth, number, time));
+        seg.sequence = number;
+        seg.start_us = toUs(time >= pto ? time - pto : 0);
+        seg.duration_us = toUs(duration);
+        tl.target_duration_us = std::max(tl.target_duration_us, seg.duration_us);
+        tl.segments.push_back(std::move(seg));
+    };
+
+    const XmlNode* timeline = own && own->child("SegmentTimeline") ? own->child("SegmentTimeline")
+                            : inherited ? inherited->child("SegmentTimeline") : nullptr;
+    if (timeline) {
+        uint64_t number = start_number;
+        uint64_t t = 0;
+        const auto& entries = timeline->children;
+        for (size_t i = 0; i < entries.size(); ++i) {
+            const XmlNode& s = entries[i];
+            if (s.name != "S") continue;
+            if (s.has("t")) t = toU64(s.attr("t"));
+            const uint64_t d = toU64(s.attr("d"));
+            if (d == 0) return device::Result::ERROR_INVALID_PARAM;
+            int64_t repeat = std::atoll(s.attr("r", "0").c_str());
+            if (repeat < 0) {
+                /* Open repeat: until the next S@t, or the end of a static period */
+                uint64_t until = 0;
+                if (i + 1 < entries.size() && entries[i + 1].has("t")) until = toU64(entries[i + 1].attr("t"));
+                else if (!live && period_us > 0) until = pto + mulDiv(static_cast<uint64_t>(period_us), timescale, 1000000);
+                const uint64_t span = until > t ? until - t : 0;
+                const uint64_t count = span / d + (span % d != 0);
+                repeat = count ? static_cast<int64_t>(std::min<uint64_t>(count, INT64_MAX)) - 1 : 0;
+            }
+            if (!fits(static_cast<uint64_t>(repeat) + 1) ||
+                static_cast<uint64_t>(repeat) + 1 > (UINT64_MAX - t) / d)
+                return device::Result::ERROR_INVALID_PARAM;
+            for (int64_t r = 0; r <= repeat; ++r) {
+                push(number++, t, d);
+                t += d;
+            }
+        }
+        return device::Result::OK;
+    }
+
+    const uint64_t d = toU64(templateAttr(own, inherited, "duration"));
+    if (d == 0) return device::Result::ERROR_INVALID_PARAM;
+    /* Number-based live needs availabilityStartTime and a wall clock: not handled */
+    if (live || period_us <= 0) return device::Result::ERROR_NOT_SUPPORTED;
+    const uint64_t total = mulDiv(static_cast<uint64_t>(period_us), timescale, 1000000);
+    const uint64_t count = total / d + (total % d != 0);
+    if (!fits(count) || pto > UINT64_MAX - total) return device::Result::ERROR_INVALID_PARAM;
+    for (uint64_t n = 0; n < count; ++n)
+        push(start_number + n, pto + n * d, std::min(d, total - n * d));
+    return device::Result::OK;
+}
+
+void sortByBandwidth(std::vector<ManifestRendition>& v) {
+    std::stable_sort(v.begin(), v.end(), [](const ManifestRendition& a, const ManifestRendition& b) {
+        return a.bandwidth_bps < b.bandwidth_bps;
+    });
+}
+
+} // namespace
+
+// -----------------------------------------------------------------------------
+// MediaTimeline
+// -----------------------------------------------------------------------------
+
+size_t MediaTimeline::findByTime(int64_t t_us) const {
+    if (segments.empty()) return npos;
+    auto it = std::upper_bound(segments.begin(), segments.end(), t_us,
+        [](int64_t t, const Segment& s) { return t < s.start_us; });
+    return it == segments.begin() ? 0 : static_cast<size_t>(it - segments.begin()) - 1;
+}
+
+size_t MediaTimeline::findBySequence(uint64_t sequence) const {
+    if (segments.empty() || sequence < segments.front().sequence) return npos;
+    const uint64_t guess = sequence - segments.front().sequence;
+    if (guess < segments.size() && segments[guess].sequence == sequence) return guess;
+    for (size_t i = 0; i < segments.size(); ++i)
+        if (segments[i].sequence == sequence) return i;
+    return npos;
+}
+
+size_t MediaTimeline::merge(const MediaTimeline& fresh) {
+    live = fresh.live;
+    target_duration_us = fresh.target_duration_us;
+    if (!fresh.init_uri.empty()) {
+        init_uri = fresh.init_uri;
+        init_offset = fresh.init_offset;
+        init_length = fresh.init_length;
+    }
+    if (segments.empty()) {
+        segments = fresh.segments;
+        return segments.size();
+    }
+
+    size_t appended = 0;
+    for (const Segment& s : fresh.segments) {
+        if (s.sequence <= segments.back().sequence) continue;
+        Segment next = s;
+        next.start_us = segments.back().start_us + segments.back().duration_us;
+        segments.push_back(std::move(next));
+        ++appended;
+    }
+    if (!fresh.segments.empty()) {
+        const uint64_t first = fresh.segments.front().sequence;
+        size_t drop = 0;
+        while (drop < segments.size() && segments[drop].sequence < first) ++drop;
+        segments.erase(segments.begin(), segments.begin() + static_cast<std::ptrdiff_t>(drop));
+    }
+    return appended;
+}
+
+// -----------------------------------------------------------------------------
+// ManifestParser
+// -----------------------------------------------------------------------------
+
+std::string ManifestParser::resolveUri(const std::string& base, const std::string& ref) {
+    if (base.empty() || ref.empty()) return ref.empty() ? base : ref;
+    const size_t scheme_end = ref.find("://");
+    if (scheme_end != std::string::npos && ref.find('/') > scheme_end) return ref;
+
+    const size_t base_scheme = base.find("://");
+    const size_t authority_end = base_scheme == std::string::npos
+        ? 0 : base.find('/', base_scheme + 3);
+    if (startsWith(ref, "//"))
+        return base_scheme == std::string::npos ? ref : base.substr(0, base_scheme + 1) + ref;
+    if (ref[0] == '/') {
+        if (base_scheme == std::string::npos) return ref;
+        return base.substr(0, authority_end == std::string::npos ? base.size() : authority_end) + ref;
+    }
+
+    /* Relative: replace the last path segment of base, then fold ./ and ../ */
+    std::string path = base.substr(0, base.find_first_of("?#"));
+    const size_t slash = path.rfind('/');
+    const size_t root = authority_end == std::string::npos ? path.size() : authority_end;
+    std::string dir = slash == std::string::npos || (base_scheme != std::string::npos && slash < root)
+        ? path + "/" : path.substr(0, slash + 1);
+    std::string rest = ref;
+    for (;;) {
+        if (startsWith(rest, "./")) {
+            rest.erase(0, 2);
+        } else if (startsWith(rest, "../")) {
+            rest.erase(0, 3);
+            const size_t floor = base_scheme == std::string::npos ? 0 : root + 1;
+            if (dir.size() > floor) {
+                const size_t up = dir.rfind('/', dir.size() - 2);
+                if (up != std::string::npos && up + 1 >= floor) dir.erase(up + 1);
+            }
+        } else {
+            break;
+        }
+    }
+    return dir + rest;
+}
+
+int64_t ManifestParser::parseIsoDuration(const std::string& text) {
+    if (text.empty() || text[0] != 'P') return -1;
+    double seconds = 0.0;
+    bool time_part = false;
+    size_t i = 1;
+    while (i < text.size()) {
+        if (text[i] == 'T') { time_part = true; ++i; continue; }
+        char* end = nullptr;
+        const double v = std::strtod(text.c_str() + i, &end);
+        if (end == text.c_str() + i || *end == '\0') return -1;
+        switch (*end) {
+            case 'D': seconds += v * 86400; break;
+            case 'H': seconds += v * 3600; break;
+            case 'M': if (!time_part) return -1; seconds += v * 60; break;   /* Months are ambiguous */
+            case 'S': seconds += v; break;
+            default: return -1;
+        }
+        i = static_cast<size_t>(end - text.c_str()) + 1;
+    }
+    return static_cast<int64_t>(std::llround(seconds * 1e6));
+}
+
+device::Result ManifestParser::parse(const std::string& text, const std::string& uri, Manifest& out) {
+    const std::string head = trim(text.substr(0, std::min<size_t>(text.size(), 512)));
+    if (startsWith(head, "#EXTM3U")) {
+        if (text.find("#EXT-X-STREAM-INF") != std::string::npos) return parseHlsMaster(text, uri, out);
+        /* Bare media playlist: one rendition of unknown bandwidth */
+        out = {};
+        out.type = ManifestType::HLS;
+        out.uri = uri;
+        ManifestRendition r;
+        r.id = uri;
+        const device::Result res = parseHlsMedia(text, uri, r.timeline);
+        if (res != device::Result::OK) return res;
+        out.live = r.timeline.live;
+        out.reload_interval_us = r.timeline.target_duration_us;
+        if (!out.live && !r.timeline.segments.empty())
+            out.duration_us = r.timeline.segments.back().start_us + r.timeline.segments.back().duration_us;
+        out.video.push_back(std::move(r));
+        return device::Result::OK;
+    }
+    if (text.find("<MPD") != std::string::npos) return parseDash(text, uri, out);
+    return device::Result::ERROR_INVALID_PARAM;
+}
+
+device::Result ManifestParser::parseHlsMaster(const std::string& text, const std::string& uri, Manifest& out) {
+    const std::vector<std::string> lines = splitLines(text);
+    if (lines.empty() || lines[0] != "#EXTM3U") return device::Result::ERROR_INVALID_PARAM;
+    out = {};
+    out.type = ManifestType::HLS;
+    out.uri = uri;
+
+    bool pending_variant = false;
+    ManifestRendition variant;
+    for (size_t i = 1; i < lines.size(); ++i) {
+        const std::string& line = lines[i];
+        if (startsWith(line, "#EXT-X-STREAM-INF:")) {
+            const Attributes a = parseAttributeList(line.substr(18));
+            variant = {};
+            variant.kind = StreamKind::VIDEO;
+            variant.bandwidth_bps = static_cast<uint32_t>(toU64(attrOr(a, "BANDWIDTH", "0")));
+            variant.codecs = attrOr(a, "CODECS");
+            const std::string res = attrOr(a, "RESOLUTION");
+            const size_t x = res.find('x');
+            if (x != std::string::npos) {
+                variant.width = static_cast<uint32_t>(toU64(res.substr(0, x)));
+                variant.height = static_cast<uint32_t>(toU64(res.substr(x + 1)));
+            }
+            pending_variant = true;
+        } else if (startsWith(line, "#EXT-X-MEDIA:")) {
+            const Attributes a = parseAttributeList(line.substr(13));
+            /* Audio without URI is muxed into the variants */
+            if (attrOr(a, "TYPE") != "AUDIO" || !findAttr(a, "URI")) continue;
+            ManifestRendition alt;
+            alt.kind = StreamKind::AUDIO;
+            alt.id = attrOr(a, "GROUP-ID") + "/" + attrOr(a, "NAME");
+            alt.language = attrOr(a, "LANGUAGE");
+            alt.playlist_uri = resolveUri(uri, attrOr(a, "URI"));
+            if (attrOr(a, "DEFAULT") == "YES") out.audio.insert(out.audio.begin(), std::move(alt));
+            else out.audio.push_back(std::move(alt));
+        } else if (line[0] != '#' && pending_variant) {
+            variant.playlist_uri = resolveUri(uri, line);
+            variant.id = variant.playlist_uri;
+            out.video.push_back(std::move(variant));
+            pending_variant = false;
+        }
+    }
+    if (out.video.empty()) return device::Result::ERROR_INVALID_PARAM;
+    sortByBandwidth(out.video);
+    return device::Result::OK;
+}
+
+device::Result ManifestParser::parseHlsMedia(const std::string& text, const std::string& uri, MediaTimeline& out) {
+    const std::vector<std::string> lines = splitLines(text);
+    if (lines.empty() || lines[0] != "#EXTM3U") return device::Result::ERROR_INVALID_PARAM;
+    out = {};
+
+    uint64_t sequence = 0;
+    int64_t start = 0;
+    int64_t pending_duration = -1;
+    uint64_t range_offset = 0, range_length = 0;
+    uint64_t next_offset = 0;
+    bool ended = false;
+    for (size_t i = 1; i < lines.size(); ++i) {
+        const std::string& line = lines[i];
+        if (startsWith(line, "#EXT-X-TARGETDURATION:")) {
+            out.target_duration_us = static_cast<int64_t>(toU64(line.substr(22))) * 1000000;
+        } else if (startsWith(line, "#EXT-X-MEDIA-SEQUENCE:")) {
+            sequence = toU64(line.substr(22));
+        } else if (startsWith(line, "#EXTINF:")) {
+            pending_duration = static_cast<int64_t>(std::llround(std::strtod(line.c_str() + 8, nullptr) * 1e6));
+        } else if (startsWith(line, "#EXT-X-BYTERANGE:")) {
+            parseByteRange(line.substr(17), next_offset, range_offset, range_length);
+        } else if (startsWith(line, "#EXT-X-MAP:")) {
+            const Attributes a = parseAttributeList(line.substr(11));
+            out.init_uri = resolveUri(uri, attrOr(a, "URI"));
+            if (const std::string* br = findAttr(a, "BYTERANGE"))
+                parseByteRange(*br, 0, out.init_offset, out.init_length);
+        } else if (line == "#EXT-X-ENDLIST") {
+            ended = true;
+        } else if (line[0] != '#') {
+            if (pending_duration < 0) return device::Result::ERROR_INVALID_PARAM;   /* URI without EXTINF */
+            Segment seg;
+            seg.uri = resolveUri(uri, line);
+            seg.sequence = sequence++;
+            seg.start_us = start;
+            seg.duration_us = pending_duration;
+            seg.byte_offset = range_offset;
+            seg.byte_length = range_length;
+            next_offset = range_length ? range_offset + range_length : 0;
+            start += pending_duration;
+            out.segments.push_back(std::move(seg));
+            pending_duration = -1;
+            range_offset = range_length = 0;
+        }
+    }
+    out.live = !ended;
+    return device::Result::OK;
+}
+
+device::Result ManifestParser::parseDash(const std::string& text, const std::string& uri, Manifest& out) {
+    XmlNode mpd;
+    if (!XmlReader(text).parse(mpd) || mpd.name != "MPD") return device::Result::ERROR_INVALID_PARAM;
+    out = {};
+    out.type = ManifestType::DASH;
+    out.uri = uri;
+    out.live = mpd.attr("type", "static") == "dynamic";
+    out.duration_us = std::max<int64_t>(parseIsoDuration(mpd.attr("mediaPresentationDuration")), 0);
+    if (out.live) out.reload_interval_us = std::max<int64_t>(parseIsoDuration(mpd.attr("minimumUpdatePeriod")), 0);
+
+    /* First period only; multi-period (ad insertion) is stitched upstream */
+    const XmlNode* period = mpd.child("Period");
+    if (!period) return device::Result::ERROR_INVALID_PARAM;
+    int64_t period_us = parseIsoDuration(period->attr("duration"));
+    if (period_us <= 0) period_us = out.duration_us;
+    const std::string period_base = baseUrlOf(*period, baseUrlOf(mpd, uri));
+
+    for (const XmlNode& set : period->children) {
+        if (set.name != "AdaptationSet") continue;
+        std::string type = set.attr("contentType");
+        if (type.empty()) type = set.attr("mimeType");
+        if (type.empty()) {
+            const XmlNode* rep = set.child("Representation");
+            if (rep) type = rep->attr("mimeType");
+        }
+        StreamKind kind;
+        if (startsWith(type, "video")) kind = StreamKind::VIDEO;
+        else if (startsWith(type, "audio")) kind = StreamKind::AUDIO;
+        else continue;   /* Text tracks are not fetched here */
+
+        const std::string set_base = baseUrlOf(set, period_base);
+        const XmlNode* set_template = set.child("SegmentTemplate");
+        for (const XmlNode& rep : set.children) {
+            if (rep.name != "Representation") continue;
+            if (rep.child("SegmentList") || set.child("SegmentList")) return device::Result::ERROR_NOT_SUPPORTED;
+
+            ManifestRendition r;
+            r.kind = kind;
+            r.id = rep.attr("id");
+            r.bandwidth_bps = static_cast<uint32_t>(toU64(rep.attr("bandwidth", "0")));
+            r.width = static_cast<uint32_t>(toU64(rep.attr("width", set.attr("width", "0"))));
+            r.height = static_cast<uint32_t>(toU64(rep.attr("height", set.attr("height", "0"))));
+            r.codecs = rep.attr("codecs", set.attr("codecs"));
+            r.language = set.attr("lang");
+            r.timeline.live = out.live;
+            const std::string base = baseUrlOf(rep, set_base);
+
+            const XmlNode* own = rep.child("SegmentTemplate");
+            if (own || set_template) {
+                const device::Result res = buildTemplateTimeline(own, set_template, r.id, r.bandwidth_bps,
+                                                                 base, out.live, period_us, r.timeline);
+                if (res != device::Result::OK) return res;
+            } else {
+                /* SegmentBase: the whole representation is one resource */
+                Segment whole;
+                whole.uri = base;
+                whole.duration_us = period_us;
+                r.timeline.target_duration_us = period_us;
+                r.timeline.segments.push_back(std::move(whole));
+            }
+            (kind == StreamKind::VIDEO ? out.video : out.audio).push_back(std::move(r));
+        }
+    }
+    if (out.video.empty() && out.audio.empty()) return device::Result::ERROR_INVALID_PARAM;
+    sortByBandwidth(out.video);
+    return device::Result::OK;
+}
+
+std::vector<Rendition> ManifestParser::ladder(const Manifest& manifest) {
+    std::vector<Rendition> out;
+    out.reserve(manifest.video.size());
+    for (const auto& r : manifest.video) out.push_back({r.bandwidth_bps, r.width, r.height});
+    return out;
+}
+
+} // namespace streaming::media
@@ -0,0 +1,120 @@
+/**
+ * @file manifest.hpp
+ * @brief HLS / DASH manifests parsed into renditions and segment timelines
+ * @copyright 2025 Streaming Device Project
+ *
+ * Both formats reduce to the same compact model: per rendition a list of
+ * segments (absolute URI, optional byte range, start, duration, sequence
+ * number) and an optional init segment. Nothing of the source text or XML
+ * tree is kept. DASH SegmentTemplate timelines are expanded here, so the
+ * fetch side never sees the difference between the formats.
+ *
+ * Renditions of one kind are assumed segment-aligned (same sequence
+ * numbers at the same times), as both HLS and DASH require for switching.
+ */
+
+#pragma once
+
+#include <streaming_device/types.hpp>
+#include "abr_controller.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace streaming::media {
+
+enum class ManifestType : uint8_t { HLS, DASH };
+enum class StreamKind : uint8_t { VIDEO, AUDIO };
+
+/** One media segment */
+struct Segment {
+    std::string uri;
+    uint64_t sequence{0};        /* HLS media sequence / DASH $Number$ */
+    int64_t start_us{0};
+    int64_t duration_us{0};
+    uint64_t byte_offset{0};
+    uint64_t byte_length{0};     /* 0: the whole resource */
+};
+
+/** Segments of one rendition */
+struct MediaTimeline {
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    std::string init_uri;        /* fMP4 init segment, empty for TS */
+    uint64_t init_offset{0};
+    uint64_t init_length{0};
+    std::vector<Segment> segments;
+    int64_t target_duration_us{0};
+    bool live{false};            /* HLS without ENDLIST / DASH type="dynamic" */
+
+    /** Segment containing t, or the nearest one; npos if empty */
+    size_t findByTime(int64_t t_us) const;
+    /** Segment with this sequence number, npos if not (or no longer) listed */
+    size_t findBySequence(uint64_t sequence) const;
+
+    /**
+     * Live reload: append segments of fresh newer than the last one known
+     * (timed on from it, so start_us stays continuous) and drop those that
+     * left fresh's window. Returns the number appended.
+     */
+    size_t merge(const MediaTimeline& fresh);
+};
+
+/** A variant (video) or alternate (audio) rendition */
+struct ManifestRendition {
+    std::string id;
+    StreamKind kind{StreamKind::VIDEO};
+    uint32_t bandwidth_bps{0};
+    uint32_t width{0};
+    uint32_t height{0};
+    std::string codecs;
+    std::string language;
+    std::string playlist_uri;    /* HLS media playlist; empty once timeline is loaded inline (DASH) */
+    MediaTimeline timeline;
+};
+
+struct Manifest {
+    ManifestType type{ManifestType::HLS};
+    std::string uri;             /* Where it was loaded from; base for reloads */
+    bool live{false};
+    int64_t duration_us{0};      /* 0 for live */
+    int64_t reload_interval_us{0};
+    std::vector<ManifestRendition> video;   /* Sorted by bandwidth, lowest first */
+    std::vector<ManifestRendition> audio;
+};
+
+/**
+ * @brief Text to Manifest
+ *
+ * Returns ERROR_INVALID_PARAM for text that is not the expected format
+ * and ERROR_NOT_SUPPORTED for valid constructs outside the subset handled
+ * (DASH SegmentList, dynamic MPDs without SegmentTimeline).
+ */
+class ManifestParser {
+public:
+    /** Segments one DASH template may expand to; more is ERROR_INVALID_PARAM */
+    static constexpr size_t kMaxTemplateSegments = 200000;
+
+    /**
+     * Detect HLS (#EXTM3U) or DASH (<MPD) and parse. HLS with
+     * #EXT-X-STREAM-INF is a master playlist; any other HLS text is a bare
+     * media playlist and becomes one rendition.
+     */
+    static device::Result parse(const std::string& text, const std::string& uri, Manifest& out);
+
+    static device::Result parseHlsMaster(const std::string& text, const std::string& uri, Manifest& out);
+    static device::Result parseHlsMedia(const std::string& text, const std::string& uri, MediaTimeline& out);
+    static device::Result parseDash(const std::string& text, const std::string& uri, Manifest& out);
+
+    /** RFC 3986 reference resolution for the absolute and relative forms manifests use */
+    static std::string resolveUri(const std::string& base, const std::string& ref);
+
+    /** Video renditions as an ABR ladder, same order as Manifest::video */
+    static std::vector<Rendition> ladder(const Manifest& manifest);
+
+    /** ISO 8601 duration (PT1H2M3.5S) in microseconds, -1 if malformed */
+    static int64_t parseIsoDuration(const std::string& text);
+};
+
+} // namespace streaming::media
@@ -0,0 +1,279 @@
+/**
+ * @file media_cache.cpp
+ * @brief MediaCache implementation
+ */
+
+#include "media_cache.hpp"
+#include "segment_scheduler.hpp"
+#include "../common/logger.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <set>
+#include <sstream>
+
+namespace streaming::media {
+
+namespace {
+
+/* FNV-1a: blob names must be stable across builds, std::hash is not */
+uint64_t fnv1a(const std::string& s) {
+    uint64_t h = 1469598103934665603ULL;
+    for (unsigned char c : s) {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+} // namespace
+
+MediaCache::MediaCache(hal::IStorageHal& storage, MediaCacheConfig config)
+    : storage_(storage), config_(std::move(config)) {}
+
+MediaCache::~MediaCache() { flush(); }
+
+std::string MediaCache::keyFor(const SegmentRequest& request) {
+    if (request.offset == 0 && request.length == 0) return request.uri;
+    return request.uri + "#" + std::to_string(request.offset) + "-" + std::to_string(request.length);
+}
+
+std::string MediaCache::blobKey(const std::string& key) const {
+    char hex[17];
+    std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(fnv1a(key)));
+    return config_.key_prefix + hex;
+}
+
+void MediaCache::waitIdleLocked(std::unique_lock<std::mutex>& lock) {
+    idle_cv_.wait(lock, [this] { return io_in_flight_ == 0; });
+}
+
+device::Result MediaCache::open() {
+    IndexSnapshot snapshot;
+    {
+        /* Startup: storage is read under the lock, nothing else is running on it */
+        std::unique_lock<std::mutex> lock(mutex_);
+        waitIdleLocked(lock);
+        lru_.clear();
+        index_.clear();
+        used_ = 0;
+        open_ = false;
+
+        uint64_t total = 0, free_bytes = 0;
+        const device::Result space = storage_.getSpace(total, free_bytes);
+        if (space != device::Result::OK) return space;
+
+        /* Index lines, most recently used first: <blob> <size> <key> */
+        std::vector<uint8_t> raw;
+        std::set<std::string> live_blobs;
+        if (storage_.readBytes(indexKey(), raw) == device::Result::OK) {
+            std::istringstream in(std::string(raw.begin(), raw.end()));
+            std::string line;
+            while (std::getline(in, line)) {
+                std::istringstream fields(line);
+                Entry e;
+                if (!(fields >> e.blob >> e.size)) continue;
+                fields.get();
+                std::getline(fields, e.key);
+                if (e.key.empty() || index_.count(e.key) || !storage_.exists(e.blob)) continue;
+                lru_.push_back(e);
+                index_[e.key] = std::prev(lru_.end());
+                live_blobs.insert(e.blob);
+                used_ += e.size;
+            }
+        }
+        /* Blobs written after the last index update */
+        std::vector<std::string> keys;
+        storage_.listKeys(config_.key_prefix, keys);
+        for (const auto& k : keys)
+            if (k != indexKey() && !live_blobs.count(k)) storage_.remove(k);
+
+        const uint64_t available = free_bytes + used_ > config_.reserve_free_bytes
+            ? free_bytes + used_ - config_.reserve_free_bytes : 0;
+        budget_ = std::min({config_.max_bytes, static_cast<uint64_t>(static_cast<double>(total) * config_.max_fraction),
+                            available});
+        open_ = true;
+        makeRoomLocked(0);   /* The budget may have shrunk since the last run */
+        LOG_INFO("MediaCache", "Opened,", lru_.size(), "entries,", used_, "of", budget_, "bytes");
+        snapshot = snapshotIndexLocked(true);
+    }
+    return writeIndex(snapshot);
+}
+
+bool MediaCache::contains(const SegmentRequest& request) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(keyFor(request));
+    return it != index_.end() && !it->second->writing;
+}
+
+device::Result MediaCache::lookup(const SegmentRequest& request, std::vector<uint8_t>& data_out) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto found = open_ ? index_.find(keyFor(request)) : index_.end();
+    if (found == index_.end() || found->second->writing) {
+        stats_.misses++;
+        return device::Result::ERROR_NOT_FOUND;
+    }
+    /* A busy entry is neither evicted nor replaced: the iterator outlives the read */
+    const Lru::iterator it = found->second;
+    it->readers++;
+    io_in_flight_++;
+    const std::string blob = it->blob;
+    const uint64_t size = it->size;
+    lock.unlock();
+
+    const bool ok = storage_.readBytes(blob, data_out) == device::Result::OK && data_out.size() == size;
+
+    IndexSnapshot snapshot;
+    lock.lock();
+    it->readers--;
+    if (--io_in_flight_ == 0) idle_cv_.notify_all();
+    if (!ok) {
+        if (!it->busy()) {
+            eraseLocked(it, true);   /* Lost or damaged on storage */
+            changedLocked();
+            snapshot = snapshotIndexLocked(false);
+        }
+        stats_.misses++;
+        lock.unlock();
+        writeIndex(snapshot);
+        return device::Result::ERROR_NOT_FOUND;
+    }
+    lru_.splice(lru_.begin(), lru_, it);
+    stats_.hits++;
+    stats_.bytes_served += data_out.size();
+    return device::Result::OK;
+}
+
+device::Result MediaCache::insert(const SegmentRequest& request, const std::vector<uint8_t>& data) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!open_) return device::Result::ERROR_INVALID_PARAM;
+    const std::string key = keyFor(request);
+    auto existing = index_.find(key);
+    if (existing != index_.end()) {
+        if (existing->second->busy()) {
+            stats_.rejected++;
+            return device::Result::ERROR_BUSY;
+        }
+        eraseLocked(existing->second, true);
+    }
+
+    if (data.size() > budget_ || !makeRoomLocked(data.size())) {
+        stats_.rejected++;
+        return device::Result::ERROR_NO_MEMORY;
+    }
+    /* Reserve the space now so concurrent inserts cannot overcommit the budget */
+    lru_.push_front(Entry{key, blobKey(key), data.size(), 0, true});
+    const Lru::iterator it = lru_.begin();
+    index_[key] = it;
+    used_ += it->size;
+    io_in_flight_++;
+    const std::string blob = it->blob;
+    lock.unlock();
+
+    device::Result r = storage_.writeBytes(blob, data);
+
+    IndexSnapshot snapshot;
+    lock.lock();
+    if (--io_in_flight_ == 0) idle_cv_.notify_all();
+    if (r != device::Result::OK) {
+        eraseLocked(it, true);
+    } else {
+        it->writing = false;
+        stats_.insertions++;
+        changedLocked();
+        snapshot = snapshotIndexLocked(false);
+    }
+    lock.unlock();
+    writeIndex(snapshot);
+    return r;
+}
+
+bool MediaCache::makeRoomLocked(uint64_t size) {
+    /* Least recently used first; pinned entries and those being read or written stay */
+    auto it = lru_.end();
+    while (used_ + size > budget_ && it != lru_.begin()) {
+        --it;
+        if (it->busy() || pins_.count(it->key)) continue;
+        auto victim = it++;
+        eraseLocked(victim, true);
+        stats_.evictions++;
+        changedLocked();
+    }
+    return used_ + size <= budget_;
+}
+
+void MediaCache::eraseLocked(Lru::iterator it, bool remove_blob) {
+    if (remove_blob) storage_.remove(it->blob);
+    used_ -= it->size;
+    index_.erase(it->key);
+    lru_.erase(it);
+}
+
+void MediaCache::pin(const SegmentRequest& request) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pins_[keyFor(request)]++;
+}
+
+void MediaCache::unpin(const SegmentRequest& request) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = pins_.find(keyFor(request));
+    if (it != pins_.end() && --it->second == 0) pins_.erase(it);
+}
+
+void MediaCache::changedLocked() {
+    ++changes_;
+}
+
+MediaCache::IndexSnapshot MediaCache::snapshotIndexLocked(bool force) {
+    IndexSnapshot snapshot;
+    if (!open_ || (!force && changes_ < config_.index_write_interval)) return snapshot;
+    /* Entries still being written have no complete blob to point at yet */
+    for (const auto& e : lru_)
+        if (!e.writing) snapshot.text += e.blob + " " + std::to_string(e.size) + " " + e.key + "\n";
+    changes_ = 0;
+    snapshot.due = true;
+    snapshot.generation = ++index_generation_;
+    return snapshot;
+}
+
+device::Result MediaCache::writeIndex(const IndexSnapshot& snapshot) {
+    if (!snapshot.due) return device::Result::OK;
+    std::lock_guard<std::mutex> lock(index_mutex_);
+    if (snapshot.generation <= index_written_) return device::Result::OK;   /* A newer one went out */
+    index_written_ = snapshot.generation;
+    return storage_.writeBytes(indexKey(), std::vector<uint8_t>(snapshot.text.begin(), snapshot.text.end()));
+}
+
+device::Result MediaCache::flush() {
+    IndexSnapshot snapshot;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        snapshot = snapshotIndexLocked(true);
+    }
+    return writeIndex(snapshot);
+}
+
+void MediaCache::clear() {
+    IndexSnapshot snapshot;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        waitIdleLocked(lock);
+        for (const auto& e : lru_) storage_.remove(e.blob);
+        lru_.clear();
+        index_.clear();
+        used_ = 0;
+        snapshot = snapshotIndexLocked(true);
+    }
+    writeIndex(snapshot);
+}
+
+MediaCacheStats MediaCache::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    MediaCacheStats stats = stats_;
+    stats.bytes_used = used_;
+    stats.budget = budget_;
+    stats.entries = lru_.size();
+    stats.pinned = pins_.size();
+    return stats;
+}
+
+} // namespace streaming::media
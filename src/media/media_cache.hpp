@@ -0,0 +1,156 @@
+/**
+ * @file media_cache.hpp
+ * @brief Persistent LRU cache of segments and byte ranges on IStorageHal
+ * @copyright 2025 Streaming Device Project
+ *
+ * Entries are keyed by URI and byte range and stored as storage blobs
+ * under a key prefix, next to an index blob listing them in LRU order.
+ * The index is rewritten every few changes and on flush(), and read back
+ * by open(): entries whose blob is gone are dropped, blobs the index does
+ * not know are deleted, so a crash costs cached data, never consistency.
+ *
+ * The size budget comes from getSpace() at open(): a fraction of the
+ * partition, capped, and never eating into a reserve of free space.
+ * Eviction goes least recently used first and skips pinned entries,
+ * which the segment scheduler holds for everything queued or playing.
+ *
+ * Blob and index reads and writes run outside the cache lock: an entry
+ * is reserved (or found) under it, its data moved unlocked, and the
+ * result committed under it again. Entries with I/O in flight are never
+ * evicted or replaced, so pin() and unpin() never wait on storage.
+ */
+
+#pragma once
+
+#include <streaming_device/types.hpp>
+#include "hal/storage_hal.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace streaming::media {
+
+struct SegmentRequest;
+
+struct MediaCacheConfig {
+    std::string key_prefix{"mcache/"};
+    double max_fraction{0.25};              /* Of the partition's total size */
+    uint64_t max_bytes{512ULL << 20};
+    uint64_t reserve_free_bytes{64ULL << 20};   /* Left free for settings and apps */
+    uint32_t index_write_interval{16};      /* Changes between index rewrites */
+};
+
+struct MediaCacheStats {
+    uint64_t hits{0};
+    uint64_t misses{0};
+    uint64_t bytes_served{0};
+    uint64_t insertions{0};
+    uint64_t rejected{0};        /* Too large, or the budget is pinned full */
+    uint64_t evictions{0};
+    uint64_t bytes_used{0};
+    uint64_t budget{0};
+    size_t entries{0};
+    size_t pinned{0};
+};
+
+/**
+ * @brief URI + range keyed blob cache
+ *
+ * Thread safe. open() and clear() wait for blob I/O in flight and run
+ * under the cache lock; lookups and inserts of different entries move
+ * their data concurrently. Without a successful open() the cache is
+ * disabled (every lookup misses).
+ */
+class MediaCache {
+public:
+    explicit MediaCache(hal::IStorageHal& storage, MediaCacheConfig config = {});
+    ~MediaCache();
+
+    MediaCache(const MediaCache&) = delete;
+    MediaCache& operator=(const MediaCache&) = delete;
+
+    /** Load the index, drop what storage lost, compute the budget */
+    device::Result open();
+
+    /** Cached bytes for request; ERROR_NOT_FOUND on a miss. Marks the entry recently used */
+    device::Result lookup(const SegmentRequest& request, std::vector<uint8_t>& data_out);
+
+    /**
+     * Store data for request, evicting unpinned LRU entries to fit.
+     * ERROR_BUSY while the entry it would replace is being read or written.
+     */
+    device::Result insert(const SegmentRequest& request, const std::vector<uint8_t>& data);
+
+    /** Cached and readable: false while the entry is still being written */
+    bool contains(const SegmentRequest& request) const;
+
+    /** Protect request from eviction (counted; may precede its insertion) */
+    void pin(const SegmentRequest& request);
+    void unpin(const SegmentRequest& request);
+
+    /** Write the index now */
+    device::Result flush();
+
+    /** Remove every entry and blob */
+    void clear();
+
+    MediaCacheStats getStats() const;
+
+    /** Cache key of a request: URI plus "#offset-length" for ranges */
+    static std::string keyFor(const SegmentRequest& request);
+
+private:
+    struct Entry {
+        std::string key;
+        std::string blob;        /* Storage key of the data */
+        uint64_t size{0};
+        uint32_t readers{0};     /* lookup()s reading the blob */
+        bool writing{false};     /* Reserved by insert(), blob not complete yet */
+        bool busy() const { return readers != 0 || writing; }
+    };
+    using Lru = std::list<Entry>;   /* Most recently used first */
+
+    /** Index text taken under the lock, written by writeIndex() outside it */
+    struct IndexSnapshot {
+        bool due{false};
+        uint64_t generation{0};
+        std::string text;
+    };
+
+    std::string blobKey(const std::string& key) const;
+    std::string indexKey() const { return config_.key_prefix + "index"; }
+    bool makeRoomLocked(uint64_t size);
+    void eraseLocked(Lru::iterator it, bool remove_blob);
+    void changedLocked();
+    /** Snapshot the index if enough changed since the last one, or if force */
+    IndexSnapshot snapshotIndexLocked(bool force);
+    /** Write a snapshot unless a newer one already went out; mutex_ not held */
+    device::Result writeIndex(const IndexSnapshot& snapshot);
+    void waitIdleLocked(std::unique_lock<std::mutex>& lock);
+
+    hal::IStorageHal& storage_;
+    const MediaCacheConfig config_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable idle_cv_;
+    uint32_t io_in_flight_{0};   /* Blob reads and writes outside mutex_ */
+    uint64_t index_generation_{0};
+    std::mutex index_mutex_;     /* Orders index writes; taken without mutex_ */
+    uint64_t index_written_{0};  /* Generation last written, under index_mutex_ */
+    bool open_{false};
+    Lru lru_;
+    std::unordered_map<std::string, Lru::iterator> index_;
+    std::map<std::string, uint32_t> pins_;
+    uint64_t used_{0};
+    uint64_t budget_{0};
+    uint32_t changes_{0};        /* Since the index was last written */
+    MediaCacheStats stats_;
+};
+
+} // namespace streaming::media
@@ -0,0 +1,130 @@
+/**
+ * @file media_clock.cpp
+ * @brief MediaClock implementation
+ */
+
+#include "media_clock.hpp"
+#include <algorithm>
+#include <cstdlib>
+
+namespace streaming::media {
+
+void MediaClock::setMode(ClockMode mode) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    mode_ = mode;
+}
+
+ClockMode MediaClock::getMode() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return mode_;
+}
+
+void MediaClock::start(Pts pts, int64_t now_us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    anchor_pts_ = pts;
+    anchor_us_ = now_us;
+    rate_ppm_ = 0;
+    running_ = true;
+    locked_ = false;
+    /* Offsets are per session (start or seek); counters and latency carry over */
+    stats_.av_offset_us = 0;
+    stats_.max_av_offset_us = 0;
+    stats_.rate_ppm = 0;
+}
+
+void MediaClock::reset(Pts pts) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    anchor_pts_ = pts;
+    rate_ppm_ = 0;
+    running_ = false;
+}
+
+bool MediaClock::isRunning() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return running_;
+}
+
+void MediaClock::setPaused(bool paused, int64_t now_us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (paused == paused_) return;
+    if (running_) {
+        if (paused) anchor_pts_ = timeLocked(now_us);
+        anchor_us_ = now_us;
+    }
+    paused_ = paused;
+}
+
+Pts MediaClock::getTime(int64_t now_us) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return timeLocked(now_us);
+}
+
+Pts MediaClock::timeLocked(int64_t now_us) const {
+    if (!running_ || paused_) return anchor_pts_;
+    const int64_t elapsed = now_us - anchor_us_;
+    return anchor_pts_ + elapsed * speed_ + elapsed * rate_ppm_ / 1000000;
+}
+
+void MediaClock::rebaseLocked(int64_t now_us) {
+    anchor_pts_ = timeLocked(now_us);
+    anchor_us_ = now_us;
+}
+
+void MediaClock::updateAudioPosition(Pts audio_pts, int64_t sampled_at_us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (mode_ != ClockMode::AUDIO_MASTER || !running_ || paused_ || speed_ != 1) return;
+
+    audio_pts -= output_latency_us_;   /* What the listener hears now */
+    const int64_t offset = audio_pts - timeLocked(sampled_at_us);
+    stats_.audio_updates++;
+
+    if (!locked_ || std::llabs(offset) > kResyncThresholdUs) {
+        anchor_pts_ = audio_pts;
+        anchor_us_ = sampled_at_us;
+        rate_ppm_ = 0;
+        if (locked_) stats_.resyncs++;
+        locked_ = true;
+        stats_.av_offset_us = 0;
+        stats_.rate_ppm = 0;
+        return;
+    }
+    stats_.av_offset_us = offset;
+    stats_.max_av_offset_us = std::max<int64_t>(stats_.max_av_offset_us, std::llabs(offset));
+
+    /* Proportional slew: remove the offset over the correction window */
+    rebaseLocked(sampled_at_us);
+    const int64_t ppm = offset * 1000000 / kCorrectionWindowUs;
+    rate_ppm_ = static_cast<int32_t>(std::clamp<int64_t>(ppm, -kMaxSlewPpm, kMaxSlewPpm));
+    stats_.rate_ppm = rate_ppm_;
+}
+
+void MediaClock::setSpeed(int32_t speed, int64_t now_us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_ && !paused_) rebaseLocked(now_us);
+    speed_ = speed == 0 ? 1 : speed;
+    rate_ppm_ = 0;
+    locked_ = false;   /* Back at 1x, the first audio position snaps */
+}
+
+int32_t MediaClock::getSpeed() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return speed_;
+}
+
+void MediaClock::setOutputLatency(int64_t latency_us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    output_latency_us_ = std::max<int64_t>(latency_us, 0);
+    stats_.output_latency_us = output_latency_us_;
+}
+
+int64_t MediaClock::getOutputLatency() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return output_latency_us_;
+}
+
+ClockStats MediaClock::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+} // namespace streaming::media
@@ -0,0 +1,112 @@
+/**
+ * @file media_clock.hpp
+ * @brief Media clock for A/V sync - audio master or free-running system clock
+ * @copyright 2025 Streaming Device Project
+ *
+ * Video presentation reads media time from this clock at every vblank.
+ * In AUDIO_MASTER mode the clock is slaved to the audio render position:
+ * small offsets are removed by slewing the clock rate (at most 0.5%), so
+ * the presentation scheduler absorbs them as an occasional repeated or
+ * dropped frame rather than a visible jump. Offsets beyond the resync
+ * threshold (a seek, an audio underrun) snap the clock to audio, as does
+ * the first audio position after start() (initial lock).
+ * The sink's output latency (e.g. ~200 ms over Bluetooth A2DP) is taken
+ * off every audio position, so video follows what is audible rather than
+ * what is leaving the HAL. A latency change mid-stream is corrected like
+ * any other offset: slewed if small, snapped if beyond the threshold.
+ * SYSTEM mode runs at exactly 1.0 for streams without audio.
+ * Trick play sets an integer speed (negative runs backwards); audio is
+ * muted then, so positions are ignored until the speed is back to 1.
+ */
+
+#pragma once
+
+#include <streaming_device/media_types.hpp>
+#include <cstdint>
+#include <mutex>
+
+namespace streaming::media {
+
+/** Clock master */
+enum class ClockMode : uint8_t {
+    SYSTEM,        /* Monotonic system time */
+    AUDIO_MASTER   /* Follow the audio render position */
+};
+
+/** A/V sync metrics */
+struct ClockStats {
+    int64_t av_offset_us{0};      /* Audio minus video clock at the last update; + means video is behind */
+    int64_t max_av_offset_us{0};  /* Largest |offset| since the last start(), excluding resyncs */
+    int32_t rate_ppm{0};          /* Current slew, parts per million away from 1.0 */
+    uint64_t audio_updates{0};
+    uint64_t resyncs{0};          /* Hard snaps to the audio position */
+    int64_t output_latency_us{0}; /* Sink latency applied to audio positions */
+};
+
+/**
+ * @brief Media clock
+ *
+ * Times are steady-clock microseconds supplied by the caller, so the
+ * clock is deterministic under test. Thread-safe.
+ */
+class MediaClock {
+public:
+    /** Offsets above this are snapped instead of slewed */
+    static constexpr int64_t kResyncThresholdUs = 100000;
+    /** Maximum rate correction, parts per million */
+    static constexpr int32_t kMaxSlewPpm = 5000;
+    /** Slew so that an offset would be removed over this much time */
+    static constexpr int64_t kCorrectionWindowUs = 2000000;
+
+    /** Select the master; takes effect from the next start() */
+    void setMode(ClockMode mode);
+    ClockMode getMode() const;
+
+    /** Start running at media time pts, now */
+    void start(Pts pts, int64_t now_us);
+
+    /** Stop at pts; getTime() returns pts until the next start() */
+    void reset(Pts pts);
+
+    bool isRunning() const;
+
+    /** Freeze/unfreeze media time */
+    void setPaused(bool paused, int64_t now_us);
+
+    /** Media time at now_us */
+    Pts getTime(int64_t now_us) const;
+
+    /**
+     * Feed the audio render position (audio_pts was leaving the output at
+     * sampled_at_us). Ignored in SYSTEM mode or while stopped/paused.
+     */
+    void updateAudioPosition(Pts audio_pts, int64_t sampled_at_us);
+
+    /** Speed multiplier for trick play, e.g. 16 or -8; rebased at now_us */
+    void setSpeed(int32_t speed, int64_t now_us);
+    int32_t getSpeed() const;
+
+    /** Delay between the HAL render position and the listener, microseconds */
+    void setOutputLatency(int64_t latency_us);
+    int64_t getOutputLatency() const;
+
+    ClockStats getStats() const;
+
+private:
+    Pts timeLocked(int64_t now_us) const;
+    void rebaseLocked(int64_t now_us);
+
+    mutable std::mutex mutex_;
+    ClockMode mode_{ClockMode::SYSTEM};
+    bool running_{false};
+    bool paused_{false};
+    bool locked_{false};   /* Audio position seen since start() */
+    Pts anchor_pts_{0};
+    int64_t anchor_us_{0};
+    int32_t rate_ppm_{0};
+    int32_t speed_{1};
+    int64_t output_latency_us_{0};
+    ClockStats stats_;
+};
+
+} // namespace streaming::media
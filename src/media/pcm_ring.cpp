@@ -0,0 +1,111 @@
+/**
+ * @file pcm_ring.cpp
+ * @brief PcmRing implementation
+ */
+
+#include "pcm_ring.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace streaming::media {
+
+PcmRing::PcmRing(uint32_t period_frames, uint32_t period_count,
+                 uint32_t channels, uint32_t sample_rate)
+    : period_frames_(std::max<uint32_t>(period_frames, 1))
+    , period_count_(std::max<uint32_t>(period_count, 2))
+    , channels_(std::max<uint32_t>(channels, 1))
+    , sample_rate_(sample_rate)
+    , storage_(static_cast<size_t>(period_frames_) * channels_ * period_count_)
+    , slots_(new Slot[period_count_]) {
+    for (uint32_t i = 0; i < period_count_; ++i) {
+        slots_[i].period.samples = slotSamples(i);
+        slots_[i].period.channels = channels_;
+        slots_[i].period.sample_rate = sample_rate_;
+    }
+}
+
+int16_t* PcmRing::slotSamples(size_t index) {
+    return storage_.data() + index * period_frames_ * channels_;
+}
+
+size_t PcmRing::write(const int16_t* samples, size_t frames, Pts pts_us) {
+    size_t done = 0;
+    while (done < frames) {
+        const uint64_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_cache_ == period_count_) {
+            head_cache_ = head_.load(std::memory_order_acquire);
+            if (tail - head_cache_ == period_count_) break;
+        }
+        const size_t index = tail % period_count_;
+        PcmPeriod& period = slots_[index].period;
+        if (fill_frames_ == 0 && sample_rate_ > 0)
+            period.pts_us = pts_us + static_cast<int64_t>(done) * 1000000 / sample_rate_;
+
+        const size_t n = std::min<size_t>(period_frames_ - fill_frames_, frames - done);
+        std::memcpy(slotSamples(index) + static_cast<size_t>(fill_frames_) * channels_,
+                    samples + done * channels_, n * channels_ * sizeof(int16_t));
+        fill_frames_ += static_cast<uint32_t>(n);
+        done += n;
+        if (fill_frames_ == period_frames_) commitPartial();
+    }
+    return done;
+}
+
+bool PcmRing::commitPartial() {
+    if (fill_frames_ == 0) return false;
+    const uint64_t tail = tail_.load(std::memory_order_relaxed);
+    slots_[tail % period_count_].period.frames = fill_frames_;
+    fill_frames_ = 0;
+    tail_.store(tail + 1, std::memory_order_release);
+
+    const size_t depth = static_cast<size_t>(tail + 1 - head_.load(std::memory_order_relaxed));
+    size_t prev = high_water_.load(std::memory_order_relaxed);
+    while (depth > prev && !high_water_.compare_exchange_weak(prev, depth, std::memory_order_relaxed)) {}
+    return true;
+}
+
+const PcmPeriod* PcmRing::front() {
+    const uint64_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_cache_) {
+        tail_cache_ = tail_.load(std::memory_order_acquire);
+        if (head == tail_cache_) return nullptr;
+    }
+    return &slots_[head % period_count_].period;
+}
+
+void PcmRing::pop() {
+    const uint64_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_cache_) return;
+    head_.store(head + 1, std::memory_order_release);
+}
+
+void PcmRing::recordUnderrun() { underruns_.fetch_add(1, std::memory_order_relaxed); }
+
+void PcmRing::reset() {
+    const uint64_t tail = tail_.load(std::memory_order_acquire);
+    head_.store(tail, std::memory_order_release);
+    head_cache_ = tail;
+    tail_cache_ = tail;
+    fill_frames_ = 0;
+}
+
+size_t PcmRing::getFillPeriods() const {
+    return static_cast<size_t>(tail_.load(std::memory_order_acquire) -
+                               head_.load(std::memory_order_acquire));
+}
+
+int64_t PcmRing::getFillUs() const {
+    if (sample_rate_ == 0) return 0;
+    return static_cast<int64_t>(getFillPeriods()) * period_frames_ * 1000000 / sample_rate_;
+}
+
+PcmRingStats PcmRing::getStats() const {
+    PcmRingStats stats;
+    stats.periods_read = head_.load(std::memory_order_acquire);
+    stats.periods_written = tail_.load(std::memory_order_acquire);
+    stats.underruns = underruns_.load(std::memory_order_relaxed);
+    stats.high_water = high_water_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+} // namespace streaming::media
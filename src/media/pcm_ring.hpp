@@ -0,0 +1,116 @@
+/**
+ * @file pcm_ring.hpp
+ * @brief Lock-free SPSC ring of PCM periods between audio decode and the sink
+ * @copyright 2025 Streaming Device Project
+ *
+ * The decode thread copies PCM into fixed-size periods; the sink thread
+ * hands whole periods to IAudioHal::play. All storage is allocated up
+ * front, so neither side allocates, locks or waits on the other while
+ * streaming. A stalled producer (UI or EventBus work on a shared core)
+ * only drains the ring; the sink keeps playing until it is empty.
+ */
+
+#pragma once
+
+#include <streaming_device/media_types.hpp>
+#include "common/spsc_queue.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace streaming::media {
+
+/** One committed period as seen by the consumer */
+struct PcmPeriod {
+    const int16_t* samples{nullptr};   /* frames * channels, interleaved */
+    uint32_t frames{0};
+    uint32_t channels{0};
+    uint32_t sample_rate{0};
+    Pts pts_us{0};                     /* Media time of the first frame */
+};
+
+/** Ring counters */
+struct PcmRingStats {
+    uint64_t periods_written{0};
+    uint64_t periods_read{0};
+    uint64_t underruns{0};        /* Consumer found the ring empty while it needed data */
+    size_t high_water{0};         /* Most periods ever queued */
+};
+
+/**
+ * @brief SPSC PCM period ring
+ *
+ * Exactly one producer thread (write/commitPartial) and one consumer
+ * thread (front/pop/recordUnderrun). reset() requires both to be idle.
+ */
+class PcmRing {
+public:
+    PcmRing(uint32_t period_frames, uint32_t period_count,
+            uint32_t channels, uint32_t sample_rate);
+
+    PcmRing(const PcmRing&) = delete;
+    PcmRing& operator=(const PcmRing&) = delete;
+
+    /**
+     * Producer: copy up to frames frames starting at media time pts_us.
+     * Full periods are committed as they fill. Returns the frames taken;
+     * fewer than requested means the ring is full (back-pressure).
+     */
+    size_t write(const int16_t* samples, size_t frames, Pts pts_us);
+
+    /** Producer: commit a partially filled period (end of stream) */
+    bool commitPartial();
+
+    /** Consumer: oldest committed period, nullptr when empty */
+    const PcmPeriod* front();
+
+    /** Consumer: release the period returned by front() */
+    void pop();
+
+    /** Consumer: count an underrun (ring empty while playing) */
+    void recordUnderrun();
+
+    /** Drop everything, committed or not (both sides quiescent) */
+    void reset();
+
+    uint32_t getPeriodFrames() const { return period_frames_; }
+    uint32_t getPeriodCount() const { return period_count_; }
+    uint32_t getChannels() const { return channels_; }
+    uint32_t getSampleRate() const { return sample_rate_; }
+
+    /** Committed periods waiting for the consumer */
+    size_t getFillPeriods() const;
+
+    /** Committed audio waiting for the consumer, microseconds */
+    int64_t getFillUs() const;
+
+    PcmRingStats getStats() const;
+
+private:
+    /** Period header padded to a cache line so adjacent slots never share one */
+    struct alignas(common::kCacheLineSize) Slot {
+        PcmPeriod period;
+    };
+
+    int16_t* slotSamples(size_t index);
+
+    const uint32_t period_frames_;
+    const uint32_t period_count_;
+    const uint32_t channels_;
+    const uint32_t sample_rate_;
+    std::vector<int16_t> storage_;
+    std::unique_ptr<Slot[]> slots_;
+
+    alignas(common::kCacheLineSize) std::atomic<uint64_t> head_{0};   /* Consumer */
+    uint64_t tail_cache_{0};
+    std::atomic<uint64_t> underruns_{0};
+
+    alignas(common::kCacheLineSize) std::atomic<uint64_t> tail_{0};   /* Producer */
+    uint64_t head_cache_{0};
+    uint32_t fill_frames_{0};         /* Frames in the uncommitted period */
+    std::atomic<size_t> high_water_{0};
+};
+
+} // namespace streaming::media
@@ -0,0 +1,110 @@
+/**
+ * @file presentation_scheduler.cpp
+ * @brief PresentationScheduler implementation
+ */
+
+#include "presentation_scheduler.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace streaming::media {
+
+PresentationScheduler::PresentationScheduler(size_t max_queued_frames)
+    : max_queued_(max_queued_frames ? max_queued_frames : 1) {}
+
+void PresentationScheduler::configure(uint32_t frame_rate_num, uint32_t frame_rate_den,
+                                      uint32_t refresh_hz) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    rate_num_ = frame_rate_num;
+    rate_den_ = frame_rate_den ? frame_rate_den : 1;
+    refresh_hz_ = refresh_hz ? refresh_hz : 60;
+}
+
+bool PresentationScheduler::queueFrame(const DecodedFrame& frame) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (queue_.size() >= max_queued_) return false;
+    /* Decoders emit presentation order; keep the queue sorted regardless */
+    auto it = std::upper_bound(queue_.begin(), queue_.end(), frame.timing.pts,
+        [](Pts pts, const DecodedFrame& f) { return pts < f.timing.pts; });
+    queue_.insert(it, frame);
+    return true;
+}
+
+void PresentationScheduler::finishHeldFrame() {
+    if (!showing_ || hold_vblanks_ == 0 || rate_num_ == 0) return;
+
+    /* Ideal hold is refresh / frame_rate vblanks, e.g. 2.5 for 24p on 60 Hz */
+    const double ideal = static_cast<double>(refresh_hz_) * rate_den_ / rate_num_;
+    const double period_us = 1e6 / refresh_hz_;
+    const double deviation_us = (hold_vblanks_ - ideal) * period_us;
+    judder_sq_sum_ += deviation_us * deviation_us;
+    ++judder_samples_;
+    stats_.judder_us = static_cast<int64_t>(std::sqrt(judder_sq_sum_ / judder_samples_));
+
+    const auto lo = static_cast<uint32_t>(std::floor(ideal + 1e-9));
+    const auto hi = static_cast<uint32_t>(std::ceil(ideal - 1e-9));
+    if (hold_vblanks_ < std::max(lo, 1u) || hold_vblanks_ > hi) ++stats_.cadence_breaks;
+}
+
+VsyncDecision PresentationScheduler::onVblank(Pts media_time_us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    VsyncDecision decision;
+    ++stats_.vblanks;
+
+    const Pts deadline = media_time_us + static_cast<Pts>(1000000 / refresh_hz_ / 4);
+    size_t due = 0;
+    while (due < queue_.size() && queue_[due].timing.pts <= deadline) ++due;
+
+    if (due > 0) {
+        /* Everything due before the newest due frame missed its slot */
+        for (size_t i = 0; i + 1 < due; ++i) decision.dropped.push_back(queue_[i]);
+        stats_.frames_dropped += due - 1;
+        decision.frame = queue_[due - 1];
+        queue_.erase(queue_.begin(), queue_.begin() + static_cast<std::ptrdiff_t>(due));
+
+        finishHeldFrame();
+        showing_ = true;
+        hold_vblanks_ = 1;
+        decision.action = VsyncAction::PRESENT;
+        ++stats_.frames_presented;
+    } else if (showing_) {
+        ++hold_vblanks_;
+        decision.action = VsyncAction::REPEAT;
+        ++stats_.frames_repeated;
+    }
+    return decision;
+}
+
+std::vector<DecodedFrame> PresentationScheduler::flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<DecodedFrame> out(queue_.begin(), queue_.end());
+    queue_.clear();
+    /* The held frame's hold is cut short by the flush; don't score it */
+    showing_ = false;
+    hold_vblanks_ = 0;
+    return out;
+}
+
+size_t PresentationScheduler::getQueuedFrames() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queue_.size();
+}
+
+int64_t PresentationScheduler::getVsyncPeriodUs() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return 1000000 / refresh_hz_;
+}
+
+CadenceStats PresentationScheduler::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void PresentationScheduler::resetStats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_ = {};
+    judder_sq_sum_ = 0;
+    judder_samples_ = 0;
+}
+
+} // namespace streaming::media
@@ -0,0 +1,100 @@
+/**
+ * @file presentation_scheduler.hpp
+ * @brief Vsync-paced presentation - maps frame PTS to vblank slots
+ * @copyright 2025 Streaming Device Project
+ *
+ * Decides at every vblank which decoded frame should be on screen.
+ * Film cadences fall out of the slot mapping: 24p on 60 Hz alternates
+ * 3 and 2 vblanks per frame (3:2 pulldown), 25p on 50 Hz holds every
+ * frame for 2 vblanks (2:2). Late frames are dropped and missing frames
+ * repeat the previous one, always by the same rule, so a given clock
+ * produces the same cadence on every run.
+ */
+
+#pragma once
+
+#include <streaming_device/media_types.hpp>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace streaming::media {
+
+/** What the display should do at a vblank */
+enum class VsyncAction : uint8_t {
+    NONE,     /* Nothing to show yet */
+    PRESENT,  /* Flip to a new frame */
+    REPEAT    /* Keep the previous frame on screen */
+};
+
+/** Scheduler decision for one vblank */
+struct VsyncDecision {
+    VsyncAction action{VsyncAction::NONE};
+    DecodedFrame frame;                  /* Valid when action == PRESENT */
+    std::vector<DecodedFrame> dropped;   /* Late frames discarded at this vblank */
+};
+
+/** Cadence and judder statistics */
+struct CadenceStats {
+    uint64_t vblanks{0};
+    uint64_t frames_presented{0};
+    uint64_t frames_repeated{0};   /* Vblanks that re-showed the previous frame */
+    uint64_t frames_dropped{0};
+    uint64_t cadence_breaks{0};    /* Frames held outside the ideal floor/ceil vblank count */
+    int64_t judder_us{0};          /* RMS deviation of on-screen time from frame duration */
+};
+
+/**
+ * @brief Presentation scheduler
+ *
+ * Thread-safe: the decode stage queues frames while the present stage
+ * calls onVblank() once per vertical blank.
+ */
+class PresentationScheduler {
+public:
+    explicit PresentationScheduler(size_t max_queued_frames = 8);
+
+    /** Set content frame rate and display refresh rate */
+    void configure(uint32_t frame_rate_num, uint32_t frame_rate_den, uint32_t refresh_hz);
+
+    /** Queue a decoded frame; returns false when the queue is full */
+    bool queueFrame(const DecodedFrame& frame);
+
+    /**
+     * Pick the frame for the vblank whose image becomes visible at
+     * media_time_us. A frame is due when its PTS is no later than the
+     * vblank time plus a quarter vsync period, which absorbs PTS rounding
+     * and clock noise without shifting the cadence.
+     */
+    VsyncDecision onVblank(Pts media_time_us);
+
+    /** Discard all queued frames (seek/stop); returns them for recycling */
+    std::vector<DecodedFrame> flush();
+
+    /** Number of frames waiting to be shown */
+    size_t getQueuedFrames() const;
+
+    /** Vsync period for the configured refresh rate */
+    int64_t getVsyncPeriodUs() const;
+
+    CadenceStats getStats() const;
+    void resetStats();
+
+private:
+    void finishHeldFrame();
+
+    mutable std::mutex mutex_;
+    std::deque<DecodedFrame> queue_;
+    size_t max_queued_;
+    uint32_t rate_num_{0};
+    uint32_t rate_den_{1};
+    uint32_t refresh_hz_{60};
+    bool showing_{false};
+    uint32_t hold_vblanks_{0};   /* Vblanks the current frame has been on screen */
+    CadenceStats stats_;
+    double judder_sq_sum_{0};
+    uint64_t judder_samples_{0};
+};
+
+} // namespace streaming::media
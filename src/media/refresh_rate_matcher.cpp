@@ -0,0 +1,159 @@
+/**
+ * @file refresh_rate_matcher.cpp
+ * @brief RefreshRateMatcher implementation
+ */
+
+#include "refresh_rate_matcher.hpp"
+#include "../common/logger.hpp"
+#include <cmath>
+
+namespace streaming::media {
+
+static bool sameMode(const hal::DisplayMode& a, const hal::DisplayMode& b) {
+    return a.width == b.width && a.height == b.height &&
+           a.refresh_rate_hz == b.refresh_rate_hz &&
+           a.format == b.format && a.interlaced == b.interlaced;
+}
+
+RefreshRateMatcher::RefreshRateMatcher(hal::IDisplayHal& display,
+                                       std::chrono::milliseconds restore_debounce)
+    : display_(display), debounce_(restore_debounce) {}
+
+RefreshRateMatcher::~RefreshRateMatcher() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        exiting_ = true;
+    }
+    cv_.notify_all();
+    if (worker_.joinable()) worker_.join();
+}
+
+bool RefreshRateMatcher::selectMode(const std::vector<hal::DisplayMode>& supported,
+                                    const hal::DisplayMode& current,
+                                    uint32_t frame_rate_num, uint32_t frame_rate_den,
+                                    hal::DisplayMode& mode_out) {
+    if (frame_rate_num == 0 || frame_rate_den == 0) return false;
+    const double content_fps = static_cast<double>(frame_rate_num) / frame_rate_den;
+
+    bool found = false;
+    for (const auto& m : supported) {
+        if (m.width != current.width || m.height != current.height || m.interlaced) continue;
+        const double multiple = m.refresh_rate_hz / content_fps;
+        const double nearest = std::round(multiple);
+        if (nearest < 1.0 || std::fabs(multiple - nearest) > nearest * 0.001) continue;
+        if (!found || m.refresh_rate_hz < mode_out.refresh_rate_hz) {
+            mode_out = m;
+            found = true;
+        }
+    }
+    return found;
+}
+
+device::Result RefreshRateMatcher::setMode(const hal::DisplayMode& mode) {
+    auto r = display_.setDisplayMode(mode);
+    if (r == device::Result::OK) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ++switch_count_;
+        }
+        LOG_INFO("RefreshRate", "Display mode ", mode.width, "x", mode.height, "@", mode.refresh_rate_hz);
+    }
+    return r;
+}
+
+device::Result RefreshRateMatcher::applyMode(const hal::DisplayMode& mode, uint64_t decision) {
+    std::lock_guard<std::mutex> apply(apply_mutex_);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (decision != decision_) return device::Result::OK;   /* A later decision replaced it */
+    }
+    return setMode(mode);
+}
+
+device::Result RefreshRateMatcher::matchContent(const VideoTrackInfo& track) {
+    /* The mode read here stays current until the switch: no other one runs meanwhile */
+    std::lock_guard<std::mutex> apply(apply_mutex_);
+    const hal::DisplayMode current = display_.getDisplayMode();
+    hal::DisplayMode ui_mode;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        restore_pending_ = false;
+        ++decision_;
+        if (!have_ui_mode_) {
+            ui_mode_ = current;
+            have_ui_mode_ = true;
+        }
+        ui_mode = ui_mode_;
+    }
+
+    hal::DisplayMode target;
+    if (!selectMode(display_.getSupportedModes(), ui_mode,
+                    track.frame_rate_num, track.frame_rate_den, target)) {
+        /* No matching rate: play in the UI mode and let the scheduler do pulldown */
+        target = ui_mode;
+    }
+    if (sameMode(target, current)) return device::Result::OK;
+    return setMode(target);
+}
+
+void RefreshRateMatcher::restoreUiMode() {
+    const hal::DisplayMode current = display_.getDisplayMode();
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!have_ui_mode_) return;
+    if (sameMode(current, ui_mode_)) {
+        have_ui_mode_ = false;
+        return;
+    }
+    if (debounce_.count() == 0) {
+        const hal::DisplayMode mode = ui_mode_;
+        have_ui_mode_ = false;
+        const uint64_t decision = ++decision_;
+        lock.unlock();
+        applyMode(mode, decision);
+        return;
+    }
+    restore_pending_ = true;
+    restore_deadline_ = std::chrono::steady_clock::now() + debounce_;
+    if (!worker_.joinable()) worker_ = std::thread(&RefreshRateMatcher::restoreWorker, this);
+    lock.unlock();
+    cv_.notify_all();
+}
+
+void RefreshRateMatcher::flushPendingRestore() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!restore_pending_) return;
+    restore_pending_ = false;
+    const hal::DisplayMode mode = ui_mode_;
+    have_ui_mode_ = false;
+    const uint64_t decision = ++decision_;
+    lock.unlock();
+    applyMode(mode, decision);
+}
+
+void RefreshRateMatcher::restoreWorker() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!exiting_) {
+        if (!restore_pending_) {
+            cv_.wait(lock, [this] { return exiting_ || restore_pending_; });
+            continue;
+        }
+        const auto deadline = restore_deadline_;
+        if (cv_.wait_until(lock, deadline, [&] {
+                return exiting_ || !restore_pending_ || restore_deadline_ != deadline; }))
+            continue;
+        restore_pending_ = false;
+        const hal::DisplayMode mode = ui_mode_;
+        have_ui_mode_ = false;
+        const uint64_t decision = ++decision_;
+        lock.unlock();
+        applyMode(mode, decision);
+        lock.lock();
+    }
+}
+
+uint32_t RefreshRateMatcher::getModeSwitchCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return switch_count_;
+}
+
+} // namespace streaming::media
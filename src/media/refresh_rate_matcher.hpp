@@ -0,0 +1,88 @@
+/**
+ * @file refresh_rate_matcher.hpp
+ * @brief Display refresh-rate matching to content frame rate
+ * @copyright 2025 Streaming Device Project
+ *
+ * Switches the HDMI output to a refresh rate that is an integer multiple
+ * of the content frame rate before the first frame, and restores the UI
+ * mode after playback. The restore is debounced so back-to-back titles
+ * with the same frame rate do not trigger two HDMI resyncs.
+ */
+
+#pragma once
+
+#include <streaming_device/types.hpp>
+#include <streaming_device/media_types.hpp>
+#include "hal/display_hal.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace streaming::media {
+
+/**
+ * @brief Refresh-rate matcher
+ *
+ * Not owning: the display HAL must outlive the matcher.
+ */
+class RefreshRateMatcher {
+public:
+    RefreshRateMatcher(hal::IDisplayHal& display, std::chrono::milliseconds restore_debounce);
+    ~RefreshRateMatcher();
+
+    RefreshRateMatcher(const RefreshRateMatcher&) = delete;
+    RefreshRateMatcher& operator=(const RefreshRateMatcher&) = delete;
+
+    /**
+     * Pick the supported mode at the current resolution whose refresh rate
+     * is the smallest integer multiple of the content rate. Integer-Hz
+     * modes match NTSC rates (e.g. 24000/1001) within 0.1%.
+     * Returns false if no supported mode qualifies.
+     */
+    static bool selectMode(const std::vector<hal::DisplayMode>& supported,
+                           const hal::DisplayMode& current,
+                           uint32_t frame_rate_num, uint32_t frame_rate_den,
+                           hal::DisplayMode& mode_out);
+
+    /** Switch to the best mode for track; cancels any pending UI restore */
+    device::Result matchContent(const VideoTrackInfo& track);
+
+    /** Restore the UI mode after the debounce interval (playback ended) */
+    void restoreUiMode();
+
+    /** Apply a pending restore immediately */
+    void flushPendingRestore();
+
+    /** Number of mode changes issued to the display */
+    uint32_t getModeSwitchCount() const;
+
+private:
+    /** setDisplayMode() and count it; apply_mutex_ held, mutex_ not */
+    device::Result setMode(const hal::DisplayMode& mode);
+    /** Switch to mode unless a newer decision than decision was taken meanwhile */
+    device::Result applyMode(const hal::DisplayMode& mode, uint64_t decision);
+    void restoreWorker();
+
+    hal::IDisplayHal& display_;
+    const std::chrono::milliseconds debounce_;
+
+    /* Mode switches block for a few vblanks: they run under apply_mutex_
+     * alone, so state queries and the debounce never wait on the HAL.
+     * Lock order: apply_mutex_, then mutex_. */
+    std::mutex apply_mutex_;
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::thread worker_;
+    hal::DisplayMode ui_mode_{};
+    bool have_ui_mode_{false};
+    bool restore_pending_{false};
+    bool exiting_{false};
+    std::chrono::steady_clock::time_point restore_deadline_;
+    uint32_t switch_count_{0};
+    uint64_t decision_{0};   /* Bumped by every match or restore; the latest one wins */
+};
+
+} // namespace streaming::media
@@ -0,0 +1,409 @@
+/**
+ * @file rtp_ingest.cpp
+ * @brief RtpLiveParser implementation
+ */
+
+#include "rtp_ingest.hpp"
+#include "../common/logger.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace streaming::media {
+
+namespace {
+
+constexpr uint32_t kVideoClockRate = 90000;
+constexpr uint32_t kAacFrameSamples = 1024;
+constexpr uint8_t kHevcAggregation = 48;     /* RFC 7798 AP */
+constexpr uint8_t kHevcFragment = 49;        /* RFC 7798 FU */
+constexpr int kPollIntervalMs = 20;
+constexpr int kReceiveBufferBytes = 1 << 20;  /* A keyframe arrives as one burst */
+const uint8_t kStartCode[] = {0, 0, 0, 1};
+
+int64_t steadyUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int64_t wallUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+bool isIrap(uint8_t nal_type) { return nal_type >= 16 && nal_type <= 23; }
+
+bool parseUint(const std::string& text, uint32_t max, uint32_t& out) {
+    if (text.empty() || text.find_first_not_of("0123456789") != std::string::npos) return false;
+    const unsigned long v = std::strtoul(text.c_str(), nullptr, 10);
+    if (v > max) return false;
+    out = static_cast<uint32_t>(v);
+    return true;
+}
+
+} // namespace
+
+// -----------------------------------------------------------------------------
+// RtpIngestConfig
+// -----------------------------------------------------------------------------
+
+device::Result RtpIngestConfig::fromUri(const std::string& uri, RtpIngestConfig& out) {
+    static const std::string kScheme = "rtp://";
+    if (uri.compare(0, kScheme.size(), kScheme) != 0) return device::Result::ERROR_INVALID_PARAM;
+    const size_t query = uri.find('?', kScheme.size());
+    const std::string authority = uri.substr(kScheme.size(), query == std::string::npos
+                                                                 ? std::string::npos : query - kScheme.size());
+    const size_t colon = authority.rfind(':');
+    uint32_t port = 0;
+    if (colon == std::string::npos || !parseUint(authority.substr(colon + 1), 65535, port))
+        return device::Result::ERROR_INVALID_PARAM;
+    RtpIngestConfig cfg;
+    cfg.bind_address = colon == 0 ? "0.0.0.0" : authority.substr(0, colon);
+    cfg.port = static_cast<uint16_t>(port);
+    in_addr addr{};
+    if (inet_pton(AF_INET, cfg.bind_address.c_str(), &addr) != 1) return device::Result::ERROR_INVALID_PARAM;
+
+    size_t pos = query == std::string::npos ? uri.size() : query + 1;
+    while (pos < uri.size()) {
+        size_t end = uri.find('&', pos);
+        if (end == std::string::npos) end = uri.size();
+        const std::string item = uri.substr(pos, end - pos);
+        pos = end + 1;
+        const size_t eq = item.find('=');
+        const std::string key = item.substr(0, eq);
+        const std::string value = eq == std::string::npos ? "" : item.substr(eq + 1);
+        uint32_t n = 0;
+        bool ok = true;
+        if (key == "codec") {
+            if (value != "hevc" && value != "h265") return device::Result::ERROR_NOT_SUPPORTED;
+        } else if (key == "audio") {
+            if (value == "aac") cfg.audio_codec = AudioCodec::AAC;
+            else if (value != "none") return device::Result::ERROR_NOT_SUPPORTED;
+        } else if (key == "width") {
+            ok = parseUint(value, 8192, cfg.width);
+        } else if (key == "height") {
+            ok = parseUint(value, 8192, cfg.height);
+        } else if (key == "fps") {
+            ok = parseUint(value, 240, cfg.frame_rate_num) && cfg.frame_rate_num > 0;
+            cfg.frame_rate_den = 1;
+        } else if (key == "vpt" || key == "apt") {
+            ok = parseUint(value, 127, n);
+            (key == "vpt" ? cfg.video_payload_type : cfg.audio_payload_type) = static_cast<uint8_t>(n);
+        } else if (key == "rate") {
+            ok = parseUint(value, 192000, cfg.sample_rate) && cfg.sample_rate > 0;
+        } else if (key == "channels") {
+            ok = parseUint(value, 8, cfg.channels) && cfg.channels > 0;
+        } else if (key == "capture_ext") {
+            ok = parseUint(value, 14, n);
+            cfg.capture_ext_id = static_cast<uint8_t>(n);
+        } else if (key == "delay_ms") {
+            ok = parseUint(value, 2000, n);
+            cfg.jitter.initial_delay_us = static_cast<int64_t>(n) * 1000;
+        }   /* Unknown keys are ignored, as in SDP */
+        if (!ok) return device::Result::ERROR_INVALID_PARAM;
+    }
+    out = cfg;
+    return device::Result::OK;
+}
+
+// -----------------------------------------------------------------------------
+// RtpLiveParser
+// -----------------------------------------------------------------------------
+
+RtpLiveParser::~RtpLiveParser() { closeContainer(); }
+
+bool RtpLiveParser::isLiveUri(const std::string& uri) { return uri.compare(0, 6, "rtp://") == 0; }
+
+device::Result RtpLiveParser::openContainer(const std::string& path_or_uri) {
+    closeContainer();
+    const device::Result parsed = RtpIngestConfig::fromUri(path_or_uri, config_);
+    if (parsed != device::Result::OK) return parsed;
+
+    fd_ = ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd_ < 0) return device::Result::ERROR_NETWORK;
+    const int one = 1;
+    setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    setsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &kReceiveBufferBytes, sizeof(kReceiveBufferBytes));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(config_.port);
+    inet_pton(AF_INET, config_.bind_address.c_str(), &addr.sin_addr);
+    socklen_t len = sizeof(addr);
+    if (::bind(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        getsockname(fd_, reinterpret_cast<sockaddr*>(&addr), &len) != 0) {
+        LOG_WARN("RtpIngest", "Cannot bind", config_.bind_address, config_.port, errno);
+        ::close(fd_);
+        fd_ = -1;
+        return device::Result::ERROR_NETWORK;
+    }
+    local_port_ = ntohs(addr.sin_port);
+
+    JitterBufferConfig jc = config_.jitter;
+    jc.clock_rate = kVideoClockRate;
+    video_jitter_ = std::make_unique<JitterBuffer>(jc);
+    jc.clock_rate = config_.sample_rate;
+    audio_jitter_ = std::make_unique<JitterBuffer>(jc);
+
+    tracks_.clear();
+    media::TrackMetadata video;
+    video.type = media::TrackType::VIDEO;
+    video.track_id = kVideoTrackId;
+    video.video.codec = config_.video_codec;
+    video.video.width = config_.width;
+    video.video.height = config_.height;
+    video.video.frame_rate_num = config_.frame_rate_num;
+    video.video.frame_rate_den = config_.frame_rate_den;
+    tracks_.push_back(video);
+    if (config_.audio_codec != AudioCodec::UNKNOWN) {
+        media::TrackMetadata audio;
+        audio.type = media::TrackType::AUDIO;
+        audio.track_id = kAudioTrackId;
+        audio.audio.codec = config_.audio_codec;
+        audio.audio.sample_rate = config_.sample_rate;
+        audio.audio.channels = config_.channels;
+        tracks_.push_back(audio);
+    }
+
+    ready_.clear();
+    au_.clear();
+    au_active_ = au_damaged_ = fragment_open_ = false;
+    waiting_keyframe_ = true;
+    audio_aligned_ = false;
+    first_video_pts_us_ = -1;
+    video_origin_us_ = -1;
+    datagrams_ = invalid_ = frames_ = frames_dropped_ = 0;
+    receiving_ = true;
+    receiver_ = std::thread(&RtpLiveParser::receiveLoop, this);
+    LOG_INFO("RtpIngest", "Receiving on", config_.bind_address, local_port_);
+    return device::Result::OK;
+}
+
+void RtpLiveParser::receiveLoop() {
+    std::vector<uint8_t> buf(65536);
+    pollfd pfd{fd_, POLLIN, 0};
+    while (receiving_) {
+        if (::poll(&pfd, 1, kPollIntervalMs) <= 0) continue;
+        while (true) {
+            const ssize_t n = ::recv(fd_, buf.data(), buf.size(), MSG_DONTWAIT);
+            if (n <= 0) break;
+            datagrams_++;
+            const int64_t arrival = steadyUs();
+            RtpPacket packet;
+            if (!RtpPacket::parse(buf.data(), static_cast<size_t>(n), packet, config_.capture_ext_id)) {
+                invalid_++;
+                continue;
+            }
+            /* Without abs-capture-time, arrival stands in for capture */
+            if (packet.capture_time_us < 0) packet.capture_time_us = wallUs();
+            if (packet.payload_type == config_.video_payload_type)
+                video_jitter_->push(std::move(packet), arrival);
+            else if (config_.audio_codec != AudioCodec::UNKNOWN && packet.payload_type == config_.audio_payload_type)
+                audio_jitter_->push(std::move(packet), arrival);
+            else
+                invalid_++;
+        }
+    }
+}
+
+device::Result RtpLiveParser::readPacket(media::EncodedPacket& packet_out) {
+    if (fd_ < 0) return device::Result::ERROR_TIMEOUT;
+    if (ready_.empty()) {
+        const int64_t now = steadyUs();
+        drainVideo(now);
+        drainAudio(now);
+        if (ready_.empty()) return device::Result::ERROR_TIMEOUT;
+    }
+    packet_out = std::move(ready_.front());
+    ready_.pop_front();
+    return device::Result::OK;
+}
+
+void RtpLiveParser::drainVideo(int64_t now_us) {
+    RtpPacket packet;
+    int64_t media_us = 0;
+    uint64_t gap = 0;
+    while (video_jitter_->pop(now_us, packet, media_us, gap)) {
+        if (video_origin_us_ < 0) video_origin_us_ = packet.capture_time_us - media_us;
+        if (gap > 0) {
+            /* Reference frames are gone: drop what is open and wait for a keyframe */
+            if (au_active_) au_damaged_ = true;
+            waiting_keyframe_ = true;
+        }
+        if (au_active_ && media_us != au_pts_us_) finishAccessUnit();   /* Marker was lost */
+        if (!au_active_) {
+            au_active_ = true;
+            au_pts_us_ = media_us;
+            au_keyframe_ = false;
+            fragment_open_ = false;
+            au_.clear();
+        }
+        appendVideoPayload(packet.payload);
+        if (packet.marker) finishAccessUnit();
+    }
+}
+
+void RtpLiveParser::appendVideoPayload(const std::vector<uint8_t>& p) {
+    if (p.size() < 3) {
+        au_damaged_ = true;
+        return;
+    }
+    const uint8_t type = (p[0] >> 1) & 0x3F;
+    auto appendNal = [this](const uint8_t* nal, size_t size) {
+        au_.insert(au_.end(), std::begin(kStartCode), std::end(kStartCode));
+        au_.insert(au_.end(), nal, nal + size);
+        if (size > 0 && isIrap((nal[0] >> 1) & 0x3F)) au_keyframe_ = true;
+    };
+    if (type == kHevcAggregation) {
+        for (size_t i = 2; i + 2 <= p.size();) {
+            const size_t size = (static_cast<size_t>(p[i]) << 8) | p[i + 1];
+            i += 2;
+            if (size == 0 || i + size > p.size()) {
+                au_damaged_ = true;
+                return;
+            }
+            appendNal(p.data() + i, size);
+            i += size;
+        }
+    } else if (type == kHevcFragment) {
+        const bool first = (p[2] & 0x80) != 0;
+        const bool last = (p[2] & 0x40) != 0;
+        const uint8_t nal_type = p[2] & 0x3F;
+        if (first) {
+            /* Rebuild the NAL header from the payload header and the FU type */
+            const uint8_t header[2] = {static_cast<uint8_t>((p[0] & 0x81) | (nal_type << 1)), p[1]};
+            appendNal(header, 2);
+            fragment_open_ = true;
+        } else if (!fragment_open_) {
+            au_damaged_ = true;   /* Start fragment lost */
+            return;
+        }
+        au_.insert(au_.end(), p.begin() + 3, p.end());
+        if (last) fragment_open_ = false;
+    } else {
+        appendNal(p.data(), p.size());
+    }
+}
+
+void RtpLiveParser::finishAccessUnit() {
+    au_active_ = false;
+    if (au_damaged_ || fragment_open_ || (waiting_keyframe_ && !au_keyframe_)) {
+        au_damaged_ = false;
+        frames_dropped_++;
+        return;
+    }
+    waiting_keyframe_ = false;
+    if (first_video_pts_us_ < 0) first_video_pts_us_ = au_pts_us_;
+    media::EncodedPacket packet;
+    packet.track_id = kVideoTrackId;
+    packet.is_keyframe = au_keyframe_;
+    packet.timing.pts = au_pts_us_;
+    packet.timing.dts = au_pts_us_;   /* Low-latency encoders send no B-frames */
+    packet.timing.duration_us = 1000000LL * config_.frame_rate_den / config_.frame_rate_num;
+    packet.data = std::move(au_);
+    au_.clear();
+    ready_.push_back(std::move(packet));
+    frames_++;
+}
+
+void RtpLiveParser::drainAudio(int64_t now_us) {
+    if (config_.audio_codec == AudioCodec::UNKNOWN) return;
+    RtpPacket packet;
+    int64_t media_us = 0;
+    uint64_t gap = 0;
+    while (audio_jitter_->pop(now_us, packet, media_us, gap)) {
+        /* Audio goes on the video timeline through capture times; nothing before the first frame */
+        const int64_t video_origin = video_origin_us_;
+        if (video_origin < 0 || first_video_pts_us_ < 0) continue;
+        if (!audio_aligned_) {
+            audio_offset_us_ = packet.capture_time_us - media_us - video_origin;
+            audio_aligned_ = true;
+        }
+        /* RFC 3640 AAC-hbr: 16-bit AU-headers-length in bits, 13-bit size + 3-bit index each */
+        const std::vector<uint8_t>& p = packet.payload;
+        if (p.size() < 2) continue;
+        const size_t headers = ((static_cast<size_t>(p[0]) << 8) | p[1]) / 16;
+        size_t data = 2 + headers * 2;
+        if (data > p.size()) continue;
+        for (size_t h = 0; h < headers; ++h) {
+            const size_t size = ((static_cast<size_t>(p[2 + 2 * h]) << 8) | p[3 + 2 * h]) >> 3;
+            if (data + size > p.size()) break;
+            const int64_t frame_us = 1000000LL * kAacFrameSamples / config_.sample_rate;
+            media::EncodedPacket au;
+            au.track_id = kAudioTrackId;
+            au.is_keyframe = true;
+            au.timing.pts = media_us + audio_offset_us_ + static_cast<int64_t>(h) * frame_us;
+            au.timing.dts = au.timing.pts;
+            au.timing.duration_us = frame_us;
+            au.data.assign(p.begin() + data, p.begin() + data + size);
+            if (au.timing.pts >= first_video_pts_us_) ready_.push_back(std::move(au));
+            data += size;
+        }
+    }
+}
+
+device::Result RtpLiveParser::seek(int64_t) { return device::Result::ERROR_NOT_SUPPORTED; }
+device::Result RtpLiveParser::seekToByte(uint64_t) { return device::Result::ERROR_NOT_SUPPORTED; }
+
+device::Result RtpLiveParser::readKeyframe(int64_t, bool, media::EncodedPacket&) {
+    return device::Result::ERROR_NOT_SUPPORTED;
+}
+
+device::Result RtpLiveParser::appendSegment(const hal::ContainerSegment&) {
+    return device::Result::ERROR_NOT_SUPPORTED;
+}
+
+std::vector<media::TrackMetadata> RtpLiveParser::getTracks() const { return tracks_; }
+
+std::vector<media::TrackMetadata> RtpLiveParser::getVideoTracks() const {
+    std::vector<media::TrackMetadata> out;
+    for (const auto& t : tracks_)
+        if (t.type == media::TrackType::VIDEO) out.push_back(t);
+    return out;
+}
+
+std::vector<media::TrackMetadata> RtpLiveParser::getAudioTracks() const {
+    std::vector<media::TrackMetadata> out;
+    for (const auto& t : tracks_)
+        if (t.type == media::TrackType::AUDIO) out.push_back(t);
+    return out;
+}
+
+std::vector<media::TrackMetadata> RtpLiveParser::getSubtitleTracks() const { return {}; }
+
+int64_t RtpLiveParser::getDurationUs() const { return 0; }
+
+device::Result RtpLiveParser::closeContainer() {
+    receiving_ = false;
+    if (receiver_.joinable()) receiver_.join();
+    if (fd_ >= 0) ::close(fd_);
+    fd_ = -1;
+    return device::Result::OK;
+}
+
+bool RtpLiveParser::supports(media::ContainerFormat format) const { return format == media::ContainerFormat::RTP; }
+
+int64_t RtpLiveParser::getCaptureTimeUs(int64_t pts_us) const {
+    const int64_t origin = video_origin_us_;
+    return origin < 0 ? -1 : origin + pts_us;
+}
+
+LiveIngestStats RtpLiveParser::getStats() const {
+    LiveIngestStats stats;
+    stats.live = true;
+    stats.local_port = local_port_;
+    stats.datagrams = datagrams_;
+    stats.invalid = invalid_;
+    stats.frames = frames_;
+    stats.frames_dropped = frames_dropped_;
+    if (video_jitter_) stats.video_jitter = video_jitter_->getStats();
+    if (audio_jitter_) stats.audio_jitter = audio_jitter_->getStats();
+    return stats;
+}
+
+} // namespace streaming::media
@@ -0,0 +1,151 @@
+/**
+ * @file rtp_ingest.hpp
+ * @brief Low-latency live ingest: RTP over UDP into the demux stage
+ * @copyright 2025 Streaming Device Project
+ *
+ * RtpLiveParser is a container parser for rtp:// sources. A receive
+ * thread reads datagrams from a local UDP socket into one JitterBuffer
+ * per stream; readPacket() takes what is due, reassembles access units
+ * (HEVC RFC 7798 single NAL, aggregation and fragmentation units;
+ * AAC RFC 3640 AAC-hbr) and hands them to the
+ * pipeline as EncodedPackets, with no container in between.
+ *
+ * There is no SDP exchange: the session is described by the URI,
+ *   rtp://<bind address>:<port>?codec=hevc&width=&height=&fps=
+ *       &vpt=96&audio=aac&apt=97&rate=48000&channels=2&capture_ext=1
+ * with defaults for everything but the port. Senders that attach the
+ * abs-capture-time header extension give capture times for the
+ * glass-to-glass measurement; without it arrival time stands in.
+ */
+
+#pragma once
+
+#include <streaming_device/types.hpp>
+#include <streaming_device/media_types.hpp>
+#include "hal/container_hal.hpp"
+#include "jitter_buffer.hpp"
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace streaming::media {
+
+/** Session description for an rtp:// source */
+struct RtpIngestConfig {
+    std::string bind_address{"0.0.0.0"};
+    uint16_t port{0};
+    VideoCodec video_codec{VideoCodec::H265_HEVC};   /* The one codec with an RTP depacketizer here */
+    uint8_t video_payload_type{96};
+    uint32_t width{1920};
+    uint32_t height{1080};
+    uint32_t frame_rate_num{50};
+    uint32_t frame_rate_den{1};
+    AudioCodec audio_codec{AudioCodec::UNKNOWN};   /* UNKNOWN: video only; AAC supported */
+    uint8_t audio_payload_type{97};
+    uint32_t sample_rate{48000};
+    uint32_t channels{2};
+    uint8_t capture_ext_id{1};                     /* abs-capture-time extension id, 0: ignore */
+    JitterBufferConfig jitter;                     /* clock_rate is set per stream */
+
+    /** ERROR_INVALID_PARAM for a malformed URI, ERROR_NOT_SUPPORTED for an unsupported codec */
+    static device::Result fromUri(const std::string& uri, RtpIngestConfig& out);
+};
+
+/** Live source counters */
+struct LiveIngestStats {
+    bool live{false};                  /* The open source is an RTP ingest */
+    uint16_t local_port{0};
+    uint64_t datagrams{0};
+    uint64_t invalid{0};               /* Not RTP, or an unknown payload type */
+    uint64_t frames{0};                /* Video access units handed to the demuxer */
+    uint64_t frames_dropped{0};        /* Damaged by loss; dropped up to the next keyframe */
+    JitterBufferStats video_jitter;
+    JitterBufferStats audio_jitter;
+    int64_t glass_to_glass_us{-1};     /* Capture to on screen, latest sample (pipeline) */
+    int64_t glass_to_glass_avg_us{-1};
+    int64_t glass_to_glass_max_us{-1};
+};
+
+/**
+ * @brief Container parser for RTP/UDP live sources
+ *
+ * Not seekable; getDurationUs() is 0. readPacket() returns ERROR_TIMEOUT
+ * while nothing is due, which the demux stage treats as a source with
+ * nothing yet.
+ */
+class RtpLiveParser : public hal::IContainerParser {
+public:
+    RtpLiveParser() = default;
+    ~RtpLiveParser() override;
+
+    RtpLiveParser(const RtpLiveParser&) = delete;
+    RtpLiveParser& operator=(const RtpLiveParser&) = delete;
+
+    /** Bind the socket and start receiving; ERROR_NETWORK if the port cannot be bound */
+    device::Result openContainer(const std::string& path_or_uri) override;
+    device::Result readPacket(media::EncodedPacket& packet_out) override;
+    device::Result seek(int64_t timestamp_us) override;
+    device::Result seekToByte(uint64_t offset) override;
+    device::Result readKeyframe(int64_t from_us, bool forward,
+                                media::EncodedPacket& packet_out) override;
+    device::Result appendSegment(const hal::ContainerSegment& segment) override;
+    std::vector<media::TrackMetadata> getTracks() const override;
+    std::vector<media::TrackMetadata> getVideoTracks() const override;
+    std::vector<media::TrackMetadata> getAudioTracks() const override;
+    std::vector<media::TrackMetadata> getSubtitleTracks() const override;
+    int64_t getDurationUs() const override;
+    device::Result closeContainer() override;
+    bool supports(media::ContainerFormat format) const override;
+
+    /** Unix time (us) at which the frame with this PTS was captured, -1 if not known yet */
+    int64_t getCaptureTimeUs(int64_t pts_us) const;
+
+    LiveIngestStats getStats() const;
+
+    static bool isLiveUri(const std::string& uri);
+
+    static constexpr uint32_t kVideoTrackId = 1;
+    static constexpr uint32_t kAudioTrackId = 2;
+
+private:
+    void receiveLoop();
+    void drainVideo(int64_t now_us);
+    void drainAudio(int64_t now_us);
+    void appendVideoPayload(const std::vector<uint8_t>& payload);
+    void finishAccessUnit();
+
+    RtpIngestConfig config_;
+    std::vector<media::TrackMetadata> tracks_;
+    std::unique_ptr<JitterBuffer> video_jitter_;
+    std::unique_ptr<JitterBuffer> audio_jitter_;
+    int fd_{-1};
+    uint16_t local_port_{0};
+    std::thread receiver_;
+    std::atomic<bool> receiving_{false};
+    std::atomic<uint64_t> datagrams_{0};
+    std::atomic<uint64_t> invalid_{0};
+
+    /* Demux thread only */
+    std::deque<media::EncodedPacket> ready_;
+    std::vector<uint8_t> au_;          /* Access unit being reassembled, Annex B */
+    bool au_active_{false};
+    bool au_keyframe_{false};
+    bool au_damaged_{false};
+    bool fragment_open_{false};        /* Inside a fragmented NAL unit */
+    int64_t au_pts_us_{0};
+    bool waiting_keyframe_{true};      /* Nothing decodes before the first keyframe after a loss */
+    int64_t first_video_pts_us_{-1};   /* Audio before the first decodable frame is dropped */
+    int64_t audio_offset_us_{0};       /* Audio media time to video PTS */
+    bool audio_aligned_{false};
+
+    std::atomic<int64_t> video_origin_us_{-1};   /* Capture time of video PTS 0 */
+    std::atomic<uint64_t> frames_{0};
+    std::atomic<uint64_t> frames_dropped_{0};
+};
+
+} // namespace streaming::media
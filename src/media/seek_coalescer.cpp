@@ -0,0 +1,99 @@
+/**
+ * @file seek_coalescer.cpp
+ * @brief SeekCoalescer implementation
+ */
+
+#include "seek_coalescer.hpp"
+#include <chrono>
+
+namespace streaming::media {
+
+SeekCoalescer::SeekCoalescer(Executor executor) : executor_(std::move(executor)) {}
+
+SeekCoalescer::~SeekCoalescer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        exiting_ = true;
+        queued_ = false;
+    }
+    cv_.notify_all();
+    if (worker_.joinable()) worker_.join();
+}
+
+void SeekCoalescer::request(int64_t target_us, SeekMode mode) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.requested++;
+        if (queued_) stats_.coalesced++;
+        queued_ = true;
+        queued_target_ = target_us;
+        queued_mode_ = mode;
+        if (!worker_.joinable()) worker_ = std::thread(&SeekCoalescer::worker, this);
+    }
+    cv_.notify_all();
+}
+
+bool SeekCoalescer::getPendingTarget(int64_t& target_us) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (queued_) {
+        target_us = queued_target_;
+        return true;
+    }
+    if (running_) {
+        target_us = running_target_;
+        return true;
+    }
+    return false;
+}
+
+void SeekCoalescer::cancel() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (queued_) stats_.coalesced++;
+    queued_ = false;
+    cv_.wait(lock, [this] { return !running_; });
+}
+
+void SeekCoalescer::waitIdle() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] { return !queued_ && !running_; });
+}
+
+device::Result SeekCoalescer::getLastResult() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return last_result_;
+}
+
+SeekStats SeekCoalescer::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void SeekCoalescer::worker() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        cv_.wait(lock, [this] { return exiting_ || queued_; });
+        if (exiting_) return;
+
+        const int64_t target = queued_target_;
+        const SeekMode mode = queued_mode_;
+        queued_ = false;
+        running_ = true;
+        running_target_ = target;
+        lock.unlock();
+
+        const auto t0 = std::chrono::steady_clock::now();
+        const device::Result r = executor_(target, mode);
+        const auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - t0).count();
+
+        lock.lock();
+        running_ = false;
+        last_result_ = r;
+        stats_.executed++;
+        if (r != device::Result::OK) stats_.failed++;
+        stats_.last_duration_us = us;
+        cv_.notify_all();
+    }
+}
+
+} // namespace streaming::media
@@ -0,0 +1,90 @@
+/**
+ * @file seek_coalescer.hpp
+ * @brief Seek policy and coalescing of seek bursts (remote scrubbing)
+ * @copyright 2025 Streaming Device Project
+ *
+ * Every executed seek is a full pipeline flush. Holding a remote key to
+ * scrub issues seeks faster than they complete, so requests are handed to
+ * a worker: the first runs at once, and anything arriving while it runs
+ * replaces the pending target. A burst of N requests costs at most two
+ * flushes, and the last one always lands on the latest target.
+ */
+
+#pragma once
+
+#include <streaming_device/types.hpp>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace streaming::media {
+
+/** Where a seek lands */
+enum class SeekMode : uint8_t {
+    KEYFRAME,   /* Previous keyframe: shows immediately, may land up to a GOP early */
+    EXACT       /* Decode from the keyframe, discard output before the target */
+};
+
+/** Coalescing counters */
+struct SeekStats {
+    uint64_t requested{0};
+    uint64_t executed{0};
+    uint64_t coalesced{0};          /* Requests replaced before they ran */
+    uint64_t failed{0};             /* Executed seeks whose executor returned an error */
+    uint64_t discarded_frames{0};   /* Decoded then dropped by EXACT seeks (filled by the engine) */
+    int64_t last_duration_us{0};    /* Flush + reposition time of the last executed seek */
+};
+
+/**
+ * @brief Latest-wins seek executor
+ *
+ * request() never blocks on a running seek. The executor runs on the
+ * coalescer's worker thread, one call at a time.
+ */
+class SeekCoalescer {
+public:
+    using Executor = std::function<device::Result(int64_t target_us, SeekMode mode)>;
+
+    explicit SeekCoalescer(Executor executor);
+    ~SeekCoalescer();
+
+    SeekCoalescer(const SeekCoalescer&) = delete;
+    SeekCoalescer& operator=(const SeekCoalescer&) = delete;
+
+    /** Queue a seek, replacing any queued one that has not started */
+    void request(int64_t target_us, SeekMode mode);
+
+    /** Target of the newest seek not yet completed (queued or running) */
+    bool getPendingTarget(int64_t& target_us) const;
+
+    /** Drop a queued seek and wait for a running one to finish */
+    void cancel();
+
+    /** Wait until nothing is queued or running */
+    void waitIdle();
+
+    /** Result of the most recent executed seek */
+    device::Result getLastResult() const;
+
+    SeekStats getStats() const;
+
+private:
+    void worker();
+
+    Executor executor_;
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::thread worker_;
+    bool exiting_{false};
+    bool queued_{false};
+    bool running_{false};
+    int64_t queued_target_{0};
+    SeekMode queued_mode_{SeekMode::KEYFRAME};
+    int64_t running_target_{0};
+    device::Result last_result_{device::Result::OK};
+    SeekStats stats_;
+};
+
+} // namespace streaming::media
@@ -0,0 +1,425 @@
+/**
+ * @file segment_scheduler.cpp
+ * @brief SegmentScheduler implementation
+ */
+
+#include "segment_scheduler.hpp"
+#include "media_cache.hpp"
+#include "../common/logger.hpp"
+#include <algorithm>
+#include <chrono>
+
+namespace streaming::media {
+
+namespace {
+
+constexpr size_t kLiveEdgeSegments = 3;   /* HLS: start no closer than three segments to the end */
+
+int64_t nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::string toText(const std::vector<uint8_t>& body) {
+    return std::string(body.begin(), body.end());
+}
+
+} // namespace
+
+SegmentScheduler::SegmentScheduler(SegmentLoader loader, AbrController& abr, SegmentSchedulerConfig config,
+                                   common::MemoryGovernor& governor)
+    : loader_(std::move(loader)), abr_(abr), config_(config),
+      memory_(governor.registerPool("segment read-ahead", common::MemoryClass::READ_AHEAD)) {}
+
+SegmentScheduler::~SegmentScheduler() { stop(); }
+
+void SegmentScheduler::setCache(MediaCache* cache) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cache_ = cache;
+}
+
+device::Result SegmentScheduler::start(Manifest manifest, int64_t position_us) {
+    if (!loader_) return device::Result::ERROR_INVALID_PARAM;
+    if (manifest.video.empty() && manifest.audio.empty()) return device::Result::ERROR_INVALID_PARAM;
+    stop();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    manifest_ = std::move(manifest);
+    stats_ = {};
+    ++epoch_;
+    positionLocked(position_us);
+    running_ = true;
+    next_reload_us_ = nowUs() + manifest_.reload_interval_us;
+    worker_ = std::thread(&SegmentScheduler::worker, this);
+    return device::Result::OK;
+}
+
+void SegmentScheduler::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+        ++epoch_;
+    }
+    cv_.notify_all();
+    if (worker_.joinable()) worker_.join();
+    std::lock_guard<std::mutex> lock(mutex_);
+    unpinTrackLocked(video_);
+    unpinTrackLocked(audio_);
+    video_ = {};
+    audio_ = {};
+    updateMemoryLocked();
+}
+
+void SegmentScheduler::updateMemoryLocked() {
+    uint64_t demand = 0, min = 0;
+    for (const Track* t : {&video_, &audio_}) {
+        if (!t->active) continue;
+        demand += t->segment_bytes * config_.prefetch_segments;
+        min += t->segment_bytes;
+    }
+    memory_demand_ = demand;
+    memory_.setDemand(demand, min);
+    memory_.setUsage(video_.queued_bytes + audio_.queued_bytes);
+}
+
+void SegmentScheduler::unpinTrackLocked(Track& t) {
+    if (!cache_) return;
+    for (const FetchedSegment& seg : t.queue) cache_->unpin(seg.source);
+    if (t.playing) cache_->unpin(t.playing_source);
+    t.playing = false;
+}
+
+void SegmentScheduler::seek(int64_t position_us) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++epoch_;
+        positionLocked(position_us);
+    }
+    cv_.notify_all();
+}
+
+void SegmentScheduler::setPlayoutBuffer(int64_t duration_us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    playout_us_ = std::max<int64_t>(duration_us, 0);
+}
+
+void SegmentScheduler::positionLocked(int64_t position_us) {
+    playout_us_ = 0;
+    for (StreamKind kind : {StreamKind::VIDEO, StreamKind::AUDIO}) {
+        Track& t = track(kind);
+        const size_t rendition = t.rendition;
+        unpinTrackLocked(t);
+        t = {};
+        t.rendition = rendition;
+        t.active = !renditions(kind).empty();
+        t.start_position_us = position_us;
+    }
+    updateMemoryLocked();
+}
+
+bool SegmentScheduler::popSegment(StreamKind kind, FetchedSegment& out) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Track& t = track(kind);
+        if (t.queue.empty()) return false;
+        out = std::move(t.queue.front());
+        t.queue.pop_front();
+        if (!out.init) t.queued_us -= out.duration_us;
+        t.queued_bytes -= out.data.size();
+        stats_.popped++;
+        updateMemoryLocked();
+        if (cache_) {
+            /* The popped segment is now the playing one: keep it, release the previous */
+            if (t.playing) cache_->unpin(t.playing_source);
+            t.playing = true;
+            t.playing_source = out.source;
+        }
+    }
+    cv_.notify_all();   /* A prefetch slot opened */
+    return true;
+}
+
+bool SegmentScheduler::isDrained(StreamKind kind) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const Track& t = track(kind);
+    return !t.active || (t.ended && t.queue.empty());
+}
+
+SegmentSchedulerStats SegmentScheduler::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    SegmentSchedulerStats stats = stats_;
+    stats.queued_video = video_.queue.size();
+    stats.queued_audio = audio_.queue.size();
+    stats.buffered_video_us = video_.queued_us;
+    stats.buffered_audio_us = audio_.queued_us;
+    stats.buffered_video_bytes = video_.queued_bytes;
+    stats.buffered_audio_bytes = audio_.queued_bytes;
+    stats.video_rendition = video_.rendition;
+    return stats;
+}
+
+Manifest SegmentScheduler::getManifest() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return manifest_;
+}
+
+device::Result SegmentScheduler::fetch(const SegmentRequest& request, std::vector<uint8_t>& body) {
+    device::Result r = device::Result::ERROR_GENERIC;
+    for (uint32_t attempt = 0; attempt <= config_.max_retries; ++attempt) {
+        body.clear();
+        r = loader_(request, body);
+        if (r == device::Result::OK) return r;
+        if (attempt < config_.max_retries)
+            std::this_thread::sleep_for(std::chrono::microseconds(config_.retry_backoff_us << attempt));
+    }
+    LOG_WARN("SegmentScheduler", "Giving up on", request.uri);
+    return r;
+}
+
+// -----------------------------------------------------------------------------
+// Worker
+// -----------------------------------------------------------------------------
+
+bool SegmentScheduler::nextJobLocked(Job& job) {
+    /* The kind with less media buffered goes first, so neither runs dry while the other fills */
+    const bool audio_first = audio_.active && video_.active && audio_.queued_us < video_.queued_us;
+    const StreamKind order[2] = {audio_first ? StreamKind::AUDIO : StreamKind::VIDEO,
+                                 audio_first ? StreamKind::VIDEO : StreamKind::AUDIO};
+    for (StreamKind kind : order)
+        if (trackJobLocked(kind, job)) return true;
+    return false;
+}
+
+bool SegmentScheduler::trackJobLocked(StreamKind kind, Job& job) {
+    Track& t = track(kind);
+    std::vector<ManifestRendition>& list = renditions(kind);
+    if (!t.active || t.ended || list.empty()) return false;
+    const size_t media_queued = static_cast<size_t>(std::count_if(t.queue.begin(), t.queue.end(),
+        [](const FetchedSegment& s) { return !s.init; }));
+    if (media_queued >= config_.prefetch_segments) return false;
+    /* Memory pressure shortens read-ahead, down to one segment per kind */
+    const uint64_t limit = memory_.getLimit();
+    if (media_queued > 0 && limit < memory_demand_ && video_.queued_bytes + audio_.queued_bytes >= limit)
+        return false;
+
+    if (!t.selected) {
+        /* Video follows ABR per segment; audio stays on the default rendition */
+        t.rendition = kind == StreamKind::VIDEO
+            ? std::min(abr_.selectRendition(t.queued_us + playout_us_), list.size() - 1) : 0;
+        t.selected = true;
+    }
+    const ManifestRendition& r = list[t.rendition];
+    job = {};
+    job.kind = kind;
+    job.rendition = t.rendition;
+
+    const MediaTimeline& tl = r.timeline;
+    if (tl.segments.empty() && tl.target_duration_us == 0 && !r.playlist_uri.empty()) {
+        job.load_playlist = true;   /* HLS media playlist not loaded yet */
+        job.request.uri = r.playlist_uri;
+        return true;
+    }
+    if (tl.segments.empty()) return false;   /* Live playlist still empty */
+    /* Renditions are picked as a slot frees, with one segment fewer than a full
+     * prefetch queued: the buffer the ABR can count on, pipeline playout on top */
+    if (kind == StreamKind::VIDEO) {
+        const size_t held = std::max<size_t>(config_.prefetch_segments, 2) - 1;
+        abr_.setBufferCeiling(static_cast<int64_t>(held) * tl.target_duration_us);
+    }
+
+    if (!t.positioned) {
+        size_t index;
+        if (t.start_position_us < 0 && tl.live)
+            index = tl.segments.size() > kLiveEdgeSegments ? tl.segments.size() - kLiveEdgeSegments : 0;
+        else
+            index = tl.findByTime(std::max<int64_t>(t.start_position_us, 0));
+        t.next_sequence = tl.segments[index].sequence;
+        t.positioned = true;
+    }
+
+    if (!tl.init_uri.empty() && t.init_rendition != t.rendition) {
+        job.init = true;
+        job.request = {tl.init_uri, tl.init_offset, tl.init_length};
+        return true;
+    }
+
+    size_t index = tl.findBySequence(t.next_sequence);
+    if (index == MediaTimeline::npos) {
+        if (t.next_sequence < tl.segments.front().sequence) {
+            /* Fell behind a live window: resume at its start */
+            index = 0;
+            t.next_sequence = tl.segments.front().sequence;
+        } else {
+            if (!tl.live) t.ended = true;   /* VOD: past the last segment */
+            return false;                   /* Live: wait for a reload */
+        }
+    }
+    job.segment = tl.segments[index];
+    job.request = {job.segment.uri, job.segment.byte_offset, job.segment.byte_length};
+    return true;
+}
+
+void SegmentScheduler::worker() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_) {
+        if (manifest_.live && nowUs() >= next_reload_us_) {
+            lock.unlock();
+            reloadLive();
+            lock.lock();
+            continue;
+        }
+
+        Job job;
+        if (!nextJobLocked(job)) {
+            /* Wait for a free slot, a seek, or the next live reload */
+            if (manifest_.live)
+                cv_.wait_for(lock, std::chrono::microseconds(std::max<int64_t>(next_reload_us_ - nowUs(), 1000)));
+            else
+                cv_.wait(lock);
+            continue;
+        }
+
+        const uint64_t epoch = epoch_;
+        MediaCache* cache = job.load_playlist ? nullptr : cache_;
+        lock.unlock();
+        std::vector<uint8_t> body;
+        const bool cached = cache && cache->lookup(job.request, body) == device::Result::OK;
+        const int64_t t0 = nowUs();
+        const device::Result r = cached ? device::Result::OK : fetch(job.request, body);
+        const int64_t took = nowUs() - t0;
+        if (cache && !cached && r == device::Result::OK) cache->insert(job.request, body);
+        MediaTimeline playlist;
+        bool parsed = false;
+        if (r == device::Result::OK && job.load_playlist) {
+            const std::string base = job.request.uri;
+            parsed = ManifestParser::parseHlsMedia(toText(body), base, playlist) == device::Result::OK;
+        }
+        if (r == device::Result::OK && !cached && !job.load_playlist && !job.init && job.kind == StreamKind::VIDEO)
+            abr_.onDownload(body.size(), took);
+        lock.lock();
+        if (epoch != epoch_) continue;   /* Seek or stop while downloading: stale */
+
+        Track& t = track(job.kind);
+        if (r != device::Result::OK || (job.load_playlist && !parsed)) {
+            stats_.failures++;
+            if (job.load_playlist) {
+                t.active = false;   /* Rendition unusable */
+                LOG_WARN("SegmentScheduler", "Unusable media playlist", job.request.uri);
+            } else if (job.init) {
+                t.init_rendition = job.rendition;
+            } else {
+                t.next_sequence = job.segment.sequence + 1;   /* Skip the segment; the demuxer resyncs */
+                t.selected = false;
+            }
+            continue;
+        }
+
+        if (job.load_playlist) {
+            renditions(job.kind)[job.rendition].timeline = std::move(playlist);
+            if (manifest_.reload_interval_us == 0)
+                manifest_.reload_interval_us = renditions(job.kind)[job.rendition].timeline.target_duration_us;
+            if (renditions(job.kind)[job.rendition].timeline.live && !manifest_.live) {
+                manifest_.live = true;
+                next_reload_us_ = nowUs() + manifest_.reload_interval_us;
+            }
+            continue;
+        }
+
+        FetchedSegment seg;
+        seg.kind = job.kind;
+        seg.rendition = job.rendition;
+        seg.init = job.init;
+        seg.source = job.request;
+        seg.data = std::move(body);
+        if (cached) {
+            stats_.cache_hits++;
+        } else {
+            stats_.fetched++;
+            stats_.bytes += seg.data.size();
+        }
+        if (cache_) cache_->pin(seg.source);
+        if (job.init) {
+            t.init_rendition = job.rendition;
+        } else {
+            seg.sequence = job.segment.sequence;
+            seg.start_us = job.segment.start_us;
+            seg.duration_us = job.segment.duration_us;
+            t.queued_us += seg.duration_us;
+            t.segment_bytes = seg.data.size();
+            t.next_sequence = seg.sequence + 1;
+            t.selected = false;
+        }
+        t.queued_bytes += seg.data.size();
+        t.queue.push_back(std::move(seg));
+        updateMemoryLocked();
+    }
+}
+
+void SegmentScheduler::reloadLive() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    const uint64_t epoch = epoch_;
+    const Manifest current = manifest_;
+    const size_t video_rendition = video_.rendition;
+    const bool video_active = video_.active;
+    const bool audio_active = audio_.active;
+    lock.unlock();
+
+    size_t appended = 0;
+    std::vector<uint8_t> body;
+    if (current.type == ManifestType::DASH) {
+        Manifest fresh;
+        if (fetch({current.uri, 0, 0}, body) == device::Result::OK &&
+            ManifestParser::parseDash(toText(body), current.uri, fresh) == device::Result::OK) {
+            lock.lock();
+            if (epoch == epoch_) {
+                for (StreamKind kind : {StreamKind::VIDEO, StreamKind::AUDIO}) {
+                    auto& known = renditions(kind);
+                    const auto& updated = kind == StreamKind::VIDEO ? fresh.video : fresh.audio;
+                    for (auto& r : known)
+                        for (const auto& u : updated)
+                            if (u.id == r.id) appended += r.timeline.merge(u.timeline);
+                }
+                manifest_.live = fresh.live;
+            }
+            lock.unlock();
+        }
+    } else {
+        /* HLS: only the playlists being fetched from */
+        struct Reload { StreamKind kind; size_t rendition; std::string uri; };
+        std::vector<Reload> reloads;
+        if (video_active && video_rendition < current.video.size() && !current.video[video_rendition].playlist_uri.empty())
+            reloads.push_back({StreamKind::VIDEO, video_rendition, current.video[video_rendition].playlist_uri});
+        if (audio_active && !current.audio.empty() && !current.audio[0].playlist_uri.empty())
+            reloads.push_back({StreamKind::AUDIO, 0, current.audio[0].playlist_uri});
+        if (reloads.empty() && !current.video.empty() && current.video[0].playlist_uri.empty())
+            reloads.push_back({StreamKind::VIDEO, 0, current.uri});   /* Bare media playlist */
+
+        bool ended = true;
+        for (const Reload& reload : reloads) {
+            MediaTimeline fresh;
+            if (fetch({reload.uri, 0, 0}, body) != device::Result::OK ||
+                ManifestParser::parseHlsMedia(toText(body), reload.uri, fresh) != device::Result::OK) {
+                ended = false;
+                continue;
+            }
+            ended = ended && !fresh.live;
+            lock.lock();
+            if (epoch == epoch_) appended += renditions(reload.kind)[reload.rendition].timeline.merge(fresh);
+            lock.unlock();
+        }
+        lock.lock();
+        if (epoch == epoch_ && ended && !reloads.empty()) manifest_.live = false;   /* ENDLIST appeared */
+        lock.unlock();
+    }
+
+    lock.lock();
+    stats_.reloads++;
+    stats_.appended += appended;
+    /* Unchanged playlist: retry at half the interval (RFC 8216 6.3.4) */
+    const int64_t interval = std::max<int64_t>(manifest_.reload_interval_us, 100000);
+    next_reload_us_ = nowUs() + (appended == 0 ? interval / 2 : interval);
+    lock.unlock();
+    cv_.notify_all();
+}
+
+} // namespace streaming::media
@@ -0,0 +1,209 @@
+/**
+ * @file segment_scheduler.hpp
+ * @brief Segment prefetch across audio and video for adaptive streams
+ * @copyright 2025 Streaming Device Project
+ *
+ * A worker keeps up to N segments downloaded ahead of the demuxer for
+ * each stream kind, always fetching for the kind with less media
+ * buffered so audio and video never drift apart. Each video segment's
+ * rendition comes from the AbrController, which is fed the timing of
+ * every download and sees the playable buffer: the segments queued here
+ * plus the media the pipeline holds past the demuxer (setPlayoutBuffer).
+ * Its buffer ceiling is what the queue holds when a slot frees,
+ * prefetch_segments - 1 target durations. A rendition change queues its
+ * init segment first.
+ * Live playlists are reloaded on the manifest's interval and merged
+ * incrementally (HLS: only the changed media playlists; a reload that
+ * brings nothing new is retried at half the interval).
+ *
+ * With a MediaCache attached, segments are looked up there first (hits
+ * do not feed the throughput estimate) and stored after download; every
+ * queued segment and the one each kind is playing stay pinned.
+ *
+ * Queued segment data is registered with the MemoryGovernor as
+ * READ_AHEAD; under memory pressure fewer segments are held ahead, but
+ * never less than one per kind.
+ */
+
+#pragma once
+
+#include <streaming_device/types.hpp>
+#include "abr_controller.hpp"
+#include "manifest.hpp"
+#include "common/memory_governor.hpp"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace streaming::media {
+
+class MediaCache;
+
+/** A resource or byte range of one */
+struct SegmentRequest {
+    std::string uri;
+    uint64_t offset{0};
+    uint64_t length{0};          /* 0: to the end */
+};
+
+/** Fetches one request; blocking, called from the scheduler worker only */
+using SegmentLoader = std::function<device::Result(const SegmentRequest& request,
+                                                   std::vector<uint8_t>& body)>;
+
+/** A downloaded segment waiting for the demuxer */
+struct FetchedSegment {
+    StreamKind kind{StreamKind::VIDEO};
+    size_t rendition{0};         /* Index into Manifest::video / audio */
+    bool init{false};            /* Init segment preceding a rendition's media */
+    uint64_t sequence{0};
+    int64_t start_us{0};
+    int64_t duration_us{0};
+    SegmentRequest source;
+    std::vector<uint8_t> data;
+};
+
+struct SegmentSchedulerConfig {
+    size_t prefetch_segments{3};   /* Media segments held ahead per kind */
+    uint32_t max_retries{2};
+    int64_t retry_backoff_us{200000};
+};
+
+struct SegmentSchedulerStats {
+    uint64_t fetched{0};           /* Media and init segments downloaded */
+    uint64_t bytes{0};
+    uint64_t failures{0};          /* Requests that failed after retries */
+    uint64_t reloads{0};           /* Live playlist / MPD refreshes */
+    uint64_t appended{0};          /* Segments added by those refreshes */
+    uint64_t cache_hits{0};        /* Segments served by the MediaCache */
+    uint64_t popped{0};            /* Handed to the demuxer */
+    size_t queued_video{0};
+    size_t queued_audio{0};
+    int64_t buffered_video_us{0};  /* Media time ready ahead of the demuxer */
+    int64_t buffered_audio_us{0};
+    uint64_t buffered_video_bytes{0};   /* Queued segment data, init segments included */
+    uint64_t buffered_audio_bytes{0};
+    size_t video_rendition{0};
+};
+
+/**
+ * @brief Prefetching segment fetcher
+ *
+ * Not owning: the ABR controller must outlive the scheduler. The loader
+ * is also used for manifest and playlist reloads.
+ */
+class SegmentScheduler {
+public:
+    SegmentScheduler(SegmentLoader loader, AbrController& abr, SegmentSchedulerConfig config = {},
+                     common::MemoryGovernor& governor = common::MemoryGovernor::instance());
+    ~SegmentScheduler();
+
+    SegmentScheduler(const SegmentScheduler&) = delete;
+    SegmentScheduler& operator=(const SegmentScheduler&) = delete;
+
+    /**
+     * Begin prefetching manifest from position_us; a negative position on
+     * a live manifest starts three target durations behind the live edge.
+     * HLS media playlists not yet loaded are fetched on first use.
+     */
+    device::Result start(Manifest manifest, int64_t position_us);
+
+    /** Serve and store segments through cache (nullptr: none); call before start() */
+    void setCache(MediaCache* cache);
+
+    /** Stop the worker and drop everything queued */
+    void stop();
+
+    /** Restart prefetching at position_us, dropping queued segments */
+    void seek(int64_t position_us);
+
+    /** Next segment of kind in order, false if none is ready; frees a prefetch slot */
+    bool popSegment(StreamKind kind, FetchedSegment& out);
+
+    /**
+     * No segment of kind will come: the last one of a VOD timeline has
+     * been popped, the kind's rendition failed, or the scheduler is stopped
+     */
+    bool isDrained(StreamKind kind) const;
+
+    /**
+     * Video the pipeline has taken from the queue and not yet played
+     * (demuxed and decoded); reported by the pipeline as it samples its
+     * buffer. Reset by start() and seek().
+     */
+    void setPlayoutBuffer(int64_t duration_us);
+
+    SegmentSchedulerStats getStats() const;
+
+    /** Copy of the manifest including live updates */
+    Manifest getManifest() const;
+
+private:
+    /** Per stream kind fetch state */
+    struct Track {
+        bool active{false};
+        size_t rendition{0};
+        bool selected{false};              /* rendition chosen for the next media segment */
+        size_t init_rendition{SIZE_MAX};   /* Rendition whose init segment was queued last */
+        bool positioned{false};            /* next_sequence valid (timeline was loaded) */
+        int64_t start_position_us{0};
+        uint64_t next_sequence{0};
+        bool ended{false};
+        std::deque<FetchedSegment> queue;
+        int64_t queued_us{0};
+        uint64_t queued_bytes{0};
+        uint64_t segment_bytes{0};         /* Last media segment, sizes the governor demand */
+        bool playing{false};               /* A popped segment is being demuxed */
+        SegmentRequest playing_source;
+    };
+
+    /** What the worker decided to do next, built under the lock */
+    struct Job {
+        StreamKind kind{StreamKind::VIDEO};
+        size_t rendition{0};
+        bool init{false};
+        bool load_playlist{false};
+        Segment segment;
+        SegmentRequest request;
+    };
+
+    void worker();
+    bool nextJobLocked(Job& job);
+    bool trackJobLocked(StreamKind kind, Job& job);
+    Track& track(StreamKind kind) { return kind == StreamKind::VIDEO ? video_ : audio_; }
+    const Track& track(StreamKind kind) const { return kind == StreamKind::VIDEO ? video_ : audio_; }
+    std::vector<ManifestRendition>& renditions(StreamKind kind) {
+        return kind == StreamKind::VIDEO ? manifest_.video : manifest_.audio;
+    }
+    void positionLocked(int64_t position_us);
+    void unpinTrackLocked(Track& t);
+    /** Report queued bytes and the full-prefetch demand to the governor */
+    void updateMemoryLocked();
+    device::Result fetch(const SegmentRequest& request, std::vector<uint8_t>& body);
+    void reloadLive();
+
+    SegmentLoader loader_;
+    AbrController& abr_;
+    const SegmentSchedulerConfig config_;
+    MediaCache* cache_{nullptr};
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::thread worker_;
+    bool running_{false};
+    uint64_t epoch_{0};            /* Bumped by seek/stop so stale downloads are dropped */
+    Manifest manifest_;
+    Track video_;
+    Track audio_;
+    int64_t next_reload_us_{0};
+    int64_t playout_us_{0};
+    SegmentSchedulerStats stats_;
+    common::MemoryGovernor::Registration memory_;
+    uint64_t memory_demand_{0};    /* Last demand reported; a limit below it means pressure */
+};
+
+} // namespace streaming::media
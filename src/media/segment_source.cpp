@@ -0,0 +1,148 @@
+/**
+ * @file segment_source.cpp
+ * @brief SegmentSourceParser implementation
+ */
+
+#include "segment_source.hpp"
+#include "../common/logger.hpp"
+#include <algorithm>
+
+namespace streaming::media {
+
+SegmentSourceParser::SegmentSourceParser(hal::IContainerParser& demuxer, SegmentScheduler& scheduler)
+    : demuxer_(demuxer), scheduler_(scheduler) {}
+
+device::Result SegmentSourceParser::openContainer(const std::string& path_or_uri) {
+    kinds_.clear();
+    video_ = {};
+    audio_ = {};
+    appended_ = false;
+    const device::Result r = demuxer_.openContainer(path_or_uri);
+    if (r != device::Result::OK) return r;
+
+    /* Audio without renditions of its own is muxed into the video segments */
+    const Manifest manifest = scheduler_.getManifest();
+    video_.gated = !manifest.video.empty();
+    audio_.gated = !manifest.audio.empty();
+    for (const media::TrackMetadata& t : demuxer_.getTracks()) {
+        if (t.type == media::TrackType::VIDEO && video_.gated)
+            kinds_[t.track_id] = StreamKind::VIDEO;
+        else if (t.type == media::TrackType::AUDIO && (audio_.gated || video_.gated))
+            kinds_[t.track_id] = audio_.gated ? StreamKind::AUDIO : StreamKind::VIDEO;
+    }
+    return r;
+}
+
+device::Result SegmentSourceParser::readPacket(media::EncodedPacket& packet_out) {
+    for (;;) {
+        if (video_.gated && video_.read_us >= video_.end_us) append(StreamKind::VIDEO);
+        if (audio_.gated && audio_.read_us >= audio_.end_us) append(StreamKind::AUDIO);
+        if (appended_) {
+            const device::Result r = demuxer_.readPacket(packet_out);
+            if (r == device::Result::OK) {
+                auto it = kinds_.find(packet_out.track_id);
+                if (it != kinds_.end()) {
+                    Gate& g = it->second == StreamKind::VIDEO ? video_ : audio_;
+                    g.read_us = std::max(g.read_us, packet_out.timing.pts + packet_out.timing.duration_us);
+                }
+                return r;
+            }
+            if (r != device::Result::ERROR_TIMEOUT) return r;
+        }
+
+        /* The demuxer has used up what was appended: every kind needs its next segment */
+        bool short_read = false;
+        for (Gate* g : {&video_, &audio_}) {
+            if (!g->gated || g->read_us >= g->end_us) continue;
+            g->read_us = g->end_us;
+            short_read = true;
+        }
+        if (!short_read) break;
+    }
+    const bool drained = (!video_.gated || scheduler_.isDrained(StreamKind::VIDEO)) &&
+                         (!audio_.gated || scheduler_.isDrained(StreamKind::AUDIO));
+    return drained ? device::Result::ERROR_END_OF_STREAM : device::Result::ERROR_TIMEOUT;
+}
+
+bool SegmentSourceParser::append(StreamKind kind) {
+    Gate& g = kind == StreamKind::VIDEO ? video_ : audio_;
+    FetchedSegment segment;
+    while (scheduler_.popSegment(kind, segment)) {
+        hal::ContainerSegment s;
+        s.data = std::move(segment.data);
+        s.init = segment.init;
+        s.video = kind == StreamKind::VIDEO;
+        s.audio = kind == StreamKind::AUDIO || !audio_.gated;
+        s.start_us = segment.start_us;
+        s.duration_us = segment.duration_us;
+        const device::Result r = demuxer_.appendSegment(s);
+        if (r != device::Result::OK)
+            LOG_WARN("SegmentSource", "Cannot demux segment", segment.sequence, static_cast<int>(r));
+        if (segment.init) continue;
+        appended_ = true;
+        g.end_us = segment.start_us + segment.duration_us;
+        return true;
+    }
+    return false;
+}
+
+void SegmentSourceParser::resetGates() {
+    for (Gate* g : {&video_, &audio_}) {
+        g->end_us = 0;
+        g->read_us = 0;
+    }
+    appended_ = false;
+}
+
+device::Result SegmentSourceParser::seek(int64_t timestamp_us) {
+    scheduler_.seek(timestamp_us);
+    resetGates();
+    return demuxer_.seek(timestamp_us);
+}
+
+device::Result SegmentSourceParser::seekToByte(uint64_t offset) {
+    return demuxer_.seekToByte(offset);
+}
+
+device::Result SegmentSourceParser::readKeyframe(int64_t from_us, bool forward,
+                                                 media::EncodedPacket& packet_out) {
+    return demuxer_.readKeyframe(from_us, forward, packet_out);
+}
+
+device::Result SegmentSourceParser::appendSegment(const hal::ContainerSegment&) {
+    return device::Result::ERROR_NOT_SUPPORTED;
+}
+
+std::vector<media::TrackMetadata> SegmentSourceParser::getTracks() const {
+    return demuxer_.getTracks();
+}
+
+std::vector<media::TrackMetadata> SegmentSourceParser::getVideoTracks() const {
+    return demuxer_.getVideoTracks();
+}
+
+std::vector<media::TrackMetadata> SegmentSourceParser::getAudioTracks() const {
+    return demuxer_.getAudioTracks();
+}
+
+std::vector<media::TrackMetadata> SegmentSourceParser::getSubtitleTracks() const {
+    return demuxer_.getSubtitleTracks();
+}
+
+int64_t SegmentSourceParser::getDurationUs() const {
+    return demuxer_.getDurationUs();
+}
+
+device::Result SegmentSourceParser::closeContainer() {
+    kinds_.clear();
+    video_ = {};
+    audio_ = {};
+    appended_ = false;
+    return demuxer_.closeContainer();
+}
+
+bool SegmentSourceParser::supports(media::ContainerFormat format) const {
+    return demuxer_.supports(format);
+}
+
+} // namespace streaming::media
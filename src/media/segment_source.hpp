@@ -0,0 +1,85 @@
+/**
+ * @file segment_source.hpp
+ * @brief Adaptive streams demuxed from a SegmentScheduler's prefetched segments
+ * @copyright 2025 Streaming Device Project
+ *
+ * SegmentSourceParser sits between the demux stage and the platform
+ * demuxer for HLS/DASH sessions. The platform demuxer, opened on the
+ * session's first media resource, demuxes the segments the scheduler has
+ * downloaded: each kind's next segment is popped and appended once what
+ * was appended of that kind has been read, so the demuxer never runs
+ * ahead of the network, each pop frees a prefetch slot, a scheduler that
+ * stops delivering starves playback the way a real outage does, and
+ * rendition switches, seeks and live edge moves change what is decoded.
+ * Packets carry the manifest's timeline.
+ */
+
+#pragma once
+
+#include <streaming_device/types.hpp>
+#include <streaming_device/media_types.hpp>
+#include "hal/container_hal.hpp"
+#include "segment_scheduler.hpp"
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace streaming::media {
+
+/**
+ * @brief Container parser gated on downloaded segments
+ *
+ * Not owning: the demuxer and the scheduler must outlive the parser.
+ * Audio without renditions of its own in the manifest is muxed into
+ * the video segments. readPacket() returns ERROR_TIMEOUT while the
+ * next segment is still downloading and ERROR_END_OF_STREAM once the
+ * scheduler has handed out the last one. Trick play reads keyframes
+ * through the demuxer's index without consuming segments. Called from
+ * the demux stage only, like any container parser.
+ */
+class SegmentSourceParser : public hal::IContainerParser {
+public:
+    SegmentSourceParser(hal::IContainerParser& demuxer, SegmentScheduler& scheduler);
+
+    SegmentSourceParser(const SegmentSourceParser&) = delete;
+    SegmentSourceParser& operator=(const SegmentSourceParser&) = delete;
+
+    device::Result openContainer(const std::string& path_or_uri) override;
+    device::Result readPacket(media::EncodedPacket& packet_out) override;
+    /** Repositions the scheduler and the demuxer */
+    device::Result seek(int64_t timestamp_us) override;
+    device::Result seekToByte(uint64_t offset) override;
+    device::Result readKeyframe(int64_t from_us, bool forward,
+                                media::EncodedPacket& packet_out) override;
+    /** ERROR_NOT_SUPPORTED: the scheduler supplies the segments */
+    device::Result appendSegment(const hal::ContainerSegment& segment) override;
+    std::vector<media::TrackMetadata> getTracks() const override;
+    std::vector<media::TrackMetadata> getVideoTracks() const override;
+    std::vector<media::TrackMetadata> getAudioTracks() const override;
+    std::vector<media::TrackMetadata> getSubtitleTracks() const override;
+    int64_t getDurationUs() const override;
+    device::Result closeContainer() override;
+    bool supports(media::ContainerFormat format) const override;
+
+private:
+    /** What one kind has appended and how much of it has been read */
+    struct Gate {
+        bool gated{false};         /* The manifest has segments of this kind */
+        int64_t end_us{0};         /* Where the appended segments reach */
+        int64_t read_us{0};        /* End of the latest packet read */
+    };
+
+    /** Pop the kind's next media segment, and any init before it, into the demuxer */
+    bool append(StreamKind kind);
+    void resetGates();
+
+    hal::IContainerParser& demuxer_;
+    SegmentScheduler& scheduler_;
+    std::map<uint32_t, StreamKind> kinds_;   /* Track id to the segments that carry it */
+    Gate video_;
+    Gate audio_;
+    bool appended_{false};                   /* A segment has been appended since open() / seek() */
+};
+
+} // namespace streaming::media
@@ -5,6 +5,7 @@
 
 #include "codec_service.hpp"
 #include "../hal/codec_hal.hpp"
+#include "../drivers/mock/mock_audio_decoder.hpp"
 #include "../drivers/mock/mock_codec_decoder.hpp"
 #include "../common/logger.hpp"
 #include <algorithm>
@@ -30,9 +31,21 @@ public:
         registerCodec(media::VideoCodec::PRORES,
             []() { return std::make_unique<drivers::mock::MockCodecDecoder>(); },
             {media::VideoCodec::PRORES, "ProRes", false, 0});
+        registerAudioCodec(media::AudioCodec::AAC,
+            []() { return std::make_unique<drivers::mock::MockAudioDecoder>(); },
+            {media::AudioCodec::AAC, "AAC", 0});
+        registerAudioCodec(media::AudioCodec::AC3,
+            []() { return std::make_unique<drivers::mock::MockAudioDecoder>(); },
+            {media::AudioCodec::AC3, "AC3", 0});
+        registerAudioCodec(media::AudioCodec::EAC3,
+            []() { return std::make_unique<drivers::mock::MockAudioDecoder>(); },
+            {media::AudioCodec::EAC3, "E-AC3", 0});
         return device::Result::OK;
     }
-    void shutdown() override { factories_.clear(); }
+    void shutdown() override {
+        factories_.clear();
+        audio_factories_.clear();
+    }
 
     device::Result registerCodec(media::VideoCodec codec,
                                  std::function<std::unique_ptr<hal::ICodecDecoder>()> factory,
@@ -95,9 +108,49 @@ public:
         prefer_hw_ = preferred;
     }
 
+    device::Result registerAudioCodec(media::AudioCodec codec,
+                                      std::function<std::unique_ptr<hal::IAudioDecoder>()> factory,
+                                      const AudioCodecRegistration& info) override {
+        if (!factory) return device::Result::ERROR_INVALID_PARAM;
+        audio_factories_[codec].push_back({info, factory});
+        LOG_INFO("CodecService", "Registered audio codec: ", info.name);
+        return device::Result::OK;
+    }
+
+    std::vector<AudioCodecRegistration> getRegisteredAudioCodecs() const override {
+        std::vector<AudioCodecRegistration> result;
+        for (const auto& p : audio_factories_)
+            for (const auto& reg : p.second) result.push_back(reg.first);
+        return result;
+    }
+
+    std::unique_ptr<hal::IAudioDecoder> createAudioDecoder(
+        const media::AudioTrackInfo& track) override {
+        auto it = audio_factories_.find(track.codec);
+        if (it == audio_factories_.end()) return nullptr;
+
+        auto sorted = it->second;
+        std::stable_sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) {
+            return a.first.priority > b.first.priority;
+        });
+        for (const auto& reg : sorted) {
+            auto dec = reg.second();
+            if (dec && dec->supports(track.codec) &&
+                dec->initialize(track.codec, track) == device::Result::OK)
+                return dec;
+        }
+        return nullptr;
+    }
+
+    bool isAudioSupported(media::AudioCodec codec) const override {
+        return audio_factories_.count(codec) && !audio_factories_.at(codec).empty();
+    }
+
 private:
     std::map<media::VideoCodec, std::vector<std::pair<CodecRegistration,
         std::function<std::unique_ptr<hal::ICodecDecoder>()>>>> factories_;
+    std::map<media::AudioCodec, std::vector<std::pair<AudioCodecRegistration,
+        std::function<std::unique_ptr<hal::IAudioDecoder>()>>>> audio_factories_;
     bool prefer_hw_{true};
 };
 
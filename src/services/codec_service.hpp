@@ -7,6 +7,7 @@
 
 #include <streaming_device/types.hpp>
 #include <streaming_device/media_types.hpp>
+#include "hal/audio_decoder_hal.hpp"
 #include "hal/codec_hal.hpp"
 #include <functional>
 #include <memory>
@@ -23,6 +24,13 @@ struct CodecRegistration {
     uint32_t priority{0};  /* Higher = preferred when multiple support same codec */
 };
 
+/** Audio codec registration info */
+struct AudioCodecRegistration {
+    media::AudioCodec codec;
+    std::string name;
+    uint32_t priority{0};  /* Higher = preferred when multiple support same codec */
+};
+
 /**
  * @brief CodecService Interface
  *
@@ -60,6 +68,21 @@ public:
 
     /** Set global hardware acceleration preference */
     virtual void setHardwareAccelerationPreferred(bool preferred) = 0;
+
+    /** Register an audio decoder factory for a codec */
+    virtual device::Result registerAudioCodec(media::AudioCodec codec,
+                                              std::function<std::unique_ptr<hal::IAudioDecoder>()> factory,
+                                              const AudioCodecRegistration& info) = 0;
+
+    /** Get all registered audio codecs */
+    virtual std::vector<AudioCodecRegistration> getRegisteredAudioCodecs() const = 0;
+
+    /** Select and initialize the highest-priority audio decoder for track */
+    virtual std::unique_ptr<hal::IAudioDecoder> createAudioDecoder(
+        const media::AudioTrackInfo& track) = 0;
+
+    /** Check if audio codec is supported */
+    virtual bool isAudioSupported(media::AudioCodec codec) const = 0;
 };
 
 std::unique_ptr<ICodecService> createCodecService();
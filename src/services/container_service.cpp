@@ -11,11 +11,12 @@
 namespace streaming::services {
 
 static media::ContainerFormat detectFormat(const std::string& path) {
+    if (media::RtpLiveParser::isLiveUri(path)) return media::ContainerFormat::RTP;
     if (path.size() < 4) return media::ContainerFormat::UNKNOWN;
     auto dot_pos = path.find_last_of('.');
     if (dot_pos == std::string::npos) return media::ContainerFormat::UNKNOWN;
     std::string ext = path.substr(dot_pos);
-    if (ext == ".mp4") return media::ContainerFormat::MP4;
+    if (ext == ".mp4" || ext == ".m4s") return media::ContainerFormat::MP4;   /* .m4s: fMP4 segment */
     if (ext == ".mov") return media::ContainerFormat::MOV;
     if (ext == ".mkv" || ext == ".webm") return media::ContainerFormat::MKV;
     return media::ContainerFormat::UNKNOWN;
@@ -24,7 +25,8 @@ static media::ContainerFormat detectFormat(const std::string& path) {
 class ContainerServiceImpl : public IContainerService {
 public:
     ContainerServiceImpl() {
-        parser_ = hal::createContainerParser();
+        platform_parser_ = hal::createContainerParser();
+        parser_ = platform_parser_.get();
     }
 
     device::Result initialize() override { return device::Result::OK; }
@@ -32,6 +34,16 @@ public:
 
     device::Result open(const std::string& path_or_uri) override {
         format_ = detectFormat(path_or_uri);
+        if (format_ == media::ContainerFormat::RTP) {
+            if (!live_parser_) live_parser_ = std::make_unique<media::RtpLiveParser>();
+            parser_ = live_parser_.get();
+        } else if (segment_scheduler_) {
+            segment_parser_ = std::make_unique<media::SegmentSourceParser>(*platform_parser_,
+                                                                           *segment_scheduler_);
+            parser_ = segment_parser_.get();
+        } else {
+            parser_ = platform_parser_.get();
+        }
         if (!parser_->supports(format_)) {
             LOG_WARN("ContainerService", "Unsupported format");
             return device::Result::ERROR_NOT_SUPPORTED;
@@ -39,6 +51,10 @@ public:
         return parser_->openContainer(path_or_uri);
     }
 
+    void setSegmentSource(media::SegmentScheduler* scheduler) override {
+        segment_scheduler_ = scheduler;
+    }
+
     device::Result readPacket(media::EncodedPacket& packet_out) override {
         return parser_->readPacket(packet_out);
     }
@@ -47,6 +63,11 @@ public:
         return parser_->seek(timestamp_us);
     }
 
+    device::Result readKeyframe(int64_t from_us, bool forward,
+                                media::EncodedPacket& packet_out) override {
+        return parser_->readKeyframe(from_us, forward, packet_out);
+    }
+
     std::vector<media::TrackMetadata> getTracks() const override {
         return parser_->getTracks();
     }
@@ -55,18 +76,38 @@ public:
         return parser_->getVideoTracks();
     }
 
+    std::vector<media::TrackMetadata> getAudioTracks() const override {
+        return parser_->getAudioTracks();
+    }
+
     int64_t getDurationUs() const override {
         return parser_->getDurationUs();
     }
 
     device::Result close() override {
-        return parser_->closeContainer();
+        const device::Result r = parser_->closeContainer();
+        parser_ = platform_parser_.get();
+        return r;
     }
 
     media::ContainerFormat getFormat() const override { return format_; }
 
+    media::LiveIngestStats getLiveStats() const override {
+        return isLive() ? live_parser_->getStats() : media::LiveIngestStats{};
+    }
+
+    int64_t getCaptureTimeUs(int64_t pts_us) const override {
+        return isLive() ? live_parser_->getCaptureTimeUs(pts_us) : -1;
+    }
+
 private:
-    std::unique_ptr<hal::IContainerParser> parser_;
+    bool isLive() const { return live_parser_ && parser_ == live_parser_.get(); }
+
+    std::unique_ptr<hal::IContainerParser> platform_parser_;
+    std::unique_ptr<media::RtpLiveParser> live_parser_;   /* Created on the first rtp:// open */
+    std::unique_ptr<media::SegmentSourceParser> segment_parser_;   /* Over platform_parser_ */
+    media::SegmentScheduler* segment_scheduler_{nullptr};
+    hal::IContainerParser* parser_{nullptr};              /* The one serving the open source */
     media::ContainerFormat format_{media::ContainerFormat::UNKNOWN};
 };
 
@@ -8,6 +8,8 @@
 #include <streaming_device/types.hpp>
 #include <streaming_device/media_types.hpp>
 #include "hal/container_hal.hpp"
+#include "media/rtp_ingest.hpp"
+#include "media/segment_source.hpp"
 #include <memory>
 #include <string>
 #include <vector>
@@ -20,6 +22,11 @@ namespace streaming::services {
  * - Select and initialize appropriate demuxer for container format
  * - Provide track metadata
  * - Deliver packetized payloads to decoders
+ *
+ * rtp:// URIs are live ingests served by media::RtpLiveParser instead
+ * of the platform demuxer. Adaptive streams are read through a
+ * media::SegmentSourceParser, which demuxes the segments their scheduler
+ * has downloaded.
  */
 class IContainerService {
 public:
@@ -31,18 +38,32 @@ public:
     /** Open container, auto-detect format, initialize demuxer */
     virtual device::Result open(const std::string& path_or_uri) = 0;
 
+    /**
+     * Demux the following opens from scheduler's segments (an adaptive
+     * stream), nullptr to read the container directly. scheduler must
+     * outlive the open.
+     */
+    virtual void setSegmentSource(media::SegmentScheduler* scheduler) = 0;
+
     /** Read next packet (video/audio/subtitle) */
     virtual device::Result readPacket(media::EncodedPacket& packet_out) = 0;
 
     /** Seek to timestamp (microseconds) */
     virtual device::Result seek(int64_t timestamp_us) = 0;
 
+    /** Next keyframe after/before from_us via the sample index (trick play) */
+    virtual device::Result readKeyframe(int64_t from_us, bool forward,
+                                        media::EncodedPacket& packet_out) = 0;
+
     /** Get all tracks */
     virtual std::vector<media::TrackMetadata> getTracks() const = 0;
 
     /** Get video tracks only */
     virtual std::vector<media::TrackMetadata> getVideoTracks() const = 0;
 
+    /** Get audio tracks only */
+    virtual std::vector<media::TrackMetadata> getAudioTracks() const = 0;
+
     /** Get container duration */
     virtual int64_t getDurationUs() const = 0;
 
@@ -51,6 +72,12 @@ public:
 
     /** Get detected container format */
     virtual media::ContainerFormat getFormat() const = 0;
+
+    /** Jitter buffer and ingest counters; live is false unless an rtp:// source is open */
+    virtual media::LiveIngestStats getLiveStats() const = 0;
+
+    /** Live sources: unix time (us) the frame at pts_us was captured; -1 otherwise */
+    virtual int64_t getCaptureTimeUs(int64_t pts_us) const = 0;
 };
 
 std::unique_ptr<IContainerService> createContainerService();
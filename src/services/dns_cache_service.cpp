@@ -0,0 +1,271 @@
+/**
+ * @file dns_cache_service.cpp
+ * @brief DNS Cache Service implementation
+ */
+
+#include "dns_cache_service.hpp"
+#include "../common/logger.hpp"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <arpa/inet.h>
+
+namespace streaming::services {
+
+static int64_t nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool isIpLiteral(const std::string& host) {
+    in_addr addr{};
+    return inet_pton(AF_INET, host.c_str(), &addr) == 1;
+}
+
+/* DNS names are case-insensitive; one entry per name, trailing root dot dropped */
+static std::string normalizeHost(std::string host) {
+    std::transform(host.begin(), host.end(), host.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    if (host.size() > 1 && host.back() == '.') host.pop_back();
+    return host;
+}
+
+std::string hostOfUri(const std::string& uri) {
+    const size_t scheme_end = uri.find("://");
+    if (scheme_end == std::string::npos) return "";
+    const size_t begin = scheme_end + 3;
+    std::string authority = uri.substr(begin, uri.find_first_of("/?#", begin) - begin);
+    const size_t at = authority.rfind('@');
+    if (at != std::string::npos) authority.erase(0, at + 1);
+    if (!authority.empty() && authority[0] == '[') {
+        authority = authority.substr(1, authority.find(']') - 1);   /* IPv6 literal */
+    } else {
+        const size_t colon = authority.find(':');
+        if (colon != std::string::npos) authority.erase(colon);
+    }
+    return normalizeHost(authority);
+}
+
+class DnsCacheServiceImpl : public IDnsCacheService {
+public:
+    DnsCacheServiceImpl(std::unique_ptr<hal::IWifiHal> wifi, DnsCacheConfig config)
+        : wifi_(std::move(wifi)), config_(config) {}
+
+    ~DnsCacheServiceImpl() override { shutdown(); }
+
+    device::Result initialize() override {
+        const device::Result r = wifi_->initialize();
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) {
+            running_ = true;
+            worker_ = std::thread(&DnsCacheServiceImpl::worker, this);
+        }
+        return r;
+    }
+
+    void shutdown() override {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!running_) return;
+            running_ = false;
+        }
+        cv_.notify_all();
+        if (worker_.joinable()) worker_.join();
+        wifi_->shutdown();
+    }
+
+    device::Result resolve(const std::string& hostname, std::string& ip_out) override {
+        if (hostname.empty()) return device::Result::ERROR_INVALID_PARAM;
+        if (isIpLiteral(hostname)) {
+            ip_out = hostname;
+            return device::Result::OK;
+        }
+        const std::string host = normalizeHost(hostname);
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            const int64_t now = nowUs();
+            auto it = entries_.find(host);
+            if (it != entries_.end()) {
+                const Entry& e = it->second;
+                if (e.ok && now < e.expires_us) {
+                    stats_.hits++;
+                    ip_out = e.ip;
+                    return device::Result::OK;
+                }
+                if (e.ok && now < e.expires_us + config_.stale_us) {
+                    stats_.stale_hits++;
+                    ip_out = e.ip;
+                    queueLocked(host);
+                    return device::Result::OK;
+                }
+                if (!e.ok && now < e.expires_us) {
+                    stats_.negative_hits++;
+                    return device::Result::ERROR_NETWORK;
+                }
+            }
+            if (resolving_.count(host) == 0) break;
+            /* Someone is already asking the HAL: share that answer */
+            stats_.coalesced++;
+            resolved_cv_.wait(lock, [&] { return resolving_.count(host) == 0; });
+        }
+        stats_.misses++;
+        resolving_.insert(host);
+        lock.unlock();
+
+        std::string ip;
+        const device::Result r = lookup(host, ip);
+        lock.lock();
+        storeLocked(host, r, ip);
+        resolving_.erase(host);
+        resolved_cv_.notify_all();
+        if (r == device::Result::OK) ip_out = ip;
+        return r;
+    }
+
+    void prefetch(const std::vector<std::string>& hostnames) override {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            const int64_t now = nowUs();
+            for (const auto& name : hostnames) {
+                if (name.empty() || isIpLiteral(name)) continue;
+                const std::string host = normalizeHost(name);
+                /* Fresh answers need nothing; recent failures wait out the negative TTL */
+                auto it = entries_.find(host);
+                if (it != entries_.end() && now < it->second.expires_us) continue;
+                if (queueLocked(host)) stats_.prefetched++;
+            }
+        }
+        cv_.notify_all();
+    }
+
+    void prefetchApps(const std::vector<device::AppMetadata>& apps) override {
+        std::vector<std::string> hosts;
+        for (const auto& app : apps) {
+            for (const std::string* uri : {&app.package_uri, &app.auth_endpoint}) {
+                const std::string host = hostOfUri(*uri);
+                if (!host.empty() && std::find(hosts.begin(), hosts.end(), host) == hosts.end())
+                    hosts.push_back(host);
+            }
+        }
+        LOG_INFO("DnsCache", "Prefetching", hosts.size(), "app hosts");
+        prefetch(hosts);
+    }
+
+    void flush() override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries_.clear();
+    }
+
+    DnsCacheStats getStats() const override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        DnsCacheStats stats = stats_;
+        stats.entries = entries_.size();
+        return stats;
+    }
+
+    std::function<device::Result(const std::string&, std::string&)> resolver() override {
+        return [this](const std::string& host, std::string& ip) { return resolve(host, ip); };
+    }
+
+private:
+    struct Entry {
+        std::string ip;
+        bool ok{false};
+        int64_t expires_us{0};   /* Answer TTL, or the negative TTL of a failure */
+    };
+
+    /** The HAL is not assumed reentrant: one lookup at a time */
+    device::Result lookup(const std::string& host, std::string& ip) {
+        std::lock_guard<std::mutex> lock(hal_mutex_);
+        return wifi_->resolveHost(host, ip);
+    }
+
+    bool queueLocked(const std::string& host) {
+        if (!pending_.insert(host).second) return false;
+        queue_.push_back(host);
+        cv_.notify_all();
+        return true;
+    }
+
+    void storeLocked(const std::string& host, device::Result r, const std::string& ip) {
+        const int64_t now = nowUs();
+        auto it = entries_.find(host);
+        if (r == device::Result::OK) {
+            entries_[host] = {ip, true, now + config_.ttl_us};
+        } else {
+            stats_.failures++;
+            /* A failed refresh keeps serving the old answer until it is too stale */
+            const bool usable = it != entries_.end() && it->second.ok &&
+                                now < it->second.expires_us + config_.stale_us;
+            if (!usable) entries_[host] = {"", false, now + config_.negative_ttl_us};
+            LOG_WARN("DnsCache", "Lookup failed", host);
+        }
+        while (entries_.size() > config_.max_entries) {
+            auto oldest = entries_.end();
+            for (auto e = entries_.begin(); e != entries_.end(); ++e)
+                if (e->first != host && (oldest == entries_.end() || e->second.expires_us < oldest->second.expires_us))
+                    oldest = e;
+            if (oldest == entries_.end()) break;
+            entries_.erase(oldest);
+        }
+    }
+
+    void worker() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (running_) {
+            if (queue_.empty()) {
+                cv_.wait(lock);
+                continue;
+            }
+            const std::string host = queue_.front();
+            queue_.pop_front();
+            auto it = entries_.find(host);
+            if (resolving_.count(host) || (it != entries_.end() && nowUs() < it->second.expires_us)) {
+                pending_.erase(host);   /* A caller's miss got there first */
+                continue;
+            }
+            resolving_.insert(host);
+            lock.unlock();
+            std::string ip;
+            const device::Result r = lookup(host, ip);
+            lock.lock();
+            storeLocked(host, r, ip);
+            stats_.refreshes++;
+            pending_.erase(host);
+            resolving_.erase(host);
+            resolved_cv_.notify_all();
+        }
+    }
+
+    std::unique_ptr<hal::IWifiHal> wifi_;
+    const DnsCacheConfig config_;
+
+    mutable std::mutex mutex_;
+    std::mutex hal_mutex_;
+    std::condition_variable cv_;
+    std::thread worker_;
+    bool running_{false};
+    std::map<std::string, Entry> entries_;
+    std::deque<std::string> queue_;        /* Hosts to resolve in the background */
+    std::set<std::string> pending_;        /* Queued or resolving: no duplicate work */
+    std::set<std::string> resolving_;      /* At the HAL now, by a caller or the worker */
+    std::condition_variable resolved_cv_;
+    DnsCacheStats stats_;
+};
+
+std::unique_ptr<IDnsCacheService> createDnsCacheService(DnsCacheConfig config) {
+    return std::make_unique<DnsCacheServiceImpl>(hal::createWifiHal(), config);
+}
+
+std::unique_ptr<IDnsCacheService> createDnsCacheService(std::unique_ptr<hal::IWifiHal> wifi,
+                                                        DnsCacheConfig config) {
+    return std::make_unique<DnsCacheServiceImpl>(std::move(wifi), config);
+}
+
+} // namespace streaming::services
@@ -0,0 +1,92 @@
+/**
+ * @file dns_cache_service.hpp
+ * @brief DNS Cache Service - TTL cache with serve-stale and prefetch in front of IWifiHal::resolveHost
+ */
+
+#pragma once
+
+#include <streaming_device/types.hpp>
+#include "hal/wifi_hal.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace streaming::services {
+
+/**
+ * Cache tuning. IWifiHal::resolveHost() does not report record TTLs, so
+ * every answer lives for ttl_us; CDN records are typically 30-300 s.
+ */
+struct DnsCacheConfig {
+    int64_t ttl_us{60000000};
+    int64_t stale_us{3600000000LL};   /* Past the TTL an answer is still served (and refreshed) this long */
+    int64_t negative_ttl_us{5000000}; /* Failed lookups are not retried sooner */
+    size_t max_entries{256};
+};
+
+/** Cache counters */
+struct DnsCacheStats {
+    uint64_t hits{0};
+    uint64_t stale_hits{0};      /* Expired answer served while a refresh runs */
+    uint64_t misses{0};          /* Resolved in the caller's thread */
+    uint64_t coalesced{0};       /* Waited for a lookup of the same host already under way */
+    uint64_t negative_hits{0};   /* Failed recently, answered without asking the HAL */
+    uint64_t refreshes{0};       /* Background resolutions (refresh and prefetch) */
+    uint64_t prefetched{0};      /* Hosts queued by prefetch() */
+    uint64_t failures{0};        /* HAL lookups that failed */
+    size_t entries{0};
+};
+
+/**
+ * @brief DNS Cache Service
+ *
+ * - Fresh answers return without touching the network
+ * - Expired answers are served at once while a worker re-resolves them
+ * - Boot prefetch of every app's package and auth hosts, so app launch
+ *   and session start never wait on DNS
+ */
+class IDnsCacheService {
+public:
+    virtual ~IDnsCacheService() = default;
+
+    /** Initialize Wi-Fi HAL, start the refresh worker */
+    virtual device::Result initialize() = 0;
+
+    /** Stop the worker */
+    virtual void shutdown() = 0;
+
+    /**
+     * Address of hostname (IPv4 literals are returned as is; names are
+     * matched case-insensitively). Blocks on the HAL only for a host that
+     * is neither cached nor stale; concurrent misses share one lookup.
+     */
+    virtual device::Result resolve(const std::string& hostname, std::string& ip_out) = 0;
+
+    /** Resolve hosts in the background; never blocks */
+    virtual void prefetch(const std::vector<std::string>& hostnames) = 0;
+
+    /** Prefetch the hosts of each app's package_uri and auth_endpoint */
+    virtual void prefetchApps(const std::vector<device::AppMetadata>& apps) = 0;
+
+    /** Drop every entry */
+    virtual void flush() = 0;
+
+    virtual DnsCacheStats getStats() const = 0;
+
+    /** resolve() as a callable, e.g. an HttpClient host resolver */
+    virtual std::function<device::Result(const std::string&, std::string&)> resolver() = 0;
+};
+
+/** Host part of a URL ("https://user@cdn.example.com:8443/x" -> "cdn.example.com"), empty if none */
+std::string hostOfUri(const std::string& uri);
+
+std::unique_ptr<IDnsCacheService> createDnsCacheService(DnsCacheConfig config = {});
+
+/** As above over a given Wi-Fi HAL (tests, shared network stacks) */
+std::unique_ptr<IDnsCacheService> createDnsCacheService(std::unique_ptr<hal::IWifiHal> wifi,
+                                                        DnsCacheConfig config = {});
+
+} // namespace streaming::services
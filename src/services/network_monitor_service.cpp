@@ -0,0 +1,288 @@
+/**
+ * @file network_monitor_service.cpp
+ * @brief Network Monitor Service implementation
+ */
+
+#include "network_monitor_service.hpp"
+#include "../common/event_bus.hpp"
+#include "../common/logger.hpp"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace streaming::services {
+
+static int64_t nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+const char* bandwidthBandName(BandwidthBand band) {
+    switch (band) {
+        case BandwidthBand::OFFLINE: return "offline";
+        case BandwidthBand::UNKNOWN: return "unknown";
+        case BandwidthBand::POOR: return "poor";
+        case BandwidthBand::FAIR: return "fair";
+        case BandwidthBand::GOOD: return "good";
+        case BandwidthBand::EXCELLENT: return "excellent";
+    }
+    return "unknown";
+}
+
+class NetworkMonitorServiceImpl : public INetworkMonitorService {
+public:
+    NetworkMonitorServiceImpl(std::unique_ptr<hal::IWifiHal> wifi, NetworkMonitorConfig config)
+        : wifi_(std::move(wifi)), config_(config) {}
+
+    ~NetworkMonitorServiceImpl() override { shutdown(); }
+
+    device::Result initialize() override {
+        const device::Result r = wifi_->initialize();
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) {
+            running_ = true;
+            last_scan_us_ = nowUs();
+            worker_ = std::thread(&NetworkMonitorServiceImpl::worker, this);
+        }
+        return r;
+    }
+
+    void shutdown() override {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!running_) return;
+            running_ = false;
+        }
+        cv_.notify_all();
+        if (worker_.joinable()) worker_.join();
+        wifi_->shutdown();
+    }
+
+    void recordTransfer(uint64_t bytes, int64_t duration_us) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.transfers++;
+        if (bytes < config_.min_transfer_bytes || duration_us <= 0) {
+            stats_.transfers_ignored++;
+            return;
+        }
+        pending_bytes_ += bytes;
+        pending_us_ += duration_us;
+    }
+
+    media::SegmentLoader instrument(media::SegmentLoader loader) override {
+        return [this, loader = std::move(loader)](const media::SegmentRequest& request,
+                                                  std::vector<uint8_t>& body) {
+            const int64_t start = nowUs();
+            const device::Result r = loader(request, body);
+            if (r == device::Result::OK) recordTransfer(body.size(), nowUs() - start);
+            return r;
+        };
+    }
+
+    void setPlaybackActive(bool active) override {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (playback_active_ == active) return;
+            playback_active_ = active;
+            wake_ = !active && scan_deferred_;   /* Run the postponed scan now */
+        }
+        cv_.notify_all();
+    }
+
+    void requestScan() override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        scan_requested_ = true;
+    }
+
+    void sample() override {
+        std::lock_guard<std::mutex> sampling(sample_mutex_);
+        const int64_t now = nowUs();
+
+        NetworkSample s;
+        s.time_us = now;
+        hal::WifiLinkInfo link;
+        const bool associated = wifi_->getState() == device::WifiState::CONNECTED &&
+                                wifi_->getLinkInfo(link) == device::Result::OK;
+        if (associated) {
+            s.rssi = link.rssi;
+            s.link_rate_mbps = link.tx_rate_mbps;
+        }
+
+        bool scan = false;
+        std::vector<NetworkQualityEvent> events;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (pending_us_ > 0) {
+                s.throughput_bps = pending_bytes_ * 8 * 1000000 / static_cast<uint64_t>(pending_us_);
+                pending_bytes_ = 0;
+                pending_us_ = 0;
+            }
+            s.predicted_bps = associated ? predictLocked(s) : 0;
+            s.band = !associated ? BandwidthBand::OFFLINE
+                   : s.predicted_bps == 0 ? BandwidthBand::UNKNOWN
+                   : bandOf(s.predicted_bps);
+            updateBandLocked(s, events);
+
+            history_.push_back(s);
+            while (history_.size() > config_.history_size) history_.pop_front();
+            stats_.samples++;
+            stats_.rssi = s.rssi;
+            if (s.throughput_bps > 0) stats_.throughput_bps = s.throughput_bps;
+            stats_.predicted_bps = s.predicted_bps;
+
+            const bool due = scan_requested_ ||
+                (config_.scan_interval_us > 0 && now - last_scan_us_ >= config_.scan_interval_us);
+            if (due && playback_active_) {
+                if (!scan_deferred_) {
+                    stats_.scans_deferred++;
+                    LOG_INFO("NetMonitor", "Background scan deferred during playback");
+                }
+                scan_deferred_ = true;
+            } else if (due) {
+                scan = true;
+            }
+        }
+
+        if (scan) {
+            std::vector<hal::WifiScanResult> results;
+            const device::Result r = wifi_->scan(results);
+            std::lock_guard<std::mutex> lock(mutex_);
+            stats_.scans++;
+            last_scan_us_ = nowUs();
+            scan_requested_ = false;
+            scan_deferred_ = false;
+            if (r == device::Result::OK) last_scan_ = std::move(results);
+            else LOG_WARN("NetMonitor", "Scan failed");
+        }
+
+        for (const auto& e : events) {
+            LOG_INFO("NetMonitor", "Bandwidth", bandwidthBandName(e.previous), "->",
+                     bandwidthBandName(e.band), e.predicted_bps / 1000, "kbit/s");
+            common::EventBus::instance().publish(common::events::NETWORK_QUALITY,
+                                                 std::make_shared<NetworkQualityEvent>(e));
+        }
+    }
+
+    std::vector<NetworkSample> getHistory() const override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return {history_.begin(), history_.end()};
+    }
+
+    std::vector<hal::WifiScanResult> getLastScan() const override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return last_scan_;
+    }
+
+    NetworkMonitorStats getStats() const override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        NetworkMonitorStats stats = stats_;
+        stats.band = band_;
+        stats.playback_active = playback_active_;
+        return stats;
+    }
+
+private:
+    /**
+     * Harmonic mean of the measured throughput in the window (it weighs
+     * the slow intervals most, which is what stalls playback), or the
+     * link rate's likely goodput when nothing was downloaded lately.
+     */
+    uint64_t predictLocked(const NetworkSample& current) const {
+        std::vector<const NetworkSample*> window;
+        for (auto it = history_.rbegin();
+             it != history_.rend() && window.size() + 1 < config_.prediction_window; ++it)
+            window.push_back(&*it);
+
+        double inverse_sum = 0.0;
+        size_t measured = 0;
+        int32_t best_rssi = current.rssi;
+        auto add = [&](const NetworkSample& s) {
+            if (s.throughput_bps > 0) {
+                inverse_sum += 1.0 / static_cast<double>(s.throughput_bps);
+                ++measured;
+            }
+            if (s.rssi != 0) best_rssi = std::max(best_rssi, s.rssi);
+        };
+        add(current);
+        for (const NetworkSample* s : window) add(*s);
+
+        double bps = measured > 0
+            ? static_cast<double>(measured) / inverse_sum * config_.safety_factor
+            : current.link_rate_mbps * 1e6 * config_.phy_efficiency;
+        if (current.rssi < config_.weak_rssi_dbm) bps *= 0.5;
+        if (best_rssi - current.rssi >= config_.rssi_drop_db) bps *= 0.7;
+        return static_cast<uint64_t>(bps);
+    }
+
+    BandwidthBand bandOf(uint64_t bps) const {
+        if (bps >= config_.excellent_bps) return BandwidthBand::EXCELLENT;
+        if (bps >= config_.good_bps) return BandwidthBand::GOOD;
+        if (bps >= config_.fair_bps) return BandwidthBand::FAIR;
+        return BandwidthBand::POOR;
+    }
+
+    /** Falls are reported at once; a rise waits for a second sample in a higher band */
+    void updateBandLocked(const NetworkSample& s, std::vector<NetworkQualityEvent>& events) {
+        BandwidthBand next = s.band;
+        const bool measured = band_ >= BandwidthBand::POOR && s.band >= BandwidthBand::POOR;
+        if (measured && s.band > band_) {
+            rise_band_ = rises_++ == 0 ? s.band : std::min(rise_band_, s.band);
+            if (rises_ < 2) return;
+            next = rise_band_;
+        }
+        rises_ = 0;
+        if (next == band_) return;
+        events.push_back({next, band_, s.predicted_bps, s.rssi});
+        band_ = next;
+        stats_.band_changes++;
+    }
+
+    void worker() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (running_) {
+            cv_.wait_for(lock, std::chrono::microseconds(config_.sample_interval_us),
+                         [this] { return !running_ || wake_; });
+            if (!running_) break;
+            wake_ = false;
+            lock.unlock();
+            sample();
+            lock.lock();
+        }
+    }
+
+    std::unique_ptr<hal::IWifiHal> wifi_;
+    const NetworkMonitorConfig config_;
+
+    mutable std::mutex mutex_;
+    std::mutex sample_mutex_;              /* One sample (and HAL call) at a time */
+    std::condition_variable cv_;
+    std::thread worker_;
+    bool running_{false};
+    bool wake_{false};
+    std::deque<NetworkSample> history_;
+    uint64_t pending_bytes_{0};            /* Transfers since the last sample */
+    int64_t pending_us_{0};
+    BandwidthBand band_{BandwidthBand::OFFLINE};
+    uint32_t rises_{0};                    /* Consecutive samples above band_ */
+    BandwidthBand rise_band_{BandwidthBand::OFFLINE};
+    bool playback_active_{false};
+    bool scan_requested_{false};
+    bool scan_deferred_{false};
+    int64_t last_scan_us_{0};
+    std::vector<hal::WifiScanResult> last_scan_;
+    NetworkMonitorStats stats_;
+};
+
+std::unique_ptr<INetworkMonitorService> createNetworkMonitorService(NetworkMonitorConfig config) {
+    return std::make_unique<NetworkMonitorServiceImpl>(hal::createWifiHal(), config);
+}
+
+std::unique_ptr<INetworkMonitorService> createNetworkMonitorService(std::unique_ptr<hal::IWifiHal> wifi,
+                                                                    NetworkMonitorConfig config) {
+    return std::make_unique<NetworkMonitorServiceImpl>(std::move(wifi), config);
+}
+
+} // namespace streaming::services
@@ -0,0 +1,131 @@
+/**
+ * @file network_monitor_service.hpp
+ * @brief Network Monitor Service - link quality history and bandwidth prediction over IWifiHal
+ */
+
+#pragma once
+
+#include <streaming_device/types.hpp>
+#include "hal/wifi_hal.hpp"
+#include "media/segment_scheduler.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace streaming::services {
+
+/** Predicted bandwidth, coarse enough to act on (ladder ceiling, UI hint) */
+enum class BandwidthBand : uint8_t {
+    OFFLINE,      /* Not associated */
+    UNKNOWN,      /* Associated, nothing to predict from yet */
+    POOR,         /* Below fair_bps: SD at best */
+    FAIR,         /* HD */
+    GOOD,         /* Full HD, HDR */
+    EXCELLENT     /* 4K */
+};
+
+const char* bandwidthBandName(BandwidthBand band);
+
+/** Sampling and prediction tuning */
+struct NetworkMonitorConfig {
+    int64_t sample_interval_us{1000000};
+    size_t history_size{60};                /* Samples kept */
+    size_t prediction_window{8};            /* Recent samples the prediction looks at */
+    double safety_factor{0.8};              /* Prediction as a fraction of the harmonic mean */
+    uint64_t min_transfer_bytes{65536};     /* Smaller transfers are latency bound, not counted */
+    double phy_efficiency{0.5};             /* Link rate to goodput while nothing was downloaded */
+    int32_t weak_rssi_dbm{-75};             /* Below this the prediction is halved */
+    int32_t rssi_drop_db{6};                /* A fall this large within the window costs 30% */
+    uint64_t fair_bps{3000000};
+    uint64_t good_bps{8000000};
+    uint64_t excellent_bps{25000000};
+    int64_t scan_interval_us{300000000};    /* Background scan for roaming candidates, 0: on request only */
+};
+
+/** One sampling interval */
+struct NetworkSample {
+    int64_t time_us{0};
+    int32_t rssi{0};                        /* dBm, 0 when not associated */
+    uint32_t link_rate_mbps{0};
+    uint64_t throughput_bps{0};             /* Achieved by downloads in the interval, 0: none */
+    uint64_t predicted_bps{0};
+    BandwidthBand band{BandwidthBand::OFFLINE};
+};
+
+/** events::NETWORK_QUALITY payload, published when the band changes */
+struct NetworkQualityEvent {
+    BandwidthBand band{BandwidthBand::OFFLINE};
+    BandwidthBand previous{BandwidthBand::OFFLINE};
+    uint64_t predicted_bps{0};
+    int32_t rssi{0};
+};
+
+/** Monitor counters */
+struct NetworkMonitorStats {
+    uint64_t samples{0};
+    uint64_t transfers{0};                  /* Reported by recordTransfer() */
+    uint64_t transfers_ignored{0};          /* Under min_transfer_bytes */
+    uint64_t scans{0};
+    uint64_t scans_deferred{0};             /* Due while playback was active */
+    uint64_t band_changes{0};
+    int32_t rssi{0};
+    uint64_t throughput_bps{0};             /* Latest interval with downloads */
+    uint64_t predicted_bps{0};
+    BandwidthBand band{BandwidthBand::OFFLINE};
+    bool playback_active{false};
+};
+
+/**
+ * @brief Network Monitor Service
+ *
+ * - Samples link RSSI and PHY rate (no scan) and the throughput that
+ *   downloads actually achieved, keeping a short history
+ * - Predicts bandwidth as a discounted harmonic mean of recent
+ *   throughput, lowered further on a weak or falling signal
+ * - Publishes the band on events::NETWORK_QUALITY; drops take effect at
+ *   once, rises after two samples agree
+ * - Background scans wait while playback is active, since each one
+ *   takes the radio off channel and dents throughput
+ */
+class INetworkMonitorService {
+public:
+    virtual ~INetworkMonitorService() = default;
+
+    /** Initialize Wi-Fi HAL, start the sampling worker */
+    virtual device::Result initialize() = 0;
+
+    /** Stop the worker */
+    virtual void shutdown() = 0;
+
+    /** A download of bytes that took duration_us (request to last byte) */
+    virtual void recordTransfer(uint64_t bytes, int64_t duration_us) = 0;
+
+    /** loader, with every successful fetch reported to recordTransfer() */
+    virtual media::SegmentLoader instrument(media::SegmentLoader loader) = 0;
+
+    /** Streaming is connecting, buffering or playing: background scans wait */
+    virtual void setPlaybackActive(bool active) = 0;
+
+    /** Scan at the next sample the playback state allows */
+    virtual void requestScan() = 0;
+
+    /** Sample now; the worker calls this every sample_interval_us */
+    virtual void sample() = 0;
+
+    /** Oldest first */
+    virtual std::vector<NetworkSample> getHistory() const = 0;
+
+    /** Result of the latest background scan */
+    virtual std::vector<hal::WifiScanResult> getLastScan() const = 0;
+
+    virtual NetworkMonitorStats getStats() const = 0;
+};
+
+std::unique_ptr<INetworkMonitorService> createNetworkMonitorService(NetworkMonitorConfig config = {});
+
+/** As above over a given Wi-Fi HAL (tests, shared network stacks); the monitor initializes and shuts it down */
+std::unique_ptr<INetworkMonitorService> createNetworkMonitorService(std::unique_ptr<hal::IWifiHal> wifi,
+                                                                    NetworkMonitorConfig config = {});
+
+} // namespace streaming::services
@@ -0,0 +1,984 @@
+/**
+ * @file playback_engine.cpp
+ * @brief PlaybackEngine implementation
+ */
+
+#include "playback_engine.hpp"
+#include "../common/logger.hpp"
+#include <algorithm>
+#include <chrono>
+#include <deque>
+
+namespace streaming::services {
+
+namespace {
+
+constexpr uint32_t kVblankTimeoutMs = 50;
+constexpr uint32_t kYieldSpins = 8;          /* Yield this many times before sleeping */
+constexpr int64_t kMaxBackoffUs = 2000;
+constexpr uint32_t kIdleMs = 2;              /* Poll period of a paused or pathless audio stage */
+constexpr size_t kTrickLookahead = 2;        /* Keyframes queued ahead of decode in trick play */
+
+int64_t nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void raiseHighWater(std::atomic<size_t>& high_water, size_t depth) {
+    size_t prev = high_water.load(std::memory_order_relaxed);
+    while (depth > prev &&
+           !high_water.compare_exchange_weak(prev, depth, std::memory_order_relaxed)) {}
+}
+
+} // namespace
+
+void PlaybackEngine::StageCounters::reset() {
+    items = 0;
+    busy_us = 0;
+    stall_us = 0;
+    starve_us = 0;
+    high_water = 0;
+}
+
+void PlaybackEngine::QueueLevel::add(const media::EncodedPacket& packet) {
+    duration_us.fetch_add(packet.timing.duration_us, std::memory_order_relaxed);
+    bytes.fetch_add(packet.data.size(), std::memory_order_relaxed);
+}
+
+void PlaybackEngine::QueueLevel::remove(const media::EncodedPacket& packet) {
+    duration_us.fetch_sub(packet.timing.duration_us, std::memory_order_relaxed);
+    bytes.fetch_sub(packet.data.size(), std::memory_order_relaxed);
+}
+
+void PlaybackEngine::QueueLevel::reset() {
+    duration_us = 0;
+    bytes = 0;
+}
+
+PlaybackEngine::PlaybackEngine(IContainerService& container,
+                               hal::IDisplayHal& display,
+                               hal::IVideoPipeline& video,
+                               hal::IAudioHal& audio,
+                               media::PresentationScheduler& scheduler,
+                               PlaybackEngineConfig config)
+    : container_(container)
+    , display_(display)
+    , video_(video)
+    , audio_(audio)
+    , scheduler_(scheduler)
+    , config_(config)
+    , packet_queue_(config.packet_queue_depth)
+    , frame_queue_(config.frame_queue_depth)
+    , audio_queue_(config.audio_queue_depth) {}
+
+PlaybackEngine::~PlaybackEngine() { stop(); }
+
+void PlaybackEngine::setAudioTrack(hal::IAudioDecoder* decoder, const media::TrackMetadata& track) {
+    if (running_) return;
+    audio_decoder_ = decoder;
+    audio_track_ = track;
+    buildAudioPath(planAudioPath(audio_.getSink()));
+}
+
+bool PlaybackEngine::canPassthrough(const media::AudioTrackInfo& track, hal::AudioSink sink) const {
+    const hal::AudioSinkCapabilities caps = audio_.getSinkCapabilities(sink);
+    return (track.codec == media::AudioCodec::AC3 && caps.ac3_passthrough) ||
+           (track.codec == media::AudioCodec::EAC3 && caps.eac3_passthrough);
+}
+
+void PlaybackEngine::setAudioDecoder(hal::IAudioDecoder* decoder) {
+    audio_decoder_ = decoder;
+}
+
+PlaybackEngine::AudioPath PlaybackEngine::planAudioPath(hal::AudioSink sink) const {
+    AudioPath path;
+    const media::AudioTrackInfo& in = audio_track_.audio;
+    if (in.sample_rate == 0 || in.channels == 0) return path;
+
+    /* Bitstream passthrough: the receiver decodes, nothing runs here but the packer */
+    if (canPassthrough(in, sink)) {
+        path.enabled = true;
+        path.passthrough = true;
+        return path;
+    }
+    const hal::AudioSinkCapabilities caps = audio_.getSinkCapabilities(sink);
+    if (!audio_decoder_) return path;
+
+    /* PCM: native if accepted, else 48 kHz (or the sink's first rate) and stereo */
+    path.enabled = true;
+    path.rate = in.sample_rate;
+    path.channels = in.channels;
+    if (!caps.sample_rates.empty() && !caps.supportsRate(path.rate))
+        path.rate = caps.supportsRate(48000) ? 48000 : caps.sample_rates.front();
+    if (path.channels > caps.max_channels) path.channels = 2;
+    if (!media::AudioConverter::isSupported(in.sample_rate, in.channels, path.rate, path.channels)) {
+        LOG_WARN("PlaybackEngine", "No conversion to the sink format, playing native audio");
+        path.rate = in.sample_rate;
+        path.channels = in.channels;
+    }
+    return path;
+}
+
+void PlaybackEngine::buildAudioPath(const AudioPath& path) {
+    const media::AudioTrackInfo& in = audio_track_.audio;
+    audio_path_ = path;
+    audio_track_id_ = path.enabled ? audio_track_.track_id : 0;
+    pcm_ring_.reset();
+    converter_.reset();
+    packer_.reset();
+    clock_.setOutputLatency(path.enabled ? audio_.getOutputLatencyUs(audio_.getSink()) : 0);
+    if (!path.enabled) return;
+
+    if (path.passthrough) {
+        packer_ = std::make_unique<media::Iec61937Packer>(in.codec, in.sample_rate);
+        const uint32_t rate = packer_->getOutputRate();
+        const uint32_t burst = packer_->getBurstFrames();
+        /* Same buffering time as PCM, one burst per period */
+        const auto periods = static_cast<uint32_t>(
+            static_cast<int64_t>(config_.audio_ring_periods) * config_.audio_period_us * rate /
+            (static_cast<int64_t>(burst) * 1000000));
+        sink_format_ = in.codec == media::AudioCodec::AC3 ? hal::AudioFormat::AC3
+                                                          : hal::AudioFormat::EAC3;
+        pcm_ring_ = std::make_unique<media::PcmRing>(burst, std::max<uint32_t>(periods, 4), 2, rate);
+        LOG_INFO("PlaybackEngine", "Passing audio through as IEC 61937 at", rate, "Hz");
+        return;
+    }
+
+    if (path.rate != in.sample_rate || path.channels != in.channels) {
+        converter_ = std::make_unique<media::AudioConverter>(in.sample_rate, in.channels,
+                                                             path.rate, path.channels);
+        LOG_INFO("PlaybackEngine", "Converting audio", in.sample_rate, "Hz", in.channels,
+                 "ch to", path.rate, "Hz", path.channels, "ch for the sink");
+    }
+    sink_format_ = path.channels == 2 ? hal::AudioFormat::PCM_16BIT_STEREO
+                                      : hal::AudioFormat::PCM_16BIT_MULTICHANNEL;
+    const auto period_frames = static_cast<uint32_t>(
+        static_cast<int64_t>(path.rate) * config_.audio_period_us / 1000000);
+    pcm_ring_ = std::make_unique<media::PcmRing>(period_frames, config_.audio_ring_periods,
+                                                 path.channels, path.rate);
+}
+
+device::Result PlaybackEngine::setAudioSink(hal::AudioSink sink) {
+    if (!output_attached_) return device::Result::ERROR_BUSY;
+    const AudioPath path = planAudioPath(sink);
+    if (!running_ || path == audio_path_) {
+        /* Same format: the HAL reroutes queued audio, only the latency changes */
+        const device::Result r = audio_.setSink(sink);
+        if (r != device::Result::OK) return r;
+        if (!running_) buildAudioPath(path);
+        else clock_.setOutputLatency(audio_path_.enabled ? audio_.getOutputLatencyUs(sink) : 0);
+        return device::Result::OK;
+    }
+
+    /* New format: park the stages, drop decoded audio and rebuild the audio path.
+     * Video keeps its queues; the clock resyncs to the first audio on the new sink. */
+    quiesce();
+    audio_.stop();
+    const device::Result r = audio_.setSink(sink);
+    if (audio_decoder_) audio_decoder_->flush();
+    buildAudioPath(r == device::Result::OK ? path : planAudioPath(audio_.getSink()));
+    resume();
+    return r;
+}
+
+device::Result PlaybackEngine::start(hal::ICodecDecoder& decoder,
+                                     std::shared_ptr<media::FramePool> pool,
+                                     uint32_t video_track_id) {
+    if (running_) return device::Result::ERROR_BUSY;
+    if (!pool) return device::Result::ERROR_INVALID_PARAM;
+
+    decoder_ = &decoder;
+    pool_ = std::move(pool);
+    video_track_id_ = video_track_id;
+    decoder_->setOutputPool(pool_);
+
+    for (auto& c : counters_) c.reset();
+    stopping_ = false;
+    barrier_ = false;
+    parked_ = 0;
+    paused_ = true;
+    demux_eos_ = false;
+    decode_eos_ = false;
+    audio_eos_ = false;
+    eos_signalled_ = false;
+    discard_before_us_ = -1;
+    discarded_frames_ = 0;
+    rate_ = 1;
+    trick_cursor_ = 0;
+    started_us_ = nowUs();
+    prerolled_us_ = 0;
+    first_play_us_ = 0;
+    first_frame_us_ = 0;
+    clock_.reset(0);
+    clock_.setSpeed(1, nowUs());
+    clock_.setPaused(true, nowUs());
+    current_pts_ = 0;
+    audio_writes_ = 0;
+    audio_bytes_ = 0;
+    video_queued_.reset();
+    audio_queued_.reset();
+    frame_us_ = 0;
+    frame_bytes_ = 0;
+    packet_memory_ = common::MemoryGovernor::instance().registerPool(
+        "packet queues", common::MemoryClass::QUEUE, config_.packet_memory_bytes, config_.packet_memory_min_bytes);
+    if (output_attached_) audio_.setPaused(true);
+
+    running_ = true;
+    threads_[kDemux] = std::thread(&PlaybackEngine::demuxLoop, this);
+    threads_[kDecode] = std::thread(&PlaybackEngine::decodeLoop, this);
+    threads_[kPresent] = std::thread(&PlaybackEngine::presentLoop, this);
+    stage_count_ = 3;
+    if (audio_track_.audio.sample_rate != 0) {
+        /* Audio stages exist for any audio track; they idle while a sink has no path for it */
+        threads_[kAudio] = std::thread(&PlaybackEngine::audioLoop, this);
+        threads_[kSink] = std::thread(&PlaybackEngine::sinkLoop, this);
+        stage_count_ = 5;
+    }
+    LOG_DEBUG("PlaybackEngine", "Started", stage_count_, "stages, packet queue",
+              packet_queue_.capacity(), "frame queue", frame_queue_.capacity());
+    return device::Result::OK;
+}
+
+bool PlaybackEngine::isPrerolled() const {
+    if (decode_eos_.load(std::memory_order_acquire)) return true;   /* Nothing more will come */
+    if (frame_queue_.empty() && scheduler_.getQueuedFrames() == 0) return false;
+    if (packet_queue_.size() < config_.preroll_packets && !demux_eos_.load(std::memory_order_acquire))
+        return false;
+    media::PcmRing* ring = pcm_ring_.get();
+    return !ring || ring->getFillPeriods() > 0 || audio_eos_.load(std::memory_order_acquire);
+}
+
+device::Result PlaybackEngine::preroll(uint32_t timeout_ms) {
+    if (!running_) return device::Result::ERROR_BUSY;
+    const int64_t deadline = nowUs() + static_cast<int64_t>(timeout_ms) * 1000;
+    while (!isPrerolled()) {
+        if (nowUs() >= deadline) {
+            LOG_WARN("PlaybackEngine", "Pre-roll timed out after", timeout_ms, "ms");
+            return device::Result::ERROR_TIMEOUT;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    const int64_t prerolled = nowUs();
+    prerolled_us_ = prerolled;
+    LOG_DEBUG("PlaybackEngine", "Pre-rolled in", prerolled - started_us_.load(), "us");
+    return device::Result::OK;
+}
+
+void PlaybackEngine::stop() {
+    if (!running_) return;
+    {
+        std::lock_guard<std::mutex> lock(barrier_mutex_);
+        stopping_ = true;
+    }
+    barrier_cv_.notify_all();
+    const bool attached = output_attached_;
+    if (attached) audio_.stop();   /* Unblocks an audio stage waiting in play() */
+    for (auto& t : threads_)
+        if (t.joinable()) t.join();
+
+    drainQueues();
+    if (attached) {
+        audio_.stop();
+        audio_.setPaused(false);
+        video_.reset();  /* Returns the buffer on the plane to the pool */
+    }
+    decoder_->setOutputPool(nullptr);
+    decoder_ = nullptr;
+    pool_.reset();
+    packet_memory_ = {};
+    running_ = false;
+    stopping_ = false;
+    barrier_ = false;
+    parked_ = 0;
+}
+
+void PlaybackEngine::setOutputAttached(bool attached) {
+    if (attached == output_attached_) return;
+    if (attached) {
+        /* Taking over from another item: its queued tail would skew the audio clock */
+        audio_.stop();
+        audio_.setPaused(paused_.load(std::memory_order_acquire));
+    }
+    output_attached_.store(attached, std::memory_order_release);
+}
+
+void PlaybackEngine::setPaused(bool paused) {
+    int64_t none = 0;
+    if (!paused) first_play_us_.compare_exchange_strong(none, nowUs());
+    if (output_attached_) audio_.setPaused(paused);
+    clock_.setPaused(paused, nowUs());
+    paused_.store(paused, std::memory_order_release);
+}
+
+device::Result PlaybackEngine::seek(int64_t timestamp_us, media::SeekMode mode) {
+    if (!running_) return device::Result::ERROR_BUSY;
+
+    quiesce();
+    drainQueues();
+    if (output_attached_) audio_.stop();
+    const device::Result r = container_.seek(timestamp_us);
+    decoder_->flush();
+    if (audio_decoder_) audio_decoder_->flush();
+    if (converter_) converter_->reset();
+    if (packer_) packer_->reset();
+    demux_eos_ = false;
+    decode_eos_ = false;
+    audio_eos_ = false;
+    eos_signalled_ = false;
+    discard_before_us_ = mode == media::SeekMode::EXACT ? timestamp_us : -1;
+    trick_cursor_ = timestamp_us;
+    clock_.reset(timestamp_us);
+    current_pts_ = timestamp_us;
+    resume();
+    return r;
+}
+
+device::Result PlaybackEngine::setPlaybackRate(int32_t rate) {
+    const int32_t magnitude = rate < 0 ? -rate : rate;
+    if (rate != 1 && (magnitude < 2 || magnitude > kMaxTrickRate))
+        return device::Result::ERROR_INVALID_PARAM;
+    if (!running_) return device::Result::ERROR_BUSY;
+    if (rate == rate_) return device::Result::OK;
+
+    /* Restart from the frame on screen in the new mode: the container is
+     * repositioned for full-rate decode, and the keyframe cursor for trick play */
+    const int64_t pts = current_pts_.load(std::memory_order_relaxed);
+    quiesce();
+    drainQueues();
+    if (output_attached_) audio_.stop();
+    const device::Result r = container_.seek(pts);
+    decoder_->flush();
+    if (audio_decoder_) audio_decoder_->flush();
+    if (converter_) converter_->reset();
+    if (packer_) packer_->reset();
+    demux_eos_ = false;
+    decode_eos_ = false;
+    audio_eos_ = false;
+    eos_signalled_ = false;
+    discard_before_us_ = -1;
+    trick_cursor_ = pts;
+    rate_ = rate;
+    clock_.reset(pts);
+    clock_.setSpeed(rate, nowUs());
+    resume();
+    LOG_INFO("PlaybackEngine", "Playback rate", rate, "x from pts", pts);
+    return r;
+}
+
+PipelineStats PlaybackEngine::getStats() const {
+    PipelineStats stats;
+    StageStats* out[kStageCount] = {&stats.demux, &stats.decode, &stats.present,
+                                    &stats.audio, &stats.sink};
+    for (int i = 0; i < kStageCount; ++i) {
+        out[i]->items = counters_[i].items.load(std::memory_order_relaxed);
+        out[i]->busy_us = counters_[i].busy_us.load(std::memory_order_relaxed);
+        out[i]->stall_us = counters_[i].stall_us.load(std::memory_order_relaxed);
+        out[i]->starve_us = counters_[i].starve_us.load(std::memory_order_relaxed);
+        out[i]->queue_high_water = counters_[i].high_water.load(std::memory_order_relaxed);
+    }
+    stats.demux.queue_depth = packet_queue_.size();
+    stats.decode.queue_depth = frame_queue_.size();
+    stats.present.queue_depth = scheduler_.getQueuedFrames();
+    stats.audio.queue_depth = audio_queue_.size();
+    stats.audio_out.writes = audio_writes_.load(std::memory_order_relaxed);
+    stats.audio_out.bytes = audio_bytes_.load(std::memory_order_relaxed);
+    if (pcm_ring_) {
+        const media::PcmRingStats ring = pcm_ring_->getStats();
+        stats.audio_out.ring_fill_periods = pcm_ring_->getFillPeriods();
+        stats.audio_out.ring_capacity_periods = pcm_ring_->getPeriodCount();
+        stats.audio_out.ring_high_water = ring.high_water;
+        stats.audio_out.ring_fill_us = pcm_ring_->getFillUs();
+        stats.audio_out.underruns = ring.underruns;
+        stats.sink.queue_depth = stats.audio_out.ring_fill_periods;
+        stats.sink.queue_high_water = ring.high_water;
+        stats.audio_out.sink_sample_rate = pcm_ring_->getSampleRate();
+        stats.audio_out.sink_channels = pcm_ring_->getChannels();
+        stats.audio_out.converted = converter_ != nullptr;
+        stats.audio_out.passthrough = packer_ != nullptr;
+    }
+    stats.clock = clock_.getStats();
+    {
+        std::lock_guard<std::mutex> lock(overlay_mutex_);
+        stats.overlay = compositor_.getStats();
+    }
+    stats.seek.discarded_frames = discarded_frames_.load(std::memory_order_relaxed);
+
+    const int64_t play = first_play_us_.load(std::memory_order_relaxed);
+    const int64_t frame = first_frame_us_.load(std::memory_order_relaxed);
+    const int64_t started = started_us_.load(std::memory_order_relaxed);
+    const int64_t prerolled = prerolled_us_.load(std::memory_order_relaxed);
+    stats.startup.prerolled = prerolled != 0;
+    if (prerolled != 0) stats.startup.preroll_us = prerolled - started;
+    if (frame != 0) {
+        stats.startup.ttff_us = frame - started;
+        if (play != 0) stats.startup.play_to_frame_us = std::max<int64_t>(frame - play, 0);
+    }
+    return stats;
+}
+
+media::BufferSnapshot PlaybackEngine::getBufferSnapshot() const {
+    media::BufferSnapshot snap;
+    media::BufferOccupancy& video_demux = snap.video.at(media::BufferLevel::DEMUX);
+    video_demux.duration_us = std::max<int64_t>(video_queued_.duration_us.load(std::memory_order_relaxed), 0);
+    video_demux.bytes = video_queued_.bytes.load(std::memory_order_relaxed);
+    /* Decoded frames are uniform in duration and size, so count them */
+    const size_t frames = frame_queue_.size() + scheduler_.getQueuedFrames();
+    media::BufferOccupancy& video_decoded = snap.video.at(media::BufferLevel::DECODED);
+    video_decoded.duration_us = static_cast<int64_t>(frames) * frame_us_.load(std::memory_order_relaxed);
+    video_decoded.bytes = frames * frame_bytes_.load(std::memory_order_relaxed);
+
+    if (const media::PcmRing* ring = pcm_ring_.get()) {
+        snap.has_audio = true;
+        media::BufferOccupancy& audio_demux = snap.audio.at(media::BufferLevel::DEMUX);
+        audio_demux.duration_us = std::max<int64_t>(audio_queued_.duration_us.load(std::memory_order_relaxed), 0);
+        audio_demux.bytes = audio_queued_.bytes.load(std::memory_order_relaxed);
+        media::BufferOccupancy& audio_decoded = snap.audio.at(media::BufferLevel::DECODED);
+        audio_decoded.duration_us = ring->getFillUs();
+        audio_decoded.bytes = static_cast<uint64_t>(ring->getFillPeriods()) * ring->getPeriodFrames() *
+                              ring->getChannels() * sizeof(int16_t);
+    }
+    snap.end_of_stream = demux_eos_.load(std::memory_order_acquire);
+    snap.saturated = packet_queue_.full() || audio_queue_.full() ||
+                     video_demux.bytes + snap.audio.at(media::BufferLevel::DEMUX).bytes >= packet_memory_.getLimit();
+    return snap;
+}
+
+// -----------------------------------------------------------------------------
+// Barrier
+// -----------------------------------------------------------------------------
+
+bool PlaybackEngine::interrupted() const {
+    return stopping_.load(std::memory_order_acquire) || barrier_.load(std::memory_order_acquire);
+}
+
+void PlaybackEngine::parkIfRequested() {
+    std::unique_lock<std::mutex> lock(barrier_mutex_);
+    if (!barrier_ || stopping_) return;
+    ++parked_;
+    barrier_cv_.notify_all();
+    barrier_cv_.wait(lock, [this] { return !barrier_ || stopping_; });
+    --parked_;
+    barrier_cv_.notify_all();
+}
+
+void PlaybackEngine::quiesce() {
+    std::unique_lock<std::mutex> lock(barrier_mutex_);
+    barrier_ = true;
+    lock.unlock();
+    if (output_attached_) audio_.stop();   /* Unblocks an audio stage waiting in play() */
+    lock.lock();
+    barrier_cv_.wait(lock, [this] { return parked_ == stage_count_; });
+}
+
+void PlaybackEngine::resume() {
+    std::unique_lock<std::mutex> lock(barrier_mutex_);
+    barrier_ = false;
+    barrier_cv_.notify_all();
+    /* Wait for everyone to leave so a back-to-back seek counts fresh arrivals */
+    barrier_cv_.wait(lock, [this] { return parked_ == 0; });
+}
+
+bool PlaybackEngine::backoff(uint32_t& spins, std::atomic<int64_t>& counter) {
+    if (interrupted()) return false;
+    const int64_t t0 = nowUs();
+    if (spins < kYieldSpins) {
+        std::this_thread::yield();
+    } else {
+        const int64_t us = std::min<int64_t>(kMaxBackoffUs, 50LL << std::min<uint32_t>(spins - kYieldSpins, 6));
+        std::this_thread::sleep_for(std::chrono::microseconds(us));
+    }
+    ++spins;
+    counter.fetch_add(nowUs() - t0, std::memory_order_relaxed);
+    return !interrupted();
+}
+
+void PlaybackEngine::recycle(const media::DecodedFrame& frame) {
+    if (pool_ && frame.handle.valid()) pool_->release(frame.handle);
+}
+
+bool PlaybackEngine::keyframesOnly() const {
+    const int32_t rate = rate_.load(std::memory_order_relaxed);
+    return rate < 0 || rate >= kKeyframeOnlyRate;
+}
+
+bool PlaybackEngine::overMemoryLimit() {
+    const uint64_t bytes = video_queued_.bytes.load(std::memory_order_relaxed) +
+                           audio_queued_.bytes.load(std::memory_order_relaxed);
+    packet_memory_.setUsage(bytes);
+    return bytes > packet_memory_.getLimit();
+}
+
+bool PlaybackEngine::discardBeforeTarget(const media::DecodedFrame& frame) {
+    if (frame.timing.pts >= discard_before_us_.load(std::memory_order_relaxed)) return false;
+    recycle(frame);
+    discarded_frames_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void PlaybackEngine::drainQueues() {
+    media::EncodedPacket packet;
+    while (packet_queue_.tryPop(packet)) {}
+    media::DecodedFrame frame;
+    while (frame_queue_.tryPop(frame)) recycle(frame);
+    while (audio_queue_.tryPop(packet)) {}
+    video_queued_.reset();
+    audio_queued_.reset();
+    if (pcm_ring_) pcm_ring_->reset();
+    for (const auto& f : scheduler_.flush()) recycle(f);
+}
+
+// -----------------------------------------------------------------------------
+// Stages
+// -----------------------------------------------------------------------------
+
+void PlaybackEngine::demuxLoop() {
+    StageCounters& c = counters_[kDemux];
+    media::EncodedPacket packet;
+    common::SpscQueue<media::EncodedPacket>* target = nullptr;
+    bool pending = false;
+    uint32_t spins = 0;
+
+    while (!stopping_) {
+        if (barrier_) {
+            pending = false;  /* Stale after a seek */
+            parkIfRequested();
+            continue;
+        }
+        if (!pending) {
+            if (demux_eos_) {
+                backoff(spins, c.starve_us);
+                continue;
+            }
+            const bool trick = keyframesOnly();
+            if (trick && packet_queue_.size() >= kTrickLookahead) {
+                /* Read late so the next keyframe is picked against the current clock */
+                backoff(spins, c.stall_us);
+                continue;
+            }
+            const int64_t t0 = nowUs();
+            device::Result r;
+            if (trick) {
+                /* Next keyframe past both the last one read and the clock:
+                 * keyframes the clock has already passed are never read */
+                const bool forward = rate_.load(std::memory_order_relaxed) > 0;
+                int64_t from = trick_cursor_.load(std::memory_order_relaxed);
+                if (clock_.isRunning()) {
+                    const int64_t now = clock_.getTime(nowUs());
+                    from = forward ? std::max(from, now) : std::min(from, now);
+                }
+                r = container_.readKeyframe(from, forward, packet);
+                if (r == device::Result::OK) trick_cursor_.store(packet.timing.pts, std::memory_order_relaxed);
+            } else {
+                r = container_.readPacket(packet);
+            }
+            c.busy_us.fetch_add(nowUs() - t0, std::memory_order_relaxed);
+            if (r == device::Result::ERROR_END_OF_STREAM) {
+                demux_eos_.store(true, std::memory_order_release);
+                continue;
+            }
+            if (r != device::Result::OK) {
+                backoff(spins, c.starve_us);  /* Source has nothing yet */
+                continue;
+            }
+            /* Audio is muted away from 1x */
+            if (packet.track_id == video_track_id_) target = &packet_queue_;
+            else if (audio_track_id_ != 0 && packet.track_id == audio_track_id_ &&
+                     rate_.load(std::memory_order_relaxed) == 1) target = &audio_queue_;
+            else continue;
+            pending = true;
+            spins = 0;
+            c.items.fetch_add(1, std::memory_order_relaxed);
+            /* Counted before the push: the consumer may pop it at once */
+            (target == &packet_queue_ ? video_queued_ : audio_queued_).add(packet);
+        }
+        /* Over the memory limit counts as full, but an empty queue always takes one */
+        if (overMemoryLimit() && !target->empty()) {
+            backoff(spins, c.stall_us);
+            continue;
+        }
+        if (target->tryPush(std::move(packet))) {
+            pending = false;
+            spins = 0;
+            raiseHighWater(c.high_water, target->size());
+        } else {
+            backoff(spins, c.stall_us);
+        }
+    }
+}
+
+void PlaybackEngine::decodeLoop() {
+    StageCounters& c = counters_[kDecode];
+    media::EncodedPacket packet;
+    bool have_packet = false;
+    std::deque<media::DecodedFrame> out;  /* Decoded, not yet queued */
+    uint32_t spins = 0;
+
+    while (!stopping_) {
+        if (barrier_) {
+            have_packet = false;
+            for (const auto& f : out) recycle(f);
+            out.clear();
+            parkIfRequested();
+            continue;
+        }
+
+        if (!out.empty()) {
+            if (frame_queue_.tryPush(out.front())) {
+                out.pop_front();
+                spins = 0;
+                raiseHighWater(c.high_water, frame_queue_.size());
+            } else {
+                backoff(spins, c.stall_us);
+            }
+            continue;
+        }
+
+        if (!have_packet) {
+            /* Read the EOS flag before checking the queue: demux sets it after its last push */
+            const bool upstream_done = demux_eos_.load(std::memory_order_acquire);
+            if (!packet_queue_.tryPop(packet)) {
+                if (upstream_done && !decode_eos_) {
+                    decoder_->drain([&](const hal::DecodeResult& r) {
+                        if (r.frame_ready && !discardBeforeTarget(r.frame)) out.push_back(r.frame);
+                    });
+                    if (out.empty()) decode_eos_.store(true, std::memory_order_release);
+                    continue;
+                }
+                backoff(spins, c.starve_us);
+                continue;
+            }
+            spins = 0;
+            video_queued_.remove(packet);
+            if (!packet.is_keyframe && keyframesOnly()) continue;
+            have_packet = true;
+        }
+
+        const int64_t t0 = nowUs();
+        hal::DecodeResult result = decoder_->decodeFrame(packet);
+        c.busy_us.fetch_add(nowUs() - t0, std::memory_order_relaxed);
+
+        if (result.status == device::Result::ERROR_BUSY) {
+            backoff(spins, c.stall_us);  /* Every pool buffer is queued or on screen */
+            continue;
+        }
+        have_packet = false;
+        if (result.status != device::Result::OK) {
+            LOG_WARN("PlaybackEngine", "Decode error", static_cast<int>(result.decode_error),
+                     "at pts", packet.timing.pts);
+            continue;
+        }
+        if (result.frame_ready) {
+            c.items.fetch_add(1, std::memory_order_relaxed);
+            if (packet.timing.duration_us > 0) frame_us_.store(packet.timing.duration_us, std::memory_order_relaxed);
+            frame_bytes_.store(result.frame.size, std::memory_order_relaxed);
+            if (!discardBeforeTarget(result.frame)) out.push_back(result.frame);
+        }
+    }
+    for (const auto& f : out) recycle(f);
+}
+
+void PlaybackEngine::presentLoop() {
+    StageCounters& c = counters_[kPresent];
+    const auto pool = pool_;
+    bool have_start = false;
+    int64_t start_pts = 0;
+
+    while (!stopping_) {
+        if (barrier_) {
+            have_start = false;
+            parkIfRequested();
+            continue;
+        }
+
+        hal::VblankInfo vblank;
+        if (display_.waitForVblank(vblank, kVblankTimeoutMs) != device::Result::OK) continue;
+        const int64_t t0 = nowUs();
+        c.items.fetch_add(1, std::memory_order_relaxed);
+
+        /* Move decoded frames into the scheduler as far as it has room. In
+         * reverse the scheduler sees negated pts, so it still runs forward */
+        const bool clock_running = clock_.isRunning();
+        const bool reverse = rate_.load(std::memory_order_relaxed) < 0;
+        media::DecodedFrame frame;
+        while (media::DecodedFrame* next = frame_queue_.front()) {
+            media::DecodedFrame queued = *next;
+            if (reverse) queued.timing.pts = -queued.timing.pts;
+            if (!scheduler_.queueFrame(queued)) break;
+            if (!clock_running && (!have_start || queued.timing.pts < start_pts)) {
+                start_pts = queued.timing.pts;
+                have_start = true;
+            }
+            frame_queue_.tryPop(frame);
+        }
+        raiseHighWater(c.high_water, scheduler_.getQueuedFrames());
+
+        /* Detached, the frames wait like paused ones: the plane belongs to another item */
+        if (paused_.load(std::memory_order_acquire) || !output_attached_.load(std::memory_order_acquire)) {
+            c.busy_us.fetch_add(nowUs() - t0, std::memory_order_relaxed);
+            continue;
+        }
+
+        if (!clock_running) {
+            if (!have_start) {
+                c.starve_us.fetch_add(scheduler_.getVsyncPeriodUs(), std::memory_order_relaxed);
+                continue;
+            }
+            /* Start the clock on the first frame so it is shown at this vblank */
+            clock_.start(reverse ? -start_pts : start_pts, vblank.timestamp_us);
+            have_start = false;
+        }
+
+        if (clock_.getMode() == media::ClockMode::AUDIO_MASTER) {
+            hal::AudioRenderPosition pos;
+            if (audio_.getRenderPosition(pos) == device::Result::OK)
+                clock_.updateAudioPosition(pos.pts_us, pos.timestamp_us);
+        }
+        const media::Pts clock_time = clock_.getTime(vblank.timestamp_us);
+        const media::Pts media_time = reverse ? -clock_time : clock_time;
+
+        media::VsyncDecision decision = scheduler_.onVblank(media_time);
+        for (const auto& f : decision.dropped) recycle(f);
+
+        if (decision.action == media::VsyncAction::PRESENT) {
+            if (reverse) decision.frame.timing.pts = -decision.frame.timing.pts;
+            int64_t none = 0;
+            first_frame_us_.compare_exchange_strong(none, nowUs());
+            current_pts_.store(decision.frame.timing.pts, std::memory_order_relaxed);
+            compositeOverlay(decision.frame);
+            video_.scanoutFrame(decision.frame, [pool](const media::BufferHandle& h) {
+                pool->release(h);
+            });
+        } else if (scheduler_.getQueuedFrames() == 0) {
+            /* The flag is read first: a frame pushed before it was set is then seen by empty() */
+            const bool decoded_all = decode_eos_.load(std::memory_order_acquire);
+            if (frame_queue_.empty()) {
+                if (decoded_all) {
+                    if (!eos_signalled_.exchange(true) && eos_cb_) eos_cb_();
+                } else {
+                    c.starve_us.fetch_add(scheduler_.getVsyncPeriodUs(), std::memory_order_relaxed);
+                }
+            }
+        }
+        c.busy_us.fetch_add(nowUs() - t0, std::memory_order_relaxed);
+    }
+}
+
+void PlaybackEngine::setOverlay(std::shared_ptr<const media::OverlayImage> overlay) {
+    std::lock_guard<std::mutex> lock(overlay_mutex_);
+    overlay_ = std::move(overlay);
+    if (!overlay_) {
+        scaled_from_.reset();
+        scaled_overlay_ = {};
+    }
+}
+
+void PlaybackEngine::compositeOverlay(const media::DecodedFrame& frame) {
+    std::lock_guard<std::mutex> lock(overlay_mutex_);
+    if (!overlay_ || !frame.data) return;
+    if (frame.format != media::PixelFormat::RGBA8888 && frame.format != media::PixelFormat::BGRA8888) return;
+    const bool fits = overlay_->width == frame.width && overlay_->height == frame.height &&
+        overlay_->pixels.size() >= static_cast<size_t>(frame.width) * frame.height * 4;
+    if (fits) {
+        scaled_from_.reset();
+        std::vector<uint8_t>().swap(scaled_overlay_.pixels);
+    } else if (scaled_from_ != overlay_ || scaled_overlay_.width != frame.width ||
+               scaled_overlay_.height != frame.height) {
+        /* Rescaled once per overlay and frame size; a malformed one is logged once */
+        scaled_from_ = overlay_;
+        if (compositor_.scale(*overlay_, frame.width, frame.height, scaled_overlay_) != device::Result::OK) {
+            LOG_WARN("PlaybackEngine", "Overlay not shown, bad", overlay_->width, "x", overlay_->height, "image");
+            scaled_overlay_ = {};
+            scaled_overlay_.width = frame.width;   /* Pixel-less: skipped below, not retried */
+            scaled_overlay_.height = frame.height;
+        }
+    }
+    const media::OverlayImage& ui = scaled_from_ ? scaled_overlay_ : *overlay_;
+    if (ui.width != frame.width || ui.height != frame.height ||
+        ui.pixels.size() < static_cast<size_t>(ui.width) * ui.height * 4)
+        return;
+    const media::Surface layer{const_cast<uint8_t*>(ui.pixels.data()), ui.width, ui.height, ui.width * 4};
+    media::Surface video{static_cast<uint8_t*>(frame.data), frame.width, frame.height, frame.stride};
+    compositor_.blend(layer, ui.mode, video);
+}
+
+void PlaybackEngine::audioLoop() {
+    StageCounters& c = counters_[kAudio];
+    media::EncodedPacket packet;
+    media::DecodedAudio pcm;
+    size_t written = 0;        /* Frames of pcm already in the ring */
+    bool have_pcm = false;
+    uint32_t spins = 0;
+
+    while (!stopping_) {
+        if (barrier_) {
+            have_pcm = false;
+            parkIfRequested();
+            continue;
+        }
+        if (!pcm_ring_) {   /* The current sink has no path for this track */
+            std::this_thread::sleep_for(std::chrono::milliseconds(kIdleMs));
+            continue;
+        }
+        media::PcmRing& ring = *pcm_ring_;
+
+        if (have_pcm) {
+            const size_t frames = pcm.frames();
+            const int64_t pts = pcm.timing.pts +
+                static_cast<int64_t>(written) * 1000000 / pcm.sample_rate;
+            written += ring.write(pcm.samples.data() + written * pcm.channels, frames - written, pts);
+            if (written == frames) {
+                have_pcm = false;
+                spins = 0;
+            } else {
+                backoff(spins, c.stall_us);  /* Ring full: the sink is behind by design */
+            }
+            continue;
+        }
+
+        /* A completed IEC 61937 burst becomes the next ring write */
+        auto takeBurst = [&] {
+            c.items.fetch_add(1, std::memory_order_relaxed);
+            pcm.samples.assign(packer_->getBurst().begin(), packer_->getBurst().end());
+            pcm.sample_rate = packer_->getOutputRate();
+            pcm.channels = 2;
+            pcm.timing.pts = packer_->getBurstPts();
+            written = 0;
+            have_pcm = true;
+        };
+
+        const bool upstream_done = demux_eos_.load(std::memory_order_acquire);
+        if (!audio_queue_.tryPop(packet)) {
+            if (upstream_done && !audio_eos_) {
+                bool ready = false;
+                if (packer_ && packer_->flush(ready) == device::Result::OK && ready) {
+                    takeBurst();   /* Held for dependent frames that will not come */
+                    continue;
+                }
+                ring.commitPartial();
+                audio_eos_.store(true, std::memory_order_release);
+            }
+            backoff(spins, c.starve_us);
+            continue;
+        }
+        spins = 0;
+        audio_queued_.remove(packet);
+        raiseHighWater(c.high_water, audio_queue_.size() + 1);
+
+        const int64_t discard = discard_before_us_.load(std::memory_order_relaxed);
+        if (packer_) {
+            /* Passthrough: frame the bitstream, no decode. Bitstreams cannot be
+             * trimmed, so an exact seek starts at the syncframe holding the target */
+            if (packet.timing.pts + packet.timing.duration_us <= discard) continue;
+            bool ready = false;
+            const int64_t t0 = nowUs();
+            const device::Result r = packer_->pack(packet.data.data(), packet.data.size(),
+                                                   packet.timing.pts, ready);
+            c.busy_us.fetch_add(nowUs() - t0, std::memory_order_relaxed);
+            if (r != device::Result::OK) {
+                LOG_WARN("PlaybackEngine", "Dropping malformed syncframe at", packet.timing.pts);
+                continue;
+            }
+            if (ready) takeBurst();
+            continue;
+        }
+
+        const int64_t t0 = nowUs();
+        hal::AudioDecodeResult result = audio_decoder_->decode(packet);
+        c.busy_us.fetch_add(nowUs() - t0, std::memory_order_relaxed);
+        if (result.status != device::Result::OK || !result.frame_ready) continue;
+        const uint32_t in_channels = converter_ ? converter_->getInputChannels() : ring.getChannels();
+        const uint32_t in_rate = converter_ ? converter_->getInputRate() : ring.getSampleRate();
+        if (result.pcm.channels != in_channels || result.pcm.sample_rate != in_rate) {
+            LOG_WARN("PlaybackEngine", "Audio format changed mid-stream, dropping unit at",
+                     packet.timing.pts);
+            continue;
+        }
+        c.items.fetch_add(1, std::memory_order_relaxed);
+        if (discard > result.pcm.timing.pts) {
+            /* Exact seek: drop decoded audio before the target, trim the unit holding it */
+            const size_t skip = std::min<size_t>(result.pcm.frames(), static_cast<size_t>(
+                (discard - result.pcm.timing.pts) * result.pcm.sample_rate / 1000000));
+            if (skip == result.pcm.frames()) continue;
+            result.pcm.samples.erase(result.pcm.samples.begin(),
+                                     result.pcm.samples.begin() + static_cast<std::ptrdiff_t>(skip * result.pcm.channels));
+            result.pcm.timing.pts += static_cast<int64_t>(skip) * 1000000 / result.pcm.sample_rate;
+        }
+        if (converter_) {
+            /* Convert into the reused buffer; pts stays that of the first input frame */
+            const int64_t t1 = nowUs();
+            pcm.samples.clear();
+            converter_->process(result.pcm.samples.data(), result.pcm.frames(), pcm.samples);
+            pcm.sample_rate = converter_->getOutputRate();
+            pcm.channels = converter_->getOutputChannels();
+            pcm.timing = result.pcm.timing;
+            c.busy_us.fetch_add(nowUs() - t1, std::memory_order_relaxed);
+        } else {
+            pcm = std::move(result.pcm);
+        }
+        written = 0;
+        have_pcm = true;
+    }
+}
+
+void PlaybackEngine::sinkLoop() {
+    StageCounters& c = counters_[kSink];
+    hal::AudioBuffer out;
+    bool started = false;     /* A period has played since start/seek */
+    bool starving = false;    /* Current empty stretch already counted */
+    uint32_t spins = 0;
+
+    while (!stopping_) {
+        if (barrier_) {
+            started = false;
+            starving = false;
+            parkIfRequested();
+            continue;
+        }
+        if (!pcm_ring_) {   /* The current sink has no path for this track */
+            std::this_thread::sleep_for(std::chrono::milliseconds(kIdleMs));
+            continue;
+        }
+        media::PcmRing& ring = *pcm_ring_;
+        if (paused_.load(std::memory_order_acquire) || !output_attached_.load(std::memory_order_acquire)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(kIdleMs));
+            continue;
+        }
+
+        /* Prime half the ring after start/seek so a decoder warming up is not an underrun */
+        if (!started && ring.getFillPeriods() < ring.getPeriodCount() / 2 &&
+            !audio_eos_.load(std::memory_order_acquire)) {
+            backoff(spins, c.starve_us);
+            continue;
+        }
+
+        const media::PcmPeriod* period = ring.front();
+        if (!period) {
+            if (started && !starving && !audio_eos_.load(std::memory_order_acquire)) {
+                ring.recordUnderrun();
+                starving = true;
+            }
+            backoff(spins, c.starve_us);
+            continue;
+        }
+        starving = false;
+        spins = 0;
+
+        out.data = reinterpret_cast<const uint8_t*>(period->samples);
+        out.size = static_cast<size_t>(period->frames) * period->channels * sizeof(int16_t);
+        out.sample_rate_hz = period->sample_rate;
+        out.channels = period->channels;
+        out.format = sink_format_;
+        out.pts_us = period->pts_us;
+
+        const int64_t t0 = nowUs();
+        audio_.play(out);  /* Blocks while the output FIFO is full */
+        c.stall_us.fetch_add(nowUs() - t0, std::memory_order_relaxed);
+        ring.pop();
+        started = true;
+        c.items.fetch_add(1, std::memory_order_relaxed);
+        audio_writes_.fetch_add(1, std::memory_order_relaxed);
+        audio_bytes_.fetch_add(out.size, std::memory_order_relaxed);
+    }
+}
+
+} // namespace streaming::services
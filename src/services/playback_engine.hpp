@@ -0,0 +1,344 @@
+/**
+ * @file playback_engine.hpp
+ * @brief Threaded demux → decode → present engine behind StreamPipeline
+ *
+ * Stage threads connected by bounded SPSC queues:
+ *
+ *   demux --[video packets]--> decode --[frames]--> present (vblank paced)
+ *         \-[audio packets]--> audio decode --[PCM periods]--> sink (FIFO paced)
+ *
+ * A full queue (or an exhausted frame pool) blocks the producer, so the
+ * display rate throttles decode and decode throttles demux. The packet
+ * queues are also bounded in bytes by their MemoryGovernor limit, which
+ * demux treats like a full queue. Seek and stop
+ * go through a barrier: every stage parks, the controller flushes queues,
+ * decoder and scheduler while nothing is running, then the stages resume.
+ */
+
+#pragma once
+
+#include "stream_pipeline_service.hpp"
+#include "container_service.hpp"
+#include "common/memory_governor.hpp"
+#include "common/spsc_queue.hpp"
+#include "hal/audio_decoder_hal.hpp"
+#include "hal/audio_hal.hpp"
+#include "hal/codec_hal.hpp"
+#include "hal/display_hal.hpp"
+#include "hal/video_pipeline_hal.hpp"
+#include "media/audio_converter.hpp"
+#include "media/buffer_model.hpp"
+#include "media/compositor.hpp"
+#include "media/frame_pool.hpp"
+#include "media/iec61937.hpp"
+#include "media/media_clock.hpp"
+#include "media/pcm_ring.hpp"
+#include "media/presentation_scheduler.hpp"
+#include "media/seek_coalescer.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace streaming::services {
+
+/** Queue sizing for the engine */
+struct PlaybackEngineConfig {
+    size_t packet_queue_depth{64};   /* Encoded packets between demux and decode */
+    size_t frame_queue_depth{4};     /* Decoded frames between decode and present */
+    size_t audio_queue_depth{256};   /* Encoded audio packets between demux and audio decode */
+    size_t preroll_packets{8};       /* Video packets queued before pre-roll completes */
+    int64_t audio_period_us{100000}; /* PCM per ring period, i.e. per IAudioHal::play call */
+    uint32_t audio_ring_periods{8};  /* Decoded audio buffered ahead of the sink */
+    uint64_t packet_memory_bytes{16ULL << 20};    /* Governor demand of both packet queues */
+    uint64_t packet_memory_min_bytes{2ULL << 20}; /* Least they run with under pressure */
+};
+
+/**
+ * @brief Staged playback engine
+ *
+ * Owned by StreamPipelineServiceImpl. All public methods are called from
+ * the controlling thread only; the stage threads never call back into the
+ * pipeline except through the end-of-stream callback.
+ */
+class PlaybackEngine {
+public:
+    PlaybackEngine(IContainerService& container,
+                   hal::IDisplayHal& display,
+                   hal::IVideoPipeline& video,
+                   hal::IAudioHal& audio,
+                   media::PresentationScheduler& scheduler,
+                   PlaybackEngineConfig config = {});
+    ~PlaybackEngine();
+
+    PlaybackEngine(const PlaybackEngine&) = delete;
+    PlaybackEngine& operator=(const PlaybackEngine&) = delete;
+
+    /** Start the stage threads for a video track; presentation begins paused */
+    device::Result start(hal::ICodecDecoder& decoder,
+                         std::shared_ptr<media::FramePool> pool,
+                         uint32_t video_track_id);
+
+    /**
+     * Wait, paused, until the first frame is decoded and held for
+     * presentation and the packet queue holds preroll_packets (or the
+     * stream ended). Audio, if any, must have a period ready as well.
+     * ERROR_TIMEOUT if that takes longer than timeout_ms; playback still
+     * works then, it just starts cold.
+     */
+    device::Result preroll(uint32_t timeout_ms);
+
+    /**
+     * Attach an audio track before start(). AC3/E-AC3 on a sink that
+     * takes the bitstream is passed through as IEC 61937 without decoding
+     * (decoder may then be nullptr). Otherwise decoded PCM is played, and
+     * resampled/downmixed first if the current sink cannot take the
+     * track's rate or channel count. No decoder and no passthrough plays
+     * video only.
+     */
+    void setAudioTrack(hal::IAudioDecoder* decoder, const media::TrackMetadata& track);
+
+    /** True if track would go to sink as an undecoded bitstream (no decoder needed) */
+    bool canPassthrough(const media::AudioTrackInfo& track, hal::AudioSink sink) const;
+
+    /**
+     * Attach a decoder to the current audio track, e.g. before switching
+     * from a passthrough sink to a PCM one. Only while stopped or while
+     * audio is passed through, when the audio stage does not decode.
+     */
+    void setAudioDecoder(hal::IAudioDecoder* decoder);
+
+    /** True if setAudioTrack() attached audio */
+    bool hasAudio() const { return pcm_ring_ != nullptr; }
+
+    /**
+     * Route audio to another sink, live. The clock picks up the new sink's
+     * output latency; if the sink needs a different format (passthrough
+     * or PCM layout) the audio path is rebuilt behind the barrier.
+     */
+    device::Result setAudioSink(hal::AudioSink sink);
+
+    /** True if audio goes to the sink as an undecoded bitstream */
+    bool isPassthrough() const { return packer_ != nullptr; }
+
+    /** Park and join all stages, recycling every in-flight frame */
+    void stop();
+
+    bool isRunning() const { return running_; }
+
+    /**
+     * Detached, the stages demux, decode and pre-roll but leave the output
+     * HALs to another engine: nothing is scanned out or played, and
+     * start, stop, seek and pause do not touch the audio output or the
+     * video plane. setAudioSink() is ERROR_BUSY. Attaching flushes audio
+     * queued by the previous owner. Engines start attached.
+     */
+    void setOutputAttached(bool attached);
+    bool isOutputAttached() const { return output_attached_.load(std::memory_order_acquire); }
+
+    /** Freeze/unfreeze the media clock; the current frame stays on screen */
+    void setPaused(bool paused);
+
+    /** AUDIO_MASTER follows the audio render position; SYSTEM free-runs */
+    void setClockMode(media::ClockMode mode) { clock_.setMode(mode); }
+
+    /**
+     * Barrier seek: flush every stage, reposition the container (on the
+     * keyframe at or before the target), resume. EXACT additionally drops
+     * decoded video and audio before the target, so presentation starts
+     * at the requested time rather than the keyframe.
+     */
+    device::Result seek(int64_t timestamp_us, media::SeekMode mode = media::SeekMode::KEYFRAME);
+
+    /**
+     * Trick play at rate x real time: 1 is normal playback, 2..32 fast
+     * forward, -2..-32 rewind; anything else is ERROR_INVALID_PARAM.
+     * Audio is muted away from 1x. Forward below kKeyframeOnlyRate still
+     * decodes every frame; faster and all reverse rates demux keyframes
+     * only through the sample index, skipping keyframes the clock has
+     * already passed, so decode work is bounded by the display rather
+     * than the speed. Rewinding past the first keyframe ends the stream.
+     */
+    device::Result setPlaybackRate(int32_t rate);
+    int32_t getPlaybackRate() const { return rate_.load(std::memory_order_relaxed); }
+
+    static constexpr int32_t kMaxTrickRate = 32;
+    static constexpr int32_t kKeyframeOnlyRate = 4;
+
+    /**
+     * UI layer the present stage blends over each frame it shows; any
+     * thread, nullptr removes it. An overlay of another size is rescaled
+     * to the frames; frames that are not 32-bit RGB are shown as they are.
+     */
+    void setOverlay(std::shared_ptr<const media::OverlayImage> overlay);
+
+    /** PTS of the frame on screen */
+    int64_t getCurrentPts() const { return current_pts_.load(std::memory_order_relaxed); }
+
+    /** True once every decoded frame has been shown after end of stream */
+    bool isEndOfStream() const { return eos_signalled_.load(std::memory_order_acquire); }
+
+    /** Called from the present thread when the last frame has been shown */
+    void setEndOfStreamCallback(std::function<void()> cb) { eos_cb_ = std::move(cb); }
+
+    /** Stage and clock metrics (cadence/video fields are filled in by the pipeline) */
+    PipelineStats getStats() const;
+
+    /**
+     * Media queued in the engine: DEMUX holds the packet queues, DECODED
+     * the frame queue and scheduler (video) and the PCM ring (audio). The
+     * NETWORK level is left empty for the caller. Saturated while demux is
+     * blocked on a full packet queue.
+     */
+    media::BufferSnapshot getBufferSnapshot() const;
+
+private:
+    /** How audio reaches the current sink */
+    struct AudioPath {
+        bool enabled{false};
+        bool passthrough{false};
+        uint32_t rate{0};       /* PCM output format */
+        uint32_t channels{0};
+        bool operator==(const AudioPath& o) const {
+            return enabled == o.enabled && passthrough == o.passthrough &&
+                   rate == o.rate && channels == o.channels;
+        }
+    };
+
+    enum Stage { kDemux = 0, kDecode = 1, kPresent = 2, kAudio = 3, kSink = 4, kStageCount = 5 };
+
+    /** Lock-free counters written by one stage thread, read by getStats() */
+    struct StageCounters {
+        std::atomic<uint64_t> items{0};
+        std::atomic<int64_t> busy_us{0};
+        std::atomic<int64_t> stall_us{0};
+        std::atomic<int64_t> starve_us{0};
+        std::atomic<size_t> high_water{0};
+        void reset();
+    };
+
+    /** Media in a packet queue: added by demux, removed by the consuming stage */
+    struct QueueLevel {
+        std::atomic<int64_t> duration_us{0};
+        std::atomic<uint64_t> bytes{0};
+        void add(const media::EncodedPacket& packet);
+        void remove(const media::EncodedPacket& packet);
+        void reset();
+    };
+
+    AudioPath planAudioPath(hal::AudioSink sink) const;
+    /** Rebuild ring/converter/packer for a path (stages not running or parked) */
+    void buildAudioPath(const AudioPath& path);
+
+    void demuxLoop();
+    void decodeLoop();
+    void presentLoop();
+    void audioLoop();
+    void sinkLoop();
+
+    /** Stage side of the barrier: park while a seek/stop is in progress */
+    void parkIfRequested();
+    /** Controller side: wait until every running stage is parked */
+    void quiesce();
+    void resume();
+    bool interrupted() const;
+
+    /** Back-off used while blocked on a queue; returns false if interrupted */
+    bool backoff(uint32_t& spins, std::atomic<int64_t>& counter);
+
+    /** Trick rates at which only keyframes are demuxed and decoded */
+    bool keyframesOnly() const;
+
+    /** Demux side: report queued packet bytes, true if over the governor's limit */
+    bool overMemoryLimit();
+
+    /** Pre-roll condition, polled by preroll() */
+    bool isPrerolled() const;
+
+    /**
+     * Present stage: blend the overlay, if any, into frame before scanout.
+     * The decoded buffer is the scanout buffer (zero-copy), so it is drawn
+     * on in place. That is safe because each frame is presented once
+     * (REPEAT keeps it on screen without coming back here) and returns to
+     * the pool only after it has left the screen, to be decoded over.
+     */
+    void compositeOverlay(const media::DecodedFrame& frame);
+
+    void recycle(const media::DecodedFrame& frame);
+    /** EXACT seek: recycle a frame before the target; true if it was dropped */
+    bool discardBeforeTarget(const media::DecodedFrame& frame);
+    void drainQueues();
+
+    IContainerService& container_;
+    hal::IDisplayHal& display_;
+    hal::IVideoPipeline& video_;
+    hal::IAudioHal& audio_;
+    media::PresentationScheduler& scheduler_;
+
+    const PlaybackEngineConfig config_;
+    hal::ICodecDecoder* decoder_{nullptr};
+    std::shared_ptr<media::FramePool> pool_;
+    uint32_t video_track_id_{0};
+    hal::IAudioDecoder* audio_decoder_{nullptr};
+    media::TrackMetadata audio_track_;
+    AudioPath audio_path_;
+    uint32_t audio_track_id_{0};   /* Demux routes audio only while a path exists */
+    std::unique_ptr<media::PcmRing> pcm_ring_;
+    std::unique_ptr<media::AudioConverter> converter_;   /* Only when the sink needs it */
+    std::unique_ptr<media::Iec61937Packer> packer_;      /* Only for passthrough */
+    hal::AudioFormat sink_format_{hal::AudioFormat::PCM_16BIT_STEREO};
+
+    common::SpscQueue<media::EncodedPacket> packet_queue_;
+    common::SpscQueue<media::DecodedFrame> frame_queue_;
+    common::SpscQueue<media::EncodedPacket> audio_queue_;
+
+    std::thread threads_[kStageCount];
+    uint32_t stage_count_{0};   /* Threads started (audio is optional) */
+    std::atomic<bool> running_{false};
+    std::atomic<bool> stopping_{false};
+    std::atomic<bool> barrier_{false};
+    std::mutex barrier_mutex_;
+    std::condition_variable barrier_cv_;
+    uint32_t parked_{0};
+
+    std::atomic<bool> paused_{true};
+    std::atomic<bool> output_attached_{true};   /* Display, video plane and audio are ours */
+    std::atomic<bool> demux_eos_{false};
+    std::atomic<bool> decode_eos_{false};
+    std::atomic<bool> audio_eos_{false};
+    std::atomic<bool> eos_signalled_{false};
+    std::atomic<int64_t> discard_before_us_{-1};   /* EXACT seek target, -1 for none */
+    std::atomic<uint64_t> discarded_frames_{0};
+    std::function<void()> eos_cb_;
+    std::atomic<int32_t> rate_{1};
+    std::atomic<int64_t> trick_cursor_{0};   /* Last keyframe demuxed in keyframe-only mode */
+
+    media::MediaClock clock_;
+    mutable std::mutex overlay_mutex_;   /* overlay_, scaled_* and compositor_ */
+    std::shared_ptr<const media::OverlayImage> overlay_;
+    std::shared_ptr<const media::OverlayImage> scaled_from_;   /* overlay_ that scaled_overlay_ was made of */
+    media::OverlayImage scaled_overlay_;
+    media::Compositor compositor_;
+    std::atomic<int64_t> current_pts_{0};
+    std::atomic<uint64_t> audio_writes_{0};
+    std::atomic<uint64_t> audio_bytes_{0};
+
+    /* Buffer occupancy for getBufferSnapshot() */
+    QueueLevel video_queued_;
+    QueueLevel audio_queued_;
+    std::atomic<int64_t> frame_us_{0};      /* Duration of the last decoded frame */
+    std::atomic<uint64_t> frame_bytes_{0};  /* Size of the last decoded frame */
+    common::MemoryGovernor::Registration packet_memory_;   /* Both packet queues, while started */
+
+    /* Startup timestamps (steady clock, 0 = not yet) for StartupStats */
+    std::atomic<int64_t> started_us_{0};
+    std::atomic<int64_t> prerolled_us_{0};
+    std::atomic<int64_t> first_play_us_{0};
+    std::atomic<int64_t> first_frame_us_{0};
+
+    StageCounters counters_[kStageCount];
+};
+
+} // namespace streaming::services
@@ -6,27 +6,81 @@
 #include "stream_pipeline_service.hpp"
 #include "codec_service.hpp"
 #include "container_service.hpp"
+#include "playback_engine.hpp"
+#include "../hal/audio_hal.hpp"
+#include "../hal/display_hal.hpp"
 #include "../hal/video_pipeline_hal.hpp"
+#include "../media/frame_pool.hpp"
+#include "../media/presentation_scheduler.hpp"
+#include "../media/refresh_rate_matcher.hpp"
 #include "../common/logger.hpp"
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 namespace streaming::services {
 
+static int64_t nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static int64_t wallUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+/** Video plane, audio output and mode matching of a standalone pipeline */
+struct OwnedOutputs {
+    std::unique_ptr<hal::IVideoPipeline> video;
+    std::unique_ptr<hal::IAudioHal> audio;
+    std::unique_ptr<media::RefreshRateMatcher> rate_matcher;
+};
+
 class StreamPipelineServiceImpl : public IStreamPipeline {
 public:
-    StreamPipelineServiceImpl()
-        : codec_svc_(createCodecService())
+    /** owned is set when the outputs are this pipeline's alone */
+    StreamPipelineServiceImpl(const PipelineOutputs& outputs, std::unique_ptr<OwnedOutputs> owned)
+        : owned_(std::move(owned))
+        , codec_svc_(createCodecService())
         , container_svc_(createContainerService())
-    {}
+        , display_(outputs.display)
+        , video_(outputs.video)
+        , audio_(outputs.audio)
+        , rate_matcher_(outputs.rate_matcher)
+        , engine_(*container_svc_, display_, video_, audio_, scheduler_)
+        , seeker_([this](int64_t target_us, media::SeekMode mode) { return executeSeek(target_us, mode); })
+    {
+        engine_.setEndOfStreamCallback([this] { if (eos_cb_) eos_cb_(); });
+    }
+
+    ~StreamPipelineServiceImpl() override {
+        seeker_.cancel();
+        stopBufferMonitor();
+        engine_.stop();
+    }
 
     device::Result initialize() override {
         codec_svc_->initialize();
         container_svc_->initialize();
+        if (owned_) {
+            audio_.initialize();
+            const auto mode = display_.getDisplayMode();
+            video_.initialize(mode.width, mode.height);
+        }
         return device::Result::OK;
     }
 
     void shutdown() override {
         stop();
+        if (owned_) {
+            rate_matcher_.flushPendingRestore();
+            video_.shutdown();
+            audio_.shutdown();
+        }
         container_svc_->shutdown();
         codec_svc_->shutdown();
     }
@@ -35,6 +89,7 @@ public:
         if (state_ != PipelineState::IDLE && state_ != PipelineState::ERROR)
             return device::Result::ERROR_BUSY;
 
+        const auto open_begin = std::chrono::steady_clock::now();
         state_ = PipelineState::OPENING;
         if (status_cb_) status_cb_(state_, "Opening...");
 
@@ -58,6 +113,57 @@ public:
             if (status_cb_) status_cb_(state_, "No decoder for codec");
             return device::Result::ERROR_NOT_SUPPORTED;
         }
+        /* Switch refresh rate before the first frame so no frame is shown in the UI
+         * mode; a detached pipeline leaves the display to the item on screen */
+        matchDisplay(engine_.isOutputAttached());
+
+        /* Audio is optional: an unsupported audio codec plays the video silently */
+        audio_decoder_.reset();
+        audio_track_ = {};
+        auto audio_tracks = container_svc_->getAudioTracks();
+        if (!audio_tracks.empty()) {
+            audio_track_ = audio_tracks[0];
+            /* A bitstream the sink decodes itself needs no decoder here */
+            if (!engine_.canPassthrough(audio_track_.audio, audio_.getSink()))
+                audio_decoder_ = codec_svc_->createAudioDecoder(audio_track_.audio);
+        }
+        engine_.setAudioTrack(audio_decoder_.get(), audio_track_);
+        if (!audio_tracks.empty() && !engine_.hasAudio())
+            LOG_WARN("StreamPipeline", "No decoder for audio codec, playing without audio");
+        /* Slave video to audio when there is audio; silent streams free-run */
+        engine_.setClockMode(engine_.hasAudio() ? media::ClockMode::AUDIO_MASTER
+                                                : media::ClockMode::SYSTEM);
+
+        /* Pre-roll: stages fill and the first keyframe is decoded before open()
+         * returns, so play() starts warm; presentation waits for play() */
+        frame_pool_ = std::make_shared<media::FramePool>(kFramePoolSize);
+        open_setup_us_ = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - open_begin).count();
+        if (engine_.start(*decoder_, frame_pool_, video_track_.track_id) != device::Result::OK) {
+            state_ = PipelineState::ERROR;
+            if (status_cb_) status_cb_(state_, "Engine start failed");
+            return device::Result::ERROR_GENERIC;
+        }
+        /* One bound for pre-roll and the fill below together */
+        const int64_t deadline = nowUs() + static_cast<int64_t>(kPrerollTimeoutMs) * 1000;
+        if (engine_.preroll(kPrerollTimeoutMs) != device::Result::OK)
+            LOG_WARN("StreamPipeline", "Pre-roll incomplete, play() will start cold");
+
+        /* Fill to the start watermark; if that takes too long play() buffers instead */
+        live_ = container_svc_->getFormat() == media::ContainerFormat::RTP;
+        buffer_.setWatermarks(live_ ? kLiveWatermarks : watermarks_);
+        g2g_last_us_ = -1;
+        g2g_max_us_ = -1;
+        g2g_sum_us_ = 0;
+        g2g_samples_ = 0;
+        buffer_.reset();
+        buffer_.restart(nowUs());
+        state_ = PipelineState::BUFFERING;
+        if (status_cb_) status_cb_(state_, "Buffering...");
+        while (buffer_.evaluate(sampleBuffer(), nowUs()) && nowUs() < deadline)
+            std::this_thread::sleep_for(kBufferPollInterval / 4);
+        rebuffers_seen_ = 0;
+        startBufferMonitor();
 
         state_ = PipelineState::PAUSED;
         if (status_cb_) status_cb_(state_, "Ready");
@@ -68,66 +174,322 @@ public:
         /* Only allow play from PAUSED - open() must be called first to initialize
          * container, decoder, and video track. Calling play() from IDLE would skip
          * initialization and cause null pointer dereferences. */
+        std::lock_guard<std::mutex> lock(control_mutex_);
+        if (state_ == PipelineState::BUFFERING) return device::Result::OK;   /* Starts when filled */
         if (state_ != PipelineState::PAUSED)
             return device::Result::ERROR_BUSY;
+        if (buffer_.isWaiting()) {
+            state_ = PipelineState::BUFFERING;
+            if (status_cb_) status_cb_(state_, "Buffering...");
+            return device::Result::OK;
+        }
+        engine_.setPaused(false);
         state_ = PipelineState::PLAYING;
         if (status_cb_) status_cb_(state_, "Playing");
         return device::Result::OK;
     }
 
     device::Result pause() override {
+        std::lock_guard<std::mutex> lock(control_mutex_);
+        engine_.setPaused(true);
         state_ = PipelineState::PAUSED;
         if (status_cb_) status_cb_(state_, "Paused");
         return device::Result::OK;
     }
 
     device::Result seek(int64_t timestamp_us) override {
-        const PipelineState prev = state_;
-        if (prev != PipelineState::PLAYING && prev != PipelineState::PAUSED)
-            return device::Result::ERROR_BUSY;
+        return seek(timestamp_us, media::SeekMode::KEYFRAME);
+    }
 
-        state_ = PipelineState::SEEKING;
-        if (status_cb_) status_cb_(state_, "Seeking...");
-        if (container_svc_->seek(timestamp_us) != device::Result::OK) {
-            state_ = prev;
-            return device::Result::ERROR_IO;
-        }
-        if (decoder_) decoder_->flush();
-        current_pts_ = timestamp_us;
-        /* Restore previous state: remain PAUSED if was paused, else PLAYING */
-        state_ = prev;
-        if (status_cb_) status_cb_(state_, prev == PipelineState::PAUSED ? "Paused" : "Playing");
+    device::Result seek(int64_t timestamp_us, media::SeekMode mode) override {
+        if (live_) return device::Result::ERROR_NOT_SUPPORTED;
+        const PipelineState s = state_;
+        if (s != PipelineState::PLAYING && s != PipelineState::PAUSED && s != PipelineState::SEEKING &&
+            s != PipelineState::BUFFERING)
+            return device::Result::ERROR_BUSY;
+        const int64_t duration_us = container_svc_->getDurationUs();   /* 0: not known */
+        if (timestamp_us < 0 || (duration_us > 0 && timestamp_us > duration_us))
+            return device::Result::ERROR_INVALID_PARAM;
+        seeker_.request(timestamp_us, mode);
         return device::Result::OK;
     }
 
+    device::Result setPlaybackRate(int32_t rate) override {
+        std::lock_guard<std::mutex> lock(control_mutex_);
+        if (state_ != PipelineState::PLAYING && state_ != PipelineState::PAUSED)
+            return device::Result::ERROR_BUSY;
+        if (live_ && rate != 1) return device::Result::ERROR_NOT_SUPPORTED;
+        const int32_t prev = engine_.getPlaybackRate();
+        const device::Result r = engine_.setPlaybackRate(rate);
+        if (engine_.getPlaybackRate() != prev) buffer_.restart(nowUs());   /* Queues were flushed */
+        return r;
+    }
+
     device::Result stop() override {
+        /* Drop queued seeks, then join the stages before tearing down what they use */
+        seeker_.cancel();
+        stopBufferMonitor();
+        std::lock_guard<std::mutex> lock(control_mutex_);
+        engine_.stop();
         if (decoder_) decoder_->reset();
         decoder_.reset();
+        audio_decoder_.reset();
+        frame_pool_.reset();
         container_svc_->close();
+        if (engine_.isOutputAttached()) rate_matcher_.restoreUiMode();
         state_ = PipelineState::IDLE;
         current_pts_ = 0;
+        live_ = false;
         return device::Result::OK;
     }
 
     PipelineState getState() const override { return state_; }
-    int64_t getCurrentPts() const override { return current_pts_; }
+
+    int64_t getCurrentPts() const override {
+        int64_t target = 0;
+        if (seeker_.getPendingTarget(target)) return target;
+        return engine_.isRunning() ? engine_.getCurrentPts() : current_pts_.load();
+    }
+
+    device::Result setAudioSink(hal::AudioSink sink) override {
+        std::lock_guard<std::mutex> lock(control_mutex_);
+        if (!engine_.isOutputAttached()) return device::Result::ERROR_BUSY;
+        return routeAudioLocked(sink);
+    }
+
+    void setOutputAttached(bool attached) override {
+        std::lock_guard<std::mutex> lock(control_mutex_);
+        if (attached == engine_.isOutputAttached()) return;
+        engine_.setOutputAttached(attached);
+        if (!attached || !engine_.isRunning()) return;
+        /* What open() left alone: the display follows this item now, audio the current sink */
+        matchDisplay(true);
+        if (routeAudioLocked(audio_.getSink()) != device::Result::OK)
+            LOG_WARN("StreamPipeline", "Cannot route audio to the current sink");
+    }
+
+    void setOverlay(std::shared_ptr<const media::OverlayImage> overlay) override {
+        engine_.setOverlay(std::move(overlay));
+    }
+
+    PipelineStats getStats() const override {
+        PipelineStats stats = engine_.getStats();
+        const uint64_t discarded = stats.seek.discarded_frames;
+        stats.seek = seeker_.getStats();
+        stats.seek.discarded_frames = discarded;
+        stats.cadence = scheduler_.getStats();
+        stats.video = video_.getStats();
+        stats.playback_rate = engine_.getPlaybackRate();
+        /* The engine times startup from its own start; add container open and setup */
+        if (stats.startup.preroll_us >= 0) stats.startup.preroll_us += open_setup_us_;
+        if (stats.startup.ttff_us >= 0) stats.startup.ttff_us += open_setup_us_;
+        stats.buffer = buffer_.getStats();
+        stats.live = container_svc_->getLiveStats();
+        if (stats.live.live) {
+            const uint64_t samples = g2g_samples_;
+            stats.live.glass_to_glass_us = g2g_last_us_;
+            stats.live.glass_to_glass_max_us = g2g_max_us_;
+            stats.live.glass_to_glass_avg_us = samples ? g2g_sum_us_ / static_cast<int64_t>(samples) : -1;
+        }
+        return stats;
+    }
+
+    void setBufferWatermarks(const media::BufferWatermarks& watermarks) override {
+        watermarks_ = watermarks;
+        if (!live_) buffer_.setWatermarks(watermarks);
+    }
+
+    void setNetworkBufferSource(NetworkBufferSource source) override {
+        std::lock_guard<std::mutex> lock(control_mutex_);
+        network_source_ = std::move(source);
+    }
+
+    void setSegmentSource(media::SegmentScheduler* scheduler) override {
+        std::lock_guard<std::mutex> lock(control_mutex_);
+        container_svc_->setSegmentSource(scheduler);
+        segment_source_ = scheduler;
+    }
+
+    uint8_t getBufferProgress() const override { return buffer_.getProgress(); }
 
     void setStatusCallback(PipelineStatusCallback cb) override { status_cb_ = std::move(cb); }
     void setTelemetryCallback(PipelineTelemetryCallback cb) override { telemetry_cb_ = std::move(cb); }
+    void setEndOfStreamCallback(PipelineEndOfStreamCallback cb) override { eos_cb_ = std::move(cb); }
 
 private:
+    /** Pace presentation for the display, switching its refresh rate to the content first if asked */
+    void matchDisplay(bool switch_mode) {
+        if (switch_mode && rate_matcher_.matchContent(video_track_.video) != device::Result::OK)
+            LOG_WARN("StreamPipeline", "Refresh-rate switch failed, keeping current mode");
+        scheduler_.configure(video_track_.video.frame_rate_num,
+                             video_track_.video.frame_rate_den,
+                             display_.getDisplayMode().refresh_rate_hz);
+    }
+
+    device::Result routeAudioLocked(hal::AudioSink sink) {
+        /* Leaving passthrough for a PCM sink: the decoder skipped at open() is needed now */
+        if (!audio_decoder_ && audio_track_.track_id != 0 && !engine_.canPassthrough(audio_track_.audio, sink)) {
+            audio_decoder_ = codec_svc_->createAudioDecoder(audio_track_.audio);
+            engine_.setAudioDecoder(audio_decoder_.get());
+        }
+        return engine_.setAudioSink(sink);
+    }
+
+    /** Runs on the seek worker: one barrier flush for the latest target */
+    device::Result executeSeek(int64_t timestamp_us, media::SeekMode mode) {
+        std::lock_guard<std::mutex> lock(control_mutex_);
+        const PipelineState prev = state_;
+        if (prev != PipelineState::PLAYING && prev != PipelineState::PAUSED &&
+            prev != PipelineState::BUFFERING)
+            return device::Result::ERROR_BUSY;
+
+        state_ = PipelineState::SEEKING;
+        if (status_cb_) status_cb_(state_, "Seeking...");
+        /* Barrier: all stages park while queues, decoder and scheduler are flushed */
+        const device::Result r = engine_.seek(timestamp_us, mode);
+        if (r == device::Result::OK) current_pts_ = timestamp_us;
+        buffer_.restart(nowUs());
+        /* Restore previous state; the buffer monitor holds playback until the start watermark */
+        state_ = prev;
+        if (r != device::Result::OK) {
+            /* The caller's seek() returned long ago: this is the only place the failure shows */
+            LOG_WARN("StreamPipeline", "Seek to", timestamp_us, "us failed");
+            if (telemetry_cb_) telemetry_cb_("seek_failed", std::to_string(timestamp_us));
+            if (status_cb_) status_cb_(state_, "Seek failed");
+            return device::Result::ERROR_IO;
+        }
+        if (status_cb_) status_cb_(state_, prev == PipelineState::PAUSED ? "Paused"
+                                           : prev == PipelineState::BUFFERING ? "Buffering..." : "Playing");
+        return r;
+    }
+
+    /**
+     * Engine occupancy plus what the network source has downloaded ahead.
+     * The segment source's ABR learns what the engine holds in turn.
+     */
+    media::BufferSnapshot sampleBuffer() const {
+        media::BufferSnapshot snap = engine_.getBufferSnapshot();
+        if (media::SegmentScheduler* segments = segment_source_.load())
+            segments->setPlayoutBuffer(snap.video.durationUs());
+        if (network_source_)
+            network_source_(snap.video.at(media::BufferLevel::NETWORK),
+                            snap.audio.at(media::BufferLevel::NETWORK));
+        return snap;
+    }
+
+    void startBufferMonitor() {
+        std::lock_guard<std::mutex> lock(monitor_mutex_);
+        if (monitoring_) return;
+        monitoring_ = true;
+        monitor_ = std::thread(&StreamPipelineServiceImpl::bufferMonitorLoop, this);
+    }
+
+    void stopBufferMonitor() {
+        {
+            std::lock_guard<std::mutex> lock(monitor_mutex_);
+            monitoring_ = false;
+        }
+        monitor_cv_.notify_all();
+        if (monitor_.joinable()) monitor_.join();
+    }
+
+    void bufferMonitorLoop() {
+        std::unique_lock<std::mutex> lock(monitor_mutex_);
+        while (!monitor_cv_.wait_for(lock, kBufferPollInterval, [this] { return !monitoring_; })) {
+            lock.unlock();
+            checkBuffer();
+            lock.lock();
+        }
+    }
+
+    /** Underrun and refill transitions at 1x; trick play reads late by design */
+    void checkBuffer() {
+        std::lock_guard<std::mutex> lock(control_mutex_);
+        if (!engine_.isRunning() || engine_.getPlaybackRate() != 1) return;
+        const bool waiting = buffer_.evaluate(sampleBuffer(), nowUs());
+        const PipelineState s = state_;
+        if (s == PipelineState::PLAYING && waiting) {
+            engine_.setPaused(true);
+            state_ = PipelineState::BUFFERING;
+            if (status_cb_) status_cb_(state_, "Buffering...");
+            const media::BufferStats bs = buffer_.getStats();
+            if (bs.rebuffers != rebuffers_seen_) {
+                rebuffers_seen_ = bs.rebuffers;
+                LOG_WARN("StreamPipeline", "Buffer underrun,", bs.buffered_us, "us buffered");
+                if (telemetry_cb_) telemetry_cb_("buffer_underrun", std::to_string(bs.buffered_us));
+            }
+        } else if (s == PipelineState::BUFFERING && !waiting) {
+            engine_.setPaused(false);
+            state_ = PipelineState::PLAYING;
+            if (status_cb_) status_cb_(state_, "Playing");
+        }
+        if (live_ && state_ == PipelineState::PLAYING) sampleLatency();
+    }
+
+    /** Glass to glass: capture time of what is on screen now, from the sender's clock */
+    void sampleLatency() {
+        const int64_t capture = container_svc_->getCaptureTimeUs(engine_.getCurrentPts());
+        if (capture < 0) return;
+        const int64_t latency = wallUs() - capture;
+        g2g_last_us_ = latency;
+        g2g_max_us_ = std::max<int64_t>(g2g_max_us_, latency);
+        g2g_sum_us_ += latency;
+        g2g_samples_++;
+    }
+
+    static constexpr std::chrono::milliseconds kBufferPollInterval{20};
+    static constexpr uint32_t kFramePoolSize = 8;
+    static constexpr uint32_t kPrerollTimeoutMs = 2000;
+
+    std::unique_ptr<OwnedOutputs> owned_;   /* Standalone pipeline: the outputs below are these */
     std::unique_ptr<ICodecService> codec_svc_;
     std::unique_ptr<IContainerService> container_svc_;
+    hal::IDisplayHal& display_;      /* Shared, initialized by the owner */
+    hal::IVideoPipeline& video_;
+    hal::IAudioHal& audio_;
+    media::RefreshRateMatcher& rate_matcher_;
+    media::PresentationScheduler scheduler_;
+    PlaybackEngine engine_;
+    std::mutex control_mutex_;       /* Serializes engine control with the seek worker */
+    media::SeekCoalescer seeker_;    /* Declared after engine_: its worker stops first */
     std::unique_ptr<hal::ICodecDecoder> decoder_;
+    std::unique_ptr<hal::IAudioDecoder> audio_decoder_;
+    std::shared_ptr<media::FramePool> frame_pool_;
     media::TrackMetadata video_track_;
-    PipelineState state_{PipelineState::IDLE};
-    int64_t current_pts_{0};
+    media::TrackMetadata audio_track_;
+    std::atomic<PipelineState> state_{PipelineState::IDLE};
+    std::atomic<int64_t> current_pts_{0};
+    int64_t open_setup_us_{0};       /* open() time before the engine started */
+    media::BufferModel buffer_;      /* Drives BUFFERING from queue occupancy */
+    media::BufferWatermarks watermarks_;   /* As set; live sources use kLiveWatermarks */
+    std::atomic<bool> live_{false};        /* An rtp:// ingest is open */
+    std::atomic<int64_t> g2g_last_us_{-1}; /* Glass-to-glass samples, monitor thread */
+    std::atomic<int64_t> g2g_max_us_{-1};
+    std::atomic<int64_t> g2g_sum_us_{0};
+    std::atomic<uint64_t> g2g_samples_{0};
+    NetworkBufferSource network_source_;
+    std::atomic<media::SegmentScheduler*> segment_source_{nullptr};
+    uint64_t rebuffers_seen_{0};     /* Underruns already reported to telemetry */
+    std::mutex monitor_mutex_;
+    std::condition_variable monitor_cv_;
+    std::thread monitor_;            /* Samples occupancy while the engine runs */
+    bool monitoring_{false};
     PipelineStatusCallback status_cb_;
     PipelineTelemetryCallback telemetry_cb_;
+    PipelineEndOfStreamCallback eos_cb_;
 };
 
-std::unique_ptr<IStreamPipeline> createStreamPipeline() {
-    return std::make_unique<StreamPipelineServiceImpl>();
+std::unique_ptr<IStreamPipeline> createStreamPipeline(hal::IDisplayHal& display) {
+    auto owned = std::make_unique<OwnedOutputs>();
+    owned->video = hal::createVideoPipeline();
+    owned->audio = hal::createAudioHal();
+    owned->rate_matcher = std::make_unique<media::RefreshRateMatcher>(display, kModeRestoreDebounce);
+    const PipelineOutputs outputs{display, *owned->video, *owned->audio, *owned->rate_matcher};
+    return std::make_unique<StreamPipelineServiceImpl>(outputs, std::move(owned));
+}
+
+std::unique_ptr<IStreamPipeline> createStreamPipeline(const PipelineOutputs& outputs) {
+    return std::make_unique<StreamPipelineServiceImpl>(outputs, nullptr);
 }
 
 } // namespace streaming::services
@@ -7,6 +7,19 @@
 
 #include <streaming_device/types.hpp>
 #include <streaming_device/media_types.hpp>
+#include "hal/audio_hal.hpp"
+#include "hal/display_hal.hpp"
+#include "hal/video_pipeline_hal.hpp"
+#include "media/buffer_model.hpp"
+#include "media/compositor.hpp"
+#include "media/media_clock.hpp"
+#include "media/presentation_scheduler.hpp"
+#include "media/refresh_rate_matcher.hpp"
+#include "media/rtp_ingest.hpp"
+#include "media/seek_coalescer.hpp"
+#include "media/segment_scheduler.hpp"
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <memory>
@@ -32,6 +45,68 @@ using PipelineStatusCallback = std::function<void(PipelineState, const std::stri
 using PipelineTelemetryCallback = std::function<void(const std::string& event,
                                                      const std::string& details)>;
 
+/** The last frame of the stream has been presented; called on the presentation thread */
+using PipelineEndOfStreamCallback = std::function<void()>;
+
+/**
+ * Media downloaded ahead of the container, per track (BufferLevel::NETWORK).
+ * Called from the pipeline's buffer monitor.
+ */
+using NetworkBufferSource = std::function<void(media::BufferOccupancy& video,
+                                               media::BufferOccupancy& audio)>;
+
+/** Per-stage throughput metrics */
+struct StageStats {
+    uint64_t items{0};             /* Packets demuxed / frames decoded / vblanks serviced */
+    int64_t busy_us{0};            /* Time spent doing the stage's own work */
+    int64_t stall_us{0};           /* Time blocked on a full downstream queue or pool */
+    int64_t starve_us{0};          /* Time waiting on an empty upstream queue */
+    size_t queue_depth{0};         /* Current depth of the stage's output queue */
+    size_t queue_high_water{0};    /* Deepest the output queue has been */
+};
+
+/** Audio output metrics */
+struct AudioRenderStats {
+    uint64_t writes{0};            /* IAudioHal::play calls */
+    uint64_t bytes{0};             /* PCM bytes handed to the HAL */
+    size_t ring_fill_periods{0};   /* Decoded periods waiting for the sink */
+    size_t ring_capacity_periods{0};
+    size_t ring_high_water{0};
+    int64_t ring_fill_us{0};
+    uint64_t underruns{0};         /* Sink found the ring empty mid-stream */
+    uint32_t sink_sample_rate{0};  /* Format handed to the HAL */
+    uint32_t sink_channels{0};
+    bool converted{false};         /* Resampled and/or downmixed for the sink */
+    bool passthrough{false};       /* AC3/E-AC3 sent undecoded as IEC 61937 */
+};
+
+/** Startup timing from open(); -1 until the event has happened */
+struct StartupStats {
+    int64_t preroll_us{-1};        /* open() until the first frame is decoded and queues are primed */
+    int64_t play_to_frame_us{-1};  /* First play() until that frame is on screen */
+    int64_t ttff_us{-1};           /* Time to first frame: open() until it is on screen */
+    bool prerolled{false};         /* open() returned with a frame ready (false on timeout) */
+};
+
+/** Pipeline metrics snapshot */
+struct PipelineStats {
+    StageStats demux;
+    StageStats decode;
+    StageStats present;
+    StageStats audio;              /* Audio decode; stall = time blocked on a full PCM ring */
+    StageStats sink;               /* Audio sink; stall = time blocked in IAudioHal::play */
+    AudioRenderStats audio_out;
+    media::CadenceStats cadence;
+    media::ClockStats clock;       /* A/V offset and clock slew */
+    media::SeekStats seek;         /* Requested vs executed seeks */
+    hal::VideoPipelineStats video;
+    media::CompositorStats overlay;   /* UI blended over video in software (setOverlay) */
+    int32_t playback_rate{1};      /* Trick-play rate, negative when rewinding */
+    StartupStats startup;
+    media::BufferStats buffer;     /* Occupancy per track and level, rebuffers */
+    media::LiveIngestStats live;   /* rtp:// sources: jitter buffers and glass-to-glass latency */
+};
+
 /**
  * @brief StreamPipeline Interface
  *
@@ -44,18 +119,49 @@ public:
     virtual device::Result initialize() = 0;
     virtual void shutdown() = 0;
 
-    /** Open stream and prepare pipeline */
+    /**
+     * Open stream and prepare pipeline. Returns after pre-roll: packet
+     * queues at their low watermark and the first keyframe decoded and
+     * held, so play() shows it on the next vblank. Reports BUFFERING
+     * while the start watermark fills.
+     *
+     * An rtp:// URI opens a low-latency live ingest: packets come through
+     * a jitter buffer straight into the demux stage, the buffer model uses
+     * kLiveWatermarks, and seeking and trick play are not supported.
+     * Call play() right away; time spent paused adds to the latency.
+     */
     virtual device::Result open(const std::string& path_or_uri) = 0;
 
-    /** Start playback */
+    /**
+     * Start playback. If the start watermark has not been reached the
+     * pipeline reports BUFFERING and starts on its own once it has.
+     */
     virtual device::Result play() = 0;
 
     /** Pause */
     virtual device::Result pause() = 0;
 
-    /** Seek to timestamp (microseconds) */
+    /** Seek to timestamp (microseconds), snapping to the previous keyframe */
     virtual device::Result seek(int64_t timestamp_us) = 0;
 
+    /**
+     * Seek with an explicit mode. Returns once the request is queued;
+     * bursts (remote scrubbing) are coalesced so only the latest target
+     * runs, and getCurrentPts() reports that target until it has landed.
+     * Status callbacks for the seek arrive on the seek worker thread; a
+     * seek that fails there is reported as "Seek failed" (state
+     * unchanged) and as a "seek_failed" telemetry event. The target is
+     * checked against the duration only when the duration is known.
+     */
+    virtual device::Result seek(int64_t timestamp_us, media::SeekMode mode) = 0;
+
+    /**
+     * Trick play: 1 for normal speed, ±2..±32 for fast forward / rewind.
+     * Audio is muted away from 1x; from 4x, and for every rewind rate,
+     * only keyframes are demuxed and decoded.
+     */
+    virtual device::Result setPlaybackRate(int32_t rate) = 0;
+
     /** Stop and close */
     virtual device::Result stop() = 0;
 
@@ -65,13 +171,91 @@ public:
     /** Get current PTS (microseconds) */
     virtual int64_t getCurrentPts() const = 0;
 
+    /**
+     * Route audio to HDMI or Bluetooth A2DP, also mid-playback. Video is
+     * re-timed to the new sink's output latency.
+     */
+    virtual device::Result setAudioSink(hal::AudioSink sink) = 0;
+
+    /**
+     * Attach to or detach from the output HALs. A detached pipeline opens,
+     * decodes and pre-rolls (a preloaded next item) without touching
+     * them: no display mode switch, nothing on the video plane or the
+     * audio output, and stop() leaves them as they are. Attaching matches
+     * the display to the open content and routes audio to the current
+     * sink. Pipelines are created attached.
+     */
+    virtual void setOutputAttached(bool attached) = 0;
+
+    /**
+     * Menu or OSD over playback on displays without a hardware overlay
+     * plane: the compositor blends it into every 32-bit RGB frame shown,
+     * in place, rescaled first if the sizes differ. nullptr removes it.
+     */
+    virtual void setOverlay(std::shared_ptr<const media::OverlayImage> overlay) = 0;
+
+    /** Get per-stage and presentation metrics */
+    virtual PipelineStats getStats() const = 0;
+
+    /**
+     * Watermarks of the buffer model. While playing at 1x, falling under
+     * the low watermark pauses presentation and reports BUFFERING; it
+     * resumes at the resume watermark (start watermark after a seek).
+     * Live sources use kLiveWatermarks instead.
+     */
+    virtual void setBufferWatermarks(const media::BufferWatermarks& watermarks) = 0;
+
+    /** Account for media buffered upstream of the container (segment prefetch) */
+    virtual void setNetworkBufferSource(NetworkBufferSource source) = 0;
+
+    /**
+     * Demux the following open()s from scheduler's downloaded segments
+     * (HLS/DASH), nullptr for a file or progressive URI. Each kind reads
+     * no further than the segments popped for it, seek() repositions the
+     * scheduler too, and the media buffered past the demuxer is reported
+     * to it for ABR. scheduler must outlive the open.
+     */
+    virtual void setSegmentSource(media::SegmentScheduler* scheduler) = 0;
+
+    /** Progress towards playable while buffering, 0-100; 100 when playable */
+    virtual uint8_t getBufferProgress() const = 0;
+
     /** Set status callback */
     virtual void setStatusCallback(PipelineStatusCallback cb) = 0;
 
     /** Set telemetry callback */
     virtual void setTelemetryCallback(PipelineTelemetryCallback cb) = 0;
+
+    /** Set end-of-stream callback; must not call back into the pipeline */
+    virtual void setEndOfStreamCallback(PipelineEndOfStreamCallback cb) = 0;
+};
+
+/** Buffer model for live ingest: every millisecond held is a millisecond of latency */
+inline constexpr media::BufferWatermarks kLiveWatermarks{120000, 200000, 20000};
+
+/** UI mode restore delay after playback, so back-to-back titles do not resync HDMI twice */
+inline constexpr std::chrono::milliseconds kModeRestoreDebounce{1500};
+
+/**
+ * Output side of playback, owned and initialized by the caller and
+ * shared by the pipelines of a session (the item playing and a preloaded
+ * next one). Only an attached pipeline uses them.
+ */
+struct PipelineOutputs {
+    hal::IDisplayHal& display;
+    hal::IVideoPipeline& video;
+    hal::IAudioHal& audio;
+    media::RefreshRateMatcher& rate_matcher;   /* Over display */
 };
 
-std::unique_ptr<IStreamPipeline> createStreamPipeline();
+/**
+ * A pipeline presenting on display, which the caller initializes and
+ * shuts down: the one the UI draws on, shared by every pipeline. The
+ * video plane, audio output and mode matching are the pipeline's own.
+ */
+std::unique_ptr<IStreamPipeline> createStreamPipeline(hal::IDisplayHal& display);
+
+/** A pipeline on shared outputs; it neither initializes nor shuts them down */
+std::unique_ptr<IStreamPipeline> createStreamPipeline(const PipelineOutputs& outputs);
 
 } // namespace streaming::services
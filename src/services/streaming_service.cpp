@@ -6,10 +6,27 @@
 #include "streaming_service.hpp"
 #include "stream_pipeline_service.hpp"
 #include <streaming_device/types.hpp>
+#include "../hal/audio_hal.hpp"
+#include "../hal/storage_hal.hpp"
+#include "../hal/video_pipeline_hal.hpp"
+#include "../media/http_client.hpp"
+#include "../media/media_cache.hpp"
+#include "../media/manifest.hpp"
 #include "../common/logger.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 namespace streaming::services {
 
+static int64_t nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 static StreamState pipelineToStreamState(PipelineState ps) {
     switch (ps) {
         case PipelineState::IDLE:
@@ -23,31 +40,101 @@ static StreamState pipelineToStreamState(PipelineState ps) {
     }
 }
 
+static bool isManifestUri(const std::string& uri) {
+    const std::string path = uri.substr(0, uri.find_first_of("?#"));
+    auto endsWith = [&](const char* ext) {
+        const std::string e(ext);
+        return path.size() >= e.size() && path.compare(path.size() - e.size(), e.size(), e) == 0;
+    };
+    return endsWith(".m3u8") || endsWith(".mpd");
+}
+
+/** Rendition choice and segment prefetch of one adaptive item */
+struct AdaptiveFeed {
+    media::AbrController abr;
+    media::SegmentScheduler scheduler;
+    std::atomic<bool> muxed_audio{false};   /* No audio renditions: audio rides in the video segments */
+
+    AdaptiveFeed(const media::SegmentLoader& loader, media::AbrConfig config)
+        : abr(config), scheduler(loader, abr) {}
+};
+
 class StreamingServiceImpl : public IStreamingService {
 public:
+    /** Without a loader, manifests and segments are fetched over a pooled HttpClient */
+    explicit StreamingServiceImpl(hal::IDisplayHal& display, media::SegmentLoader loader = {})
+        : display_(display),
+          video_(hal::createVideoPipeline()),
+          audio_(hal::createAudioHal()),
+          rate_matcher_(display, kModeRestoreDebounce),
+          http_(loader ? nullptr : std::make_unique<media::HttpClient>()),
+          storage_(hal::createStorageHal()),
+          cache_(*storage_),
+          loader_(loader ? std::move(loader) : http_->loader()) {
+        feed_ = makeFeed();
+    }
+
+    ~StreamingServiceImpl() override {
+        /* Pipelines first: they demux from the feeds' schedulers */
+        stopGaplessWorker();
+        next_.reset();
+        pipeline_.reset();
+    }
+
     device::Result initialize() override {
-        pipeline_ = createStreamPipeline();
-        pipeline_->initialize();
-        pipeline_->setStatusCallback([this](PipelineState ps, const std::string& msg) {
-            state_ = pipelineToStreamState(ps);
-            if (status_cb_) status_cb_(state_, msg);
-        });
+        if (storage_->initialize() != device::Result::OK || cache_.open() != device::Result::OK)
+            LOG_WARN("Streaming", "Segment cache unavailable");
+        audio_->initialize();
+        const hal::DisplayMode mode = display_.getDisplayMode();
+        video_->initialize(mode.width, mode.height);
+        {
+            std::lock_guard<std::mutex> lock(session_mutex_);
+            pipeline_ = makePipeline(*feed_);
+            current_ = pipeline_.get();
+        }
+        std::lock_guard<std::mutex> lock(event_mutex_);
+        if (!gapless_running_) {
+            gapless_running_ = true;
+            gapless_worker_ = std::thread(&StreamingServiceImpl::gaplessLoop, this);
+        }
         return device::Result::OK;
     }
 
     void shutdown() override {
+        stopGaplessWorker();
+        dropNext();
+        std::lock_guard<std::mutex> lock(session_mutex_);
         pipeline_->shutdown();
+        feed_->scheduler.stop();
+        rate_matcher_.flushPendingRestore();
+        video_->shutdown();
+        audio_->shutdown();
+        cache_.flush();
     }
 
     device::Result startSession(const std::string& app_id,
                                 const std::string& content_id,
                                 const std::string& session_id) override {
         LOG_INFO("Streaming", "Start session: ", app_id, content_id, session_id);
+        dropNext();
 
         std::string uri = content_id.empty()
             ? "https://example.com/stream_" + app_id + ".mp4"  /* stub URL */
             : content_id;
+        std::lock_guard<std::mutex> lock(session_mutex_);
+        ended_us_ = -1;
+        const bool adaptive = isManifestUri(uri);
+        if (adaptive) {
+            const device::Result r = startAdaptive(*feed_, uri);
+            if (r != device::Result::OK) {
+                state_ = StreamState::ERROR;
+                return r;
+            }
+        } else {
+            feed_->scheduler.stop();
+        }
 
+        pipeline_->setSegmentSource(adaptive ? &feed_->scheduler : nullptr);
         if (pipeline_->open(uri) != device::Result::OK) {
             state_ = StreamState::ERROR;
             return device::Result::ERROR_NETWORK;
@@ -56,38 +143,385 @@ public:
     }
 
     device::Result stopSession() override {
-        pipeline_->stop();
+        dropNext();
+        {
+            std::lock_guard<std::mutex> lock(session_mutex_);
+            pipeline_->stop();
+            feed_->scheduler.stop();
+            ended_us_ = -1;
+        }
         state_ = StreamState::IDLE;
         if (status_cb_) status_cb_(state_, "");
         return device::Result::OK;
     }
 
     device::Result pause() override {
+        std::lock_guard<std::mutex> lock(session_mutex_);
         return pipeline_->pause();
     }
 
     device::Result resume() override {
+        std::lock_guard<std::mutex> lock(session_mutex_);
         return pipeline_->play();
     }
 
-    device::Result setQuality(device::StreamQuality) override { return device::Result::OK; }
+    device::Result seek(int64_t timestamp_us) override {
+        const StreamState s = state_;
+        if (s == StreamState::IDLE || s == StreamState::ERROR) return device::Result::ERROR_BUSY;
+        /* The pipeline's segment source repositions feed_'s scheduler with the container */
+        std::lock_guard<std::mutex> lock(session_mutex_);
+        ended_us_ = -1;   /* Back into the item: it ends again later */
+        return pipeline_->seek(timestamp_us);
+    }
+
+    device::Result setQuality(device::StreamQuality quality) override {
+        if (quality > device::StreamQuality::ULTRA) return device::Result::ERROR_INVALID_PARAM;
+        {
+            std::lock_guard<std::mutex> lock(session_mutex_);
+            feed_->abr.setQualityCap(quality);
+            if (next_feed_) next_feed_->abr.setQualityCap(quality);
+        }
+        LOG_INFO("Streaming", "Quality cap", static_cast<int>(quality));
+        return device::Result::OK;
+    }
+
+    media::AbrStats getAbrStats() const override {
+        std::lock_guard<std::mutex> lock(session_mutex_);
+        return feed_->abr.getStats();
+    }
+
+    media::SegmentSchedulerStats getSegmentStats() const override {
+        std::lock_guard<std::mutex> lock(session_mutex_);
+        return feed_->scheduler.getStats();
+    }
+
+    media::MediaCacheStats getCacheStats() const override { return cache_.getStats(); }
 
     StreamState getState() const override { return state_; }
 
     void setStatusCallback(StreamStatusCallback cb) override { status_cb_ = std::move(cb); }
 
     uint8_t getBufferProgress() const override {
-        return (state_ == StreamState::BUFFERING) ? 50u : 100u;
+        const StreamState s = state_;
+        if (s == StreamState::IDLE || s == StreamState::ERROR) return 0;
+        std::lock_guard<std::mutex> lock(session_mutex_);
+        return pipeline_ ? pipeline_->getBufferProgress() : 0;
+    }
+
+    device::Result queueNext(const std::string& content_id) override {
+        if (content_id.empty()) return device::Result::ERROR_INVALID_PARAM;
+        const StreamState s = state_;
+        if (s == StreamState::IDLE || s == StreamState::ERROR) return device::Result::ERROR_BUSY;
+        std::unique_ptr<AdaptiveFeed> replaced_feed;
+        std::unique_ptr<IStreamPipeline> replaced;
+        {
+            std::lock_guard<std::mutex> lock(session_mutex_);
+            ++next_generation_;
+            next_content_ = content_id;
+            next_queued_us_ = nowUs();
+            replaced = std::move(next_);
+            replaced_feed = std::move(next_feed_);
+        }
+        closePipeline(std::move(replaced));
+        {
+            std::lock_guard<std::mutex> lock(event_mutex_);
+            preload_pending_ = true;
+        }
+        event_cv_.notify_all();
+        LOG_INFO("Streaming", "Queued next item", content_id);
+        return device::Result::OK;
+    }
+
+    GaplessStats getGaplessStats() const override {
+        std::lock_guard<std::mutex> lock(session_mutex_);
+        GaplessStats stats = gapless_;
+        stats.next_ready = next_ != nullptr;
+        stats.ended = ended_us_ >= 0;
+        stats.next_content = next_content_;
+        /* The new item's first frame lands a vblank or two after play() */
+        if (switch_delay_us_ >= 0 && pipeline_) {
+            const int64_t to_frame = pipeline_->getStats().startup.play_to_frame_us;
+            if (to_frame >= 0) stats.last_gap_us = switch_delay_us_ + to_frame;
+        }
+        return stats;
     }
 
 private:
+    /**
+     * Feed for another item, starting from the session's throughput
+     * estimate and quality cap; serves and stores segments through cache_
+     */
+    std::unique_ptr<AdaptiveFeed> makeFeed() {
+        media::AbrConfig config;
+        if (feed_) config.initial_estimate_bps = feed_->abr.getEstimate();
+        auto feed = std::make_unique<AdaptiveFeed>(loader_, config);
+        if (feed_) feed->abr.setQualityCap(feed_->abr.getStats().cap);
+        feed->scheduler.setCache(&cache_);
+        return feed;
+    }
+
+    /**
+     * A pipeline wired to the service, on the service's outputs, demuxing
+     * adaptive items from feed. Status and network occupancy only flow for
+     * the pipeline being played (current_), so a next item pre-rolling in
+     * the background stays invisible until the switch.
+     */
+    std::unique_ptr<IStreamPipeline> makePipeline(AdaptiveFeed& feed) {
+        std::unique_ptr<IStreamPipeline> p =
+            createStreamPipeline(PipelineOutputs{display_, *video_, *audio_, rate_matcher_});
+        IStreamPipeline* const self = p.get();
+        p->initialize();
+        p->setStatusCallback([this, self](PipelineState ps, const std::string& msg) {
+            if (current_.load() != self) return;
+            state_ = pipelineToStreamState(ps);
+            if (status_cb_) status_cb_(state_, msg);
+        });
+        /* Segments still queued count towards the buffer the pipeline plays
+         * from; a popped one is the demuxer's and shows in its levels */
+        p->setNetworkBufferSource([this, self, &feed](media::BufferOccupancy& video,
+                                                      media::BufferOccupancy& audio) {
+            if (current_.load() != self) return;
+            const media::SegmentSchedulerStats st = feed.scheduler.getStats();
+            video = {st.buffered_video_us, st.buffered_video_bytes};
+            audio = feed.muxed_audio ? media::BufferOccupancy{st.buffered_video_us, 0}
+                                     : media::BufferOccupancy{st.buffered_audio_us, st.buffered_audio_bytes};
+        });
+        p->setEndOfStreamCallback([this, self] {
+            {
+                std::lock_guard<std::mutex> lock(event_mutex_);
+                eos_pipeline_ = self;
+                eos_us_ = nowUs();
+            }
+            event_cv_.notify_all();
+        });
+        return p;
+    }
+
+    static void closePipeline(std::unique_ptr<IStreamPipeline> p) {
+        if (!p) return;
+        p->stop();
+        p->shutdown();
+    }
+
+    /** Forget the queued item and close its pipeline if it was pre-rolled */
+    void dropNext() {
+        std::unique_ptr<AdaptiveFeed> dropped_feed;
+        std::unique_ptr<IStreamPipeline> dropped;
+        {
+            std::lock_guard<std::mutex> lock(session_mutex_);
+            ++next_generation_;
+            next_content_.clear();
+            dropped = std::move(next_);
+            dropped_feed = std::move(next_feed_);
+        }
+        closePipeline(std::move(dropped));
+    }
+
+    void stopGaplessWorker() {
+        {
+            std::lock_guard<std::mutex> lock(event_mutex_);
+            gapless_running_ = false;
+        }
+        event_cv_.notify_all();
+        if (gapless_worker_.joinable()) gapless_worker_.join();
+    }
+
+    /** Preloads queued items and switches to them at end of stream */
+    void gaplessLoop() {
+        std::unique_lock<std::mutex> lock(event_mutex_);
+        while (true) {
+            event_cv_.wait(lock, [this] {
+                return !gapless_running_ || preload_pending_ || eos_pipeline_ != nullptr;
+            });
+            if (!gapless_running_) break;
+            /* Preload first: an item that ends while the next one pre-rolls waits for it */
+            if (preload_pending_) {
+                preload_pending_ = false;
+                lock.unlock();
+                preloadNext();
+                lock.lock();
+                continue;
+            }
+            IStreamPipeline* const ended = eos_pipeline_;
+            const int64_t eos_us = eos_us_;
+            eos_pipeline_ = nullptr;
+            lock.unlock();
+            switchToNext(ended, eos_us);
+            lock.lock();
+        }
+    }
+
+    /**
+     * Open and pre-roll the queued item on a pipeline of its own; an
+     * adaptive item starts prefetching on a feed of its own too, and
+     * pre-rolls from those segments
+     */
+    void preloadNext() {
+        std::string uri;
+        uint64_t generation = 0;
+        {
+            std::lock_guard<std::mutex> lock(session_mutex_);
+            if (next_content_.empty() || next_) return;
+            uri = next_content_;
+            generation = next_generation_;
+        }
+        const bool adaptive = isManifestUri(uri);
+        std::unique_ptr<AdaptiveFeed> feed = makeFeed();
+        device::Result r = adaptive ? startAdaptive(*feed, uri) : device::Result::OK;
+        std::unique_ptr<IStreamPipeline> p;
+        if (r == device::Result::OK) {
+            p = makePipeline(*feed);
+            p->setOutputAttached(false);   /* The current item keeps the display mode, plane and audio */
+            p->setSegmentSource(adaptive ? &feed->scheduler : nullptr);
+            r = p->open(uri);   /* Returns pre-rolled and PAUSED */
+        }
+
+        std::unique_lock<std::mutex> lock(session_mutex_);
+        if (generation != next_generation_) {   /* Replaced or dropped meanwhile */
+            lock.unlock();
+            closePipeline(std::move(p));
+            return;
+        }
+        if (r != device::Result::OK) {
+            LOG_WARN("Streaming", "Cannot preload next item", next_content_);
+            next_content_.clear();
+            lock.unlock();
+            closePipeline(std::move(p));
+            return;
+        }
+        next_ = std::move(p);
+        next_feed_ = std::move(feed);
+        gapless_.preloaded++;
+        gapless_.last_preroll_us = nowUs() - next_queued_us_;
+        LOG_INFO("Streaming", "Next item ready in", gapless_.last_preroll_us, "us");
+        if (ended_us_ < 0) return;
+        IStreamPipeline* const ended = pipeline_.get();
+        const int64_t eos_us = ended_us_;
+        lock.unlock();
+        switchToNext(ended, eos_us);   /* The current item is over already */
+    }
+
+    /** End of stream on ended: start the pre-rolled item, then retire the old pipeline */
+    void switchToNext(IStreamPipeline* ended, int64_t eos_us) {
+        std::unique_ptr<AdaptiveFeed> old_feed;
+        std::unique_ptr<IStreamPipeline> old;
+        {
+            std::lock_guard<std::mutex> lock(session_mutex_);
+            if (ended != pipeline_.get()) return;
+            if (!next_) {
+                /* Nothing pre-rolled yet: the preload switches once it is */
+                ended_us_ = eos_us;
+                return;
+            }
+            ended_us_ = -1;
+            /* Hand the outputs over: the ended item's last frame stays up until the next one's first */
+            pipeline_->setOutputAttached(false);
+            next_->setOutputAttached(true);
+            current_ = next_.get();
+            next_->play();
+            switch_delay_us_ = nowUs() - eos_us;
+            old = std::move(pipeline_);
+            pipeline_ = std::move(next_);
+            /* The new item has been prefetching since its preload */
+            old_feed = std::move(feed_);
+            feed_ = std::move(next_feed_);
+            gapless_.switches++;
+            LOG_INFO("Streaming", "Switched to next item", next_content_);
+            next_content_.clear();
+        }
+        closePipeline(std::move(old));
+        old_feed->scheduler.stop();
+    }
+
+    /** Fetch and parse a manifest; errors as startSession reports them */
+    device::Result loadManifest(const std::string& uri, media::Manifest& manifest) {
+        std::vector<uint8_t> body;
+        const device::Result loaded = loader_({uri, 0, 0}, body);
+        if (loaded != device::Result::OK) {
+            LOG_WARN("Streaming", "Cannot load manifest", uri);
+            return loaded == device::Result::ERROR_NOT_SUPPORTED ? loaded : device::Result::ERROR_NETWORK;
+        }
+        const device::Result parsed =
+            media::ManifestParser::parse(std::string(body.begin(), body.end()), uri, manifest);
+        if (parsed != device::Result::OK || manifest.video.empty()) {
+            LOG_WARN("Streaming", "Unusable manifest", uri);
+            return parsed == device::Result::OK ? device::Result::ERROR_NOT_SUPPORTED : parsed;
+        }
+        return device::Result::OK;
+    }
+
+    /**
+     * Load the manifest, hand its ladder to feed's ABR and start
+     * prefetching. On success uri becomes the first media resource of the
+     * rendition ABR picked, which the pipeline's container opens.
+     */
+    device::Result startAdaptive(AdaptiveFeed& feed, std::string& uri) {
+        media::Manifest manifest;
+        const device::Result loaded = loadManifest(uri, manifest);
+        if (loaded != device::Result::OK) return loaded;
+        feed.abr.setRenditions(media::ManifestParser::ladder(manifest));
+        feed.muxed_audio = manifest.audio.empty();
+        const device::Result started = feed.scheduler.start(std::move(manifest), -1);   /* Live edge / start */
+        if (started != device::Result::OK) return started;
+
+        /* HLS variants load their media playlist on first use; wait for it */
+        const auto deadline = std::chrono::steady_clock::now() + kManifestTimeout;
+        while (std::chrono::steady_clock::now() < deadline) {
+            const media::Manifest m = feed.scheduler.getManifest();
+            const media::MediaTimeline& tl = m.video[feed.scheduler.getStats().video_rendition].timeline;
+            if (!tl.segments.empty()) {
+                uri = tl.init_uri.empty() ? tl.segments.front().uri : tl.init_uri;
+                LOG_INFO("Streaming", "Adaptive session,", m.video.size(), "renditions, live", m.live);
+                return device::Result::OK;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        feed.scheduler.stop();
+        return device::Result::ERROR_TIMEOUT;
+    }
+
+    static constexpr std::chrono::milliseconds kManifestTimeout{3000};
+
+    mutable std::mutex session_mutex_;          /* pipeline_, next_, their feeds and the gapless state below */
     std::unique_ptr<IStreamPipeline> pipeline_;
-    StreamState state_{StreamState::IDLE};
+    std::atomic<IStreamPipeline*> current_{nullptr};   /* The pipeline status is reported for */
+    std::unique_ptr<IStreamPipeline> next_;     /* Pre-rolled next item, PAUSED */
+    std::string next_content_;                  /* Queued content id */
+    uint64_t next_generation_{0};               /* Bumped on queue/drop so stale preloads are discarded */
+    int64_t next_queued_us_{0};
+    int64_t switch_delay_us_{-1};               /* End of stream to play() of the next item */
+    int64_t ended_us_{-1};                      /* pipeline_'s unhandled end of stream; -1 while playing */
+    GaplessStats gapless_;
+
+    std::mutex event_mutex_;                    /* Never held across pipeline calls: EOS arrives from one */
+    std::condition_variable event_cv_;
+    std::thread gapless_worker_;
+    bool gapless_running_{false};
+    bool preload_pending_{false};
+    IStreamPipeline* eos_pipeline_{nullptr};    /* Pipeline whose end of stream is unhandled */
+    int64_t eos_us_{0};
+
+    hal::IDisplayHal& display_;                 /* Every pipeline presents here */
+    std::unique_ptr<hal::IVideoPipeline> video_;   /* One video plane and audio output for all pipelines */
+    std::unique_ptr<hal::IAudioHal> audio_;
+    media::RefreshRateMatcher rate_matcher_;
+    std::unique_ptr<media::HttpClient> http_;   /* Keep-alive pool, unless a loader was injected */
+    std::unique_ptr<hal::IStorageHal> storage_;
+    media::MediaCache cache_;                   /* Segments for re-watching and seeking back */
+    media::SegmentLoader loader_;
+    std::unique_ptr<AdaptiveFeed> feed_;        /* pipeline_'s; session_mutex_ once pipelines run */
+    std::unique_ptr<AdaptiveFeed> next_feed_;   /* next_'s, prefetching for it since the preload */
+    std::atomic<StreamState> state_{StreamState::IDLE};
     StreamStatusCallback status_cb_;
 };
 
-std::unique_ptr<IStreamingService> createStreamingService() {
-    return std::make_unique<StreamingServiceImpl>();
+std::unique_ptr<IStreamingService> createStreamingService(hal::IDisplayHal& display) {
+    return std::make_unique<StreamingServiceImpl>(display);
+}
+
+std::unique_ptr<IStreamingService> createStreamingService(hal::IDisplayHal& display,
+                                                          media::SegmentLoader loader) {
+    return std::make_unique<StreamingServiceImpl>(display, std::move(loader));
 }
 
 } // namespace streaming::services
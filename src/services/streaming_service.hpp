@@ -6,6 +6,10 @@
 #pragma once
 
 #include <streaming_device/types.hpp>
+#include "hal/display_hal.hpp"
+#include "media/abr_controller.hpp"
+#include "media/media_cache.hpp"
+#include "media/segment_scheduler.hpp"
 #include <cstdint>
 #include <functional>
 #include <memory>
@@ -23,6 +27,17 @@ enum class StreamState : uint8_t {
     ERROR
 };
 
+/** Next-item preloading and the switches it made (queueNext) */
+struct GaplessStats {
+    uint64_t preloaded{0};         /* Next items opened and pre-rolled */
+    uint64_t switches{0};          /* End-of-stream switches to a preloaded item */
+    int64_t last_gap_us{-1};       /* Last frame of one item to the first of the next; -1 until shown */
+    int64_t last_preroll_us{-1};   /* queueNext() until that item was ready */
+    bool next_ready{false};        /* A next item is pre-rolled and waiting */
+    bool ended{false};             /* The item played to its end with nothing ready to follow */
+    std::string next_content;      /* Queued content id, empty if none */
+};
+
 /** Stream status callback */
 using StreamStatusCallback = std::function<void(StreamState, const std::string&)>;
 
@@ -41,7 +56,11 @@ public:
     /** Shutdown */
     virtual void shutdown() = 0;
 
-    /** Start streaming session (app-specific pipeline) */
+    /**
+     * Start streaming session (app-specific pipeline). A content id that
+     * names an .m3u8 or .mpd manifest starts an adaptive session: the
+     * manifest is parsed, ABR gets its ladder and segments are prefetched.
+     */
     virtual device::Result startSession(const std::string& app_id,
                                         const std::string& content_id,
                                         const std::string& session_id) = 0;
@@ -53,19 +72,60 @@ public:
     virtual device::Result pause() = 0;
     virtual device::Result resume() = 0;
 
-    /** Set quality */
+    /**
+     * Seek to timestamp_us (the keyframe before it). Adaptive sessions
+     * restart segment prefetch there, and segments already watched come
+     * from the segment cache instead of the network.
+     */
+    virtual device::Result seek(int64_t timestamp_us) = 0;
+
+    /**
+     * Set quality. AUTO lets adaptive bitrate use the whole ladder;
+     * LOW/MEDIUM/HIGH/ULTRA cap it at 480p/720p/1080p/no limit.
+     */
     virtual device::Result setQuality(device::StreamQuality quality) = 0;
 
+    /** Adaptive bitrate state: selected rendition, throughput estimate, switches */
+    virtual media::AbrStats getAbrStats() const = 0;
+
+    /** Segment prefetch state of an HLS/DASH session */
+    virtual media::SegmentSchedulerStats getSegmentStats() const = 0;
+
+    /** Persistent segment cache: hits, evictions, bytes used against the storage budget */
+    virtual media::MediaCacheStats getCacheStats() const = 0;
+
     /** Get current state */
     virtual StreamState getState() const = 0;
 
     /** Register status callback */
     virtual void setStatusCallback(StreamStatusCallback cb) = 0;
 
-    /** Get buffering progress 0-100 */
+    /** Progress towards playable from the pipeline's buffer model, 0-100; 0 without a session */
     virtual uint8_t getBufferProgress() const = 0;
+
+    /**
+     * Queue the item to play when the current one ends (autoplay next
+     * episode). Its container is opened, probed and its decoders pre-rolled
+     * in the background on a second pipeline, so at end of stream the
+     * switch is a pipeline swap with no black gap. Queued after the current
+     * item has already ended, it starts as soon as it is pre-rolled.
+     * Queuing again replaces the pending item; starting or stopping a
+     * session drops it.
+     */
+    virtual device::Result queueNext(const std::string& content_id) = 0;
+
+    virtual GaplessStats getGaplessStats() const = 0;
 };
 
-std::unique_ptr<IStreamingService> createStreamingService();
+/**
+ * Video is presented on display, which the caller initializes and shuts
+ * down (the UI's display). HLS/DASH manifests and segments are fetched
+ * with a keep-alive media::HttpClient.
+ */
+std::unique_ptr<IStreamingService> createStreamingService(hal::IDisplayHal& display);
+
+/** As above, fetching through loader instead (tests, platform network stacks) */
+std::unique_ptr<IStreamingService> createStreamingService(hal::IDisplayHal& display,
+                                                          media::SegmentLoader loader);
 
 } // namespace streaming::services
@@ -0,0 +1,161 @@
+/**
+ * @file rtp_loopback_sender.cpp
+ * @brief RtpLoopbackSender implementation
+ */
+
+#include "rtp_loopback_sender.hpp"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <random>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace streaming::media {
+
+namespace {
+
+constexpr uint32_t kVideoClockRate = 90000;
+constexpr uint32_t kAacFrameSamples = 1024;
+constexpr uint8_t kHevcFragment = 49;        /* RFC 7798 FU */
+constexpr uint8_t kHevcIdrWRadl = 19;
+constexpr uint8_t kHevcTrailR = 1;
+
+int64_t steadyUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int64_t wallUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+RtpLoopbackSender::RtpLoopbackSender(RtpLoopbackConfig config) : config_(std::move(config)) {}
+
+RtpLoopbackSender::~RtpLoopbackSender() { stop(); }
+
+device::Result RtpLoopbackSender::start() {
+    if (running_) return device::Result::ERROR_BUSY;
+    in_addr addr{};
+    if (config_.port == 0 || inet_pton(AF_INET, config_.host.c_str(), &addr) != 1)
+        return device::Result::ERROR_INVALID_PARAM;
+    address_ = addr.s_addr;
+    fd_ = ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd_ < 0) return device::Result::ERROR_NETWORK;
+    running_ = true;
+    worker_ = std::thread(&RtpLoopbackSender::sendLoop, this);
+    return device::Result::OK;
+}
+
+void RtpLoopbackSender::stop() {
+    running_ = false;
+    if (worker_.joinable()) worker_.join();
+    if (fd_ >= 0) ::close(fd_);
+    fd_ = -1;
+}
+
+void RtpLoopbackSender::send(const RtpPacket& packet) {
+    sockaddr_in to{};
+    to.sin_family = AF_INET;
+    to.sin_port = htons(config_.port);
+    to.sin_addr.s_addr = address_;
+    const std::vector<uint8_t> datagram = packet.serialize(config_.capture_ext_id);
+    if (::sendto(fd_, datagram.data(), datagram.size(), 0, reinterpret_cast<sockaddr*>(&to), sizeof(to)) > 0)
+        packets_++;
+}
+
+void RtpLoopbackSender::packetizeFrame(uint64_t index, int64_t capture_us, std::vector<RtpPacket>& out) {
+    const bool key = index % config_.gop_frames == 0;
+    const uint8_t nal_type = key ? kHevcIdrWRadl : kHevcTrailR;
+    std::vector<uint8_t> nal(key ? config_.keyframe_bytes : config_.frame_bytes, 0);
+    nal[0] = static_cast<uint8_t>(nal_type << 1);
+    nal[1] = 1;   /* nuh_temporal_id_plus1 */
+
+    RtpPacket base;
+    base.payload_type = 96;
+    base.ssrc = 0x5EED0001;
+    base.timestamp = static_cast<uint32_t>(index * kVideoClockRate * config_.frame_rate_den / config_.frame_rate_num);
+    base.capture_time_us = config_.capture_ext_id != 0 ? capture_us : -1;
+    if (nal.size() <= config_.max_payload) {
+        RtpPacket p = base;
+        p.sequence = video_seq_++;
+        p.marker = true;
+        p.payload = std::move(nal);
+        out.push_back(std::move(p));
+        return;
+    }
+    for (size_t offset = 2; offset < nal.size();) {
+        const size_t chunk = std::min(config_.max_payload - 3, nal.size() - offset);
+        RtpPacket p = base;
+        p.sequence = video_seq_++;
+        p.payload = {static_cast<uint8_t>(kHevcFragment << 1), nal[1],
+                     static_cast<uint8_t>((offset == 2 ? 0x80 : 0) |
+                                          (offset + chunk == nal.size() ? 0x40 : 0) | nal_type)};
+        p.payload.insert(p.payload.end(), nal.begin() + offset, nal.begin() + offset + chunk);
+        offset += chunk;
+        p.marker = offset == nal.size();
+        out.push_back(std::move(p));
+    }
+}
+
+void RtpLoopbackSender::sendLoop() {
+    std::minstd_rand rng(42);
+    const int64_t frame_us = 1000000LL * config_.frame_rate_den / config_.frame_rate_num;
+    const int64_t audio_us = 1000000LL * kAacFrameSamples / 48000;
+    const int64_t begin = steadyUs();
+    uint64_t frame = 0;
+    uint64_t audio_frame = 0;
+    uint64_t datagrams = 0;
+    std::vector<RtpPacket> packets;
+    while (running_) {
+        const int64_t next_video = begin + static_cast<int64_t>(frame) * frame_us;
+        const int64_t next_audio = config_.audio ? begin + static_cast<int64_t>(audio_frame) * audio_us : INT64_MAX;
+        const int64_t due = std::min(next_video, next_audio);
+        const int64_t now = steadyUs();
+        if (due > now) {
+            std::this_thread::sleep_for(std::chrono::microseconds(std::min<int64_t>(due - now, 5000)));
+            continue;
+        }
+        packets.clear();
+        if (next_audio < next_video) {
+            RtpPacket p;
+            p.payload_type = 97;
+            p.ssrc = 0x5EED0002;
+            p.sequence = audio_seq_++;
+            p.timestamp = static_cast<uint32_t>(audio_frame * kAacFrameSamples);
+            p.marker = true;
+            p.capture_time_us = config_.capture_ext_id != 0 ? wallUs() - (steadyUs() - next_audio) : -1;
+            const size_t au_size = 384;
+            p.payload = {0, 16, static_cast<uint8_t>(au_size >> 5), static_cast<uint8_t>((au_size & 0x1F) << 3)};
+            p.payload.resize(4 + au_size, 0);
+            packets.push_back(std::move(p));
+            ++audio_frame;
+        } else {
+            const int64_t capture = wallUs() - (steadyUs() - next_video);   /* The frame's tick */
+            if (config_.jitter_us > 0) {
+                std::uniform_int_distribution<int64_t> delay(0, config_.jitter_us);
+                std::this_thread::sleep_for(std::chrono::microseconds(delay(rng)));
+            }
+            packetizeFrame(frame, capture, packets);
+            ++frame;
+            frames_++;
+        }
+        for (size_t i = 0; i < packets.size(); ++i) {
+            /* Swap a pair now and then: the receiver has to put them back in order */
+            if (config_.reorder_every != 0 && i + 1 < packets.size() && ++datagrams % config_.reorder_every == 0) {
+                send(packets[i + 1]);
+                send(packets[i]);
+                ++i;
+                continue;
+            }
+            send(packets[i]);
+        }
+    }
+}
+
+} // namespace streaming::media
@@ -0,0 +1,74 @@
+/**
+ * @file rtp_loopback_sender.hpp
+ * @brief Synthetic RTP source for the live ingest tests
+ *
+ * Produces the stream RtpLiveParser expects (paced HEVC, optional AAC)
+ * on a UDP socket, for the latency and loss tests.
+ */
+
+#pragma once
+
+#include <streaming_device/types.hpp>
+#include "media/jitter_buffer.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace streaming::media {
+
+/** Synthetic RTP stream for RtpLiveParser */
+struct RtpLoopbackConfig {
+    std::string host{"127.0.0.1"};
+    uint16_t port{0};
+    uint32_t frame_rate_num{50};
+    uint32_t frame_rate_den{1};
+    uint32_t gop_frames{50};           /* Keyframe interval */
+    size_t keyframe_bytes{40000};
+    size_t frame_bytes{6000};
+    size_t max_payload{1200};          /* Larger NAL units are sent as fragmentation units */
+    bool audio{false};                 /* Also send AAC (RFC 3640) at 48 kHz */
+    int64_t jitter_us{0};              /* Each frame leaves up to this late */
+    uint32_t reorder_every{0};         /* Swap every Nth pair of datagrams, 0: in order */
+    uint8_t capture_ext_id{1};         /* abs-capture-time id, 0: not sent */
+};
+
+/**
+ * @brief Paced HEVC (+AAC) RTP sender on a UDP socket
+ *
+ * Frames are stamped with the capture (send) time, so a receiver on the
+ * same host measures true glass-to-glass latency.
+ */
+class RtpLoopbackSender {
+public:
+    explicit RtpLoopbackSender(RtpLoopbackConfig config);
+    ~RtpLoopbackSender();
+
+    RtpLoopbackSender(const RtpLoopbackSender&) = delete;
+    RtpLoopbackSender& operator=(const RtpLoopbackSender&) = delete;
+
+    device::Result start();
+    void stop();
+
+    uint64_t getFramesSent() const { return frames_.load(); }
+    uint64_t getPacketsSent() const { return packets_.load(); }
+
+private:
+    void sendLoop();
+    void packetizeFrame(uint64_t index, int64_t capture_us, std::vector<RtpPacket>& out);
+    void send(const RtpPacket& packet);
+
+    const RtpLoopbackConfig config_;
+    int fd_{-1};
+    uint32_t address_{0};              /* Destination, network byte order */
+    std::thread worker_;
+    std::atomic<bool> running_{false};
+    std::atomic<uint64_t> frames_{0};
+    std::atomic<uint64_t> packets_{0};
+    uint16_t video_seq_{0};
+    uint16_t audio_seq_{0};
+};
+
+} // namespace streaming::media
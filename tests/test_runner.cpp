@@ -8,17 +8,65 @@
 #include "hal/storage_hal.hpp"
 #include "hal/hdmi_cec_hal.hpp"
 #include "drivers/mock/mock_input_driver.hpp"
+#include "drivers/mock/mock_display_driver.hpp"
+#include "drivers/mock/mock_wifi_driver.hpp"
+#include "drivers/mock/mock_storage_driver.hpp"
+#include "drivers/mock/mock_container_parser.hpp"
 #include "services/app_launcher_service.hpp"
 #include "services/ui_service.hpp"
 #include "services/config_service.hpp"
+#include "services/dns_cache_service.hpp"
+#include "services/network_monitor_service.hpp"
 #include "services/hdmi_cec_service.hpp"
 #include "services/bluetooth_control_service.hpp"
 #include "services/codec_service.hpp"
 #include "services/container_service.hpp"
 #include "services/stream_pipeline_service.hpp"
+#include "services/streaming_service.hpp"
 #include "hal/container_hal.hpp"
+#include "media/presentation_scheduler.hpp"
+#include "media/refresh_rate_matcher.hpp"
+#include "media/frame_pool.hpp"
+#include "media/compositor.hpp"
+#include "media/media_clock.hpp"
+#include "media/pcm_ring.hpp"
+#include "media/audio_converter.hpp"
+#include "media/buffer_model.hpp"
+#include "media/iec61937.hpp"
+#include "media/seek_coalescer.hpp"
+#include "media/abr_controller.hpp"
+#include "media/manifest.hpp"
+#include "media/segment_scheduler.hpp"
+#include "media/segment_source.hpp"
+#include "media/http_client.hpp"
+#include "media/media_cache.hpp"
+#include "media/jitter_buffer.hpp"
+#include "media/rtp_ingest.hpp"
+#include "common/event_bus.hpp"
+#include "common/memory_governor.hpp"
+#include "common/spsc_queue.hpp"
+#include "hal/video_pipeline_hal.hpp"
+#include "hal/audio_hal.hpp"
+#include "rtp_loopback_sender.hpp"
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
 
 #define ASSERT(cond) do { if (!(cond)) { std::cerr << "FAIL: " << #cond << "\n"; ++failures; } else { ++passed; } } while(0)
 #define TEST(name) std::cout << "Test: " << (name) << " ... "; std::cout.flush()
@@ -37,6 +85,92 @@ void run_hal_tests() {
     ASSERT(display->clear() == streaming::device::Result::OK);
     TEST_END();
 
+    TEST("Display swap chain page flip");
+    streaming::hal::SwapChainBuffer back;
+    ASSERT(display->getSwapChainLength() == 3);
+    ASSERT(display->acquireBackBuffer(back) == streaming::device::Result::OK);
+    ASSERT(back.framebuffer.base_address != nullptr);
+    ASSERT(back.framebuffer.base_address != display->getFramebuffer().base_address);
+    streaming::hal::SwapChainBuffer second;
+    ASSERT(display->acquireBackBuffer(second) == streaming::device::Result::OK);
+    streaming::hal::SwapChainBuffer third;
+    ASSERT(display->acquireBackBuffer(third) == streaming::device::Result::ERROR_TIMEOUT);
+    std::mutex flip_mutex;
+    std::condition_variable flip_cv;
+    uint64_t flipped_seq = 0;
+    ASSERT(display->queuePresent(back.index, [&](const streaming::hal::VblankInfo& v) {
+        {
+            std::lock_guard<std::mutex> lock(flip_mutex);
+            flipped_seq = v.sequence;
+        }
+        flip_cv.notify_all();
+    }) == streaming::device::Result::OK);
+    ASSERT(display->queuePresent(back.index) == streaming::device::Result::ERROR_INVALID_PARAM);
+    streaming::hal::VblankInfo vblank;
+    ASSERT(display->waitForVblank(vblank, 100) == streaming::device::Result::OK);
+    {
+        std::unique_lock<std::mutex> lock(flip_mutex);
+        ASSERT(flip_cv.wait_for(lock, std::chrono::milliseconds(200), [&] { return flipped_seq != 0; }));
+    }
+    auto* mock_display = dynamic_cast<streaming::drivers::mock::MockDisplayDriver*>(display.get());
+    ASSERT(mock_display != nullptr && mock_display->getScanoutIndex() == back.index);
+    /* Previous front buffer retired at the flip, so a third acquire now succeeds */
+    ASSERT(display->acquireBackBuffer(third, 50) == streaming::device::Result::OK);
+    TEST_END();
+
+    TEST("Display mode switch with a busy swap chain");
+    {
+        using streaming::device::Result;
+        const streaming::hal::DisplayMode uhd{3840, 2160, 50, streaming::hal::PixelFormat::RGBA8888, false};
+        /* second and third are still being drawn */
+        ASSERT(display->setDisplayMode(uhd) == Result::ERROR_BUSY);
+        ASSERT(display->getDisplayMode().width == 1920);
+        ASSERT(display->queuePresent(second.index) == Result::OK);
+        ASSERT(display->queuePresent(third.index) == Result::OK);
+        /* Both queued flips are shown before the swap chain is reallocated */
+        ASSERT(display->setDisplayMode(uhd) == Result::OK);
+        ASSERT(mock_display->getScanoutIndex() == third.index);
+        ASSERT(display->getFramebuffer().size_bytes == 3840u * 2160u * 4u);
+        streaming::hal::SwapChainBuffer a, b, c;
+        ASSERT(display->acquireBackBuffer(a, 0) == Result::OK);
+        ASSERT(display->acquireBackBuffer(b, 0) == Result::OK);
+        ASSERT(a.index != third.index && b.index != third.index);
+        ASSERT(a.framebuffer.size_bytes == 3840u * 2160u * 4u && a.framebuffer.width == 3840);
+        ASSERT(display->acquireBackBuffer(c, 0) == Result::ERROR_TIMEOUT);
+        ASSERT(display->setDisplayMode({1920, 1080, 60, streaming::hal::PixelFormat::RGBA8888, false}) ==
+               Result::ERROR_BUSY);
+        ASSERT(display->queuePresent(a.index) == Result::OK);
+        ASSERT(display->queuePresent(b.index) == Result::OK);
+        ASSERT(display->setDisplayMode({1920, 1080, 60, streaming::hal::PixelFormat::RGBA8888, false}) ==
+               Result::OK);
+        ASSERT(mock_display->getScanoutIndex() == b.index);
+        ASSERT(display->getFramebuffer().size_bytes == 1920u * 1080u * 4u);
+    }
+    TEST_END();
+
+    TEST("Display mode switch cancels flips that cannot latch");
+    {
+        using streaming::device::Result;
+        streaming::hal::SwapChainBuffer a, b;
+        ASSERT(display->acquireBackBuffer(a, 0) == Result::OK);
+        ASSERT(display->acquireBackBuffer(b, 0) == Result::OK);
+        /* No vblank after shutdown: the flips stay queued */
+        ASSERT(display->shutdown() == Result::OK);
+        int dropped = 0;
+        auto on_flip = [&](const streaming::hal::VblankInfo& v) { if (v.dropped) ++dropped; };
+        ASSERT(display->queuePresent(a.index, on_flip) == Result::OK);
+        ASSERT(display->queuePresent(b.index, on_flip) == Result::OK);
+        ASSERT(display->setDisplayMode({1280, 720, 60, streaming::hal::PixelFormat::RGBA8888, false}) ==
+               Result::OK);
+        ASSERT(dropped == 2);
+        streaming::hal::SwapChainBuffer c;
+        ASSERT(display->acquireBackBuffer(c, 0) == Result::OK);
+        ASSERT(display->queuePresent(c.index, on_flip) == Result::OK);
+        ASSERT(display->shutdown() == Result::OK);
+        ASSERT(dropped == 3);
+    }
+    TEST_END();
+
     TEST("Input init and inject");
     auto input = streaming::hal::createInputHal();
     ASSERT(input->initialize() == streaming::device::Result::OK);
@@ -91,6 +225,200 @@ void run_service_tests() {
     ASSERT(config->getString("wifi.ssid", ssid) == streaming::device::Result::OK);
     ASSERT(ssid == "MyNetwork");
     TEST_END();
+
+    TEST("DNS Cache Service - TTL, serve-stale, boot prefetch");
+    {
+        using streaming::device::Result;
+        auto wifi_owned = std::make_unique<streaming::drivers::mock::MockWifiDriver>();
+        auto* wifi = wifi_owned.get();
+        wifi->setHostAddress("cdn.netflix.com", "10.0.0.1");
+        wifi->setHostAddress("auth.netflix.com", "10.0.0.2");
+        wifi->setHostAddress("www.hulu.com", "10.0.0.3");
+        wifi->setResolveDelayMs(30);   /* A slow resolver makes blocking visible */
+        streaming::services::DnsCacheConfig cfg;
+        cfg.ttl_us = 200000;
+        cfg.stale_us = 400000;
+        cfg.negative_ttl_us = 200000;
+        auto dns = streaming::services::createDnsCacheService(std::move(wifi_owned), cfg);
+        ASSERT(dns->initialize() == Result::OK);
+
+        ASSERT(streaming::services::hostOfUri("https://user@CDN.Netflix.com:8443/app?x=1") == "cdn.netflix.com");
+        ASSERT(streaming::services::hostOfUri("http://[::1]:80/") == "::1");
+        ASSERT(streaming::services::hostOfUri("/local/path").empty());
+
+        /* Boot: app hosts resolve in the background, the caller is not held */
+        auto t0 = std::chrono::steady_clock::now();
+        dns->prefetchApps({{"netflix", "Netflix", "", "https://cdn.netflix.com/app", "https://auth.netflix.com/login", true},
+                           {"hulu", "Hulu", "", "https://www.hulu.com", "", true},
+                           {"local", "Local", "", "file:///apps/local", "", false}});
+        ASSERT(std::chrono::steady_clock::now() - t0 < std::chrono::milliseconds(20));
+        for (int i = 0; i < 100 && dns->getStats().refreshes < 3; ++i)
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        auto st = dns->getStats();
+        ASSERT(st.prefetched == 3 && st.refreshes == 3 && st.entries == 3);
+
+        /* Launch-time lookups are cache hits: no HAL call, no delay */
+        const uint32_t hal_calls = wifi->getResolveCount();
+        std::string ip;
+        t0 = std::chrono::steady_clock::now();
+        ASSERT(dns->resolve("cdn.netflix.com", ip) == Result::OK && ip == "10.0.0.1");
+        ASSERT(dns->resolve("auth.netflix.com", ip) == Result::OK && ip == "10.0.0.2");
+        ASSERT(std::chrono::steady_clock::now() - t0 < std::chrono::milliseconds(20));
+        ASSERT(wifi->getResolveCount() == hal_calls && dns->getStats().hits == 2);
+        ASSERT(dns->resolve("10.1.2.3", ip) == Result::OK && ip == "10.1.2.3");
+
+        /* Expired: the old answer is served at once and refreshed behind it */
+        wifi->setHostAddress("cdn.netflix.com", "10.0.0.9");
+        std::this_thread::sleep_for(std::chrono::milliseconds(250));
+        t0 = std::chrono::steady_clock::now();
+        ASSERT(dns->resolve("cdn.netflix.com", ip) == Result::OK && ip == "10.0.0.1");
+        ASSERT(std::chrono::steady_clock::now() - t0 < std::chrono::milliseconds(20));
+        ASSERT(dns->getStats().stale_hits == 1);
+        std::this_thread::sleep_for(std::chrono::milliseconds(80));
+        ASSERT(dns->resolve("cdn.netflix.com", ip) == Result::OK && ip == "10.0.0.9");
+
+        /* Resolver down: stale answers keep working, a refresh failure does not evict */
+        wifi->setResolveFailure(true);
+        std::this_thread::sleep_for(std::chrono::milliseconds(250));
+        ASSERT(dns->resolve("cdn.netflix.com", ip) == Result::OK && ip == "10.0.0.9");
+        std::this_thread::sleep_for(std::chrono::milliseconds(80));
+        ASSERT(dns->resolve("cdn.netflix.com", ip) == Result::OK && ip == "10.0.0.9");
+
+        /* An unknown host blocks once, then fails fast for the negative TTL */
+        ASSERT(dns->resolve("new.example.com", ip) == Result::ERROR_NETWORK);
+        const uint32_t after_miss = wifi->getResolveCount();
+        ASSERT(dns->resolve("new.example.com", ip) == Result::ERROR_NETWORK);
+        ASSERT(wifi->getResolveCount() == after_miss && dns->getStats().negative_hits == 1);
+        /* Nor does a prefetch retry it before the negative TTL runs out */
+        const uint64_t prefetched = dns->getStats().prefetched;
+        dns->prefetch({"new.example.com", "NEW.example.com"});
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        ASSERT(wifi->getResolveCount() == after_miss && dns->getStats().prefetched == prefetched);
+        wifi->setResolveFailure(false);
+        std::this_thread::sleep_for(std::chrono::milliseconds(210));
+        ASSERT(dns->resolve("new.example.com", ip) == Result::OK && ip == "127.0.0.1");
+        ASSERT(dns->getStats().misses == 2);
+
+        /* Names are case-insensitive: one entry, no second lookup */
+        const uint32_t before_case = wifi->getResolveCount();
+        ASSERT(dns->resolve("New.Example.COM.", ip) == Result::OK && ip == "127.0.0.1");
+        ASSERT(wifi->getResolveCount() == before_case);
+
+        /* Concurrent misses for one host share a single HAL lookup */
+        wifi->setHostAddress("burst.example.com", "10.0.0.7");
+        const uint32_t before_burst = wifi->getResolveCount();
+        std::string ip_a, ip_b;
+        std::thread other([&] { dns->resolve("burst.example.com", ip_a); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        ASSERT(dns->resolve("Burst.example.com", ip_b) == Result::OK);
+        other.join();
+        ASSERT(ip_a == "10.0.0.7" && ip_b == "10.0.0.7");
+        ASSERT(wifi->getResolveCount() == before_burst + 1 && dns->getStats().coalesced == 1);
+
+        dns->flush();
+        ASSERT(dns->getStats().entries == 0);
+        dns->shutdown();
+    }
+    TEST_END();
+
+    TEST("Network Monitor Service - bandwidth bands, signal discount, scans deferred during playback");
+    {
+        using streaming::services::BandwidthBand;
+        auto wifi_owned = std::make_unique<streaming::drivers::mock::MockWifiDriver>();
+        auto* wifi = wifi_owned.get();
+        streaming::services::NetworkMonitorConfig cfg;
+        cfg.sample_interval_us = 60000000;   /* Sampled by hand below */
+        cfg.scan_interval_us = 0;
+        auto net = streaming::services::createNetworkMonitorService(std::move(wifi_owned), cfg);
+        ASSERT(net->initialize() == streaming::device::Result::OK);
+
+        std::mutex events_mutex;
+        std::vector<BandwidthBand> published;
+        streaming::common::EventBus::instance().subscribe(streaming::common::events::NETWORK_QUALITY,
+            [&](const streaming::common::Event& e) {
+                auto q = std::static_pointer_cast<streaming::services::NetworkQualityEvent>(e.payload);
+                std::lock_guard<std::mutex> lock(events_mutex);
+                published.push_back(q->band);
+            });
+
+        net->sample();
+        ASSERT(net->getStats().band == BandwidthBand::OFFLINE);
+
+        /* Associated, nothing downloaded yet: the link rate stands in */
+        wifi->connect("TestNetwork", "secret");
+        wifi->setLinkInfo(-50, 433);
+        net->sample();
+        auto st = net->getStats();
+        ASSERT(st.band == BandwidthBand::EXCELLENT && st.rssi == -50);
+        ASSERT(st.predicted_bps == 216500000);
+
+        /* 2 Mbit/s achieved: the drop is reported at once */
+        net->recordTransfer(250000, 1000000);
+        net->recordTransfer(1000, 1000);   /* Playlist sized, latency bound: ignored */
+        net->sample();
+        st = net->getStats();
+        ASSERT(st.band == BandwidthBand::POOR && st.throughput_bps == 2000000);
+        ASSERT(st.transfers == 2 && st.transfers_ignored == 1);
+
+        /* 20 Mbit/s: the harmonic mean lets the slow sample go slowly, rises need two samples */
+        std::vector<BandwidthBand> rising;
+        for (int i = 0; i < 9; ++i) {
+            net->recordTransfer(2500000, 1000000);
+            net->sample();
+            rising.push_back(net->getStats().band);
+        }
+        ASSERT(rising.front() == BandwidthBand::POOR);
+        ASSERT(rising[rising.size() - 2] == BandwidthBand::FAIR && rising.back() == BandwidthBand::GOOD);
+        ASSERT(std::llabs(static_cast<long long>(net->getStats().predicted_bps) - 16000000) < 100);
+        ASSERT(std::is_sorted(rising.begin(), rising.end()));
+
+        /* Signal falls 30 dB into weak territory: same throughput, lower prediction */
+        wifi->setLinkInfo(-80, 65);
+        net->recordTransfer(2500000, 1000000);
+        net->sample();
+        st = net->getStats();
+        ASSERT(st.band == BandwidthBand::FAIR && std::llabs(static_cast<long long>(st.predicted_bps) - 5600000) < 100);
+
+        /* Instrumented loader: successful fetches are timed and recorded */
+        auto loader = net->instrument([](const streaming::media::SegmentRequest&, std::vector<uint8_t>& body) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            body.assign(100000, 0);
+            return streaming::device::Result::OK;
+        });
+        std::vector<uint8_t> body;
+        ASSERT(loader({"http://cdn/seg1.m4s", 0, 0}, body) == streaming::device::Result::OK);
+        ASSERT(net->getStats().transfers == st.transfers + 1 && net->getStats().transfers_ignored == 1);
+        net->sample();
+        const auto history = net->getHistory();
+        ASSERT(history.size() == 14 && history.back().throughput_bps > 0 &&
+               history.back().throughput_bps <= 160000000);
+
+        /* Scans wait for playback to stop, then run */
+        net->setPlaybackActive(true);
+        net->requestScan();
+        net->sample();
+        net->sample();
+        st = net->getStats();
+        ASSERT(st.scans == 0 && st.scans_deferred == 1 && st.playback_active);
+        ASSERT(wifi->getScanCount() == 0);
+        net->setPlaybackActive(false);   /* Wakes the worker for the postponed scan */
+        for (int i = 0; i < 100 && net->getStats().scans == 0; ++i)
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        ASSERT(net->getStats().scans == 1 && wifi->getScanCount() == 1);
+        ASSERT(net->getLastScan().size() == 1 && net->getLastScan()[0].rssi == -80);
+
+        wifi->disconnect();
+        net->sample();
+        ASSERT(net->getStats().band == BandwidthBand::OFFLINE);
+        net->shutdown();
+        streaming::common::EventBus::instance().unsubscribe(streaming::common::events::NETWORK_QUALITY);
+
+        std::lock_guard<std::mutex> lock(events_mutex);
+        ASSERT((published == std::vector<BandwidthBand>{BandwidthBand::EXCELLENT, BandwidthBand::POOR,
+                                                        BandwidthBand::FAIR, BandwidthBand::GOOD,
+                                                        BandwidthBand::FAIR, BandwidthBand::OFFLINE}));
+    }
+    TEST_END();
 }
 
 void run_cec_tests() {
@@ -106,9 +434,147 @@ void run_cec_tests() {
     TEST_END();
 }
 
+/**
+ * Loopback HTTP/1.1 origin for the client tests: keep-alive, pipelining,
+ * Range. /data.bin is 1 MiB of byte i = i * 7; /chunked.m3u8 is sent
+ * chunked; /close answers with Connection: close; anything else is 404.
+ */
+class LoopbackHttpServer {
+public:
+    LoopbackHttpServer() {
+        for (size_t i = 0; i < data_.size(); ++i) data_[i] = static_cast<uint8_t>(i * 7);
+        listen_fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        ::bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        ::listen(listen_fd_, 8);
+        socklen_t len = sizeof(addr);
+        ::getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&addr), &len);
+        port_ = ntohs(addr.sin_port);
+        acceptor_ = std::thread([this] { acceptLoop(); });
+    }
+
+    ~LoopbackHttpServer() {
+        running_ = false;
+        acceptor_.join();
+        dropConnections();
+        for (auto& t : handlers_) t.join();
+        ::close(listen_fd_);
+    }
+
+    std::string url(const std::string& path) const {
+        return "http://127.0.0.1:" + std::to_string(port_) + path;
+    }
+    const std::vector<uint8_t>& data() const { return data_; }
+    uint32_t accepted() const { return accepted_; }
+    uint32_t served() const { return served_; }
+
+    /** Close every open connection without a response, like an idle timeout */
+    void dropConnections() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (int fd : open_) ::shutdown(fd, SHUT_RDWR);
+    }
+
+private:
+    void acceptLoop() {
+        while (running_) {
+            pollfd pfd{listen_fd_, POLLIN, 0};
+            if (::poll(&pfd, 1, 20) <= 0) continue;
+            const int fd = ::accept(listen_fd_, nullptr, nullptr);
+            if (fd < 0) continue;
+            ++accepted_;
+            std::lock_guard<std::mutex> lock(mutex_);
+            open_.push_back(fd);
+            handlers_.emplace_back([this, fd] { serve(fd); });
+        }
+    }
+
+    void serve(int fd) {
+        std::string rx;
+        char buf[4096];
+        for (;;) {
+            size_t end;
+            while ((end = rx.find("\r\n\r\n")) == std::string::npos) {
+                const ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+                if (n <= 0) return finish(fd);
+                rx.append(buf, static_cast<size_t>(n));
+            }
+            const std::string head = rx.substr(0, end);
+            rx.erase(0, end + 4);
+            const std::string path = head.substr(4, head.find(' ', 4) - 4);
+            ++served_;
+
+            std::string reply;
+            bool close_after = false;
+            if (path == "/data.bin") {
+                uint64_t first = 0, last = data_.size() - 1;
+                const size_t range = head.find("Range: bytes=");
+                if (range != std::string::npos) {
+                    first = std::strtoull(head.c_str() + range + 13, nullptr, 10);
+                    const size_t dash = head.find('-', range + 13);
+                    if (std::isdigit(static_cast<unsigned char>(head[dash + 1])))
+                        last = std::min<uint64_t>(std::strtoull(head.c_str() + dash + 1, nullptr, 10), last);
+                }
+                const std::string body(data_.begin() + static_cast<long>(first), data_.begin() + static_cast<long>(last) + 1);
+                reply = range != std::string::npos
+                    ? "HTTP/1.1 206 Partial Content\r\nContent-Range: bytes " + std::to_string(first) + "-" +
+                      std::to_string(last) + "/" + std::to_string(data_.size()) + "\r\n"
+                    : "HTTP/1.1 200 OK\r\n";
+                reply += "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+            } else if (path == "/chunked.m3u8") {
+                reply = "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+                        "8\r\n#EXTM3U\n\r\n10\r\n#EXT-X-ENDLIST\n\n\r\n0\r\n\r\n";
+            } else if (path == "/huge" || path == "/negative") {
+                /* A broken or hostile length; nothing follows it */
+                reply = std::string("HTTP/1.1 200 OK\r\nContent-Length: ") +
+                        (path == "/huge" ? "99999999999999" : "-5") + "\r\n\r\n";
+                close_after = true;
+            } else if (path == "/close") {
+                reply = "HTTP/1.1 200 OK\r\nConnection: close\r\nContent-Length: 3\r\n\r\nbye";
+                close_after = true;
+            } else {
+                reply = "HTTP/1.1 404 Not Found\r\nContent-Length: 9\r\n\r\nnot found";
+            }
+            if (::send(fd, reply.data(), reply.size(), MSG_NOSIGNAL) < 0 || close_after) return finish(fd);
+        }
+    }
+
+    void finish(int fd) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        open_.erase(std::remove(open_.begin(), open_.end(), fd), open_.end());
+        ::close(fd);
+    }
+
+    std::vector<uint8_t> data_ = std::vector<uint8_t>(1 << 20);
+    int listen_fd_{-1};
+    uint16_t port_{0};
+    std::atomic<bool> running_{true};
+    std::atomic<uint32_t> accepted_{0};
+    std::atomic<uint32_t> served_{0};
+    std::thread acceptor_;
+    std::mutex mutex_;
+    std::vector<int> open_;
+    std::vector<std::thread> handlers_;
+};
+
+/** Mock display that counts mode switches (HDMI resyncs the viewer would see) */
+class ModeCountingDisplay : public streaming::drivers::mock::MockDisplayDriver {
+public:
+    streaming::device::Result setDisplayMode(const streaming::hal::DisplayMode& mode) override {
+        switches++;
+        return MockDisplayDriver::setDisplayMode(mode);
+    }
+    std::atomic<uint32_t> switches{0};
+};
+
 void run_codec_container_tests() {
     std::cout << "\n=== Codec & Container Tests ===\n";
 
+    /* Pipelines present on one shared display, as in main() */
+    auto display = streaming::hal::createDisplayHal();
+    display->initialize();
+
     TEST("CodecService - register and create decoder");
     auto codec_svc = streaming::services::createCodecService();
     codec_svc->initialize();
@@ -130,6 +596,61 @@ void run_codec_container_tests() {
     ASSERT(result.frame_ready);
     TEST_END();
 
+    TEST("CodecService - audio decoder for AAC/AC3/EAC3");
+    {
+        ASSERT(codec_svc->isAudioSupported(streaming::media::AudioCodec::AAC));
+        ASSERT(codec_svc->isAudioSupported(streaming::media::AudioCodec::EAC3));
+        ASSERT(!codec_svc->isAudioSupported(streaming::media::AudioCodec::MP3));
+        streaming::media::AudioTrackInfo atrack;
+        atrack.codec = streaming::media::AudioCodec::AC3;
+        atrack.sample_rate = 48000;
+        atrack.channels = 6;
+        auto adec = codec_svc->createAudioDecoder(atrack);
+        ASSERT(adec != nullptr);
+        streaming::media::EncodedPacket apkt;
+        apkt.data.assign(768, 0);
+        apkt.timing.pts = 32000;
+        auto ar = adec->decode(apkt);
+        ASSERT(ar.status == streaming::device::Result::OK && ar.frame_ready);
+        ASSERT(ar.pcm.channels == 6 && ar.pcm.sample_rate == 48000);
+        ASSERT(ar.pcm.frames() == 1536);
+        ASSERT(ar.pcm.timing.pts == 32000 && ar.pcm.timing.duration_us == 32000);
+        atrack.codec = streaming::media::AudioCodec::MP3;
+        ASSERT(codec_svc->createAudioDecoder(atrack) == nullptr);
+    }
+    TEST_END();
+
+    TEST("Zero-copy scanout of pooled decoder output");
+    {
+        auto pool = std::make_shared<streaming::media::FramePool>(3);
+        dec->setOutputPool(pool);
+        std::vector<streaming::media::DecodedFrame> frames;
+        for (int i = 0; i < 3; ++i) {
+            pkt.timing.pts = i * 40000;
+            auto r = dec->decodeFrame(pkt);
+            ASSERT(r.status == streaming::device::Result::OK && r.frame_ready);
+            ASSERT(r.frame.handle.valid() && r.frame.data != nullptr);
+            frames.push_back(r.frame);
+        }
+        ASSERT(dec->decodeFrame(pkt).status == streaming::device::Result::ERROR_BUSY);
+
+        auto vp = streaming::hal::createVideoPipeline();
+        ASSERT(vp->initialize(1920, 1080) == streaming::device::Result::OK);
+        auto release = [pool](const streaming::media::BufferHandle& h) { pool->release(h); };
+        ASSERT(vp->scanoutFrame(frames[0], release) == streaming::device::Result::OK);
+        ASSERT(pool->getBuffersInUse() == 3);
+        ASSERT(vp->scanoutFrame(frames[1], release) == streaming::device::Result::OK);
+        ASSERT(pool->getBuffersInUse() == 2);  /* frame 0 retired from the plane */
+        ASSERT(dec->decodeFrame(pkt).status == streaming::device::Result::OK);
+        auto st = vp->getStats();
+        ASSERT(st.frames_scanned_out == 2);
+        ASSERT(st.bytes_copied == 0);
+        vp->shutdown();
+        ASSERT(pool->getBuffersInUse() == 2);
+        dec->setOutputPool(nullptr);
+    }
+    TEST_END();
+
     TEST("ContainerService - open and get tracks");
     auto container_svc = streaming::services::createContainerService();
     container_svc->initialize();
@@ -140,14 +661,2107 @@ void run_codec_container_tests() {
     ASSERT(container_svc->close() == streaming::device::Result::OK);
     TEST_END();
 
+    TEST("PresentationScheduler - 3:2 pulldown for 24p on 60 Hz");
+    {
+        streaming::media::PresentationScheduler sched(64);
+        sched.configure(24, 1, 60);
+        for (int k = 0; k < 24; ++k) {
+            streaming::media::DecodedFrame f;
+            f.timing.pts = k * 1000000LL / 24;
+            ASSERT(sched.queueFrame(f));
+        }
+        std::vector<int> holds;
+        for (int v = 0; v < 60; ++v) {
+            auto d = sched.onVblank(v * 1000000LL / 60);
+            if (d.action == streaming::media::VsyncAction::PRESENT) holds.push_back(1);
+            else if (d.action == streaming::media::VsyncAction::REPEAT) ++holds.back();
+        }
+        ASSERT(holds.size() == 24);
+        ASSERT(holds[0] == 3 && holds[1] == 2 && holds[2] == 3 && holds[3] == 2);
+        auto st = sched.getStats();
+        ASSERT(st.frames_presented == 24);
+        ASSERT(st.frames_dropped == 0);
+        ASSERT(st.cadence_breaks == 0);
+        ASSERT(st.judder_us > 8000 && st.judder_us < 8700);
+    }
+    TEST_END();
+
+    TEST("PresentationScheduler - 2:2 for 25p on 50 Hz, drop when late");
+    {
+        streaming::media::PresentationScheduler sched(64);
+        sched.configure(25, 1, 50);
+        for (int k = 0; k < 10; ++k) {
+            streaming::media::DecodedFrame f;
+            f.timing.pts = k * 40000LL;
+            sched.queueFrame(f);
+        }
+        for (int v = 0; v < 10; ++v) sched.onVblank(v * 20000LL);
+        auto st = sched.getStats();
+        ASSERT(st.frames_presented == 5);
+        ASSERT(st.judder_us == 0);
+        ASSERT(st.cadence_breaks == 0);
+        /* Clock jumps ahead: three late frames dropped, newest due frame shown */
+        auto d = sched.onVblank(320000);
+        ASSERT(d.action == streaming::media::VsyncAction::PRESENT);
+        ASSERT(d.frame.timing.pts == 320000);
+        ASSERT(d.dropped.size() == 3);
+        ASSERT(sched.getStats().frames_dropped == 3);
+        ASSERT(sched.flush().size() == 1);
+    }
+    TEST_END();
+
+    TEST("RefreshRateMatcher - match content rate and debounce restore");
+    {
+        streaming::hal::DisplayMode mode;
+        streaming::hal::DisplayMode current{1920, 1080, 60, streaming::hal::PixelFormat::RGBA8888, false};
+        std::vector<streaming::hal::DisplayMode> modes = {
+            {1920, 1080, 60, streaming::hal::PixelFormat::RGBA8888, false},
+            {1920, 1080, 50, streaming::hal::PixelFormat::RGBA8888, false},
+            {1920, 1080, 24, streaming::hal::PixelFormat::RGBA8888, false},
+            {3840, 2160, 25, streaming::hal::PixelFormat::RGBA8888, false}};
+        ASSERT(streaming::media::RefreshRateMatcher::selectMode(modes, current, 24000, 1001, mode));
+        ASSERT(mode.refresh_rate_hz == 24);
+        ASSERT(streaming::media::RefreshRateMatcher::selectMode(modes, current, 25, 1, mode));
+        ASSERT(mode.refresh_rate_hz == 50);
+        ASSERT(streaming::media::RefreshRateMatcher::selectMode(modes, current, 30, 1, mode));
+        ASSERT(mode.refresh_rate_hz == 60);
+        ASSERT(!streaming::media::RefreshRateMatcher::selectMode(modes, current, 23, 1, mode));
+
+        auto disp = streaming::hal::createDisplayHal();
+        disp->initialize();
+        streaming::media::RefreshRateMatcher matcher(*disp, std::chrono::milliseconds(30));
+        streaming::media::VideoTrackInfo film;
+        film.frame_rate_num = 24;
+        ASSERT(matcher.matchContent(film) == streaming::device::Result::OK);
+        ASSERT(disp->getDisplayMode().refresh_rate_hz == 24);
+        /* Stop then immediately open the next 24p title: no resync either way */
+        matcher.restoreUiMode();
+        ASSERT(matcher.matchContent(film) == streaming::device::Result::OK);
+        std::this_thread::sleep_for(std::chrono::milliseconds(60));
+        ASSERT(disp->getDisplayMode().refresh_rate_hz == 24);
+        ASSERT(matcher.getModeSwitchCount() == 1);
+        matcher.restoreUiMode();
+        ASSERT(disp->getDisplayMode().refresh_rate_hz == 24);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        ASSERT(disp->getDisplayMode().refresh_rate_hz == 60);
+        ASSERT(matcher.getModeSwitchCount() == 2);
+    }
+    TEST_END();
+
+    TEST("Compositor - SIMD kernels match scalar, transparent tiles skipped");
+    {
+        const uint32_t w = 203, h = 37;  /* Odd size exercises partial tiles and SIMD tails */
+        std::mt19937 rng(7);
+        std::vector<uint8_t> ui(w * h * 4), video(w * h * 4);
+        for (auto& b : ui) b = static_cast<uint8_t>(rng());
+        for (auto& b : video) b = static_cast<uint8_t>(rng());
+        /* Premultiplied input must have color <= alpha */
+        std::vector<uint8_t> ui_pm = ui;
+        for (size_t i = 0; i < ui_pm.size(); i += 4)
+            for (int c = 0; c < 3; ++c) ui_pm[i + c] = static_cast<uint8_t>(ui_pm[i + c] * ui_pm[i + 3] / 255);
+
+        for (auto mode : {streaming::media::AlphaMode::STRAIGHT, streaming::media::AlphaMode::PREMULTIPLIED}) {
+            const auto& src = (mode == streaming::media::AlphaMode::STRAIGHT) ? ui : ui_pm;
+            streaming::media::Surface overlay{const_cast<uint8_t*>(src.data()), w, h, w * 4};
+            std::vector<uint8_t> ref = video;
+            streaming::media::Surface ref_surface{ref.data(), w, h, w * 4};
+            streaming::media::Compositor scalar;
+            scalar.setKernel(streaming::media::BlendKernel::SCALAR);
+            ASSERT(scalar.blend(overlay, mode, ref_surface) == streaming::device::Result::OK);
+            for (auto k : {streaming::media::BlendKernel::SSE2, streaming::media::BlendKernel::AVX2}) {
+                if (!streaming::media::Compositor::isKernelSupported(k)) continue;
+                std::vector<uint8_t> out = video;
+                streaming::media::Surface out_surface{out.data(), w, h, w * 4};
+                streaming::media::Compositor simd;
+                simd.setKernel(k);
+                ASSERT(simd.getKernel() == k);
+                simd.blend(overlay, mode, out_surface);
+                ASSERT(out == ref);
+            }
+        }
+
+        /* Clear UI except one opaque tile: everything else is skipped untouched */
+        std::vector<uint8_t> osd(w * h * 4, 0);
+        for (uint32_t y = 0; y < 16; ++y)
+            for (uint32_t x = 0; x < 64; ++x) osd[(y * w + x) * 4 + 3] = 0xFF;
+        std::vector<uint8_t> out = video;
+        streaming::media::Surface overlay{osd.data(), w, h, w * 4};
+        streaming::media::Surface out_surface{out.data(), w, h, w * 4};
+        streaming::media::Compositor comp;
+        comp.blend(overlay, streaming::media::AlphaMode::PREMULTIPLIED, out_surface);
+        auto st = comp.getStats();
+        ASSERT(st.tiles_copied == 1);
+        ASSERT(st.tiles_blended == 0);
+        ASSERT(st.tiles_skipped == 4 * 3 - 1);
+        ASSERT(std::memcmp(out.data() + 16 * w * 4, video.data() + 16 * w * 4, (h - 16) * w * 4) == 0);
+    }
+    TEST_END();
+
+    TEST("Compositor - overlay rescaled to the video size");
+    {
+        using streaming::device::Result;
+        /* 2x2 quadrants, each pixel value its index */
+        streaming::media::OverlayImage quad;
+        quad.width = 2;
+        quad.height = 2;
+        quad.mode = streaming::media::AlphaMode::STRAIGHT;
+        for (uint8_t i = 0; i < 4; ++i) quad.pixels.insert(quad.pixels.end(), {i, i, i, 255});
+        streaming::media::Compositor comp;
+        streaming::media::OverlayImage big;
+        ASSERT(comp.scale(quad, 6, 4, big) == Result::OK);
+        ASSERT(big.width == 6 && big.height == 4 && big.pixels.size() == 6u * 4u * 4u);
+        ASSERT(big.mode == streaming::media::AlphaMode::STRAIGHT);
+        for (uint32_t y = 0; y < 4; ++y)
+            for (uint32_t x = 0; x < 6; ++x)
+                ASSERT(big.pixels[(y * 6 + x) * 4] == (y / 2) * 2 + x / 3);
+        streaming::media::OverlayImage one;
+        ASSERT(comp.scale(big, 1, 1, one) == Result::OK && one.pixels.size() == 4);
+        streaming::media::OverlayImage truncated = quad;
+        truncated.pixels.resize(8);
+        ASSERT(comp.scale(truncated, 4, 4, one) == Result::ERROR_INVALID_PARAM);
+        ASSERT(comp.getStats().layers_scaled == 2 && comp.getStats().layers_rejected == 1);
+    }
+    TEST_END();
+
+    TEST("MediaClock - audio master holds lip-sync over two hours");
+    {
+        using streaming::media::MediaClock;
+        MediaClock clock;
+        clock.setMode(streaming::media::ClockMode::AUDIO_MASTER);
+        clock.start(0, 0);
+
+        /* DAC crystal 150 ppm fast, positions reported every 10 ms with +-1 ms jitter */
+        std::mt19937 rng(7);
+        std::uniform_int_distribution<int> jitter(-1000, 1000);
+        auto audio_at = [](int64_t t) { return t + t * 150 / 1000000; };
+        const int64_t two_hours = 2LL * 3600 * 1000000;
+        int64_t worst = 0;
+        for (int64_t t = 0; t < two_hours; t += 10000) {
+            clock.updateAudioPosition(audio_at(t) + jitter(rng), t);
+            const int64_t vblank = t + 6667;
+            worst = std::max<int64_t>(worst, std::llabs(audio_at(vblank) - clock.getTime(vblank)));
+        }
+        ASSERT(worst <= 20000);
+        auto st = clock.getStats();
+        ASSERT(st.resyncs == 0);
+        ASSERT(st.max_av_offset_us <= 20000);
+        ASSERT(std::llabs(st.av_offset_us) <= 5000);  /* Converged onto the fast DAC */
+
+        /* A 40 ms glitch is slewed out, never snapped */
+        int64_t t = two_hours;
+        const int64_t before = clock.getTime(t);
+        clock.updateAudioPosition(audio_at(t) + 40000, t);
+        ASSERT(clock.getTime(t) == before);
+        ASSERT(clock.getStats().rate_ppm == MediaClock::kMaxSlewPpm);
+        /* A discontinuity beyond the threshold resyncs immediately */
+        clock.updateAudioPosition(audio_at(t) + 500000, t + 10000);
+        ASSERT(clock.getTime(t + 10000) == audio_at(t) + 500000);
+        ASSERT(clock.getStats().resyncs == 1);
+
+        /* A new session (or seek) does not report the previous one's offsets */
+        ASSERT(clock.getStats().max_av_offset_us >= 40000);
+        clock.start(0, t + 20000);
+        ASSERT(clock.getStats().max_av_offset_us == 0 && clock.getStats().rate_ppm == 0);
+        ASSERT(clock.getStats().resyncs == 1);
+
+        /* Pause freezes time; SYSTEM mode ignores audio */
+        MediaClock sys;
+        sys.start(1000000, 0);
+        sys.updateAudioPosition(9000000, 0);
+        ASSERT(sys.getTime(500000) == 1500000);
+        sys.setPaused(true, 500000);
+        ASSERT(sys.getTime(900000) == 1500000);
+        sys.setPaused(false, 900000);
+        ASSERT(sys.getTime(1000000) == 1600000);
+    }
+    TEST_END();
+
+    TEST("MediaClock - sink output latency delays video");
+    {
+        using streaming::media::MediaClock;
+        MediaClock clock;
+        clock.setMode(streaming::media::ClockMode::AUDIO_MASTER);
+        clock.start(0, 0);
+        clock.setOutputLatency(200000);   /* A2DP headset */
+        clock.updateAudioPosition(1000000, 1000000);
+        ASSERT(clock.getTime(1000000) == 800000);
+        ASSERT(clock.getStats().output_latency_us == 200000);
+        /* Switch to HDMI: 180 ms is beyond the resync threshold, snap forward */
+        clock.setOutputLatency(20000);
+        clock.updateAudioPosition(1010000, 1010000);
+        ASSERT(clock.getTime(1010000) == 990000);
+        ASSERT(clock.getStats().resyncs == 1);
+        /* A small latency change is slewed out */
+        clock.setOutputLatency(30000);
+        clock.updateAudioPosition(1020000, 1020000);
+        ASSERT(clock.getStats().av_offset_us == -10000);
+        ASSERT(clock.getStats().rate_ppm < 0);
+        ASSERT(clock.getStats().resyncs == 1);
+    }
+    TEST_END();
+
+    TEST("Audio HAL - render position follows timed buffers");
+    {
+        auto audio = streaming::hal::createAudioHal();
+        audio->initialize();
+        streaming::hal::AudioRenderPosition pos;
+        ASSERT(audio->getRenderPosition(pos) == streaming::device::Result::ERROR_NOT_FOUND);
+        std::vector<uint8_t> pcm(48000 * 4 / 10, 0);  /* 100 ms of 16-bit stereo */
+        streaming::hal::AudioBuffer buf;
+        buf.data = pcm.data();
+        buf.size = pcm.size();
+        buf.pts_us = 3000000;
+        ASSERT(audio->play(buf) == streaming::device::Result::OK);
+        buf.pts_us = 3100000;
+        ASSERT(audio->play(buf) == streaming::device::Result::OK);
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        ASSERT(audio->getRenderPosition(pos) == streaming::device::Result::OK);
+        ASSERT(pos.pts_us >= 3020000 && pos.pts_us < 3200000);
+        ASSERT(audio->stop() == streaming::device::Result::OK);
+        ASSERT(audio->getRenderPosition(pos) == streaming::device::Result::ERROR_NOT_FOUND);
+    }
+    TEST_END();
+
+    TEST("PcmRing - periods, back-pressure and underruns");
+    {
+        /* 4 periods of 480 stereo frames (10 ms at 48 kHz) */
+        streaming::media::PcmRing ring(480, 4, 2, 48000);
+        std::vector<int16_t> unit(1024 * 2);
+        for (size_t i = 0; i < unit.size(); ++i) unit[i] = static_cast<int16_t>(i);
+        ASSERT(ring.write(unit.data(), 1024, 0) == 1024);
+        ASSERT(ring.getFillPeriods() == 2);       /* 64 frames still uncommitted */
+        ASSERT(ring.write(unit.data(), 1024, 21333) == 1024 - 128);  /* Only 896 fit */
+        ASSERT(ring.getFillPeriods() == 4);
+        ASSERT(ring.getFillUs() == 40000);
+        ASSERT(ring.write(unit.data(), 1, 0) == 0);
+
+        const streaming::media::PcmPeriod* p = ring.front();
+        ASSERT(p != nullptr && p->frames == 480 && p->pts_us == 0);
+        ASSERT(p->samples[2 * 479 + 1] == static_cast<int16_t>(2 * 479 + 1));
+        ring.pop();
+        p = ring.front();
+        ASSERT(p->pts_us == 10000);
+        ASSERT(p->samples[0] == static_cast<int16_t>(2 * 480));
+        ring.pop();
+        p = ring.front();
+        ASSERT(p->pts_us == 20000);   /* Straddles two decoder units */
+        ring.pop();
+        ring.pop();
+        ASSERT(ring.front() == nullptr);
+        ring.recordUnderrun();
+
+        ASSERT(ring.write(unit.data(), 100, 500000) == 100);
+        ASSERT(ring.front() == nullptr);
+        ASSERT(ring.commitPartial());
+        p = ring.front();
+        ASSERT(p->frames == 100 && p->pts_us == 500000);
+        ring.reset();
+        ASSERT(ring.getFillPeriods() == 0 && ring.front() == nullptr);
+
+        auto st = ring.getStats();
+        ASSERT(st.underruns == 1);
+        ASSERT(st.high_water == 4);
+        ASSERT(st.periods_written == 5);
+    }
+    TEST_END();
+
+    TEST("AudioConverter - 44.1 to 48 kHz resample and 5.1/7.1 downmix");
+    {
+        using streaming::media::AudioConverter;
+        using streaming::media::DspKernel;
+        /* 1 s of a 1 kHz stereo sine at 44.1 kHz, fed in decoder-sized chunks */
+        const size_t in_frames = 44100;
+        std::vector<int16_t> sine(in_frames * 2);
+        for (size_t i = 0; i < in_frames; ++i)
+            sine[2 * i] = sine[2 * i + 1] =
+                static_cast<int16_t>(16000 * std::sin(2 * M_PI * 1000.0 * i / 44100));
+
+        std::vector<int16_t> ref;
+        for (auto k : {DspKernel::SCALAR, DspKernel::SSE2, DspKernel::AVX2}) {
+            if (!AudioConverter::isKernelSupported(k)) continue;
+            AudioConverter conv(44100, 2, 48000, 2);
+            ASSERT(conv.isValid() && !conv.isIdentity());
+            conv.setKernel(k);
+            std::vector<int16_t> out;
+            size_t produced = 0;
+            for (size_t i = 0; i < in_frames; i += 1024)
+                produced += conv.process(sine.data() + 2 * i, std::min<size_t>(1024, in_frames - i), out);
+            ASSERT(produced == out.size() / 2);
+            ASSERT(produced + 1 >= conv.estimateOutputFrames(in_frames) - AudioConverter::kTaps);
+            ASSERT(produced <= conv.estimateOutputFrames(in_frames) + 1);
+            if (ref.empty()) {
+                ref = out;
+                continue;
+            }
+            /* SIMD kernels only reorder float sums */
+            ASSERT(out.size() == ref.size());
+            int worst = 0;
+            for (size_t i = 0; i < out.size(); ++i) worst = std::max(worst, std::abs(out[i] - ref[i]));
+            ASSERT(worst <= 1);
+        }
+        /* Still 1 kHz at the new rate (rising zero crossings), amplitude kept */
+        int crossings = 0;
+        int16_t peak = 0;
+        for (size_t i = 2 * 1000; i + 2 < ref.size(); i += 2) {
+            if (ref[i] < 0 && ref[i + 2] >= 0) ++crossings;
+            peak = std::max(peak, ref[i]);
+        }
+        ASSERT(crossings >= 975 && crossings <= 980);   /* (48000 - 1000 - kTaps) / 48 periods */
+        ASSERT(peak > 15700 && peak < 16300);
+
+        /* One shot matches chunked */
+        AudioConverter once(44100, 2, 48000, 2);
+        once.setKernel(DspKernel::SCALAR);
+        std::vector<int16_t> whole;
+        once.process(sine.data(), in_frames, whole);
+        ASSERT(whole == ref);
+
+        /* 5.1 -> stereo: centre at -3 dB into both sides, LFE dropped, full scale never clips */
+        AudioConverter dmx(48000, 6, 48000, 2);
+        ASSERT(dmx.isValid());
+        const float norm = 1.0f + 0.7071f + 0.7071f;
+        std::vector<int16_t> frame51 = {0, 0, 20000, 20000, 0, 0};
+        std::vector<int16_t> st;
+        ASSERT(dmx.process(frame51.data(), 1, st) == 1);
+        ASSERT(st.size() == 2 && st[0] == st[1]);
+        ASSERT(std::abs(st[0] - static_cast<int>(20000 * 0.7071f / norm)) <= 1);
+        std::vector<int16_t> full51(6 * 64, 32767);
+        st.clear();
+        dmx.process(full51.data(), 64, st);
+        for (int16_t s : st) ASSERT(s >= 32766);
+        std::vector<int16_t> neg51(6 * 64, -32768);
+        st.clear();
+        dmx.process(neg51.data(), 64, st);
+        for (int16_t s : st) ASSERT(s <= -32767);
+
+        /* 7.1 surround left lands only on the left */
+        AudioConverter dmx71(48000, 8, 48000, 2);
+        std::vector<int16_t> frame71 = {0, 0, 0, 0, 0, 0, 10000, 0};
+        st.clear();
+        dmx71.process(frame71.data(), 1, st);
+        ASSERT(st[0] > 1000 && st[1] == 0);
+        ASSERT(!AudioConverter(48000, 2, 48000, 6).isValid());   /* No upmix */
+
+        /* Cost: 1 s of 7.1 at 48 kHz to 44.1 kHz stereo must be a small fraction of real time */
+        std::vector<int16_t> surround(48000 * 8);
+        for (size_t i = 0; i < surround.size(); ++i) surround[i] = static_cast<int16_t>(i * 7919);
+        AudioConverter bench(48000, 8, 44100, 2);
+        std::vector<int16_t> sink;
+        const auto t0 = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < 48000; i += 1536) {
+            sink.clear();
+            bench.process(surround.data() + 8 * i, std::min<size_t>(1536, 48000 - i), sink);
+        }
+        const auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - t0).count();
+        ASSERT(us < 250000);   /* Loose for unoptimized builds; -O2 is well under 2% */
+    }
+    TEST_END();
+
+    TEST("IEC 61937 - AC3 and E-AC3 bursts");
+    {
+        using streaming::media::Iec61937Packer;
+        /* AC3: one 1536-byte syncframe (bsmod 2) per 1536-frame burst */
+        Iec61937Packer ac3(streaming::media::AudioCodec::AC3, 48000);
+        ASSERT(ac3.isValid() && ac3.getOutputRate() == 48000 && ac3.getBurstFrames() == 1536);
+        std::vector<uint8_t> frame(1536, 0);
+        frame[0] = 0x0B; frame[1] = 0x77; frame[5] = (8 << 3) | 2;
+        frame[1534] = 0x12; frame[1535] = 0x34;
+        bool ready = false;
+        ASSERT(ac3.pack(frame.data(), frame.size(), 700000, ready) == streaming::device::Result::OK && ready);
+        const auto& b = ac3.getBurst();
+        ASSERT(b.size() == 1536 * 2);
+        ASSERT(static_cast<uint16_t>(b[0]) == 0xF872 && b[1] == 0x4E1F);
+        ASSERT(b[2] == (1 | (2 << 8)));              /* Type AC3, bsmod 2 */
+        ASSERT(b[3] == 1536 * 8);                    /* Length in bits */
+        ASSERT(b[4] == 0x0B77 && b[4 + 767] == 0x1234);   /* Big-endian words */
+        ASSERT(b[4 + 768] == 0 && b.back() == 0);
+        ASSERT(ac3.getBurstPts() == 700000);
+        std::vector<uint8_t> junk(64, 0xFF);
+        ASSERT(ac3.pack(junk.data(), junk.size(), 0, ready) == streaming::device::Result::ERROR_INVALID_PARAM);
+
+        /* E-AC3: two-block frames are aggregated three to a burst at 4x rate */
+        Iec61937Packer eac3(streaming::media::AudioCodec::EAC3, 48000);
+        ASSERT(eac3.getOutputRate() == 192000 && eac3.getBurstFrames() == 6144);
+        std::vector<uint8_t> ef(1001, 0);
+        ef[0] = 0x0B; ef[1] = 0x77; ef[4] = 1 << 4;  /* numblkscod 1: two blocks */
+        ef[1000] = 0xAB;
+        ASSERT(eac3.pack(ef.data(), ef.size(), 1000, ready) == streaming::device::Result::OK && !ready);
+        ASSERT(eac3.pack(ef.data(), ef.size(), 11666, ready) == streaming::device::Result::OK && !ready);
+        ASSERT(eac3.pack(ef.data(), ef.size(), 22333, ready) == streaming::device::Result::OK && ready);
+        const auto& e = eac3.getBurst();
+        ASSERT(e.size() == 6144 * 2);
+        ASSERT(e[2] == 21 && e[3] == 3003);          /* Type E-AC3, length in bytes */
+        ASSERT(e[4 + 500] == static_cast<int16_t>(0xAB0B));  /* Odd frames straddle words */
+        ASSERT(eac3.getBurstPts() == 1000);
+        eac3.pack(ef.data(), ef.size(), 0, ready);
+        eac3.reset();   /* Seek drops the partial burst */
+        eac3.pack(ef.data(), ef.size(), 5000, ready);
+        eac3.pack(ef.data(), ef.size(), 5000, ready);
+        ASSERT(!ready);
+
+        /* 7.1: a dependent substream adds no blocks and rides in its independent frame's burst */
+        auto syncframe = [](size_t bytes, uint8_t strmtyp, uint8_t numblkscod) {
+            std::vector<uint8_t> f(bytes, 0);
+            const size_t frmsiz = bytes / 2 - 1;
+            f[0] = 0x0B; f[1] = 0x77;
+            f[2] = static_cast<uint8_t>((strmtyp << 6) | (frmsiz >> 8));
+            f[3] = static_cast<uint8_t>(frmsiz & 0xFF);
+            f[4] = static_cast<uint8_t>(numblkscod << 4);
+            return f;
+        };
+        const auto indep = syncframe(1000, 0, 3);
+        const auto dep = syncframe(500, 1, 3);
+        std::vector<uint8_t> unit = indep;               /* As demuxed from MP4: one access unit */
+        unit.insert(unit.end(), dep.begin(), dep.end());
+        Iec61937Packer merged(streaming::media::AudioCodec::EAC3, 48000);
+        ASSERT(merged.pack(unit.data(), unit.size(), 0, ready) == streaming::device::Result::OK && !ready);
+        ASSERT(merged.pack(unit.data(), unit.size(), 32000, ready) == streaming::device::Result::OK && ready);
+        ASSERT(merged.getBurst()[3] == 1500 && merged.getBurstPts() == 0);
+        ASSERT(merged.getBurst()[4 + 500] == 0x0B77);    /* Dependent frame after the independent one */
+        ASSERT(merged.flush(ready) == streaming::device::Result::OK && ready && merged.getBurstPts() == 32000);
+        ASSERT(merged.flush(ready) == streaming::device::Result::ERROR_NOT_FOUND && !ready);
+
+        /* Separate packets: the first dependent frame shows the stream needs holding */
+        Iec61937Packer split(streaming::media::AudioCodec::EAC3, 48000);
+        ASSERT(split.pack(indep.data(), indep.size(), 0, ready) == streaming::device::Result::OK && ready);
+        split.pack(dep.data(), dep.size(), 0, ready);
+        ASSERT(!ready);
+        split.pack(indep.data(), indep.size(), 32000, ready);
+        ASSERT(!ready);
+        split.pack(dep.data(), dep.size(), 32000, ready);
+        ASSERT(!ready);
+        split.pack(indep.data(), indep.size(), 64000, ready);
+        ASSERT(ready && split.getBurst()[3] == 1500 && split.getBurstPts() == 32000);
+    }
+    TEST_END();
+
+    TEST("SeekCoalescer - scrub burst runs first and latest only");
+    {
+        using streaming::media::SeekMode;
+        std::mutex m;
+        std::vector<int64_t> ran;
+        streaming::media::SeekCoalescer seeker([&](int64_t target, SeekMode) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));   /* A full flush */
+            std::lock_guard<std::mutex> lock(m);
+            ran.push_back(target);
+            return streaming::device::Result::OK;
+        });
+        int64_t pending = -1;
+        ASSERT(!seeker.getPendingTarget(pending));
+        for (int64_t t = 1; t <= 50; ++t) seeker.request(t * 1000000, SeekMode::KEYFRAME);
+        ASSERT(seeker.getPendingTarget(pending) && pending == 50000000);
+        seeker.waitIdle();
+        ASSERT(ran.size() <= 2 && ran.back() == 50000000);
+        auto st = seeker.getStats();
+        ASSERT(st.requested == 50);
+        ASSERT(st.executed == ran.size());
+        ASSERT(st.coalesced == 50 - st.executed);
+        ASSERT(st.last_duration_us >= 20000);
+
+        /* cancel() drops the queued seek and waits out the running one */
+        seeker.request(1, SeekMode::EXACT);
+        seeker.request(2, SeekMode::EXACT);
+        seeker.cancel();
+        ASSERT(!seeker.getPendingTarget(pending));
+        ASSERT(ran.back() != 2);
+        ASSERT(seeker.getStats().failed == 0);
+
+        /* A failing executor is counted and its result kept */
+        streaming::media::SeekCoalescer failing([](int64_t, SeekMode) {
+            return streaming::device::Result::ERROR_IO;
+        });
+        failing.request(1000000, SeekMode::KEYFRAME);
+        failing.waitIdle();
+        ASSERT(failing.getStats().failed == 1);
+        ASSERT(failing.getLastResult() == streaming::device::Result::ERROR_IO);
+    }
+    TEST_END();
+
+    TEST("AbrController - follows shaped bandwidth without oscillating");
+    {
+        using streaming::media::Rendition;
+        const std::vector<Rendition> ladder = {
+            {400000, 426, 240}, {16000000, 3840, 2160}, {1000000, 640, 360},
+            {2500000, 854, 480}, {4500000, 1280, 720}, {8000000, 1920, 1080}};
+        streaming::media::AbrController abr;
+        abr.setRenditions(ladder);
+        ASSERT(abr.getRenditions().front().height == 240 && abr.getRenditions().back().height == 2160);
+
+        /* Stand-in for the HTTP origin: 4 s segments over a link shaped to
+         * 30 -> 6 -> 30 Mbps, simulated in virtual time with a 30 s buffer */
+        const int64_t seg_us = 4000000;
+        int64_t buffer_us = 0;
+        uint32_t stalls = 0;
+        std::vector<size_t> picks;
+        auto fetch = [&](uint32_t link_bps, int segments) {
+            for (int i = 0; i < segments; ++i) {
+                if (buffer_us > 30000000 - seg_us) buffer_us = 30000000 - seg_us;   /* Wait for room */
+                const size_t r = abr.selectRendition(buffer_us);
+                picks.push_back(r);
+                const uint64_t bytes = static_cast<uint64_t>(abr.getRenditions()[r].bandwidth_bps) * 4 / 8;
+                const int64_t took_us = static_cast<int64_t>(bytes * 8 * 1000000 / link_bps);
+                abr.onDownload(bytes, took_us);
+                buffer_us -= took_us;
+                if (buffer_us < 0) {
+                    if (picks.size() > 1) ++stalls;
+                    buffer_us = 0;
+                }
+                buffer_us += seg_us;
+            }
+        };
+
+        fetch(30000000, 30);
+        ASSERT(picks.back() == 5);                         /* 16 Mbps fits 30 Mbps */
+        ASSERT(abr.getEstimate() > 25000000);
+        fetch(6000000, 30);
+        const std::vector<size_t> low(picks.end() - 20, picks.end());
+        ASSERT(picks[35] <= 3);                            /* Down within a few segments */
+        ASSERT(std::all_of(low.begin(), low.end(), [](size_t r) { return r == 3; }));   /* 4.5 of 6 Mbps, steady */
+        fetch(30000000, 30);
+        ASSERT(picks.back() == 5);
+        ASSERT(stalls == 0);
+        auto st = abr.getStats();
+        ASSERT(st.switches_up + st.switches_down <= 10);
+        ASSERT(st.samples == 90);
+
+        /* Quality presets are caps on the ladder */
+        abr.setQualityCap(streaming::device::StreamQuality::HIGH);
+        ASSERT(abr.selectRendition(buffer_us) == 4);       /* 1080p */
+        abr.setQualityCap(streaming::device::StreamQuality::LOW);
+        ASSERT(abr.selectRendition(buffer_us) == 2);       /* 480p */
+        abr.setQualityCap(streaming::device::StreamQuality::AUTO);
+        abr.selectRendition(buffer_us);
+        ASSERT(abr.selectRendition(buffer_us) == 5);       /* Up again after the hysteresis */
+        ASSERT(abr.getStats().cap == streaming::device::StreamQuality::AUTO);
+
+        auto svc = streaming::services::createStreamingService(*display);
+        ASSERT(svc->setQuality(streaming::device::StreamQuality::MEDIUM) == streaming::device::Result::OK);
+        ASSERT(svc->getAbrStats().cap == streaming::device::StreamQuality::MEDIUM);
+        ASSERT(streaming::media::AbrController::capIndex(abr.getRenditions(),
+               streaming::device::StreamQuality::MEDIUM) == 3);
+    }
+    TEST_END();
+
+    TEST("ManifestParser - HLS and DASH to renditions and timelines");
+    {
+        using streaming::media::ManifestParser;
+        using streaming::device::Result;
+        ASSERT(ManifestParser::resolveUri("https://cdn.test/a/b/master.m3u8?tok=1", "v/720.m3u8") ==
+               "https://cdn.test/a/b/v/720.m3u8");
+        ASSERT(ManifestParser::resolveUri("https://cdn.test/a/b/x.mpd", "../seg/1.m4s") == "https://cdn.test/a/seg/1.m4s");
+        ASSERT(ManifestParser::resolveUri("https://cdn.test/a/x.mpd", "/root.m4s") == "https://cdn.test/root.m4s");
+        ASSERT(ManifestParser::resolveUri("https://cdn.test/a/x.mpd", "http://other/y") == "http://other/y");
+        ASSERT(ManifestParser::parseIsoDuration("PT1H2M3.5S") == 3723500000LL);
+        ASSERT(ManifestParser::parseIsoDuration("PT0S") == 0);
+        ASSERT(ManifestParser::parseIsoDuration("1H") == -1);
+
+        const std::string master =
+            "#EXTM3U\n#EXT-X-VERSION:7\n"
+            "#EXT-X-MEDIA:TYPE=AUDIO,GROUP-ID=\"aac\",NAME=\"English\",LANGUAGE=\"en\",DEFAULT=YES,URI=\"audio/en.m3u8\"\n"
+            "#EXT-X-STREAM-INF:BANDWIDTH=8000000,RESOLUTION=1920x1080,CODECS=\"hvc1.2.4.L123,mp4a.40.2\",AUDIO=\"aac\"\n"
+            "v/1080.m3u8\n"
+            "#EXT-X-STREAM-INF:BANDWIDTH=1000000,RESOLUTION=640x360,AUDIO=\"aac\"\nv/360.m3u8\n"
+            "#EXT-X-STREAM-INF:BANDWIDTH=4500000,RESOLUTION=1280x720,AUDIO=\"aac\"\nv/720.m3u8\n";
+        streaming::media::Manifest m;
+        ASSERT(ManifestParser::parse(master, "https://cdn.test/show/master.m3u8", m) == Result::OK);
+        ASSERT(m.type == streaming::media::ManifestType::HLS);
+        ASSERT(m.video.size() == 3 && m.audio.size() == 1);
+        ASSERT(m.video[0].height == 360 && m.video[2].bandwidth_bps == 8000000);
+        ASSERT(m.video[2].codecs == "hvc1.2.4.L123,mp4a.40.2");
+        ASSERT(m.video[1].playlist_uri == "https://cdn.test/show/v/720.m3u8");
+        ASSERT(m.audio[0].language == "en" && m.audio[0].playlist_uri == "https://cdn.test/show/audio/en.m3u8");
+        ASSERT(ManifestParser::ladder(m).size() == 3);
+
+        const std::string media =
+            "#EXTM3U\n#EXT-X-TARGETDURATION:4\n#EXT-X-MEDIA-SEQUENCE:100\n"
+            "#EXT-X-MAP:URI=\"init.mp4\",BYTERANGE=\"720@0\"\n"
+            "#EXTINF:4.000,\n#EXT-X-BYTERANGE:50000@720\nall.mp4\n"
+            "#EXTINF:4.000,\n#EXT-X-BYTERANGE:60000\nall.mp4\n"
+            "#EXTINF:2.5,\nall.mp4\n#EXT-X-ENDLIST\n";
+        streaming::media::MediaTimeline tl;
+        ASSERT(ManifestParser::parseHlsMedia(media, "https://cdn.test/show/v/720.m3u8", tl) == Result::OK);
+        ASSERT(!tl.live && tl.segments.size() == 3 && tl.target_duration_us == 4000000);
+        ASSERT(tl.init_uri == "https://cdn.test/show/v/init.mp4" && tl.init_length == 720);
+        ASSERT(tl.segments[0].sequence == 100 && tl.segments[0].byte_offset == 720);
+        ASSERT(tl.segments[1].byte_offset == 50720 && tl.segments[1].byte_length == 60000);
+        ASSERT(tl.segments[2].start_us == 8000000 && tl.segments[2].duration_us == 2500000);
+        ASSERT(tl.findByTime(9000000) == 2 && tl.findBySequence(101) == 1);
+
+        /* Live window slides by two: merge appends two, drops two, keeps time continuous */
+        streaming::media::MediaTimeline live, fresh;
+        ManifestParser::parseHlsMedia("#EXTM3U\n#EXT-X-TARGETDURATION:2\n#EXT-X-MEDIA-SEQUENCE:7\n"
+            "#EXTINF:2,\ns7.ts\n#EXTINF:2,\ns8.ts\n#EXTINF:2,\ns9.ts\n", "https://live.test/p.m3u8", live);
+        ManifestParser::parseHlsMedia("#EXTM3U\n#EXT-X-TARGETDURATION:2\n#EXT-X-MEDIA-SEQUENCE:9\n"
+            "#EXTINF:2,\ns9.ts\n#EXTINF:2,\ns10.ts\n#EXTINF:2,\ns11.ts\n", "https://live.test/p.m3u8", fresh);
+        ASSERT(live.live && live.merge(fresh) == 2);
+        ASSERT(live.segments.size() == 3 && live.segments.front().sequence == 9);
+        ASSERT(live.segments.back().uri == "https://live.test/s11.ts" && live.segments.back().start_us == 8000000);
+
+        const std::string mpd =
+            "<?xml version=\"1.0\"?>\n<!-- VOD -->\n"
+            "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\" type=\"static\" mediaPresentationDuration=\"PT30S\">\n"
+            " <BaseURL>https://cdn.test/dash/</BaseURL>\n <Period>\n"
+            "  <AdaptationSet contentType=\"video\" codecs=\"hev1\">\n"
+            "   <SegmentTemplate timescale=\"90000\" initialization=\"$RepresentationID$/init.mp4\"\n"
+            "                    media=\"$RepresentationID$/$Number%05d$.m4s?a=1&amp;b=2\" startNumber=\"1\">\n"
+            "    <SegmentTimeline><S t=\"0\" d=\"360000\" r=\"6\"/><S d=\"180000\"/></SegmentTimeline>\n"
+            "   </SegmentTemplate>\n"
+            "   <Representation id=\"v1080\" bandwidth=\"8000000\" width=\"1920\" height=\"1080\"/>\n"
+            "   <Representation id=\"v360\" bandwidth=\"1000000\" width=\"640\" height=\"360\"/>\n"
+            "  </AdaptationSet>\n"
+            "  <AdaptationSet mimeType=\"audio/mp4\" lang=\"de\">\n"
+            "   <Representation id=\"a\" bandwidth=\"128000\">\n"
+            "    <SegmentTemplate timescale=\"48000\" duration=\"192000\" media=\"a/$Time$.m4s\" initialization=\"a/i.mp4\"/>\n"
+            "   </Representation>\n  </AdaptationSet>\n"
+            "  <AdaptationSet contentType=\"text\"><Representation id=\"t\"/></AdaptationSet>\n"
+            " </Period>\n</MPD>\n";
+        ASSERT(ManifestParser::parse(mpd, "https://cdn.test/dash/show.mpd", m) == Result::OK);
+        ASSERT(m.type == streaming::media::ManifestType::DASH && !m.live && m.duration_us == 30000000);
+        ASSERT(m.video.size() == 2 && m.audio.size() == 1);
+        const auto& v = m.video[1].timeline;
+        ASSERT(m.video[1].id == "v1080" && m.video[1].codecs == "hev1");
+        ASSERT(v.segments.size() == 8 && v.init_uri == "https://cdn.test/dash/v1080/init.mp4");
+        ASSERT(v.segments[0].uri == "https://cdn.test/dash/v1080/00001.m4s?a=1&b=2");
+        ASSERT(v.segments[7].start_us == 28000000 && v.segments[7].duration_us == 2000000);
+        const auto& a = m.audio[0].timeline;
+        ASSERT(m.audio[0].language == "de" && a.segments.size() == 8);   /* 30 s in 4 s segments */
+        ASSERT(a.segments[1].uri == "https://cdn.test/dash/a/192000.m4s" && a.segments[7].duration_us == 2000000);
+        ASSERT(ManifestParser::parse("<html/>", "x", m) == Result::ERROR_INVALID_PARAM);
+        ASSERT(ManifestParser::parse("<MPD type=\"dynamic\"><Period><AdaptationSet contentType=\"video\">"
+               "<SegmentTemplate media=\"$Number$.m4s\" duration=\"4\"/><Representation id=\"v\" bandwidth=\"1\"/>"
+               "</AdaptationSet></Period></MPD>", "x", m) == Result::ERROR_NOT_SUPPORTED);
+
+        /* Segment counts past the cap are refused, not allocated */
+        auto vodMpd = [](const std::string& duration, const std::string& tmpl) {
+            return "<MPD type=\"static\" mediaPresentationDuration=\"" + duration + "\"><Period>"
+                   "<AdaptationSet contentType=\"video\">" + tmpl + "<Representation id=\"v\" bandwidth=\"1\"/>"
+                   "</AdaptationSet></Period></MPD>";
+        };
+        ASSERT(ManifestParser::parse(vodMpd("PT30S", "<SegmentTemplate media=\"$Time$.m4s\"><SegmentTimeline>"
+               "<S t=\"0\" d=\"1\" r=\"4000000000\"/></SegmentTimeline></SegmentTemplate>"), "x", m) ==
+               Result::ERROR_INVALID_PARAM);
+        ASSERT(ManifestParser::parse(vodMpd("PT1000000H", "<SegmentTemplate media=\"$Number$.m4s\" duration=\"1\"/>"),
+               "x", m) == Result::ERROR_INVALID_PARAM);
+        ASSERT(ManifestParser::parse(vodMpd("PT1000000H", "<SegmentTemplate media=\"$Time$.m4s\" "
+               "timescale=\"18446744073709551615\"><SegmentTimeline><S t=\"0\" d=\"1000\" r=\"-1\"/>"
+               "</SegmentTimeline></SegmentTemplate>"), "x", m) == Result::ERROR_INVALID_PARAM);
+        /* period * timescale past 64 bits: 1e6 h at 2^24 ticks/s in 2^54-tick segments */
+        ASSERT(ManifestParser::parse(vodMpd("PT1000000H", "<SegmentTemplate media=\"$Number$.m4s\" "
+               "timescale=\"16777216\" duration=\"18014398509481984\"/>"), "x", m) == Result::OK);
+        ASSERT(m.video.size() == 1 && m.video[0].timeline.segments.size() == 4);
+        ASSERT(m.video[0].timeline.segments[1].start_us == 1073741824000000LL);
+        std::string capped = vodMpd("PT30S", "<SegmentTemplate media=\"$Time$.m4s\"><SegmentTimeline>"
+            "<S t=\"0\" d=\"1\" r=\"" + std::to_string(ManifestParser::kMaxTemplateSegments - 1) +
+            "\"/></SegmentTimeline></SegmentTemplate>");
+        ASSERT(ManifestParser::parse(capped, "x", m) == Result::OK);
+        ASSERT(m.video[0].timeline.segments.size() == ManifestParser::kMaxTemplateSegments);
+
+        /* Only EXT-X-STREAM-INF makes a master playlist: a media playlist with no segments yet is one */
+        ASSERT(ManifestParser::parse("#EXTM3U\n#EXT-X-TARGETDURATION:4\n#EXT-X-MEDIA-SEQUENCE:7\n",
+                                     "https://cdn.test/live.m3u8", m) == Result::OK);
+        ASSERT(m.video.size() == 1 && m.video[0].timeline.segments.empty() && m.live);
+    }
+    TEST_END();
+
+    TEST("SegmentScheduler - prefetch across audio and video, live reload");
+    {
+        using streaming::device::Result;
+        /* In-memory origin: playlists as text, segments as bytes named after their URI */
+        std::mutex origin_mutex;
+        std::map<std::string, std::string> origin;
+        std::atomic<uint32_t> requests{0};
+        auto loader = [&](const streaming::media::SegmentRequest& req, std::vector<uint8_t>& body) {
+            ++requests;
+            std::lock_guard<std::mutex> lock(origin_mutex);
+            auto it = origin.find(req.uri);
+            std::string data;
+            if (it != origin.end()) data = it->second;
+            else if (req.uri.find(".m3u8") == std::string::npos) data = req.uri + std::string(20000, 'x');
+            else return Result::ERROR_NOT_FOUND;
+            body.assign(data.begin(), data.end());
+            return Result::OK;
+        };
+        auto livePlaylist = [](int first, int last) {
+            std::string p = "#EXTM3U\n#EXT-X-TARGETDURATION:1\n#EXT-X-MEDIA-SEQUENCE:" + std::to_string(first) + "\n";
+            for (int i = first; i <= last; ++i) p += "#EXTINF:1.0,\nseg" + std::to_string(i) + ".ts\n";
+            return p;
+        };
+        std::string vod = "#EXTM3U\n#EXT-X-TARGETDURATION:4\n#EXT-X-MAP:URI=\"init.mp4\"\n";
+        for (int i = 0; i < 10; ++i) vod += "#EXTINF:4,\n" + std::to_string(i) + ".m4s\n";
+        vod += "#EXT-X-ENDLIST\n";
+        origin["https://o.test/v/lo.m3u8"] = vod;
+        origin["https://o.test/v/hi.m3u8"] = vod;
+        origin["https://o.test/a/en.m3u8"] = vod;
+        origin["https://o.test/live.m3u8"] = livePlaylist(0, 5);
+
+        streaming::media::Manifest m;
+        ASSERT(streaming::media::ManifestParser::parse(
+            "#EXTM3U\n#EXT-X-MEDIA:TYPE=AUDIO,GROUP-ID=\"a\",NAME=\"en\",URI=\"a/en.m3u8\"\n"
+            "#EXT-X-STREAM-INF:BANDWIDTH=800000,RESOLUTION=640x360\nv/lo.m3u8\n"
+            "#EXT-X-STREAM-INF:BANDWIDTH=5000000,RESOLUTION=1920x1080\nv/hi.m3u8\n",
+            "https://o.test/master.m3u8", m) == Result::OK);
+
+        streaming::media::AbrConfig abr_cfg;
+        abr_cfg.initial_estimate_bps = 1000000;   /* Start on the low rendition */
+        streaming::media::AbrController abr(abr_cfg);
+        abr.setRenditions(streaming::media::ManifestParser::ladder(m));
+        abr.setQualityCap(streaming::device::StreamQuality::LOW);   /* The instant loader would switch up */
+        streaming::media::SegmentScheduler sched(loader, abr);
+        ASSERT(sched.start(m, 8000000) == Result::OK);
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        auto st = sched.getStats();
+        ASSERT(st.queued_video == 4 && st.queued_audio == 4);   /* Init + three segments each */
+        ASSERT(st.buffered_video_us == 12000000 && st.buffered_audio_us == 12000000);
+
+        streaming::media::FetchedSegment seg;
+        ASSERT(sched.popSegment(streaming::media::StreamKind::VIDEO, seg) && seg.init);
+        ASSERT(std::string(seg.data.begin(), seg.data.begin() + 24) == "https://o.test/v/init.mp");
+        ASSERT(sched.popSegment(streaming::media::StreamKind::VIDEO, seg) && !seg.init);
+        ASSERT(seg.sequence == 2 && seg.start_us == 8000000);   /* Started at the 8 s segment */
+        ASSERT(sched.popSegment(streaming::media::StreamKind::VIDEO, seg) && seg.sequence == 3);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        ASSERT(sched.getStats().queued_video == 3);             /* Refilled to three ahead */
+        ASSERT(sched.getStats().queued_audio == 4);             /* Audio untouched */
+
+        /* Seek drops the queues and restarts at the new position */
+        sched.seek(36000000);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        ASSERT(sched.popSegment(streaming::media::StreamKind::AUDIO, seg) && seg.init);
+        ASSERT(sched.popSegment(streaming::media::StreamKind::AUDIO, seg) && seg.sequence == 9);
+        ASSERT(!sched.popSegment(streaming::media::StreamKind::AUDIO, seg));   /* VOD ended */
+        sched.stop();
+
+        /* Live: start three behind the edge, follow the sliding window */
+        ASSERT(streaming::media::ManifestParser::parse(origin["https://o.test/live.m3u8"],
+               "https://o.test/live.m3u8", m) == Result::OK && m.live);
+        abr.setRenditions(streaming::media::ManifestParser::ladder(m));
+        ASSERT(sched.start(m, -1) == Result::OK);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        ASSERT(sched.popSegment(streaming::media::StreamKind::VIDEO, seg) && seg.sequence == 3);
+        {
+            std::lock_guard<std::mutex> lock(origin_mutex);
+            origin["https://o.test/live.m3u8"] = livePlaylist(2, 9);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1300));
+        st = sched.getStats();
+        ASSERT(st.reloads >= 1 && st.appended == 4);
+        uint64_t expect = 4;
+        bool in_order = true;
+        while (sched.popSegment(streaming::media::StreamKind::VIDEO, seg)) in_order = in_order && seg.sequence == expect++;
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        while (sched.popSegment(streaming::media::StreamKind::VIDEO, seg)) in_order = in_order && seg.sequence == expect++;
+        ASSERT(in_order && expect == 10);
+        ASSERT(sched.getManifest().video[0].timeline.segments.front().sequence == 2);
+        sched.stop();
+
+        /* Through the streaming service: an adaptive session from a master playlist */
+        origin["https://o.test/master.m3u8"] =
+            "#EXTM3U\n#EXT-X-STREAM-INF:BANDWIDTH=800000,RESOLUTION=640x360\nv/lo.m3u8\n"
+            "#EXT-X-STREAM-INF:BANDWIDTH=5000000,RESOLUTION=1920x1080\nv/hi.m3u8\n";
+        auto svc = streaming::services::createStreamingService(*display, loader);
+        svc->initialize();
+        ASSERT(svc->startSession("app", "https://o.test/master.m3u8", "s1") == Result::OK);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        ASSERT(svc->getSegmentStats().fetched >= 4);
+        ASSERT(svc->getSegmentStats().popped >= 2);   /* Pre-roll demuxed the init and first segment */
+        ASSERT(svc->getAbrStats().samples >= 1);
+        /* Seeks reposition the prefetch; seeking back is served from the segment cache */
+        ASSERT(svc->seek(20000000) == Result::OK);
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        const auto ahead = svc->getSegmentStats();
+        const uint32_t requests_ahead = requests;
+        ASSERT(ahead.fetched >= 6);   /* The 20 s segment and its read-ahead were new */
+        ASSERT(svc->seek(0) == Result::OK);
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        const auto back = svc->getSegmentStats();
+        ASSERT(back.cache_hits >= ahead.cache_hits + 3);   /* Init, 0 s and 4 s segments: watched already */
+        ASSERT(back.popped > ahead.popped);
+        ASSERT(requests - requests_ahead <= back.fetched - ahead.fetched);
+        ASSERT(svc->stopSession() == Result::OK);
+
+        /* Gapless onto an adaptive item: it pre-rolls from segments of its own, which carry on after the switch */
+        streaming::drivers::mock::MockStreamConfig intro;
+        intro.duration_us = 1000000;
+        streaming::drivers::mock::MockContainerParser::setStream("intro.mp4", intro);
+        ASSERT(svc->startSession("app", "intro.mp4", "s4") == Result::OK);
+        ASSERT(svc->queueNext("https://o.test/master.m3u8") == Result::OK);
+        for (int i = 0; i < 400 && svc->getGaplessStats().switches == 0; ++i)
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        ASSERT(svc->getGaplessStats().switches == 1);
+        const auto next_st = svc->getSegmentStats();
+        ASSERT(next_st.cache_hits >= 4 && next_st.popped >= 2);   /* s1 left them in the cache */
+        ASSERT(svc->stopSession() == Result::OK);
+        svc->shutdown();
+        auto no_loader = streaming::services::createStreamingService(*display);
+        no_loader->initialize();
+        ASSERT(no_loader->startSession("app", "https://o.test/master.m3u8", "s2") == Result::ERROR_NOT_SUPPORTED);
+        ASSERT(no_loader->startSession("app", "http://127.0.0.1:1/master.m3u8", "s3") == Result::ERROR_NETWORK);
+        no_loader->shutdown();
+    }
+    TEST_END();
+
+    TEST("SegmentScheduler - ABR climbs the full ladder on the prefetch buffer");
+    {
+        using streaming::device::Result;
+        using streaming::media::StreamKind;
+        /* Four renditions, 6 s segments, a fast origin: only the buffer rule holds ABR back */
+        std::string vod = "#EXTM3U\n#EXT-X-TARGETDURATION:6\n";
+        for (int i = 0; i < 40; ++i) vod += "#EXTINF:6,\n" + std::to_string(i) + ".ts\n";
+        vod += "#EXT-X-ENDLIST\n";
+        auto loader = [&](const streaming::media::SegmentRequest& req, std::vector<uint8_t>& body) {
+            if (req.uri.find(".m3u8") != std::string::npos) body.assign(vod.begin(), vod.end());
+            else body.assign(64 * 1024, 0);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            return Result::OK;
+        };
+        streaming::media::Manifest m;
+        ASSERT(streaming::media::ManifestParser::parse(
+            "#EXTM3U\n"
+            "#EXT-X-STREAM-INF:BANDWIDTH=1000000,RESOLUTION=640x360\nv0.m3u8\n"
+            "#EXT-X-STREAM-INF:BANDWIDTH=2500000,RESOLUTION=854x480\nv1.m3u8\n"
+            "#EXT-X-STREAM-INF:BANDWIDTH=5000000,RESOLUTION=1280x720\nv2.m3u8\n"
+            "#EXT-X-STREAM-INF:BANDWIDTH=8000000,RESOLUTION=1920x1080\nv3.m3u8\n",
+            "https://o.test/master.m3u8", m) == Result::OK);
+        streaming::media::AbrConfig abr_cfg;
+        abr_cfg.initial_estimate_bps = 1200000;   /* Start on the lowest rung */
+        streaming::media::AbrController abr(abr_cfg);
+        abr.setRenditions(streaming::media::ManifestParser::ladder(m));
+        streaming::media::SegmentScheduler sched(loader, abr);   /* Three segments, 18 s, ahead */
+        ASSERT(sched.start(m, 0) == Result::OK);
+
+        /* Playback takes a segment whenever the origin has long refilled the slot:
+         * 12 s queued when a rendition is picked, above the 10 s BOLA floor but far
+         * below its default 24 s target, which would pin the choice to the low rungs */
+        streaming::media::FetchedSegment seg;
+        std::vector<size_t> renditions;
+        for (int i = 0; i < 2000 && renditions.size() < 30; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            if (sched.popSegment(StreamKind::VIDEO, seg)) renditions.push_back(seg.rendition);
+        }
+        ASSERT(renditions.size() == 30 && renditions.front() == 0);
+        ASSERT(renditions.back() == 3);   /* The top rung, reached within the prefetch */
+        ASSERT(std::is_sorted(renditions.begin(), renditions.end()));   /* Straight up, no flapping */
+        ASSERT(abr.getStats().switches_down == 0 && abr.getStats().switches_up >= 1);
+        sched.stop();
+    }
+    TEST_END();
+
+    TEST("SegmentSourceParser - demux paced by popped segments");
+    {
+        using streaming::device::Result;
+        using streaming::media::StreamKind;
+        /* Five 2 s segments; the origin serves only those below `allowed` */
+        std::atomic<int> allowed{2};
+        std::atomic<bool> closing{false};
+        auto loader = [&](const streaming::media::SegmentRequest& req, std::vector<uint8_t>& body) {
+            const std::string name = req.uri.substr(req.uri.find_last_of('/') + 1);
+            const int index = name[0] - '0';
+            while (index >= allowed && !closing) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            body.assign(30000, 0x5a);
+            return Result::OK;
+        };
+        std::string vod = "#EXTM3U\n#EXT-X-TARGETDURATION:2\n";
+        for (int i = 0; i < 5; ++i) vod += "#EXTINF:2,\n" + std::to_string(i) + ".m4s\n";
+        vod += "#EXT-X-ENDLIST\n";
+        streaming::media::Manifest m;
+        ASSERT(streaming::media::ManifestParser::parse(vod, "https://o.test/short.m3u8", m) == Result::OK);
+        ASSERT(m.video.size() == 1 && m.audio.empty());
+
+        streaming::media::AbrController abr;
+        abr.setRenditions(streaming::media::ManifestParser::ladder(m));
+        streaming::media::SegmentScheduler sched(loader, abr);
+        streaming::drivers::mock::MockContainerParser demuxer;
+        streaming::media::SegmentSourceParser source(demuxer, sched);
+        ASSERT(sched.start(m, 0) == Result::OK);
+        ASSERT(source.openContainer("short.mp4") == Result::OK);
+
+        /* Reads until the source refuses; audio is muxed, so it is gated on the video segments */
+        auto drain = [&](int64_t& last_video, int64_t& last_audio) {
+            streaming::media::EncodedPacket pkt;
+            Result r = Result::OK;
+            for (int idle = 0; idle < 300;) {
+                r = source.readPacket(pkt);
+                if (r == Result::ERROR_END_OF_STREAM) break;
+                if (r != Result::OK) {
+                    ++idle;
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                    continue;
+                }
+                idle = 0;
+                (pkt.track_id == source.getVideoTracks()[0].track_id ? last_video : last_audio) = pkt.timing.pts;
+            }
+            return r;
+        };
+        int64_t last_video = -1, last_audio = -1;
+        ASSERT(drain(last_video, last_audio) == Result::ERROR_TIMEOUT);   /* Segment 2 never came */
+        ASSERT(last_video >= 3900000 && last_video < 4000000);
+        ASSERT(last_audio >= 3900000 && last_audio < 4000000);
+        ASSERT(sched.getStats().popped == 2);
+        ASSERT(!sched.isDrained(StreamKind::VIDEO));
+
+        allowed = 5;
+        ASSERT(drain(last_video, last_audio) == Result::ERROR_END_OF_STREAM);   /* Last segment popped */
+        ASSERT(last_video >= 9900000 && last_video < 10000000);
+        ASSERT(sched.getStats().popped == 5 && sched.isDrained(StreamKind::VIDEO));
+
+        /* Seeking repositions the scheduler as well */
+        ASSERT(source.seek(6000000) == Result::OK);
+        streaming::media::EncodedPacket pkt;
+        Result r = Result::ERROR_TIMEOUT;
+        for (int i = 0; i < 500 && r == Result::ERROR_TIMEOUT; ++i) {
+            r = source.readPacket(pkt);
+            if (r == Result::ERROR_TIMEOUT) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        ASSERT(r == Result::OK && pkt.timing.pts > 5900000 && pkt.timing.pts <= 6000000);   /* Keyframe at 6 s */
+        ASSERT(sched.getStats().popped == 6);   /* The 6 s segment */
+        closing = true;
+        sched.stop();
+        ASSERT(sched.isDrained(StreamKind::VIDEO));
+    }
+    TEST_END();
+
+    TEST("SegmentSourceParser - rendition switch changes the demuxed track");
+    {
+        using streaming::device::Result;
+        using streaming::drivers::mock::MockContainerParser;
+        /* Each rendition has its own init segment and fills its media segments with its own byte */
+        auto loader = [&](const streaming::media::SegmentRequest& req, std::vector<uint8_t>& body) {
+            const bool hi = req.uri.find("/hi") != std::string::npos;
+            if (req.uri.find("init") != std::string::npos)
+                body = hi ? MockContainerParser::makeInitSegment(1920, 1080)
+                          : MockContainerParser::makeInitSegment(640, 360);
+            else
+                body.assign(20000, hi ? 'H' : 'L');
+            return Result::OK;
+        };
+        auto playlist = [](const std::string& name) {
+            std::string p = "#EXTM3U\n#EXT-X-TARGETDURATION:2\n#EXT-X-MAP:URI=\"" + name + "-init.mp4\"\n";
+            for (int i = 0; i < 10; ++i) p += "#EXTINF:2,\n" + name + std::to_string(i) + ".m4s\n";
+            return p + "#EXT-X-ENDLIST\n";
+        };
+        streaming::media::Manifest m;
+        ASSERT(streaming::media::ManifestParser::parse(
+            "#EXTM3U\n#EXT-X-STREAM-INF:BANDWIDTH=800000,RESOLUTION=640x360\nlo.m3u8\n"
+            "#EXT-X-STREAM-INF:BANDWIDTH=5000000,RESOLUTION=1920x1080\nhi.m3u8\n",
+            "https://o.test/master.m3u8", m) == Result::OK);
+        ASSERT(streaming::media::ManifestParser::parseHlsMedia(playlist("lo"), "https://o.test/lo.m3u8",
+                                                               m.video[0].timeline) == Result::OK);
+        ASSERT(streaming::media::ManifestParser::parseHlsMedia(playlist("hi"), "https://o.test/hi.m3u8",
+                                                               m.video[1].timeline) == Result::OK);
+
+        streaming::media::AbrConfig abr_cfg;
+        abr_cfg.initial_estimate_bps = 1000000;
+        streaming::media::AbrController abr(abr_cfg);
+        abr.setRenditions(streaming::media::ManifestParser::ladder(m));
+        abr.setQualityCap(streaming::device::StreamQuality::LOW);
+        streaming::media::SegmentScheduler sched(loader, abr);
+        MockContainerParser demuxer;
+        streaming::media::SegmentSourceParser source(demuxer, sched);
+        ASSERT(sched.start(m, 0) == Result::OK);
+        ASSERT(source.openContainer("master.mp4") == Result::OK);
+
+        /* Low until the cap lifts; the instant origin then moves to the top rung */
+        streaming::media::EncodedPacket pkt;
+        int64_t last_pts = -1, switch_pts = -1;
+        bool in_order = true, low_first = true, resized = false;
+        for (int idle = 0; idle < 2000 && switch_pts < 0;) {
+            const Result r = source.readPacket(pkt);
+            if (r != Result::OK) {
+                ++idle;
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+            if (pkt.track_id != MockContainerParser::kVideoTrackId) continue;
+            in_order = in_order && pkt.timing.pts > last_pts;
+            last_pts = pkt.timing.pts;
+            if (pkt.timing.pts == 2000000) abr.setQualityCap(streaming::device::StreamQuality::AUTO);
+            if (pkt.data.front() == 'L') {
+                low_first = low_first && source.getVideoTracks()[0].video.width == 640;
+                continue;
+            }
+            switch_pts = pkt.timing.pts;
+            resized = source.getVideoTracks()[0].video.width == 1920 &&
+                      source.getVideoTracks()[0].video.height == 1080;
+            ASSERT(pkt.is_keyframe && pkt.data.back() == 'H');
+        }
+        ASSERT(in_order && low_first);
+        ASSERT(switch_pts > 2000000 && switch_pts % 2000000 == 0);   /* On a segment boundary */
+        ASSERT(resized);   /* The new rendition's init segment applied with its first frame */
+        ASSERT(abr.getStats().switches_up >= 1);
+        sched.stop();
+    }
+    TEST_END();
+
+    TEST("MediaCache - LRU budget, pins, persistence, seek back from cache");
+    {
+        using streaming::device::Result;
+        using streaming::media::SegmentRequest;
+        streaming::drivers::mock::MockStorageDriver storage;
+        storage.setSpace(1000000, 600000);
+        streaming::media::MediaCacheConfig cfg;
+        cfg.reserve_free_bytes = 100000;
+        auto seg = [](int i) { return SegmentRequest{"http://cdn/v/" + std::to_string(i) + ".m4s", 0, 0}; };
+        auto bytes = [](int i) { return std::vector<uint8_t>(60000, static_cast<uint8_t>(i)); };
+        std::vector<uint8_t> out;
+        {
+            streaming::media::MediaCache cache(storage, cfg);
+            ASSERT(cache.lookup(seg(0), out) == Result::ERROR_NOT_FOUND);   /* Not opened: disabled */
+            ASSERT(cache.open() == Result::OK);
+            ASSERT(cache.getStats().budget == 250000);   /* A quarter of the partition */
+            for (int i = 0; i < 4; ++i) ASSERT(cache.insert(seg(i), bytes(i)) == Result::OK);
+            ASSERT(cache.lookup(seg(0), out) == Result::OK && out == bytes(0));   /* 0 most recent */
+            ASSERT(cache.insert(seg(4), bytes(4)) == Result::OK);
+            ASSERT(!cache.contains(seg(1)) && cache.contains(seg(0)));          /* LRU went */
+            cache.pin(seg(2));                                                  /* Playing */
+            ASSERT(cache.insert(seg(5), bytes(5)) == Result::OK);
+            ASSERT(cache.contains(seg(2)) && !cache.contains(seg(3)));
+            cache.unpin(seg(2));
+            ASSERT(cache.insert(seg(6), std::vector<uint8_t>(300000)) == Result::ERROR_NO_MEMORY);
+            /* Byte ranges of one resource are separate entries */
+            SegmentRequest a{"http://cdn/all.mp4", 0, 100}, b{"http://cdn/all.mp4", 100, 100};
+            ASSERT(cache.insert(a, std::vector<uint8_t>(100, 1)) == Result::OK);
+            ASSERT(cache.insert(b, std::vector<uint8_t>(100, 2)) == Result::OK);
+            ASSERT(cache.lookup(b, out) == Result::OK && out[0] == 2);
+            auto st = cache.getStats();
+            ASSERT(st.entries == 6 && st.evictions == 2 && st.rejected == 1 && st.bytes_used <= st.budget);
+        }
+        /* Reopen: the index survives, orphaned and lost blobs are cleaned up */
+        storage.writeBytes("mcache/orphan", std::vector<uint8_t>(10));
+        {
+            streaming::media::MediaCache probe(storage, cfg);
+            probe.open();
+            probe.pin(seg(0));   /* Pins are per process, not persisted */
+        }
+        std::vector<uint8_t> index_blob;
+        storage.readBytes("mcache/index", index_blob);
+        const std::string index_text(index_blob.begin(), index_blob.end());
+        const size_t line = index_text.rfind('\n', index_text.find(seg(4).uri));
+        storage.remove(index_text.substr(line + 1, index_text.find(' ', line + 1) - line - 1));   /* Lose seg 4's blob */
+        {
+            streaming::media::MediaCache cache(storage, cfg);
+            ASSERT(cache.open() == Result::OK);
+            ASSERT(!storage.exists("mcache/orphan") && cache.getStats().entries == 5);
+            ASSERT(cache.lookup(seg(5), out) == Result::OK && out == bytes(5));
+            storage.setSpace(1000000, 150000);   /* Partition filled up meanwhile */
+            ASSERT(cache.open() == Result::OK);
+            ASSERT(cache.getStats().budget == cache.getStats().bytes_used + 50000);
+            cache.clear();
+            ASSERT(cache.getStats().entries == 0);
+        }
+
+        /* Scheduler: a backward seek is served from the cache, not the network */
+        storage.setSpace(1ULL << 30, 512ULL << 20);
+        cfg.reserve_free_bytes = 64ULL << 20;
+        streaming::media::MediaCache cache(storage, cfg);
+        ASSERT(cache.open() == Result::OK);
+        std::atomic<uint32_t> segment_requests{0};
+        std::string vod = "#EXTM3U\n#EXT-X-TARGETDURATION:4\n";
+        for (int i = 0; i < 10; ++i) vod += "#EXTINF:4,\n" + std::to_string(i) + ".ts\n";
+        vod += "#EXT-X-ENDLIST\n";
+        auto loader = [&](const SegmentRequest& req, std::vector<uint8_t>& body) {
+            if (req.uri.find(".m3u8") != std::string::npos) {
+                body.assign(vod.begin(), vod.end());
+            } else {
+                ++segment_requests;
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                body.assign(40000, static_cast<uint8_t>(req.uri[req.uri.size() - 4]));
+            }
+            return Result::OK;
+        };
+        streaming::media::Manifest m;
+        streaming::media::ManifestParser::parse(vod, "http://cdn/v.m3u8", m);
+        streaming::media::AbrController abr;
+        abr.setRenditions(streaming::media::ManifestParser::ladder(m));
+        streaming::media::SegmentScheduler sched(loader, abr);
+        sched.setCache(&cache);
+        ASSERT(sched.start(m, 0) == Result::OK);
+        streaming::media::FetchedSegment fs;
+        int popped = 0;
+        for (int i = 0; i < 200 && popped < 6; ++i) {
+            if (sched.popSegment(streaming::media::StreamKind::VIDEO, fs)) ++popped;
+            else std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        ASSERT(popped == 6 && fs.sequence == 5);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));   /* Prefetch refilled, worker idle */
+        ASSERT(cache.getStats().pinned == 4);   /* Playing segment plus three queued */
+        const uint32_t downloaded = segment_requests;
+        const uint64_t samples = abr.getStats().samples;
+        sched.seek(0);
+        popped = 0;
+        for (int i = 0; i < 200 && popped < 4; ++i) {
+            if (sched.popSegment(streaming::media::StreamKind::VIDEO, fs)) ++popped;
+            else std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        ASSERT(popped == 4 && fs.sequence == 3 && fs.data[0] == '3');
+        ASSERT(segment_requests == downloaded);               /* All from the cache */
+        ASSERT(sched.getStats().cache_hits >= 4);
+        ASSERT(abr.getStats().samples == samples);            /* Hits say nothing about the link */
+        sched.stop();
+        ASSERT(cache.getStats().pinned == 0);
+    }
+    TEST_END();
+
+    TEST("MediaCache - blob I/O runs outside the cache lock");
+    {
+        using streaming::device::Result;
+        using streaming::media::SegmentRequest;
+        /* Blob reads park until released, or for at most two seconds */
+        struct GatedStorage : streaming::drivers::mock::MockStorageDriver {
+            std::mutex m;
+            std::condition_variable cv;
+            bool gate{false}, parked{false}, released{false}, timed_out{false};
+            Result readBytes(const std::string& key, std::vector<uint8_t>& out) override {
+                {
+                    std::unique_lock<std::mutex> lock(m);
+                    if (gate && key != "mcache/index") {
+                        parked = true;
+                        cv.notify_all();
+                        timed_out = !cv.wait_for(lock, std::chrono::seconds(2), [&] { return released; });
+                    }
+                }
+                return MockStorageDriver::readBytes(key, out);
+            }
+        } storage;
+        storage.setSpace(1000000, 600000);
+        streaming::media::MediaCacheConfig cfg;
+        cfg.reserve_free_bytes = 100000;
+        streaming::media::MediaCache cache(storage, cfg);
+        ASSERT(cache.open() == Result::OK);
+        const SegmentRequest a{"http://cdn/a.m4s", 0, 0}, b{"http://cdn/b.m4s", 0, 0};
+        ASSERT(cache.insert(a, std::vector<uint8_t>(1000, 1)) == Result::OK);
+        storage.gate = true;
+        std::vector<uint8_t> out;
+        std::thread reader([&] { cache.lookup(a, out); });
+        {
+            std::unique_lock<std::mutex> lock(storage.m);
+            ASSERT(storage.cv.wait_for(lock, std::chrono::seconds(1), [&] { return storage.parked; }));
+        }
+        /* The demux thread's unpin, stats and other inserts go ahead meanwhile */
+        cache.pin(a);
+        cache.unpin(a);
+        ASSERT(cache.getStats().entries == 1);
+        ASSERT(cache.insert(b, std::vector<uint8_t>(1000, 2)) == Result::OK);
+        ASSERT(cache.insert(a, std::vector<uint8_t>(1000, 3)) == Result::ERROR_BUSY);   /* Being read */
+        {
+            std::lock_guard<std::mutex> lock(storage.m);
+            storage.released = true;
+        }
+        storage.cv.notify_all();
+        reader.join();
+        ASSERT(!storage.timed_out);   /* Nothing above waited for the read */
+        ASSERT(out == std::vector<uint8_t>(1000, 1));
+        storage.gate = false;
+        ASSERT(cache.lookup(b, out) == Result::OK && out[0] == 2);
+        ASSERT(cache.getStats().hits == 2 && cache.getStats().rejected == 1);
+    }
+    TEST_END();
+
+    TEST("HttpClient - keep-alive pool, pipelined ranges, byte source");
+    {
+        using streaming::device::Result;
+        LoopbackHttpServer server;
+        const auto& data = server.data();
+        streaming::media::HttpClient http;
+        std::vector<uint8_t> body;
+
+        ASSERT(http.get(server.url("/data.bin"), {}, body) == Result::OK);
+        ASSERT(body == data);
+        ASSERT(http.get(server.url("/data.bin"), {1000, 5000}, body) == Result::OK);
+        ASSERT(body.size() == 5000 && std::equal(body.begin(), body.end(), data.begin() + 1000));
+        ASSERT(http.get(server.url("/data.bin"), {data.size() - 10, 0}, body) == Result::OK && body.size() == 10);
+        ASSERT(http.get(server.url("/missing"), {}, body) == Result::ERROR_NOT_FOUND);
+        ASSERT(http.get(server.url("/chunked.m3u8"), {}, body) == Result::OK);
+        ASSERT(std::string(body.begin(), body.end()) == "#EXTM3U\n#EXT-X-ENDLIST\n\n");
+        ASSERT(server.accepted() == 1);   /* Five requests, one handshake, 404 included */
+
+        std::vector<streaming::media::HttpRange> ranges;
+        for (uint64_t i = 0; i < 6; ++i) ranges.push_back({i * 100000, 4096});
+        std::vector<std::vector<uint8_t>> bodies;
+        ASSERT(http.getRanges(server.url("/data.bin"), ranges, bodies) == Result::OK);
+        bool ranges_ok = bodies.size() == 6;
+        for (size_t i = 0; ranges_ok && i < 6; ++i)
+            ranges_ok = bodies[i].size() == 4096 && std::equal(bodies[i].begin(), bodies[i].end(), data.begin() + i * 100000);
+        ASSERT(ranges_ok);
+        auto st = http.getStats();
+        ASSERT(st.pipelined == 4);          /* Two batches of depth 4 and 2 */
+        ASSERT(server.accepted() == 1 && st.connects == 1 && st.reuses == 10);
+
+        /* The server dropping idle connections costs a reconnect, not an error */
+        server.dropConnections();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        ASSERT(http.get(server.url("/data.bin"), {0, 16}, body) == Result::OK && body.size() == 16);
+        ASSERT(server.accepted() == 2);
+        ASSERT(http.get(server.url("/close"), {}, body) == Result::OK && http.getIdleConnections() == 0);
+        ASSERT(http.get(server.url("/data.bin"), {16, 16}, body) == Result::OK);
+        ASSERT(server.accepted() == 3);
+
+        /* As the segment scheduler's loader */
+        auto loader = http.loader();
+        ASSERT(loader({server.url("/data.bin"), 512, 256}, body) == Result::OK);
+        ASSERT(body.size() == 256 && body[0] == data[512]);
+
+        /* Progressive file: seekToByte within the read-ahead window is free */
+        streaming::media::HttpByteSource source(http, 64 * 1024);
+        ASSERT(source.open(server.url("/data.bin")) == Result::OK && source.length() == data.size());
+        ASSERT(source.seekToByte(700000) == Result::OK);
+        ASSERT(source.read(100, body) == Result::OK && body.size() == 100);
+        ASSERT(std::equal(body.begin(), body.end(), data.begin() + 700000));
+        const uint64_t fetches = source.getFetches();
+        ASSERT(fetches == 2);
+        ASSERT(source.read(64 * 1024, body) == Result::OK && body.size() == 64 * 1024);   /* Crosses into the 2nd chunk */
+        ASSERT(std::equal(body.begin(), body.end(), data.begin() + 700100));
+        ASSERT(source.seekToByte(700000 + 100 * 1024) == Result::OK);
+        ASSERT(source.read(10, body) == Result::OK && source.getFetches() == fetches);
+        ASSERT(source.seekToByte(data.size() - 5) == Result::OK);
+        ASSERT(source.read(100, body) == Result::OK && body.size() == 5);
+        ASSERT(source.read(1, body) == Result::ERROR_END_OF_STREAM);
+        ASSERT(source.seekToByte(data.size() + 1) == Result::ERROR_INVALID_PARAM);
+
+        /* Lengths are bounded: by the range asked for, else by max_response_bytes */
+        ASSERT(http.get(server.url("/huge"), {}, body) == Result::ERROR_IO && body.empty());
+        ASSERT(http.get(server.url("/negative"), {}, body) == Result::ERROR_IO);
+        streaming::media::HttpClientConfig small;
+        small.max_response_bytes = 1000;
+        streaming::media::HttpClient bounded(small);
+        ASSERT(bounded.get(server.url("/data.bin"), {}, body) == Result::ERROR_IO);
+        ASSERT(bounded.get(server.url("/data.bin"), {0, 1000}, body) == Result::OK && body.size() == 1000);
+
+        ASSERT(http.get("https://127.0.0.1/x", {}, body) == Result::ERROR_NOT_SUPPORTED);
+        ASSERT(http.get("http://127.0.0.1:1/x", {}, body) == Result::ERROR_NETWORK);
+        ASSERT(http.get("ftp://host/x", {}, body) == Result::ERROR_INVALID_PARAM);
+    }
+    TEST_END();
+
+    TEST("SpscQueue - bounded FIFO across threads");
+    {
+        streaming::common::SpscQueue<int> q(5);
+        ASSERT(q.capacity() == 8);
+        for (int i = 0; i < 8; ++i) ASSERT(q.tryPush(i));
+        ASSERT(!q.tryPush(99));
+        int v = -1;
+        for (int i = 0; i < 8; ++i) ASSERT(q.tryPop(v) && v == i);
+        ASSERT(!q.tryPop(v));
+
+        constexpr int kCount = 100000;
+        std::thread producer([&q] {
+            for (int i = 0; i < kCount; ++i)
+                while (!q.tryPush(i)) std::this_thread::yield();
+        });
+        bool in_order = true;
+        for (int expected = 0; expected < kCount;) {
+            if (!q.tryPop(v)) { std::this_thread::yield(); continue; }
+            in_order = in_order && v == expected;
+            ++expected;
+        }
+        producer.join();
+        ASSERT(in_order);
+        ASSERT(q.empty());
+    }
+    TEST_END();
+
+    TEST("BufferModel - watermarks drive start, underrun and resume");
+    {
+        using streaming::media::BufferLevel;
+        streaming::media::BufferModel model({1000000, 1500000, 500000});
+        auto sample = [](int64_t video_us, int64_t audio_us) {
+            streaming::media::BufferSnapshot s;
+            s.has_audio = true;
+            s.video.at(BufferLevel::NETWORK) = {video_us / 2, 400000};
+            s.video.at(BufferLevel::DEMUX) = {video_us / 4, 100000};
+            s.video.at(BufferLevel::DECODED) = {video_us - video_us / 2 - video_us / 4, 12000000};
+            s.audio.at(BufferLevel::DEMUX) = {audio_us / 2, 4000};
+            s.audio.at(BufferLevel::DECODED) = {audio_us - audio_us / 2, 96000};
+            return s;
+        };
+
+        /* Start: waits for the start watermark on the track with the least buffered */
+        model.restart(0);
+        ASSERT(model.evaluate(sample(2000000, 500000), 10000));
+        ASSERT(model.getProgress() == 50);
+        ASSERT(!model.evaluate(sample(2000000, 1000000), 250000));
+        ASSERT(model.getProgress() == 100);
+        auto st = model.getStats();
+        ASSERT(st.buffered_us == 1000000 && st.last_start_us == 250000);
+        ASSERT(st.video.durationUs() == 2000000 && st.video.bytes() == 12500000);
+        ASSERT(st.audio.at(BufferLevel::DECODED).duration_us == 500000);
+
+        /* Draining between low and start is still playable; under low stalls */
+        ASSERT(!model.evaluate(sample(700000, 600000), 1000000));
+        ASSERT(model.evaluate(sample(450000, 600000), 1100000));
+        st = model.getStats();
+        ASSERT(st.rebuffers == 1 && st.waiting);
+        ASSERT(st.progress == 30);                      /* 450 ms of the 1.5 s resume mark */
+
+        /* Recovery needs the resume watermark, not just the start one */
+        ASSERT(model.evaluate(sample(1200000, 1200000), 1500000));
+        ASSERT(!model.evaluate(sample(1600000, 1500000), 1900000));
+        st = model.getStats();
+        ASSERT(st.rebuffers == 1 && st.rebuffer_us == 800000);
+
+        /* Saturated queues or end of stream satisfy any watermark, never stall */
+        auto full = sample(100000, 100000);
+        full.saturated = true;
+        ASSERT(!model.evaluate(full, 2000000));
+        auto tail = sample(0, 0);
+        tail.end_of_stream = true;
+        ASSERT(!model.evaluate(tail, 2100000));
+        ASSERT(model.getStats().rebuffers == 1);
+
+        /* A seek restarts from the start watermark without counting a rebuffer */
+        model.restart(3000000);
+        ASSERT(model.evaluate(sample(200000, 200000), 3010000));
+        ASSERT(!model.evaluate(sample(1000000, 1000000), 3100000));
+        ASSERT(model.getStats().rebuffers == 1);
+
+        /* Video-only streams ignore the empty audio track; watermarks are kept ordered */
+        streaming::media::BufferModel silent({200000, 100000, 300000});
+        const auto w = silent.getWatermarks();
+        ASSERT(w.low_us == 300000 && w.start_us == 300000 && w.resume_us == 300000);
+        auto video_only = sample(400000, 0);
+        video_only.has_audio = false;
+        silent.restart(0);
+        ASSERT(!silent.evaluate(video_only, 1));
+    }
+    TEST_END();
+
+    TEST("JitterBuffer - reorders, skips losses and sizes itself from jitter");
+    {
+        using streaming::media::RtpPacket;
+        streaming::media::JitterBuffer jb;
+        const int64_t t0 = 1000000;
+        auto packet = [](uint16_t seq, uint32_t ts) {
+            RtpPacket p;
+            p.payload_type = 96;
+            p.sequence = seq;
+            p.timestamp = ts;
+            p.payload.assign(100, static_cast<uint8_t>(seq));
+            return p;
+        };
+        /* 20 ms frames (1800 ticks at 90 kHz); 2 overtakes 1 */
+        jb.push(packet(100, 0), t0);
+        jb.push(packet(102, 3600), t0 + 40000);
+        jb.push(packet(101, 1800), t0 + 41000);
+        jb.push(packet(102, 3600), t0 + 42000);
+        auto st = jb.getStats();
+        ASSERT(st.received == 4 && st.reordered == 1 && st.duplicates == 1 && st.depth == 3);
+
+        RtpPacket out;
+        int64_t media_us = 0;
+        uint64_t gap = 0;
+        ASSERT(!jb.pop(t0, out, media_us, gap));                          /* Held for the target delay */
+        ASSERT(jb.pop(t0 + st.target_delay_us, out, media_us, gap) && out.sequence == 100 && media_us == 0);
+        ASSERT(jb.pop(t0 + 100000, out, media_us, gap) && out.sequence == 101 && media_us == 20000);
+        ASSERT(jb.pop(t0 + 100000, out, media_us, gap) && out.sequence == 102 && media_us == 40000);
+        ASSERT(!jb.pop(t0 + 100000, out, media_us, gap));
+
+        /* 103 never arrives: skipped once 104 is due, and too late when it turns up */
+        jb.push(packet(104, 7200), t0 + 80000);
+        ASSERT(jb.pop(t0 + 200000, out, media_us, gap) && out.sequence == 104 && gap == 1);
+        const int64_t target = jb.getStats().target_delay_us;
+        jb.push(packet(103, 5400), t0 + 210000);
+        st = jb.getStats();
+        ASSERT(st.lost == 1 && st.late == 1 && st.target_delay_us > target);
+
+        /* Sequence and timestamp wrap */
+        jb.reset();
+        const uint16_t seqs[] = {65534, 65535, 0, 1};
+        for (int i = 0; i < 4; ++i)
+            jb.push(packet(seqs[i], 0xFFFFF000u + static_cast<uint32_t>(i) * 1800), t0 + i * 20000);
+        bool ordered = true;
+        for (int i = 0; i < 4; ++i)
+            ordered = ordered && jb.pop(t0 + 500000, out, media_us, gap) && out.sequence == seqs[i] &&
+                      media_us == i * 20000 && gap == 0;
+        ASSERT(ordered);
+
+        /* Jittery arrivals grow the target delay; a steady stream lets it shrink back */
+        jb.reset();
+        for (int i = 0; i < 200; ++i)
+            jb.push(packet(static_cast<uint16_t>(i), static_cast<uint32_t>(i) * 1800),
+                    t0 + i * 20000 + (i % 2) * 15000);
+        st = jb.getStats();
+        ASSERT(st.jitter_us > 8000 && st.target_delay_us >= 4 * 8000 && st.target_delay_us <= 400000);
+        for (int i = 200; i < 1200; ++i)
+            jb.push(packet(static_cast<uint16_t>(i), static_cast<uint32_t>(i) * 1800), t0 + i * 20000);
+        ASSERT(jb.getStats().target_delay_us < st.target_delay_us / 2);
+
+        /* Wire format with the abs-capture-time extension */
+        RtpPacket sent = packet(7, 123456);
+        sent.marker = true;
+        sent.ssrc = 0xCAFE;
+        sent.capture_time_us = 1700000000123456LL;
+        const std::vector<uint8_t> wire = sent.serialize();
+        RtpPacket parsed;
+        ASSERT(RtpPacket::parse(wire.data(), wire.size(), parsed));
+        ASSERT(parsed.sequence == 7 && parsed.timestamp == 123456 && parsed.marker && parsed.ssrc == 0xCAFE);
+        ASSERT(parsed.payload == sent.payload);
+        ASSERT(std::llabs(parsed.capture_time_us - sent.capture_time_us) <= 1);
+        ASSERT(RtpPacket::parse(wire.data(), wire.size(), parsed, 2) && parsed.capture_time_us == -1);
+        ASSERT(!RtpPacket::parse(wire.data(), 8, parsed));
+    }
+    TEST_END();
+
+    TEST("JitterBuffer - a slow sender clock does not drain the margin");
+    {
+        using streaming::media::RtpPacket;
+        streaming::media::JitterBuffer jb;
+        /* Sender clock 0.2% slow: 20 ms of real time carries 19.96 ms of media.
+         * +-1 ms jitter, and every 10th packet is overtaken by the next one. */
+        struct Arrival { int64_t at; uint16_t seq; uint32_t ts; };
+        std::vector<Arrival> arrivals;
+        std::mt19937 rng(11);
+        std::uniform_int_distribution<int> jitter(0, 2000);
+        const int kPackets = 3000;   /* 60 s; an all-time minimum would be 120 ms behind by the end */
+        for (int i = 0; i < kPackets; ++i) {
+            int64_t at = 1000000 + static_cast<int64_t>(i) * 20000 + jitter(rng);
+            if (i % 10 == 0) at += 24000;
+            const auto ts = static_cast<uint32_t>(static_cast<int64_t>(i) * 20000 * 998 / 1000 * 90 / 1000);
+            arrivals.push_back({at, static_cast<uint16_t>(i), ts});
+        }
+        std::sort(arrivals.begin(), arrivals.end(), [](const Arrival& a, const Arrival& b) { return a.at < b.at; });
+
+        RtpPacket out;
+        int64_t media_us = 0;
+        uint64_t gap = 0;
+        uint64_t late_at_half = 0;
+        size_t next = 0;
+        for (int64_t now = 1000000; next < arrivals.size() || jb.getStats().depth > 0; now += 1000) {
+            for (; next < arrivals.size() && arrivals[next].at <= now; ++next) {
+                RtpPacket p;
+                p.sequence = arrivals[next].seq;
+                p.timestamp = arrivals[next].ts;
+                jb.push(std::move(p), arrivals[next].at);
+            }
+            while (jb.pop(now, out, media_us, gap)) {}
+            if (next == arrivals.size() / 2 && late_at_half == 0) late_at_half = jb.getStats().late + 1;
+        }
+        const auto st = jb.getStats();
+        /* Once settled the overtaken packets make their slots; the delay stays low */
+        ASSERT(st.late + 1 == late_at_half);
+        ASSERT(st.late <= 1 && st.lost == 0);   /* Packet 0, overtaken before the stream started */
+        ASSERT(st.reordered >= kPackets / 10 - 1);
+        ASSERT(st.target_delay_us < 100000);
+    }
+    TEST_END();
+
+    TEST("MemoryGovernor - budget shrinks read-ahead, then queues, then frames");
+    {
+        using streaming::common::MemoryClass;
+        constexpr uint64_t MB = 1ULL << 20;
+        streaming::common::MemoryGovernor gov(200 * MB);
+        auto fb = gov.registerPool("framebuffers", MemoryClass::FIXED, 24 * MB, 24 * MB);
+        auto frames = gov.registerPool("frames", MemoryClass::FRAMES, 64 * MB, 24 * MB);
+        auto packets = gov.registerPool("packets", MemoryClass::QUEUE, 16 * MB, 2 * MB);
+        auto ahead = gov.registerPool("read-ahead", MemoryClass::READ_AHEAD, 60 * MB, 10 * MB);
+        ASSERT(frames.getLimit() == 64 * MB && ahead.getLimit() == 60 * MB);
+        ASSERT(!gov.getStats().under_pressure);
+
+        /* 4K mode change: framebuffers grow to 3 x 33 MB; read-ahead gives first */
+        fb.setDemand(99 * MB, 99 * MB);
+        auto st = gov.getStats();
+        ASSERT(st.under_pressure && st.pressure_events == 1);
+        ASSERT(ahead.getLimit() == 21 * MB);                /* 200 - 99 - 64 - 16 */
+        ASSERT(packets.getLimit() == 16 * MB && frames.getLimit() == 64 * MB);
+
+        /* An app takes memory: read-ahead hits its floor, then queues, then frames */
+        gov.setBudget(150 * MB);
+        ASSERT(ahead.getLimit() == 10 * MB);
+        ASSERT(packets.getLimit() == 2 * MB);
+        ASSERT(frames.getLimit() == 39 * MB);              /* 150 - 99 - 10 - 2 */
+        ASSERT(gov.getStats().pressure_events == 1);       /* Still the same episode */
+
+        /* Usage is reported per pool */
+        frames.setUsage(30 * MB);
+        packets.setUsage(1 * MB);
+        frames.setUsage(20 * MB);
+        st = gov.getStats();
+        ASSERT(st.used == 21 * MB && st.peak == 31 * MB);
+        ASSERT(st.pools.size() == 4 && st.pools[1].name == "frames" && st.pools[1].peak == 30 * MB);
+        ASSERT(st.pools[0].limit == 99 * MB);               /* Fixed pools show their demand */
+
+        /* Leaving pools give their share back; pressure ends */
+        {
+            auto moved = std::move(ahead);
+            ASSERT(!ahead.valid() && moved.valid());
+        }
+        gov.setBudget(300 * MB);
+        st = gov.getStats();
+        ASSERT(!st.under_pressure && st.pools.size() == 3);
+        ASSERT(frames.getLimit() == 64 * MB && packets.getLimit() == 16 * MB);
+
+        /* FramePool: fewer buffers circulate under a limit, never fewer than three */
+        streaming::common::MemoryGovernor small(40 * MB);
+        streaming::media::FramePool pool(8, small);
+        std::vector<streaming::media::DecodedFrame> held(8);
+        for (int i = 0; i < 4; ++i)
+            ASSERT(pool.acquire(8 * MB, held[i]) == streaming::device::Result::OK);
+        ASSERT(pool.getUsableBuffers() == 5);               /* 40 MB / 8 MB */
+        ASSERT(pool.acquire(8 * MB, held[4]) == streaming::device::Result::OK);
+        ASSERT(pool.acquire(8 * MB, held[5]) == streaming::device::Result::ERROR_BUSY);
+        small.setBudget(16 * MB);                           /* Below the pool's floor: it gets the floor */
+        ASSERT(small.getStats().pools[0].limit == 24 * MB);
+        ASSERT(pool.getUsableBuffers() == streaming::media::FramePool::kMinBuffers);
+        for (int i = 0; i < 3; ++i) pool.release(held[i].handle);
+        ASSERT(pool.getAllocatedBytes() == 24 * MB);        /* Freed down to the limit as they return */
+        ASSERT(small.getStats().pools[0].used == 24 * MB);
+        ASSERT(pool.acquire(8 * MB, held[0]) == streaming::device::Result::OK);
+        ASSERT(pool.acquire(8 * MB, held[1]) == streaming::device::Result::ERROR_BUSY);
+    }
+    TEST_END();
+
+    TEST("StreamPipeline - threaded demux/decode/present");
+    {
+        auto threaded = streaming::services::createStreamPipeline(*display);
+        threaded->initialize();
+        ASSERT(threaded->open("movie.mkv") == streaming::device::Result::OK);
+        ASSERT(threaded->play() == streaming::device::Result::OK);
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        auto st = threaded->getStats();
+        ASSERT(st.demux.items > 0);
+        ASSERT(st.decode.items > 0);
+        ASSERT(st.present.items > 0);
+        ASSERT(st.cadence.frames_presented > 0);
+        ASSERT(st.video.frames_scanned_out > 0);
+        ASSERT(st.video.bytes_copied == 0);
+        /* Bounded queues: decode is throttled by presentation, not racing ahead */
+        ASSERT(st.decode.queue_high_water <= 4);
+        ASSERT(st.decode.items < 40);
+        ASSERT(st.decode.stall_us > 0);
+        /* Audio branch: decoded AAC reaches the HAL in ~100 ms batches */
+        ASSERT(st.audio.items > 0);
+        ASSERT(st.audio_out.writes > 0);
+        ASSERT(st.audio_out.bytes / st.audio_out.writes >= 48000 * 4 / 10);
+        /* Sink drains whole periods from the ring; decode keeps it topped up */
+        ASSERT(st.sink.items == st.audio_out.writes);
+        ASSERT(st.audio_out.ring_capacity_periods == 8);
+        ASSERT(st.audio_out.sink_sample_rate == 48000 && !st.audio_out.converted);   /* HDMI takes AAC PCM as is */
+        ASSERT(st.audio_out.ring_high_water > 0);
+        ASSERT(st.audio_out.underruns == 0);
+        ASSERT(st.clock.audio_updates > 0);
+        ASSERT(std::llabs(st.clock.av_offset_us) <= 20000);
+        ASSERT(st.clock.output_latency_us == 20000);   /* HDMI */
+
+        /* Live switch to A2DP: same 48 kHz stereo path, video re-timed by the headset latency */
+        const uint64_t writes = st.audio_out.writes;
+        ASSERT(threaded->setAudioSink(streaming::hal::AudioSink::BLUETOOTH_A2DP) == streaming::device::Result::OK);
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        st = threaded->getStats();
+        ASSERT(st.clock.output_latency_us == 200000);
+        ASSERT(st.clock.resyncs >= 1);                 /* 180 ms step is snapped, not slewed */
+        ASSERT(std::llabs(st.clock.av_offset_us) <= 20000);
+        ASSERT(st.audio_out.writes > writes && !st.audio_out.converted);
+        ASSERT(st.audio_out.underruns == 0);
+
+        /* Barrier seek lands on the keyframe before the target */
+        ASSERT(threaded->seek(5000000) == streaming::device::Result::OK);
+        std::this_thread::sleep_for(std::chrono::milliseconds(400));   /* First frame waits out the 200 ms A2DP delay */
+        const int64_t pts = threaded->getCurrentPts();
+        ASSERT(pts >= 4000000 && pts < 5000000);
+
+        ASSERT(threaded->pause() == streaming::device::Result::OK);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        const int64_t frozen = threaded->getCurrentPts();
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        ASSERT(threaded->getCurrentPts() == frozen);
+        ASSERT(threaded->stop() == streaming::device::Result::OK);
+        threaded->shutdown();
+    }
+    TEST_END();
+
+    TEST("StreamPipeline - OSD overlay composited over presented frames");
+    {
+        using streaming::device::Result;
+        auto op = streaming::services::createStreamPipeline(*display);
+        op->initialize();
+        ASSERT(op->open("movie.mkv") == Result::OK);
+        /* A 1080p OSD with one opaque 16-row banner on top, transparent elsewhere */
+        auto osd = std::make_shared<streaming::media::OverlayImage>();
+        osd->width = 1920;
+        osd->height = 1080;
+        osd->pixels.assign(1920u * 1080u * 4u, 0);
+        for (size_t i = 3; i < 1920u * 16u * 4u; i += 4) osd->pixels[i] = 255;
+        op->setOverlay(osd);
+        ASSERT(op->play() == Result::OK);
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        auto st = op->getStats();
+        /* Per frame: 30 banner tiles copied, the other 67 tile rows skipped */
+        ASSERT(st.overlay.tiles_copied >= 30 && st.overlay.tiles_copied % 30 == 0);
+        ASSERT(st.overlay.tiles_skipped == st.overlay.tiles_copied * 67);
+        ASSERT(st.overlay.tiles_blended == 0);
+
+        /* Removed, or malformed: frames are shown as decoded */
+        op->setOverlay(nullptr);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        uint64_t copied = op->getStats().overlay.tiles_copied;
+        auto bad = std::make_shared<streaming::media::OverlayImage>();
+        bad->width = 1280;
+        bad->height = 720;
+        bad->pixels.assign(16, 255);
+        op->setOverlay(bad);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        st = op->getStats();
+        ASSERT(st.overlay.tiles_copied == copied && st.cadence.frames_presented > 0);
+        ASSERT(st.overlay.layers_rejected == 1 && st.overlay.layers_scaled == 0);
+
+        /* Another size: scaled to the frame once, then blended every frame */
+        auto small = std::make_shared<streaming::media::OverlayImage>();
+        small->width = 1280;
+        small->height = 720;
+        small->pixels.assign(1280u * 720u * 4u, 255);
+        op->setOverlay(small);
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        st = op->getStats();
+        ASSERT(st.overlay.layers_scaled == 1);
+        /* Fully opaque at 1080p: 30 x 68 tiles copied per frame */
+        ASSERT(st.overlay.tiles_copied - copied >= 2 * 30 * 68);
+        ASSERT((st.overlay.tiles_copied - copied) % (30 * 68) == 0);
+        ASSERT(op->stop() == Result::OK);
+        op->shutdown();
+    }
+    TEST_END();
+
+    TEST("StreamPipeline - exact seek and coalesced scrubbing");
+    {
+        auto sp = streaming::services::createStreamPipeline(*display);
+        sp->initialize();
+        ASSERT(sp->open("movie.mkv") == streaming::device::Result::OK);
+        ASSERT(sp->play() == streaming::device::Result::OK);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+        /* Remote scrub: 30 seeks in a burst; the UI sees the latest target at once */
+        for (int64_t t = 10; t < 40; ++t) ASSERT(sp->seek(t * 1000000) == streaming::device::Result::OK);
+        ASSERT(sp->getCurrentPts() == 39000000);
+        ASSERT(sp->seek(-1) == streaming::device::Result::ERROR_INVALID_PARAM);
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        auto st = sp->getStats();
+        ASSERT(st.seek.requested == 30);
+        ASSERT(st.seek.executed <= 3);
+        ASSERT(st.seek.executed + st.seek.coalesced == 30);
+        int64_t pts = sp->getCurrentPts();
+        ASSERT(pts >= 38000000 && pts < 39000000);   /* Keyframe snap */
+
+        /* Exact: frames between the keyframe and the target are decoded and dropped */
+        ASSERT(sp->seek(45500000, streaming::media::SeekMode::EXACT) == streaming::device::Result::OK);
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        pts = sp->getCurrentPts();
+        ASSERT(pts >= 45500000 && pts < 46000000);
+        st = sp->getStats();
+        ASSERT(st.seek.discarded_frames >= 36);      /* 44 s keyframe to 45.5 s at 24 fps */
+        ASSERT(st.audio_out.underruns == 0);
+        ASSERT(sp->getState() == streaming::services::PipelineState::PLAYING);
+        ASSERT(sp->stop() == streaming::device::Result::OK);
+        sp->shutdown();
+    }
+    TEST_END();
+
+    TEST("StreamPipeline - trick play decodes keyframes only");
+    {
+        auto tp = streaming::services::createStreamPipeline(*display);
+        tp->initialize();
+        ASSERT(tp->open("movie.mkv") == streaming::device::Result::OK);
+        ASSERT(tp->play() == streaming::device::Result::OK);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        ASSERT(tp->setPlaybackRate(0) == streaming::device::Result::ERROR_INVALID_PARAM);
+        ASSERT(tp->setPlaybackRate(-1) == streaming::device::Result::ERROR_INVALID_PARAM);
+        ASSERT(tp->setPlaybackRate(64) == streaming::device::Result::ERROR_INVALID_PARAM);
+
+        /* 16x: ~8 s of media in half a second from four or five decoded keyframes */
+        auto st = tp->getStats();
+        const uint64_t decoded = st.decode.items;
+        const int64_t from = tp->getCurrentPts();
+        ASSERT(tp->setPlaybackRate(16) == streaming::device::Result::OK);
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        st = tp->getStats();
+        int64_t pts = tp->getCurrentPts();
+        ASSERT(st.playback_rate == 16);
+        ASSERT(pts >= from + 4000000);
+        ASSERT(pts % 2000000 == 0);                      /* Only keyframes on screen */
+        ASSERT(st.decode.items - decoded <= 12);         /* 24 fps at 16x would be 192 */
+        const uint64_t writes = st.audio_out.writes;
+
+        /* Rewind steps back keyframe by keyframe, still muted */
+        ASSERT(tp->setPlaybackRate(-8) == streaming::device::Result::OK);
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        const int64_t rewound = tp->getCurrentPts();
+        ASSERT(rewound < pts && rewound % 2000000 == 0);
+        ASSERT(tp->getStats().audio_out.writes <= writes + 1);
+
+        /* Back to 1x: audio resumes from the frame on screen */
+        ASSERT(tp->setPlaybackRate(1) == streaming::device::Result::OK);
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        st = tp->getStats();
+        ASSERT(st.playback_rate == 1);
+        ASSERT(st.audio_out.writes > writes + 1);
+        pts = tp->getCurrentPts();
+        ASSERT(pts >= rewound && pts < rewound + 1000000);
+        ASSERT(tp->stop() == streaming::device::Result::OK);
+        tp->shutdown();
+    }
+    TEST_END();
+
+    TEST("StreamPipeline - pre-rolled start and time to first frame");
+    {
+        auto pr = streaming::services::createStreamPipeline(*display);
+        pr->initialize();
+        ASSERT(pr->open("movie.mkv") == streaming::device::Result::OK);
+        auto st = pr->getStats();
+        ASSERT(st.startup.prerolled && st.startup.preroll_us > 0);
+        ASSERT(st.decode.items >= 1);                  /* First keyframe decoded while paused */
+        ASSERT(st.demux.queue_depth >= 8 || st.demux.queue_high_water >= 8);
+        ASSERT(st.startup.ttff_us == -1);                 /* Nothing on screen before play() */
+        ASSERT(pr->getCurrentPts() == 0);
+
+        /* Held frame goes out on the next vblank (16.7 ms at 60 Hz), not after a cold start */
+        ASSERT(pr->play() == streaming::device::Result::OK);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        st = pr->getStats();
+        ASSERT(st.startup.play_to_frame_us >= 0 && st.startup.play_to_frame_us < 60000);
+        ASSERT(st.startup.ttff_us >= st.startup.preroll_us);
+        ASSERT(pr->stop() == streaming::device::Result::OK);
+        pr->shutdown();
+    }
+    TEST_END();
+
+    TEST("StreamPipeline - rebuffers on a source stall and resumes");
+    {
+        auto rb = streaming::services::createStreamPipeline(*display);
+        rb->initialize();
+        std::vector<streaming::services::PipelineState> states;
+        std::vector<std::string> events;
+        std::mutex mu;
+        rb->setStatusCallback([&](streaming::services::PipelineState ps, const std::string&) {
+            std::lock_guard<std::mutex> lock(mu);
+            states.push_back(ps);
+        });
+        rb->setTelemetryCallback([&](const std::string& event, const std::string&) {
+            std::lock_guard<std::mutex> lock(mu);
+            events.push_back(event);
+        });
+        rb->setBufferWatermarks({500000, 1000000, 300000});
+        /* The source runs dry 1 s in, for 1.5 s: playback drains to the low mark and stalls */
+        streaming::drivers::mock::MockStreamConfig outage;
+        outage.stall = true;
+        streaming::drivers::mock::MockContainerParser::setStream("stall.mp4", outage);
+        ASSERT(rb->open("stall.mp4") == streaming::device::Result::OK);
+        auto st = rb->getStats();
+        ASSERT(!st.buffer.waiting && rb->getBufferProgress() == 100);
+        ASSERT(st.buffer.buffered_us >= 500000);
+        ASSERT(st.buffer.video.at(streaming::media::BufferLevel::DEMUX).bytes > 0);
+        ASSERT(st.buffer.video.at(streaming::media::BufferLevel::DECODED).duration_us > 0);
+        ASSERT(st.buffer.audio.at(streaming::media::BufferLevel::DECODED).duration_us > 0);
+        ASSERT(rb->play() == streaming::device::Result::OK);
+        ASSERT(rb->getState() == streaming::services::PipelineState::PLAYING);
+
+        auto waitFor = [&](streaming::services::PipelineState want) {
+            for (int i = 0; i < 300 && rb->getState() != want; ++i)
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            return rb->getState() == want;
+        };
+        ASSERT(waitFor(streaming::services::PipelineState::BUFFERING));
+        st = rb->getStats();
+        ASSERT(st.buffer.rebuffers == 1 && st.buffer.waiting);
+        ASSERT(st.buffer.buffered_us < 1000000);
+        ASSERT(rb->getBufferProgress() < 100);
+        /* Presentation is held: the playhead does not move while buffering */
+        const int64_t held = rb->getCurrentPts();
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if (rb->getState() == streaming::services::PipelineState::BUFFERING)
+            ASSERT(rb->getCurrentPts() == held);
+
+        ASSERT(waitFor(streaming::services::PipelineState::PLAYING));
+        st = rb->getStats();
+        ASSERT(st.buffer.rebuffers == 1 && !st.buffer.waiting);
+        ASSERT(st.buffer.rebuffer_us > 0);
+        ASSERT(rb->getBufferProgress() == 100);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        ASSERT(rb->getCurrentPts() > held);
+        {
+            std::lock_guard<std::mutex> lock(mu);
+            ASSERT(std::count(events.begin(), events.end(), "buffer_underrun") == 1);
+            ASSERT(std::count(states.begin(), states.end(), streaming::services::PipelineState::BUFFERING) >= 2);
+        }
+        ASSERT(rb->stop() == streaming::device::Result::OK);
+        rb->shutdown();
+    }
+    TEST_END();
+
+    TEST("StreamPipeline - rebuffers when segment delivery stops mid-play");
+    {
+        using streaming::device::Result;
+        using streaming::media::BufferLevel;
+        /* Half-second segments; the origin holds every one from `allowed` on */
+        std::atomic<int> allowed{4};
+        std::atomic<bool> closing{false};
+        auto loader = [&](const streaming::media::SegmentRequest& req, std::vector<uint8_t>& body) {
+            const std::string name = req.uri.substr(req.uri.find_last_of('/') + 1);
+            const int index = std::atoi(name.c_str());
+            while (index >= allowed && !closing) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            body.assign(40000, 0x5a);
+            return Result::OK;
+        };
+        std::string vod = "#EXTM3U\n#EXT-X-TARGETDURATION:1\n";
+        for (int i = 0; i < 40; ++i) vod += "#EXTINF:0.5,\n" + std::to_string(i) + ".m4s\n";
+        vod += "#EXT-X-ENDLIST\n";
+        streaming::media::Manifest m;
+        ASSERT(streaming::media::ManifestParser::parse(vod, "https://o.test/halves.m3u8", m) == Result::OK);
+        streaming::media::AbrController abr;
+        abr.setRenditions(streaming::media::ManifestParser::ladder(m));
+        streaming::media::SegmentScheduler sched(loader, abr);
+
+        auto sp = streaming::services::createStreamPipeline(*display);
+        sp->initialize();
+        std::atomic<int> buffering{0};
+        sp->setStatusCallback([&](streaming::services::PipelineState ps, const std::string&) {
+            if (ps == streaming::services::PipelineState::BUFFERING) ++buffering;
+        });
+        /* As the streaming service wires it; the audio is muxed into the video segments */
+        sp->setNetworkBufferSource([&](streaming::media::BufferOccupancy& video,
+                                       streaming::media::BufferOccupancy& audio) {
+            const auto st = sched.getStats();
+            video = {st.buffered_video_us, st.buffered_video_bytes};
+            audio = {st.buffered_video_us, 0};
+        });
+        sp->setSegmentSource(&sched);
+        sp->setBufferWatermarks({500000, 1000000, 300000});
+        ASSERT(sched.start(m, 0) == Result::OK);
+        ASSERT(sp->open("halves.mp4") == Result::OK);
+        auto st = sp->getStats();
+        ASSERT(!st.buffer.waiting && sched.getStats().popped >= 2);
+        ASSERT(sp->play() == Result::OK);
+
+        auto waitFor = [&](streaming::services::PipelineState want) {
+            for (int i = 0; i < 400 && sp->getState() != want; ++i)
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            return sp->getState() == want;
+        };
+        /* Two seconds in, the scheduler has nothing left to hand over */
+        const int before = buffering;
+        ASSERT(waitFor(streaming::services::PipelineState::BUFFERING));
+        ASSERT(buffering > before);
+        st = sp->getStats();
+        ASSERT(st.buffer.rebuffers == 1 && st.buffer.waiting);
+        ASSERT(st.buffer.video.at(BufferLevel::NETWORK).duration_us == 0);   /* Every segment was popped */
+        ASSERT(st.buffer.video.at(BufferLevel::NETWORK).bytes == 0);
+        ASSERT(sched.getStats().popped == 4);
+        ASSERT(sp->getCurrentPts() < 2000000);
+
+        allowed = 40;
+        ASSERT(waitFor(streaming::services::PipelineState::PLAYING));
+        st = sp->getStats();
+        ASSERT(st.buffer.rebuffers == 1 && !st.buffer.waiting);
+        ASSERT(sched.getStats().popped > 4);
+        closing = true;
+        ASSERT(sp->stop() == Result::OK);
+        sp->shutdown();
+        sched.stop();
+    }
+    TEST_END();
+
+    TEST("StreamPipeline - stages report to the memory governor and shrink under pressure");
+    {
+        auto& gov = streaming::common::MemoryGovernor::instance();
+        auto mp = streaming::services::createStreamPipeline(*display);
+        mp->initialize();
+        ASSERT(mp->open("movie.mp4") == streaming::device::Result::OK);
+        ASSERT(mp->play() == streaming::device::Result::OK);
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        auto pool_stats = [&gov](const std::string& name) {
+            for (const auto& p : gov.getStats().pools)
+                if (p.name == name) return p;
+            return streaming::common::MemoryPoolStats{};
+        };
+        ASSERT(pool_stats("framebuffers").used >= 3ULL * 1920 * 1080 * 4);
+        ASSERT(pool_stats("frame pool").used > 0 && pool_stats("packet queues").used > 0);
+        ASSERT(pool_stats("frame pool").limit == pool_stats("frame pool").demand);
+
+        /* Nothing left: every pool drops to its floor, playback carries on */
+        gov.setBudget(1);
+        ASSERT(gov.getStats().under_pressure);
+        const auto frames = pool_stats("frame pool");
+        ASSERT(frames.limit == frames.min && frames.limit < frames.demand);
+        const uint64_t decoded = mp->getStats().decode.items;
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        ASSERT(mp->getStats().decode.items > decoded);
+        ASSERT(pool_stats("frame pool").used <= frames.limit);
+        ASSERT(pool_stats("packet queues").used <= pool_stats("packet queues").limit + 64 * 1024);
+        ASSERT(mp->getState() == streaming::services::PipelineState::PLAYING);
+        gov.setBudget(streaming::common::MemoryGovernor::kDefaultBudgetBytes);
+        ASSERT(mp->stop() == streaming::device::Result::OK);
+        ASSERT(pool_stats("frame pool").name.empty());   /* Unregistered with the pool */
+        mp->shutdown();
+    }
+    TEST_END();
+
+    TEST("StreamingService - queueNext pre-rolls the next item and switches without a gap");
+    {
+        using streaming::device::Result;
+        using streaming::services::StreamState;
+        ModeCountingDisplay tv;
+        tv.initialize();
+        const uint32_t ui_hz = tv.getDisplayMode().refresh_rate_hz;
+        auto framebufferPools = [] {
+            size_t n = 0;
+            for (const auto& pool : streaming::common::MemoryGovernor::instance().getStats().pools)
+                n += pool.name == "framebuffers";
+            return n;
+        };
+        const size_t fb_pools = framebufferPools();
+        auto gs = streaming::services::createStreamingService(tv);
+        gs->initialize();
+        ASSERT(gs->queueNext("episode2_clip.mp4") == Result::ERROR_BUSY);   /* No session */
+        std::vector<StreamState> states;
+        std::mutex mu;
+        gs->setStatusCallback([&](StreamState s, const std::string&) {
+            std::lock_guard<std::mutex> lock(mu);
+            states.push_back(s);
+        });
+        /* Two second clips, so the first one ends during the test */
+        streaming::drivers::mock::MockStreamConfig clip;
+        clip.duration_us = 2000000;
+        for (const char* episode : {"episode1_clip.mp4", "episode2_clip.mp4", "episode3_clip.mp4"})
+            streaming::drivers::mock::MockContainerParser::setStream(episode, clip);
+        ASSERT(gs->startSession("app", "episode1_clip.mp4", "s1") == Result::OK);
+        ASSERT(tv.switches == 1 && tv.getDisplayMode().refresh_rate_hz == 24);   /* Matched to 24p */
+        size_t reported = 0;
+        {
+            std::lock_guard<std::mutex> lock(mu);
+            reported = states.size();
+        }
+        ASSERT(gs->queueNext("") == Result::ERROR_INVALID_PARAM);
+        ASSERT(gs->queueNext("episode2_clip.mp4") == Result::OK);
+        ASSERT(gs->getGaplessStats().next_content == "episode2_clip.mp4");
+
+        auto waitUntil = [&](auto done) {
+            for (int i = 0; i < 400 && !done(); ++i)
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            return done();
+        };
+        ASSERT(waitUntil([&] { return gs->getGaplessStats().next_ready; }));
+        auto gst = gs->getGaplessStats();
+        ASSERT(gst.preloaded == 1 && gst.switches == 0 && gst.last_preroll_us > 0);
+        {
+            /* Pre-rolling in the background does not disturb the reported state */
+            std::lock_guard<std::mutex> lock(mu);
+            ASSERT(states.size() == reported);
+        }
+        ASSERT(gs->getState() == StreamState::PLAYING);
+        /* The preload shares the session's outputs: no second swap chain, no mode switch */
+        ASSERT(framebufferPools() == fb_pools);
+        ASSERT(tv.switches == 1);
+
+        /* End of the first clip: the pre-rolled pipeline takes over */
+        ASSERT(waitUntil([&] { return gs->getGaplessStats().switches == 1; }));
+        ASSERT(waitUntil([&] { return gs->getGaplessStats().last_gap_us >= 0; }));
+        gst = gs->getGaplessStats();
+        ASSERT(!gst.next_ready && gst.next_content.empty());
+        ASSERT(gst.last_gap_us < 200000);
+        ASSERT(gs->getState() == StreamState::PLAYING);
+
+        /* Nothing queued when the second clip ends: the next item queued after it starts at once */
+        ASSERT(!gst.ended);
+        ASSERT(waitUntil([&] { return gs->getGaplessStats().ended; }));
+        ASSERT(gs->getGaplessStats().switches == 1);
+        ASSERT(gs->queueNext("episode3_clip.mp4") == Result::OK);
+        ASSERT(waitUntil([&] { return gs->getGaplessStats().switches == 2; }));
+        gst = gs->getGaplessStats();
+        ASSERT(!gst.ended && !gst.next_ready && gst.next_content.empty() && gst.preloaded == 2);
+        ASSERT(gs->getState() == StreamState::PLAYING);
+
+        /* A queued item is dropped when the session stops */
+        ASSERT(gs->queueNext("episode1_clip.mp4") == Result::OK);
+        ASSERT(gs->stopSession() == Result::OK);
+        gst = gs->getGaplessStats();
+        ASSERT(!gst.next_ready && gst.next_content.empty() && gst.switches == 2);
+        gs->shutdown();
+        /* Same frame rate back to back: one switch in, one restore to the UI mode */
+        ASSERT(tv.switches == 2 && tv.getDisplayMode().refresh_rate_hz == ui_hz);
+    }
+    TEST_END();
+
+    TEST("StreamPipeline - RTP live ingest with sub-second glass to glass");
+    {
+        using streaming::device::Result;
+        streaming::media::RtpLoopbackConfig sc;
+        sc.port = 47010;
+        sc.audio = true;
+        sc.gop_frames = 10;
+        sc.jitter_us = 5000;
+        sc.reorder_every = 7;
+        streaming::media::RtpLoopbackSender sender(sc);
+        ASSERT(sender.start() == Result::OK);
+
+        auto lp = streaming::services::createStreamPipeline(*display);
+        lp->initialize();
+        ASSERT(lp->open("rtp://127.0.0.1:47011?codec=vp8") == Result::ERROR_IO);
+        ASSERT(lp->open("rtp://127.0.0.1:47010?fps=50&audio=aac") == Result::OK);
+        ASSERT(lp->play() == Result::OK);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+        auto st = lp->getStats();
+        ASSERT(lp->getState() == streaming::services::PipelineState::PLAYING);
+        ASSERT(st.live.live && st.live.local_port == 47010);
+        ASSERT(st.live.frames >= 30);
+        ASSERT(st.live.frames_dropped < 10);    /* Only while waiting for the first keyframe */
+        ASSERT(st.live.video_jitter.reordered > 0 && st.live.video_jitter.lost == 0);
+        ASSERT(st.live.audio_jitter.received > 0);
+        ASSERT(st.decode.items >= 30 && st.present.items > 0);
+        ASSERT(st.live.glass_to_glass_us > 0 && st.live.glass_to_glass_max_us < 1000000);
+        ASSERT(st.live.glass_to_glass_avg_us <= st.live.glass_to_glass_max_us);
+        ASSERT(lp->seek(0) == Result::ERROR_NOT_SUPPORTED);
+        ASSERT(lp->setPlaybackRate(2) == Result::ERROR_NOT_SUPPORTED);
+        ASSERT(lp->stop() == Result::OK);
+        sender.stop();
+        ASSERT(sender.getFramesSent() >= 50);
+        ASSERT(!lp->getStats().live.live);
+        lp->shutdown();
+    }
+    TEST_END();
+
+    TEST("StreamPipeline - E-AC3 passthrough to HDMI");
+    {
+        auto pt = streaming::services::createStreamPipeline(*display);
+        pt->initialize();
+        streaming::drivers::mock::MockStreamConfig dolby;
+        dolby.audio_codec = streaming::media::AudioCodec::EAC3;
+        streaming::drivers::mock::MockContainerParser::setStream("movie_eac3.mkv", dolby);
+        ASSERT(pt->open("movie_eac3.mkv") == streaming::device::Result::OK);
+        ASSERT(pt->play() == streaming::device::Result::OK);
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        auto st = pt->getStats();
+        ASSERT(st.audio_out.passthrough && !st.audio_out.converted);
+        ASSERT(st.audio_out.sink_sample_rate == 192000 && st.audio_out.sink_channels == 2);
+        ASSERT(st.audio.items > 0);                       /* Bursts packed, nothing decoded */
+        ASSERT(st.audio_out.writes > 0);
+        ASSERT(st.audio_out.bytes == st.audio_out.writes * 6144 * 4);
+        ASSERT(st.audio_out.underruns == 0);
+        ASSERT(st.clock.audio_updates > 0);               /* Bursts still drive A/V sync */
+
+        /* A2DP cannot take the bitstream: switching decodes and downmixes instead */
+        ASSERT(pt->setAudioSink(streaming::hal::AudioSink::BLUETOOTH_A2DP) == streaming::device::Result::OK);
+        std::this_thread::sleep_for(std::chrono::milliseconds(400));
+        st = pt->getStats();
+        ASSERT(!st.audio_out.passthrough && st.audio_out.converted);
+        ASSERT(st.audio_out.sink_sample_rate == 48000 && st.audio_out.sink_channels == 2);
+        ASSERT(st.audio_out.writes > 0);
+        ASSERT(st.clock.output_latency_us == 200000);
+        ASSERT(pt->setAudioSink(streaming::hal::AudioSink::HDMI) == streaming::device::Result::OK);
+        ASSERT(pt->getStats().audio_out.passthrough);
+        ASSERT(pt->stop() == streaming::device::Result::OK);
+        pt->shutdown();
+    }
+    TEST_END();
+
     TEST("StreamPipeline - open and play");
-    auto pipeline = streaming::services::createStreamPipeline();
+    auto pipeline = streaming::services::createStreamPipeline(*display);
     pipeline->initialize();
     ASSERT(pipeline->open("video.mp4") == streaming::device::Result::OK);
     ASSERT(pipeline->play() == streaming::device::Result::OK);
     ASSERT(pipeline->getState() == streaming::services::PipelineState::PLAYING);
     ASSERT(pipeline->seek(5000000) == streaming::device::Result::OK);
     ASSERT(pipeline->stop() == streaming::device::Result::OK);
+    pipeline->shutdown();
+    /* The display belongs to the caller: it keeps running for the UI */
+    streaming::hal::VblankInfo ui_vblank;
+    ASSERT(display->waitForVblank(ui_vblank, 100) == streaming::device::Result::OK);
     TEST_END();
 }
 